@@ -66,8 +66,9 @@ class DLContext:
             self.py_type = py_type
             
     class dl_type_context_info(Structure): _fields_ = [ ('num_types', c_uint),   ('num_enums',   c_uint) ]
-    class dl_instance_info(Structure):     _fields_ = [ ('load_size', c_uint),   ('ptrsize',     c_uint), ('endian',     c_uint), ('root_type',    c_uint32) ]
-    class dl_type_info(Structure):         _fields_ = [ ('tid',       c_uint),   ('name',      c_char_p), ('size',       c_uint),  ('alignment', c_uint), ('member_count', c_uint) ]
+    class dl_instance_info(Structure):     _fields_ = [ ('load_size', c_size_t), ('ptrsize',     c_uint), ('endian',     c_uint), ('root_type',    c_uint32), ('layout_fingerprint', c_uint32) ]
+    class dl_type_info(Structure):         _fields_ = [ ('tid',       c_uint),   ('name',      c_char_p), ('comment',    c_char_p), ('size',       c_uint),  ('alignment', c_uint), ('member_count', c_uint),
+                                                    ('is_extern', c_uint, 1), ('is_union', c_uint, 1), ('should_verify', c_uint, 1), ('layout_fingerprint', c_uint32) ]
     class dl_enum_info(Structure):         _fields_ = [ ('tid',       c_uint),   ('name',      c_char_p), ('value_count', c_uint) ]
     class dl_enum_value_info(Structure):   _fields_ = [ ('name',      c_char_p), ('value',       c_uint) ]
     class dl_member_info(Structure):
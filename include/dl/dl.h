@@ -31,7 +31,6 @@ typedef struct dl_context* dl_ctx_t;
 	DL_ERROR_DYNAMIC_SIZE_TYPES_AND_NO_INSTANCE_ALLOCATOR  - DL would need to do a dynamic allocation but has no allocator.
 	DL_ERROR_TYPE_MISMATCH                                 - Expected type A but found type B.
 	DL_ERROR_TYPE_NOT_FOUND                                - Could not find a requested type. Is the correct type library loaded?
-	DL_ERROR_MEMBER_NOT_FOUND                              - Could not find a requested member of a type.
 	DL_ERROR_BUFFER_TO_SMALL                               - Provided buffer is to small.
 	DL_ERROR_ENDIAN_MISMATCH                               - Endianness of provided data is not the same as the platform's.
 	DL_ERROR_BAD_ALIGNMENT                                 - One argument has a bad alignment that will break, for example, loaded data.
@@ -43,6 +42,11 @@ typedef struct dl_context* dl_ctx_t;
 
 	DL_ERROR_UTIL_FILE_NOT_FOUND                           - An argument-file is not found.
 	DL_ERROR_UTIL_FILE_TYPE_MISMATCH                       - File type specified to read do not match file content.
+	DL_ERROR_UTIL_END_OF_STREAM                            - No more records to read from stream.
+	DL_ERROR_UTIL_IO_ERROR                                 - Reading from or writing to a file failed.
+	DL_ERROR_CHECKSUM_MISMATCH                             - The checksum stored with a packed instance do not match its data.
+	DL_ERROR_TYPE_LAYOUT_MISMATCH                          - The packed instance was stored with another layout of its type than the one in the context.
+	DL_ERROR_MEMBER_NOT_FOUND                              - Could not find a requested member of a type.
 
 	DL_ERROR_INTERNAL_ERROR                                - Internal error, contact dev!
 */
@@ -78,6 +82,11 @@ typedef enum
 
 	DL_ERROR_UTIL_FILE_NOT_FOUND,
 	DL_ERROR_UTIL_FILE_TYPE_MISMATCH,
+	DL_ERROR_UTIL_END_OF_STREAM,
+	DL_ERROR_UTIL_IO_ERROR,
+	DL_ERROR_CHECKSUM_MISMATCH,
+	DL_ERROR_TYPE_LAYOUT_MISMATCH,
+	DL_ERROR_MEMBER_NOT_FOUND,
 
 	DL_ERROR_INTERNAL_ERROR
 } dl_error_t;
@@ -276,6 +285,21 @@ dl_error_t DL_DLL_EXPORT dl_context_destroy( dl_ctx_t dl_ctx );
 */
 dl_error_t DL_DLL_EXPORT dl_context_load_type_library( dl_ctx_t dl_ctx, const unsigned char* lib_data, size_t lib_data_size );
 
+/*
+	Function: dl_context_alloc
+		Allocate memory with the alloc_func the context was created with, free it with dl_context_free.
+
+	Returns:
+		Allocated memory or 0x0 if the allocation failed.
+*/
+void* DL_DLL_EXPORT dl_context_alloc( dl_ctx_t dl_ctx, size_t size );
+
+/*
+	Function: dl_context_free
+		Free memory allocated with dl_context_alloc.
+*/
+void DL_DLL_EXPORT dl_context_free( dl_ctx_t dl_ctx, void* ptr );
+
 
 /*
 	Group: Load
@@ -296,6 +320,8 @@ dl_error_t DL_DLL_EXPORT dl_context_load_type_library( dl_ctx_t dl_ctx, const un
 
 	Note:
 		Packed instance to load is required to be in current platform endian, if not DL_ERROR_ENDIAN_ERROR will be returned.
+		Instances compressed with dl_compress are decompressed directly to instance, instance may then not overlap
+		packed_instance.
 */
 dl_error_t DL_DLL_EXPORT dl_instance_load( dl_ctx_t             dl_ctx,          dl_typeid_t type,
                                            void*                instance,        size_t instance_size,
@@ -318,11 +344,142 @@ dl_error_t DL_DLL_EXPORT dl_instance_load( dl_ctx_t             dl_ctx,
 
 	Note:
 		Some small memory-waste will be incurred by this function since some header-data will be left in memory.
+		Compressed instances can not be loaded inplace, DL_ERROR_UNSUPPORTED_OPERATION is returned.
 */
 dl_error_t DL_DLL_EXPORT dl_instance_load_inplace( dl_ctx_t       dl_ctx,          dl_typeid_t type,
 												   unsigned char* packed_instance, size_t      packed_instance_size,
 												   void**         loaded_instance, size_t*     consumed );
 
+/*
+	Enum: dl_load_flags_t
+		Flags controlling how dl_instance_load_ex and dl_instance_load_inplace_ex loads an instance.
+
+	DL_LOADFLAGS_NONE            - Load the instance the same way as dl_instance_load.
+	DL_LOADFLAGS_VERIFY_CHECKSUM - Verify the checksum stored with DL_STOREFLAGS_CHECKSUM before the instance is patched,
+	                               DL_ERROR_CHECKSUM_MISMATCH is returned if it do not match. Instances stored without
+	                               a checksum are loaded as usual.
+	DL_LOADFLAGS_VALIDATE        - Validate that all pointers, array-ranges, strings and union-types are within the
+	                               packed instance while patching it, DL_ERROR_MALFORMED_DATA is returned if not. Use this
+	                               when loading data from untrusted sources.
+*/
+typedef enum
+{
+	DL_LOADFLAGS_NONE            = 0,
+	DL_LOADFLAGS_VERIFY_CHECKSUM = 1 << 0,
+	DL_LOADFLAGS_VALIDATE        = 1 << 1,
+} dl_load_flags_t;
+
+/*
+	Struct: dl_load_params_t
+		Passed with parameters to dl_instance_load_ex and dl_instance_load_inplace_ex.
+		This struct is open to change in later versions of dl.
+
+	Members:
+		flags - combination of dl_load_flags_t.
+*/
+typedef struct dl_load_params
+{
+	unsigned int flags;
+} dl_load_params_t;
+
+/*
+	Macro: DL_LOAD_PARAMS_SET_DEFAULT
+		The preferred way to initialize dl_load_params_t, sets values so that dl_instance_load_ex
+		behaves as dl_instance_load.
+*/
+#define DL_LOAD_PARAMS_SET_DEFAULT( params ) \
+		params.flags = DL_LOADFLAGS_NONE;
+
+/*
+	Function: dl_instance_load_ex
+		Load an instance with extra parameters, see dl_instance_load.
+
+	Parameters:
+		load_params - Parameters controlling the load, see DL_LOAD_PARAMS_SET_DEFAULT. 0x0 is the same as the
+		              default parameters.
+*/
+dl_error_t DL_DLL_EXPORT dl_instance_load_ex( dl_ctx_t             dl_ctx,          dl_typeid_t type,
+                                              void*                instance,        size_t instance_size,
+                                              const unsigned char* packed_instance, size_t packed_instance_size,
+                                              size_t*              consumed,
+                                              const dl_load_params_t* load_params );
+
+/*
+	Function: dl_instance_load_inplace_ex
+		Load an instance inplace with extra parameters, see dl_instance_load_inplace.
+
+	Parameters:
+		load_params - Parameters controlling the load, see DL_LOAD_PARAMS_SET_DEFAULT. 0x0 is the same as the
+		              default parameters.
+*/
+dl_error_t DL_DLL_EXPORT dl_instance_load_inplace_ex( dl_ctx_t       dl_ctx,          dl_typeid_t type,
+													  unsigned char* packed_instance, size_t      packed_instance_size,
+													  void**         loaded_instance, size_t*     consumed,
+													  const dl_load_params_t* load_params );
+
+/*
+	Function: dl_instance_load_batch
+		Load a batch of instances stored with dl_instance_store_batch. All instances are patched together
+		and will be placed in buffer.
+
+	Parameters:
+		dl_ctx               - DL-context to use when loading instances.
+		dl_typeid            - Type of the instances in the batch.
+		buffer               - Buffer to load the instances into.
+		buffer_size          - Size of buffer, need to be at least the size of the batch minus the header.
+		packed_instance      - Packed batch to load.
+		packed_instance_size - Size of buffer pointed to by packed_instance.
+		loaded_instances     - Array where a pointer to each loaded instance will be returned.
+		max_instances        - Number of elements in loaded_instances.
+		instance_count       - Number of instances in the batch is returned here, 0x0 to ignore.
+		consumed             - Number of bytes consumed to load the batch is returned here, 0x0 to ignore.
+
+	Return:
+		DL_ERROR_OK on success, DL_ERROR_BUFFER_TO_SMALL if buffer or loaded_instances is to small and
+		DL_ERROR_UNSUPPORTED_OPERATION if packed_instance is not a batch.
+		instance_count is set as soon as the batch-header has been read so that it can be used to allocate
+		loaded_instances.
+*/
+dl_error_t DL_DLL_EXPORT dl_instance_load_batch( dl_ctx_t             dl_ctx,           dl_typeid_t   type,
+												 void*                buffer,           size_t        buffer_size,
+												 const unsigned char* packed_instance,  size_t        packed_instance_size,
+												 void**               loaded_instances, unsigned int  max_instances,
+												 unsigned int*        instance_count,   size_t*       consumed );
+
+/*
+	Function: dl_instance_load_subtree
+		Load only a part of a packed instance, the struct found at path and all data reachable from it. The subtree is
+		copied into instance as a compact, loaded instance of type subtree_type and the rest of the packed instance
+		is never read.
+
+	Parameters:
+		dl_ctx               - DL-context to use when loading.
+		type                 - Type of the root instance in the packed data.
+		packed_instance      - Packed instance in host endian, may use any ptr-size.
+		packed_instance_size - Size of buffer pointed to by packed_instance.
+		path                 - Path to the struct to load, member-names separated by '.' with an element of an array
+		                       selected as name[index], for example "regions[12].navmesh". Pointers are followed.
+		                       An empty path loads the root instance.
+		subtree_type         - Type of the struct found at path.
+		instance             - Buffer to load the subtree to, can be 0x0 if instance_size is 0.
+		instance_size        - Size of instance, pass 0 to only calculate the size needed.
+		produced_bytes       - Number of bytes needed to load the subtree is returned here, 0x0 to ignore.
+
+	Returns:
+		DL_ERROR_OK on success, DL_ERROR_MEMBER_NOT_FOUND if a member in path do not exist or a null-ptr or an unset
+		union-member is found along the path, DL_ERROR_INVALID_PARAMETER if path is malformed or an index is out of
+		bounds, DL_ERROR_TYPE_MISMATCH if the struct at path is not of subtree_type and DL_ERROR_BUFFER_TO_SMALL if
+		instance is to small.
+
+	Note:
+		The checksum of the packed instance is not verified since that would require reading all of it.
+*/
+dl_error_t DL_DLL_EXPORT dl_instance_load_subtree( dl_ctx_t             dl_ctx,          dl_typeid_t type,
+												   const unsigned char* packed_instance, size_t      packed_instance_size,
+												   const char*          path,            dl_typeid_t subtree_type,
+												   void*                instance,        size_t      instance_size,
+												   size_t*              produced_bytes );
+
 /*
 	Group: Store
 */
@@ -361,10 +518,218 @@ dl_error_t DL_DLL_EXPORT dl_instance_calc_size( dl_ctx_t dl_ctx, dl_typeid_t typ
 
 		Function can be used to calculate the amount of bytes that will be produced if storing an instance
 		by setting out_buffer_size to 0.
+
+		Pointers, strings and arrays referencing the same memory are only stored once and will still reference
+		the same memory after load.
 */
 dl_error_t DL_DLL_EXPORT dl_instance_store( dl_ctx_t       dl_ctx,     dl_typeid_t type,            const void* instance,
 											unsigned char* out_buffer, size_t      out_buffer_size, size_t*     produced_bytes );
 
+/*
+	Enum: dl_store_flags_t
+		Flags controlling how dl_instance_store_ex writes an instance.
+
+	DL_STOREFLAGS_NONE                    - Store the instance the same way as dl_instance_store.
+	DL_STOREFLAGS_INTERN_STRINGS          - Write each distinct string only once, all members referencing a string with the
+	                                        same content will point to the same data after load.
+	DL_STOREFLAGS_MERGE_IDENTICAL_SUBDATA - Write arrays and pointed to instances with identical content only once, all
+	                                        members referencing equal subdata will point to the same data after load.
+	                                        Content is compared deeply, except for pointers that are compared by address.
+	DL_STOREFLAGS_CHECKSUM                - Store a CRC32C of the instance-data in the header, it can be verified on load
+	                                        with DL_LOADFLAGS_VERIFY_CHECKSUM.
+	DL_STOREFLAGS_LAYOUT_FINGERPRINT      - Store the layout-fingerprint of the root-type, see dl_type_info_t, with the
+	                                        instance. Loading, converting or unpacking the instance with a context where
+	                                        the layout of the type differs will return DL_ERROR_TYPE_LAYOUT_MISMATCH
+	                                        without looking at the instance-data. The fingerprint is stored in 4 bytes
+	                                        after the instance-data so the instance can still be loaded by versions of
+	                                        dl that do not know about it.
+	DL_STOREFLAGS_CANONICAL               - Write all padding, alignment-gaps, unused bits of bitfields and unused bytes of
+	                                        unions as zero instead of copying them from the instance or leaving them
+	                                        as they were in out_buffer, so that instances with equal content give equal
+	                                        bytes. Subdata is always written in the order it is found when walking the
+	                                        instance member by member, independent of where it is placed in memory.
+*/
+typedef enum
+{
+	DL_STOREFLAGS_NONE                    = 0,
+	DL_STOREFLAGS_INTERN_STRINGS          = 1 << 0,
+	DL_STOREFLAGS_MERGE_IDENTICAL_SUBDATA = 1 << 1,
+	DL_STOREFLAGS_CHECKSUM                = 1 << 2,
+	DL_STOREFLAGS_LAYOUT_FINGERPRINT      = 1 << 3,
+	DL_STOREFLAGS_CANONICAL               = 1 << 4,
+} dl_store_flags_t;
+
+/*
+	Struct: dl_store_params_t
+		Passed with parameters to dl_instance_store_ex.
+		This struct is open to change in later versions of dl.
+
+	Members:
+		flags           - combination of dl_store_flags_t.
+		target_endian   - endian to store the instance in.
+		target_ptr_size - pointer-size, in bytes, to store the instance with, 4 or 8.
+*/
+typedef struct dl_store_params
+{
+	unsigned int flags;
+	dl_endian_t  target_endian;
+	unsigned int target_ptr_size;
+} dl_store_params_t;
+
+/*
+	Macro: DL_STORE_PARAMS_SET_DEFAULT
+		The preferred way to initialize dl_store_params_t, sets values so that dl_instance_store_ex
+		behaves as dl_instance_store.
+*/
+#define DL_STORE_PARAMS_SET_DEFAULT( params ) \
+		params.flags           = DL_STOREFLAGS_NONE; \
+		params.target_endian   = DL_ENDIAN_HOST; \
+		params.target_ptr_size = sizeof(void*);
+
+/*
+	Function: dl_instance_store_ex
+		Store the instances with extra parameters, see dl_instance_store.
+
+	Parameters:
+		dl_ctx          - Context to load type-library into.
+		type            - Type id for type to store.
+		instance        - Ptr to instance to store.
+		out_buffer      - Ptr to memory-area where to store the instances.
+		out_buffer_size - Size of out_buffer.
+		produced_bytes  - number of bytes that would have been written to out_buffer if it was large enough.
+		store_params    - Parameters controlling the store, see DL_STORE_PARAMS_SET_DEFAULT. 0x0 is the same
+		                  as the default parameters.
+
+	Return:
+		Same as dl_instance_store, DL_ERROR_INVALID_PARAMETER is returned if store_params->target_ptr_size is
+		not 4 or 8. DL_ERROR_UNSUPPORTED_OPERATION is returned if the instance-data is larger than 4GB and
+		store_params->target_ptr_size is 4.
+
+	Note:
+		The same store_params need to be passed when calculating the size of an instance as when storing it.
+		Instances stored with another target_endian or target_ptr_size than the host can not be loaded on this
+		platform, but they are written in one pass without the need to call dl_convert afterwards.
+		Data stored with DL_STOREFLAGS_INTERN_STRINGS or DL_STOREFLAGS_MERGE_IDENTICAL_SUBDATA shares data between members
+		and should be treated as read-only after load.
+		Instances with more than 4GB of instance-data are stored with a newer header-version that older versions
+		of dl will refuse to load, all other instances are stored as before.
+*/
+dl_error_t DL_DLL_EXPORT dl_instance_store_ex( dl_ctx_t       dl_ctx,     dl_typeid_t type,            const void* instance,
+											   unsigned char* out_buffer, size_t      out_buffer_size, size_t*     produced_bytes,
+											   const dl_store_params_t* store_params );
+
+/*
+	Function: dl_instance_store_batch
+		Store many instances of the same type in one packed buffer with one header. The type lookup and
+		store-setup is only done once and pointers, strings and arrays shared between the instances are
+		stored once.
+
+	Parameters:
+		dl_ctx          - Context to load type-library into.
+		type            - Type id for type to store.
+		instances       - Ptr to an array of instances to store.
+		instance_count  - Number of instances in instances.
+		out_buffer      - Ptr to memory-area where to store the instances.
+		out_buffer_size - Size of out_buffer.
+		produced_bytes  - number of bytes that would have been written to out_buffer if it was large enough.
+		store_params    - Parameters controlling the store, same as for dl_instance_store_ex. 0x0 is the same
+		                  as the default parameters.
+
+	Return:
+		Same as dl_instance_store_ex, DL_ERROR_UNSUPPORTED_OPERATION is also returned if the offset to any of the
+		instances is above 4GB.
+
+	Note:
+		A stored batch can only be loaded with dl_instance_load_batch, all other functions reading packed
+		instances will return DL_ERROR_UNSUPPORTED_OPERATION.
+*/
+dl_error_t DL_DLL_EXPORT dl_instance_store_batch( dl_ctx_t       dl_ctx,     dl_typeid_t type,            const void* instances, unsigned int instance_count,
+												  unsigned char* out_buffer, size_t      out_buffer_size, size_t*     produced_bytes,
+												  const dl_store_params_t* store_params );
+
+/*
+	Function: dl_instance_copy
+		Deep copy a loaded instance to a buffer in one pass. The copy is written compact, in the same way as by
+		dl_instance_store, but with all pointers already pointing into out_buffer so that it is usable directly,
+		without storing and loading it.
+
+	Parameters:
+		dl_ctx          - Context containing the type.
+		type            - Type id for type to copy.
+		instance        - Ptr to instance to copy.
+		out_buffer      - Buffer to copy the instance to, need to be aligned to the alignment of type. The copy of
+		                  instance is placed first in the buffer.
+		out_buffer_size - Size of out_buffer, pass 0 to only calculate the size needed.
+		produced_bytes  - Number of bytes that would have been written to out_buffer if it was large enough.
+
+	Returns:
+		DL_ERROR_OK on success, DL_ERROR_BUFFER_TO_SMALL if out_buffer_size is > 0 but to small for the copy.
+
+	Note:
+		Pointers, strings and arrays shared between members of instance are shared in the copy as well.
+*/
+dl_error_t DL_DLL_EXPORT dl_instance_copy( dl_ctx_t dl_ctx,     dl_typeid_t type,            const void* instance,
+										   void*    out_buffer, size_t      out_buffer_size, size_t*     produced_bytes );
+
+/*
+	Enum: dl_hash_flags_t
+		Flags used with dl_instance_hash and dl_instance_equal.
+
+	Values:
+		DL_HASHFLAGS_NONE             - Floats are compared bit by bit, i.e. -0 != 0 and NaNs are only equal if they have the same bits.
+		DL_HASHFLAGS_CANONICAL_FLOATS - -0 is treated as 0 and all NaNs as the same value.
+*/
+typedef enum
+{
+	DL_HASHFLAGS_NONE             = 0,
+	DL_HASHFLAGS_CANONICAL_FLOATS = 1 << 0,
+} dl_hash_flags_t;
+
+/*
+	Function: dl_instance_hash
+		Calculate a 64-bit hash of the content of a loaded instance, without storing it.
+
+		Members are hashed by value by walking the type-information, padding between members and unused bits of
+		bitfields are skipped and pointers, arrays and strings are followed and hashed by their content. Runs of members
+		without padding are hashed as one block.
+
+	Parameters:
+		dl_ctx   - Context containing the type.
+		type     - Type id for type to hash.
+		instance - Ptr to instance to hash.
+		flags    - Flags from dl_hash_flags_t.
+		out_hash - Ptr where to return the hash.
+
+	Returns:
+		DL_ERROR_OK on success, DL_ERROR_TYPE_NOT_FOUND if type is not in dl_ctx and DL_ERROR_OUT_OF_LIBRARY_MEMORY if
+		the table of visited pointers could not be allocated.
+
+	Note:
+		Instances that are equal according to dl_instance_equal with the same flags have the same hash. The hash is the
+		same on all platforms with the same endian, but not between endians.
+*/
+dl_error_t DL_DLL_EXPORT dl_instance_hash( dl_ctx_t dl_ctx, dl_typeid_t type, const void* instance, unsigned int flags, uint64_t* out_hash );
+
+/*
+	Function: dl_instance_equal
+		Compare the content of two loaded instances in the same way as they are hashed by dl_instance_hash.
+
+	Parameters:
+		dl_ctx    - Context containing the type.
+		type      - Type id for type of a and b.
+		a         - Ptr to first instance to compare.
+		b         - Ptr to second instance to compare.
+		flags     - Flags from dl_hash_flags_t.
+		out_equal - Ptr where to return 1 if the instances are equal, otherwise 0.
+
+	Returns:
+		Same as dl_instance_hash.
+
+	Note:
+		Pointers are compared by the instances they point to. If a and b contain pointers to the same instance from
+		several places, or cycles, they need to do so in the same places in both a and b to be equal.
+*/
+dl_error_t DL_DLL_EXPORT dl_instance_equal( dl_ctx_t dl_ctx, dl_typeid_t type, const void* a, const void* b, unsigned int flags, int* out_equal );
 
 /*
 	Group: Util
@@ -378,10 +743,11 @@ DL_DLL_EXPORT const char* dl_error_to_string( dl_error_t error );
 
 typedef struct dl_instance_info
 {
-	unsigned int load_size;
+	size_t       load_size;
 	unsigned int ptrsize;
 	dl_endian_t  endian;
 	dl_typeid_t  root_type;
+	uint32_t     layout_fingerprint; // layout-fingerprint of root_type stored with DL_STOREFLAGS_LAYOUT_FINGERPRINT, 0 if not stored or not within packed_instance_size.
 } dl_instance_info_t;
 
 /*
@@ -395,6 +761,10 @@ typedef struct dl_instance_info
 
 	Return:
 		DL_ERROR_OK on success.
+
+	Note:
+		out_info->layout_fingerprint can be compared to dl_type_info_t::layout_fingerprint to find out if the instance
+		can be loaded with a context without touching the instance-data.
 */
 dl_error_t DL_DLL_EXPORT dl_instance_get_info( const unsigned char* packed_instance, size_t packed_instance_size, dl_instance_info_t* out_info );
 
@@ -0,0 +1,329 @@
+/* copyright (c) 2010 Fredrik Kihlander, see LICENSE for more info */
+
+#ifndef DL_DL_HPP_INCLUDED
+#define DL_DL_HPP_INCLUDED
+
+/*
+	File: dl.hpp
+		Optional header-only C++11 layer on top of the dl C-api for types from headers generated by
+		dl_context_write_type_library_c_header.
+
+		dl::packed<T> and dl::loaded<T> own a packed and a loaded instance of T. They are move-only and free their
+		memory with the allocator of the context they were created with, so buffers are never copied implicitly.
+		dl::store, dl::load, dl::load_inplace and dl::convert use T::TYPE_ID so no type-ids need to be passed around
+		and the type of the instance is checked at compile time.
+
+		Example:
+		(start code)
+		dl::packed<MyType> packed;
+		dl_error_t err = dl::store( dl_ctx, my_instance, &packed );
+
+		dl::loaded<MyType> loaded;
+		err = dl::load( packed, &loaded );
+		use( loaded->member );
+
+		// reuse the memory of the packed instance.
+		err = dl::load_inplace( std::move( packed ), &loaded );
+		(end code)
+*/
+
+#include <dl/dl.h>
+#include <dl/dl_convert.h>
+
+#include <utility>
+
+namespace dl
+{
+	template <typename T> class loaded;
+
+	/*
+		Class: packed
+			Owns a packed instance of T.
+	*/
+	template <typename T>
+	class packed
+	{
+	public:
+		packed() : m_ctx( 0x0 ), m_data( 0x0 ), m_size( 0 ) {}
+
+		/*
+			Function: packed
+				Allocate size bytes with the allocator of dl_ctx, for example to read a packed instance to. Check data()
+				to see if the allocation succeeded.
+		*/
+		packed( dl_ctx_t dl_ctx, size_t size )
+			: m_ctx( dl_ctx )
+			, m_data( (unsigned char*)dl_context_alloc( dl_ctx, size ) )
+			, m_size( m_data != 0x0 ? size : 0 )
+		{}
+
+		packed( packed&& other ) : m_ctx( other.m_ctx ), m_data( other.m_data ), m_size( other.m_size )
+		{
+			other.m_data = 0x0;
+			other.m_size = 0;
+		}
+
+		packed& operator=( packed&& other )
+		{
+			if( this != &other )
+			{
+				reset();
+				m_ctx  = other.m_ctx;
+				m_data = other.m_data;
+				m_size = other.m_size;
+				other.m_data = 0x0;
+				other.m_size = 0;
+			}
+			return *this;
+		}
+
+		packed( const packed& ) = delete;
+		packed& operator=( const packed& ) = delete;
+
+		~packed() { reset(); }
+
+		// free the instance.
+		void reset()
+		{
+			if( m_data != 0x0 )
+				dl_context_free( m_ctx, m_data );
+			m_data = 0x0;
+			m_size = 0;
+		}
+
+		unsigned char*       data()       { return m_data; }
+		const unsigned char* data() const { return m_data; }
+		size_t               size() const { return m_size; }
+		dl_ctx_t             ctx()  const { return m_ctx; }
+
+		explicit operator bool() const { return m_data != 0x0; }
+
+	private:
+		template <typename U> friend dl_error_t load_inplace( packed<U>&& packed_instance, loaded<U>* out_loaded );
+
+		dl_ctx_t       m_ctx;
+		unsigned char* m_data;
+		size_t         m_size;
+	};
+
+	/*
+		Class: loaded
+			Owns a loaded instance of T.
+	*/
+	template <typename T>
+	class loaded
+	{
+	public:
+		loaded() : m_ctx( 0x0 ), m_memory( 0x0 ), m_instance( 0x0 ) {}
+
+		loaded( loaded&& other ) : m_ctx( other.m_ctx ), m_memory( other.m_memory ), m_instance( other.m_instance )
+		{
+			other.m_memory   = 0x0;
+			other.m_instance = 0x0;
+		}
+
+		loaded& operator=( loaded&& other )
+		{
+			if( this != &other )
+			{
+				reset();
+				m_ctx      = other.m_ctx;
+				m_memory   = other.m_memory;
+				m_instance = other.m_instance;
+				other.m_memory   = 0x0;
+				other.m_instance = 0x0;
+			}
+			return *this;
+		}
+
+		loaded( const loaded& ) = delete;
+		loaded& operator=( const loaded& ) = delete;
+
+		~loaded() { reset(); }
+
+		// free the instance.
+		void reset()
+		{
+			if( m_memory != 0x0 )
+				dl_context_free( m_ctx, m_memory );
+			m_memory   = 0x0;
+			m_instance = 0x0;
+		}
+
+		T*       get()              { return m_instance; }
+		const T* get()        const { return m_instance; }
+		T*       operator->()       { return m_instance; }
+		const T* operator->() const { return m_instance; }
+		T&       operator*()        { return *m_instance; }
+		const T& operator*()  const { return *m_instance; }
+		dl_ctx_t ctx()        const { return m_ctx; }
+
+		explicit operator bool() const { return m_instance != 0x0; }
+
+	private:
+		template <typename U> friend dl_error_t load( dl_ctx_t dl_ctx, const unsigned char* packed_instance, size_t packed_instance_size, loaded<U>* out_loaded );
+		template <typename U> friend dl_error_t load_inplace( packed<U>&& packed_instance, loaded<U>* out_loaded );
+		template <typename U> friend dl_error_t copy( const U& instance, dl_ctx_t dl_ctx, loaded<U>* out_loaded );
+
+		dl_ctx_t m_ctx;
+		void*    m_memory;   // memory allocated from m_ctx that m_instance is loaded to.
+		T*       m_instance;
+	};
+
+	/*
+		Function: store
+			Store instance as a packed instance, see dl_instance_store_ex.
+
+		Parameters:
+			dl_ctx       - Context to store with and to allocate the packed instance from.
+			instance     - Instance to store.
+			out_packed   - Set to the packed instance on success, left unchanged on failure.
+			store_params - Parameters passed to dl_instance_store_ex, 0x0 for the default.
+	*/
+	template <typename T>
+	dl_error_t store( dl_ctx_t dl_ctx, const T& instance, packed<T>* out_packed, const dl_store_params_t* store_params = 0x0 )
+	{
+		size_t size = 0;
+		dl_error_t err = dl_instance_store_ex( dl_ctx, T::TYPE_ID, &instance, 0x0, 0, &size, store_params );
+		if( err != DL_ERROR_OK )
+			return err;
+
+		packed<T> result( dl_ctx, size );
+		if( !result )
+			return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+
+		err = dl_instance_store_ex( dl_ctx, T::TYPE_ID, &instance, result.data(), result.size(), 0x0, store_params );
+		if( err == DL_ERROR_OK )
+			*out_packed = std::move( result );
+		return err;
+	}
+
+	/*
+		Function: load
+			Load a packed instance of T to memory allocated from dl_ctx, see dl_instance_load.
+
+		Parameters:
+			dl_ctx               - Context to load with and to allocate the loaded instance from.
+			packed_instance      - Packed instance to load, only read during the call.
+			packed_instance_size - Size of packed_instance.
+			out_loaded           - Set to the loaded instance on success, left unchanged on failure.
+	*/
+	template <typename T>
+	dl_error_t load( dl_ctx_t dl_ctx, const unsigned char* packed_instance, size_t packed_instance_size, loaded<T>* out_loaded )
+	{
+		dl_instance_info_t info;
+		dl_error_t err = dl_instance_get_info( packed_instance, packed_instance_size, &info );
+		if( err != DL_ERROR_OK )
+			return err;
+		if( info.root_type != T::TYPE_ID )
+			return DL_ERROR_TYPE_MISMATCH;
+
+		loaded<T> result;
+		result.m_ctx    = dl_ctx;
+		result.m_memory = dl_context_alloc( dl_ctx, info.load_size );
+		if( result.m_memory == 0x0 )
+			return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+
+		err = dl_instance_load( dl_ctx, T::TYPE_ID, result.m_memory, info.load_size, packed_instance, packed_instance_size, 0x0 );
+		if( err != DL_ERROR_OK )
+			return err;
+
+		result.m_instance = (T*)result.m_memory;
+		*out_loaded = std::move( result );
+		return DL_ERROR_OK;
+	}
+
+	template <typename T>
+	dl_error_t load( const packed<T>& packed_instance, loaded<T>* out_loaded )
+	{
+		return load( packed_instance.ctx(), packed_instance.data(), packed_instance.size(), out_loaded );
+	}
+
+	/*
+		Function: load_inplace
+			Load a packed instance in the memory of the packed instance, see dl_instance_load_inplace. The memory is
+			moved to out_loaded so no memory is allocated or copied.
+
+		Parameters:
+			packed_instance - Packed instance to load. Is empty after a successful load and left unchanged on failure,
+			                  however it might have been partially patched if the error was found while loading.
+			out_loaded      - Set to the loaded instance on success, left unchanged on failure.
+	*/
+	template <typename T>
+	dl_error_t load_inplace( packed<T>&& packed_instance, loaded<T>* out_loaded )
+	{
+		void* instance = 0x0;
+		dl_error_t err = dl_instance_load_inplace( packed_instance.m_ctx, T::TYPE_ID, packed_instance.m_data, packed_instance.m_size, &instance, 0x0 );
+		if( err != DL_ERROR_OK )
+			return err;
+
+		loaded<T> result;
+		result.m_ctx      = packed_instance.m_ctx;
+		result.m_memory   = packed_instance.m_data;
+		result.m_instance = (T*)instance;
+		packed_instance.m_data = 0x0;
+		packed_instance.m_size = 0;
+		*out_loaded = std::move( result );
+		return DL_ERROR_OK;
+	}
+
+	/*
+		Function: copy
+			Copy instance to memory allocated from dl_ctx, see dl_instance_copy.
+	*/
+	template <typename T>
+	dl_error_t copy( const T& instance, dl_ctx_t dl_ctx, loaded<T>* out_loaded )
+	{
+		size_t size = 0;
+		dl_error_t err = dl_instance_copy( dl_ctx, T::TYPE_ID, &instance, 0x0, 0, &size );
+		if( err != DL_ERROR_OK )
+			return err;
+
+		loaded<T> result;
+		result.m_ctx    = dl_ctx;
+		result.m_memory = dl_context_alloc( dl_ctx, size );
+		if( result.m_memory == 0x0 )
+			return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+
+		err = dl_instance_copy( dl_ctx, T::TYPE_ID, &instance, result.m_memory, size, 0x0 );
+		if( err != DL_ERROR_OK )
+			return err;
+
+		result.m_instance = (T*)result.m_memory;
+		*out_loaded = std::move( result );
+		return DL_ERROR_OK;
+	}
+
+	/*
+		Function: convert
+			Convert a packed instance to another endian and ptr-size, see dl_convert.
+
+		Parameters:
+			packed_instance - Packed instance to convert.
+			out_endian      - Endian to convert to.
+			out_ptr_size    - Size of ptrs to convert to, 4 or 8.
+			out_packed      - Set to the converted instance on success, left unchanged on failure.
+	*/
+	template <typename T>
+	dl_error_t convert( const packed<T>& packed_instance, dl_endian_t out_endian, size_t out_ptr_size, packed<T>* out_packed )
+	{
+		// dl_convert do not modify the instance when converting to another buffer.
+		unsigned char* data = const_cast<unsigned char*>( packed_instance.data() );
+
+		size_t size = 0;
+		dl_error_t err = dl_convert_calc_size( packed_instance.ctx(), T::TYPE_ID, data, packed_instance.size(), out_ptr_size, &size );
+		if( err != DL_ERROR_OK )
+			return err;
+
+		packed<T> result( packed_instance.ctx(), size );
+		if( !result )
+			return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+
+		err = dl_convert( packed_instance.ctx(), T::TYPE_ID, data, packed_instance.size(), result.data(), result.size(), out_endian, out_ptr_size, 0x0 );
+		if( err == DL_ERROR_OK )
+			*out_packed = std::move( result );
+		return err;
+	}
+}
+
+#endif // DL_DL_HPP_INCLUDED
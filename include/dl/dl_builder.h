@@ -0,0 +1,212 @@
+/* copyright (c) 2010 Fredrik Kihlander, see LICENSE for more info */
+
+#ifndef DL_DL_BUILDER_H_INCLUDED
+#define DL_DL_BUILDER_H_INCLUDED
+
+/*
+	File: dl_builder.h
+		Build a packed instance member by member without first building it as native structs.
+
+		The builder owns a growing buffer that is laid out exactly as the instance-data of the packed instance, with
+		ptrs stored as offsets in the ptr-size selected when the builder was created. Structs, strings and array-data
+		are appended to the buffer as they are created, so dl_builder_finish only has to write the header.
+
+		Members that are not set are zero, strings and ptrs are null and arrays are empty. Default-values from the
+		type-library are not applied. Members are referenced by the same handles as used by dl_cursor.h.
+
+		Array-data is reserved with room to grow and is moved to the end of the buffer if it can not grow in place.
+		Ptrs set with dl_builder_set_ptr to elements of a moved array are updated to point to the new data, but all
+		dl_builder_struct_t to elements in it are invalidated. The old data is left unused in the instance, so the
+		finished instance is larger than the same instance stored with dl_instance_store. Use dl_builder_reserve to
+		avoid this when the number of elements is known.
+
+		Example:
+		(start code)
+		dl_member_handle_t items;
+		dl_member_handle_t item_name;
+		dl_cursor_member_handle( dl_ctx, MyRoot::TYPE_ID, "items", &items );
+		dl_cursor_member_handle( dl_ctx, MyItem::TYPE_ID, "name",  &item_name );
+
+		dl_builder_t        builder;
+		dl_builder_struct_t root;
+		dl_builder_begin( dl_ctx, MyRoot::TYPE_ID, 8, &builder, &root );
+
+		unsigned int index;
+		dl_builder_push( builder, &root, items, &index );
+
+		dl_builder_struct_t item;
+		dl_builder_struct( builder, &root, items, index, &item );
+		dl_builder_set_string( builder, &item, item_name, 0, "apa" );
+
+		dl_builder_finish( builder, out_buffer, out_buffer_size, &produced_bytes );
+		dl_builder_free( builder );
+		(end code)
+*/
+
+#include <dl/dl.h>
+#include <dl/dl_cursor.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+/*
+	Handle: dl_builder_t
+		Handle to a packed instance being built.
+*/
+typedef struct dl_builder* dl_builder_t;
+
+/*
+	Struct: dl_builder_struct_t
+		Points to a struct in the instance being built, setup by dl_builder_begin or dl_builder_struct.
+*/
+typedef struct dl_builder_struct
+{
+	size_t      offset; // offset of the struct in the instance-data.
+	dl_typeid_t type;   // type of the struct.
+} dl_builder_struct_t;
+
+/*
+	Function: dl_builder_begin
+		Create a builder for an instance of type with all members unset.
+
+	Parameters:
+		dl_ctx      - Handle to valid DL-context, need to outlive the builder.
+		type        - Type of the root instance.
+		ptr_size    - Size of ptrs in the built instance, 4 or 8.
+		out_builder - Created builder, free with dl_builder_free.
+		out_root    - Root instance of the builder.
+
+	Returns:
+		DL_ERROR_OK on success, DL_ERROR_TYPE_NOT_FOUND if type is not in dl_ctx and DL_ERROR_INVALID_PARAMETER for
+		unsupported ptr_size.
+*/
+dl_error_t DL_DLL_EXPORT dl_builder_begin( dl_ctx_t dl_ctx, dl_typeid_t type, unsigned int ptr_size, dl_builder_t* out_builder, dl_builder_struct_t* out_root );
+
+/*
+	Function: dl_builder_set
+		Set a member of int-, uint-, fp-, enum- or bitfield-type or an element of an array of such types.
+
+	Parameters:
+		builder    - Builder the struct belongs to.
+		parent     - Struct with the member.
+		member     - Handle to the member.
+		index      - Index of the element to set if member is an array, 0 otherwise.
+		value      - Value to set.
+		value_size - Size of value, need to match the size of the member-type. Bitfields are set from an unsigned
+		             integer of the size of the bitfield-storage.
+
+	Returns:
+		DL_ERROR_OK on success, DL_ERROR_TYPE_MISMATCH if the member is not a member of parent, is of another type or
+		value_size do not match it and DL_ERROR_INVALID_PARAMETER if index is out of bounds. Setting a member of a union
+		makes that member the active one.
+*/
+dl_error_t DL_DLL_EXPORT dl_builder_set( dl_builder_t builder, const dl_builder_struct_t* parent, dl_member_handle_t member, unsigned int index, const void* value, size_t value_size );
+
+/*
+	Function: dl_builder_set_string
+		Set a string-member or an element of an array of strings. The string is copied into the instance.
+
+	Parameters:
+		builder - Builder the struct belongs to.
+		parent  - Struct with the member.
+		member  - Handle to the member.
+		index   - Index of the element to set if member is an array, 0 otherwise.
+		str     - String to set, 0x0 for a null string.
+
+	Returns:
+		Same as dl_builder_set and DL_ERROR_OUT_OF_LIBRARY_MEMORY if the instance could not grow.
+*/
+dl_error_t DL_DLL_EXPORT dl_builder_set_string( dl_builder_t builder, const dl_builder_struct_t* parent, dl_member_handle_t member, unsigned int index, const char* str );
+
+/*
+	Function: dl_builder_set_ptr
+		Set a ptr-member or an element of an array of ptrs to point to a struct in the instance.
+
+	Parameters:
+		builder - Builder the struct belongs to.
+		parent  - Struct with the member.
+		member  - Handle to the member.
+		index   - Index of the element to set if member is an array, 0 otherwise.
+		target  - Struct to point to, 0x0 for a null-ptr. Need to be of the type the member points to. Can be an
+		          element of an array, the ptr follows the element if the array is moved.
+
+	Returns:
+		Same as dl_builder_set_string.
+*/
+dl_error_t DL_DLL_EXPORT dl_builder_set_ptr( dl_builder_t builder, const dl_builder_struct_t* parent, dl_member_handle_t member, unsigned int index, const dl_builder_struct_t* target );
+
+/*
+	Function: dl_builder_struct
+		Get a struct-member, the struct a ptr-member points to or an element of an array of those. If the ptr is null a
+		new struct with all members unset is added to the instance and the ptr is set to point to it.
+
+	Parameters:
+		builder    - Builder the struct belongs to.
+		parent     - Struct with the member.
+		member     - Handle to the member.
+		index      - Index of the element if member is an array, 0 otherwise.
+		out_struct - The struct.
+
+	Returns:
+		Same as dl_builder_set_string.
+*/
+dl_error_t DL_DLL_EXPORT dl_builder_struct( dl_builder_t builder, const dl_builder_struct_t* parent, dl_member_handle_t member, unsigned int index, dl_builder_struct_t* out_struct );
+
+/*
+	Function: dl_builder_push
+		Add an unset element to the end of an array-member, set it with the other dl_builder_*-functions.
+
+	Parameters:
+		builder   - Builder the struct belongs to.
+		parent    - Struct with the member.
+		member    - Handle to the array-member.
+		out_index - Index of the added element, can be 0x0.
+
+	Returns:
+		Same as dl_builder_set_string.
+*/
+dl_error_t DL_DLL_EXPORT dl_builder_push( dl_builder_t builder, const dl_builder_struct_t* parent, dl_member_handle_t member, unsigned int* out_index );
+
+/*
+	Function: dl_builder_reserve
+		Reserve room for a number of elements in an array-member so that they can be pushed without moving the array.
+
+	Parameters:
+		builder  - Builder the struct belongs to.
+		parent   - Struct with the member.
+		member   - Handle to the array-member.
+		capacity - Number of elements to reserve room for, including the elements already in the array.
+
+	Returns:
+		Same as dl_builder_set_string.
+*/
+dl_error_t DL_DLL_EXPORT dl_builder_reserve( dl_builder_t builder, const dl_builder_struct_t* parent, dl_member_handle_t member, unsigned int capacity );
+
+/*
+	Function: dl_builder_finish
+		Write the built instance as a packed instance in host endian. The builder can still be used after this.
+
+	Parameters:
+		builder         - Builder to write.
+		out_buffer      - Buffer to write the packed instance to.
+		out_buffer_size - Size of out_buffer. Pass 0 to only calculate the size needed.
+		produced_bytes  - Number of bytes that would have been written to out_buffer, can be 0x0.
+
+	Returns:
+		DL_ERROR_OK on success, DL_ERROR_BUFFER_TO_SMALL if out_buffer_size is > 0 but to small and
+		DL_ERROR_UNSUPPORTED_OPERATION if the instance is to big to be stored with the ptr-size of the builder.
+*/
+dl_error_t DL_DLL_EXPORT dl_builder_finish( dl_builder_t builder, unsigned char* out_buffer, size_t out_buffer_size, size_t* produced_bytes );
+
+/*
+	Function: dl_builder_free
+		Free a builder and all memory used by it.
+*/
+dl_error_t DL_DLL_EXPORT dl_builder_free( dl_builder_t builder );
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif // DL_DL_BUILDER_H_INCLUDED
@@ -0,0 +1,123 @@
+/* copyright (c) 2010 Fredrik Kihlander, see LICENSE for more info */
+
+#ifndef DL_DL_COMPRESS_H_INCLUDED
+#define DL_DL_COMPRESS_H_INCLUDED
+
+/*
+	File: dl_compress.h
+		Exposes functionality to compress packed dl-instances with the built-in block compressor.
+
+		A compressed instance keeps the header of the packed instance, flagged as compressed, followed by
+		a block-table and the instance-data compressed in independent blocks with a fast LZ-codec. Since
+		blocks are independent they can be decompressed in parallel, directly to the final load-buffer.
+
+		dl_instance_load accepts compressed instances and decompress them directly to the instance-buffer.
+*/
+
+#include <dl/dl.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+/*
+	Struct: dl_compressed_info_t
+		Information about a compressed instance.
+
+	Members:
+		is_compressed     - 1 if the instance is compressed, 0 otherwise.
+		decompressed_size - Size of the packed instance after decompression.
+		block_size        - Size of each decompressed block, the last block may be smaller.
+		block_count       - Number of blocks that the instance-data is compressed in.
+*/
+typedef struct dl_compressed_info
+{
+	unsigned int is_compressed;
+	size_t       decompressed_size;
+	unsigned int block_size;
+	unsigned int block_count;
+} dl_compressed_info_t;
+
+/*
+	Function: dl_compress
+		Compress a packed instance.
+
+	Parameters:
+		dl_ctx               - Handle to valid DL-context.
+		packed_instance      - Packed instance to compress, may be of any endian and ptr-size.
+		packed_instance_size - Size of packed_instance.
+		out_buffer           - Buffer to write compressed instance to.
+		out_buffer_size      - Size of out_buffer. Pass 0 to only calculate the size of the compressed instance.
+		produced_bytes       - Number of bytes that would have been written to out_buffer, can be 0x0.
+
+	Returns:
+		DL_ERROR_OK on success, DL_ERROR_UNSUPPORTED_OPERATION if packed_instance is already compressed.
+*/
+dl_error_t DL_DLL_EXPORT dl_compress( dl_ctx_t             dl_ctx,
+									  const unsigned char* packed_instance, size_t  packed_instance_size,
+									  unsigned char*       out_buffer,      size_t  out_buffer_size,
+									  size_t*              produced_bytes );
+
+/*
+	Function: dl_decompress
+		Decompress a compressed instance to a packed instance.
+
+	Parameters:
+		dl_ctx          - Handle to valid DL-context.
+		compressed      - Compressed instance.
+		compressed_size - Size of compressed.
+		out_buffer      - Buffer to write packed instance to.
+		out_buffer_size - Size of out_buffer. Pass 0 to only calculate the size of the packed instance.
+		produced_bytes  - Number of bytes that would have been written to out_buffer, can be 0x0.
+
+	Returns:
+		DL_ERROR_OK on success, DL_ERROR_UNSUPPORTED_OPERATION if compressed is not compressed.
+*/
+dl_error_t DL_DLL_EXPORT dl_decompress( dl_ctx_t             dl_ctx,
+										const unsigned char* compressed, size_t compressed_size,
+										unsigned char*       out_buffer, size_t out_buffer_size,
+										size_t*              produced_bytes );
+
+/*
+	Function: dl_decompress_blocks
+		Decompress a range of blocks of a compressed instance to out_buffer. Blocks are written to the same
+		position in out_buffer as dl_decompress would write them, so many threads can decompress separate
+		ranges of blocks to the same buffer at the same time. The header of the packed instance is written by
+		the call decompressing block 0.
+
+	Parameters:
+		dl_ctx          - Handle to valid DL-context.
+		compressed      - Compressed instance.
+		compressed_size - Size of compressed.
+		out_buffer      - Buffer to write packed instance to.
+		out_buffer_size - Size of out_buffer, need to be at least decompressed_size from dl_compressed_get_info.
+		first_block     - First block to decompress.
+		block_count     - Number of blocks to decompress.
+
+	Returns:
+		DL_ERROR_OK on success.
+*/
+dl_error_t DL_DLL_EXPORT dl_decompress_blocks( dl_ctx_t             dl_ctx,
+											   const unsigned char* compressed,  size_t       compressed_size,
+											   unsigned char*       out_buffer,  size_t       out_buffer_size,
+											   unsigned int         first_block, unsigned int block_count );
+
+/*
+	Function: dl_compressed_get_info
+		Fetch information about a, possibly, compressed instance.
+
+	Parameters:
+		compressed      - Packed or compressed instance.
+		compressed_size - Size of compressed.
+		out_info        - Ptr to fill with information.
+
+	Returns:
+		DL_ERROR_OK on success.
+*/
+dl_error_t DL_DLL_EXPORT dl_compressed_get_info( const unsigned char* compressed, size_t compressed_size, dl_compressed_info_t* out_info );
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif // DL_DL_COMPRESS_H_INCLUDED
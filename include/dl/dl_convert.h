@@ -6,7 +6,7 @@
 /*
 	File: dl_convert.h
 		Exposes functionality to convert packed dl-instances between different formats
-		regarding pointer-size and endianness.
+		regarding pointer-size and endianness and between different versions of a type.
 */
 
 #include <dl/dl.h>
@@ -76,6 +76,39 @@ dl_error_t DL_DLL_EXPORT dl_convert_calc_size( dl_ctx_t       dl_ctx,          d
                                                unsigned char* packed_instance, size_t      packed_instance_size,
                                                size_t         out_ptr_size,    size_t*     out_size );
 
+/*
+	Function: dl_instance_migrate
+		Migrates a packed instance stored with one version of a type-library to the layout of the same type in
+		another version of the type-library, without unpacking it to text.
+
+	Parameters:
+		old_ctx              - Handle to valid DL-context with the type-library the instance was stored with.
+		new_ctx              - Handle to valid DL-context with the type-library to migrate the instance to.
+		type                 - DL-type expected to be found in packed instance.
+		packed_instance      - Ptr to memory-area where packed instance is to be found.
+		packed_instance_size - Size of packed_instance.
+		out_instance         - Ptr to memory-area where to place the migrated instance, may not overlap packed_instance.
+		out_instance_size    - Size of out_instance, pass 0 to only calculate the size of the migrated instance.
+		produced_bytes       - Ptr where size of migrated instance will be returned. Can be set to 0x0.
+
+	Note:
+		Members are matched by name between the old and new version of each type, members that are only in the old
+		version are dropped and members that are only in the new version get their default value. Numeric members,
+		and arrays of numbers, are converted if their type has changed, for example from int16 to int64 or from int32
+		to fp64, values that do not fit the new type are converted as by a C-cast. Inline arrays that grow get their
+		new elements set to 0.
+		The migrated instance is stored in the current platforms endian and pointer-size. The packed instance is
+		required to be in the current platforms endian and can not be compressed or a batch.
+
+	Return:
+		DL_ERROR_OK on success. DL_ERROR_TYPE_MISMATCH is returned if a member has changed to an incompatible type or
+		if a member is added without default value. DL_ERROR_BUFFER_TO_SMALL if out_instance is to small.
+*/
+dl_error_t DL_DLL_EXPORT dl_instance_migrate( dl_ctx_t             old_ctx,         dl_ctx_t    new_ctx,           dl_typeid_t type,
+                                              const unsigned char* packed_instance, size_t      packed_instance_size,
+                                              unsigned char*       out_instance,    size_t      out_instance_size,
+                                              size_t*              produced_bytes );
+
 #ifdef __cplusplus
 }
 #endif  // __cplusplus
@@ -0,0 +1,165 @@
+/* copyright (c) 2010 Fredrik Kihlander, see LICENSE for more info */
+
+#ifndef DL_DL_CURSOR_H_INCLUDED
+#define DL_DL_CURSOR_H_INCLUDED
+
+/*
+	File: dl_cursor.h
+		Read-only access to single members of a packed instance without loading it.
+
+		A cursor points to a struct in the packed buffer and member-values are read directly from the buffer,
+		resolving offsets as they are followed. The buffer is never modified or copied, so reading a few members of a
+		large instance only cost the data that is actually touched. All offsets are validated against the size of the
+		buffer before being followed.
+
+		Example:
+		(start code)
+		dl_member_handle_t items;
+		dl_member_handle_t item_id;
+		dl_cursor_member_handle( dl_ctx, MyRoot::TYPE_ID, "items", &items );
+		dl_cursor_member_handle( dl_ctx, MyItem::TYPE_ID, "id",    &item_id );
+
+		dl_cursor_t root;
+		dl_cursor_init( dl_ctx, MyRoot::TYPE_ID, packed, packed_size, &root );
+
+		unsigned int item_count;
+		dl_cursor_array_count( &root, items, &item_count );
+
+		dl_cursor_t item;
+		dl_cursor_struct( &root, items, item_count - 1, &item );
+
+		uint32_t id;
+		dl_cursor_read( &item, item_id, 0, &id, sizeof(id) );
+		(end code)
+*/
+
+#include <dl/dl.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+/*
+	Struct: dl_member_handle_t
+		Handle to a member of a type, resolved once by name with dl_cursor_member_handle.
+*/
+typedef struct dl_member_handle
+{
+	dl_typeid_t  type;
+	unsigned int member_index;
+} dl_member_handle_t;
+
+/*
+	Struct: dl_cursor_t
+		Points to a struct in a packed instance, setup by dl_cursor_init or by following a member of another cursor.
+		Should be treated as opaque except for data that is 0x0 for cursors pointing to a null-ptr.
+*/
+typedef struct dl_cursor
+{
+	dl_ctx_t             ctx;
+	const unsigned char* data;      // instance-data of the packed instance, i.e. the data following the header.
+	size_t               data_size;
+	size_t               offset;    // offset of the struct in data.
+	dl_typeid_t          type;      // type of the struct.
+	unsigned int         ptr_size;  // size of ptrs in the packed instance, 4 or 8.
+} dl_cursor_t;
+
+/*
+	Function: dl_cursor_init
+		Setup a cursor pointing to the root instance of a packed instance.
+
+	Parameters:
+		dl_ctx               - Handle to valid DL-context.
+		type                 - Type expected to be stored in packed_instance.
+		packed_instance      - Packed instance in host endian, may use any ptr-size. Need to outlive the cursor.
+		packed_instance_size - Size of packed_instance.
+		out_cursor           - Cursor to setup.
+
+	Returns:
+		DL_ERROR_OK on success, DL_ERROR_ENDIAN_MISMATCH if the instance is not in host endian and
+		DL_ERROR_UNSUPPORTED_OPERATION for compressed or batch-stored instances.
+*/
+dl_error_t DL_DLL_EXPORT dl_cursor_init( dl_ctx_t             dl_ctx,          dl_typeid_t type,
+										 const unsigned char* packed_instance, size_t      packed_instance_size,
+										 dl_cursor_t*         out_cursor );
+
+/*
+	Function: dl_cursor_member_handle
+		Resolve a member of a type by name to a handle to use with the other dl_cursor_*-functions.
+
+	Parameters:
+		dl_ctx      - Handle to valid DL-context.
+		type        - Type the member is a member of.
+		member_name - Name of the member.
+		out_handle  - Handle to the member.
+
+	Returns:
+		DL_ERROR_OK on success, DL_ERROR_TYPE_NOT_FOUND or DL_ERROR_MEMBER_NOT_FOUND if type or member do not exist.
+*/
+dl_error_t DL_DLL_EXPORT dl_cursor_member_handle( dl_ctx_t dl_ctx, dl_typeid_t type, const char* member_name, dl_member_handle_t* out_handle );
+
+/*
+	Function: dl_cursor_array_count
+		Get the number of elements in an array or inline-array member.
+
+	Parameters:
+		cursor    - Cursor to a struct with the member.
+		member    - Handle to the member.
+		out_count - Number of elements in the array.
+*/
+dl_error_t DL_DLL_EXPORT dl_cursor_array_count( const dl_cursor_t* cursor, dl_member_handle_t member, unsigned int* out_count );
+
+/*
+	Function: dl_cursor_read
+		Read the value of a member of int-, uint-, fp-, enum- or bitfield-type or an element of an array of such types.
+
+	Parameters:
+		cursor         - Cursor to a struct with the member.
+		member         - Handle to the member.
+		index          - Index of the element to read if member is an array, 0 otherwise.
+		out_value      - Buffer to read the value to.
+		out_value_size - Size of out_value, need to match the size of the member-type. Bitfields are read as an unsigned
+		                 integer of size 1, 2, 4 or 8.
+
+	Returns:
+		DL_ERROR_OK on success, DL_ERROR_TYPE_MISMATCH if the member is of another type or out_value_size do not match it,
+		DL_ERROR_INVALID_PARAMETER if index is out of bounds and DL_ERROR_MEMBER_NOT_FOUND if the member is a member of
+		a union that is not set.
+*/
+dl_error_t DL_DLL_EXPORT dl_cursor_read( const dl_cursor_t* cursor, dl_member_handle_t member, unsigned int index, void* out_value, size_t out_value_size );
+
+/*
+	Function: dl_cursor_read_string
+		Read a string-member or an element of an array of strings.
+
+	Parameters:
+		cursor  - Cursor to a struct with the member.
+		member  - Handle to the member.
+		index   - Index of the element to read if member is an array, 0 otherwise.
+		out_str - Set to the string inside the packed instance or 0x0 for a null string.
+
+	Returns:
+		Same as dl_cursor_read.
+*/
+dl_error_t DL_DLL_EXPORT dl_cursor_read_string( const dl_cursor_t* cursor, dl_member_handle_t member, unsigned int index, const char** out_str );
+
+/*
+	Function: dl_cursor_struct
+		Get a cursor to a struct-member, the struct a ptr-member points to or an element of an array of those.
+
+	Parameters:
+		cursor     - Cursor to a struct with the member.
+		member     - Handle to the member.
+		index      - Index of the element if member is an array, 0 otherwise.
+		out_cursor - Cursor to the struct, out_cursor->data is set to 0x0 if the member is a null-ptr.
+
+	Returns:
+		Same as dl_cursor_read.
+*/
+dl_error_t DL_DLL_EXPORT dl_cursor_struct( const dl_cursor_t* cursor, dl_member_handle_t member, unsigned int index, dl_cursor_t* out_cursor );
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif // DL_DL_CURSOR_H_INCLUDED
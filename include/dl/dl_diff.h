@@ -0,0 +1,102 @@
+/* copyright (c) 2010 Fredrik Kihlander, see LICENSE for more info */
+
+#ifndef DL_DL_DIFF_H_INCLUDED
+#define DL_DL_DIFF_H_INCLUDED
+
+/*
+	File: dl_diff.h
+		Exposes functionality to calculate the difference between two instances of a type and apply it to another
+		instance, so that an edit can be sent with a size that depends on the size of the edit instead of the size
+		of the instance.
+
+		A diff is built by walking the old and the new instance member by member and only contains the members that
+		changed. Changed values are stored as the new value, arrays of the same length as the indices and values of
+		changed elements and arrays that changed length as one splice that replaces a range of elements. Members are
+		referenced by index in the type, so a diff can be applied on platforms with another ptr-size, but need to be
+		applied with a type-library with the same layout of the type as the one it was calculated with.
+
+		If the pointers in the instance change, i.e. a pointer is set to or from null or is changed to point to
+		another instance, the diff stores the complete new instance instead.
+*/
+
+#include <dl/dl.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+/*
+	Function: dl_instance_diff
+		Calculate the difference from one loaded instance to another.
+
+	Parameters:
+		dl_ctx         - Handle to valid DL-context.
+		type           - Type id of old_instance and new_instance.
+		old_instance   - Loaded instance the diff is calculated from.
+		new_instance   - Loaded instance the diff is calculated to.
+		out_diff       - Buffer to write the diff to.
+		out_diff_size  - Size of out_diff. Pass 0 to only calculate the size of the diff.
+		produced_bytes - Number of bytes that would have been written to out_diff, can be 0x0.
+
+	Returns:
+		DL_ERROR_OK on success, DL_ERROR_TYPE_NOT_FOUND if type is not in dl_ctx and DL_ERROR_BUFFER_TO_SMALL if
+		out_diff_size is > 0 but to small for the diff.
+*/
+dl_error_t DL_DLL_EXPORT dl_instance_diff( dl_ctx_t       dl_ctx,   dl_typeid_t type,          const void* old_instance, const void* new_instance,
+										   unsigned char* out_diff, size_t      out_diff_size, size_t*     produced_bytes );
+
+/*
+	Function: dl_instance_apply_diff
+		Apply a diff to a loaded instance and write the result as a new loaded instance, in the same way as by
+		dl_instance_copy. The instance is not modified.
+
+	Parameters:
+		dl_ctx            - Handle to valid DL-context.
+		type              - Type id of instance.
+		instance          - Loaded instance equal to the old instance the diff was calculated from.
+		diff              - Diff calculated with dl_instance_diff.
+		diff_size         - Size of diff.
+		out_instance      - Buffer to write the result to, need to be aligned to the alignment of type.
+		out_instance_size - Size of out_instance. Pass 0 to only calculate the size needed.
+		produced_bytes    - Number of bytes that would have been written to out_instance, can be 0x0.
+
+	Returns:
+		DL_ERROR_OK on success, DL_ERROR_TYPE_MISMATCH if the diff was calculated for another type,
+		DL_ERROR_ENDIAN_MISMATCH if it was calculated on a platform with another endian, DL_ERROR_MALFORMED_DATA if the
+		diff is malformed or do not match instance and DL_ERROR_BUFFER_TO_SMALL if out_instance_size is > 0 but to
+		small for the result.
+*/
+dl_error_t DL_DLL_EXPORT dl_instance_apply_diff( dl_ctx_t    dl_ctx,       dl_typeid_t          type,
+												 const void* instance,     const unsigned char* diff,              size_t  diff_size,
+												 void*       out_instance, size_t               out_instance_size, size_t* produced_bytes );
+
+/*
+	Function: dl_instance_apply_diff_packed
+		Apply a diff to a packed instance and write the result as a new packed instance.
+
+	Parameters:
+		dl_ctx               - Handle to valid DL-context.
+		type                 - Type id of packed_instance.
+		packed_instance      - Packed instance in host endian and ptr-size, equal to the old instance the diff was
+		                       calculated from.
+		packed_instance_size - Size of packed_instance.
+		diff                 - Diff calculated with dl_instance_diff.
+		diff_size            - Size of diff.
+		out_buffer           - Buffer to write the packed result to.
+		out_buffer_size      - Size of out_buffer. Pass 0 to only calculate the size needed.
+		produced_bytes       - Number of bytes that would have been written to out_buffer, can be 0x0.
+
+	Returns:
+		Same as dl_instance_apply_diff and the errors returned by dl_instance_load for packed_instance.
+*/
+dl_error_t DL_DLL_EXPORT dl_instance_apply_diff_packed( dl_ctx_t             dl_ctx,          dl_typeid_t          type,
+														const unsigned char* packed_instance, size_t               packed_instance_size,
+														const unsigned char* diff,            size_t               diff_size,
+														unsigned char*       out_buffer,      size_t               out_buffer_size,
+														size_t*              produced_bytes );
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif // DL_DL_DIFF_H_INCLUDED
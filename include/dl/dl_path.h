@@ -0,0 +1,144 @@
+/* copyright (c) 2010 Fredrik Kihlander, see LICENSE for more info */
+
+#ifndef DL_DL_PATH_H_INCLUDED
+#define DL_DL_PATH_H_INCLUDED
+
+/*
+	File: dl_path.h
+		Get and set members of loaded or packed instances by path, such as "a.b[3].c".
+
+		A path is resolved against the type-information once by dl_path_compile and can then be evaluated against any
+		number of instances of the root type without looking up any names. Evaluating a path costs one step per
+		member in the path.
+
+		Example:
+		(start code)
+		dl_path_t health;
+		dl_path_compile( dl_ctx, MyRoot::TYPE_ID, "units[3].stats.health", &health );
+
+		float value;
+		dl_path_get( health, my_loaded_root, &value, sizeof(value) );
+		value += 10.0f;
+		dl_path_set( health, my_loaded_root, &value, sizeof(value) );
+
+		dl_path_free( health );
+		(end code)
+*/
+
+#include <dl/dl.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+/*
+	Handle: dl_path_t
+		Opaque handle to a compiled path.
+*/
+typedef struct dl_path* dl_path_t;
+
+/*
+	Function: dl_path_compile
+		Resolve a path from a root type to a member.
+
+	Parameters:
+		dl_ctx    - Handle to valid DL-context, need to outlive the compiled path.
+		root_type - Type the path starts in.
+		path      - Member-names separated by '.', with an element of an array selected as name[index]. Pointers and
+		            structs are followed by the member after them. The last member need to be of int-, uint-, fp-,
+		            enum-, bitfield- or string-type, or an element of an array of such types.
+		out_path  - Compiled path, free with dl_path_free.
+
+	Returns:
+		DL_ERROR_OK on success, DL_ERROR_INVALID_PARAMETER if path is malformed, an index is missing for an array or is out
+		of bounds of an inline array, DL_ERROR_MEMBER_NOT_FOUND if a member do not exist and DL_ERROR_TYPE_MISMATCH if a
+		member in the path can not be followed or the last member is not a value.
+*/
+dl_error_t DL_DLL_EXPORT dl_path_compile( dl_ctx_t dl_ctx, dl_typeid_t root_type, const char* path, dl_path_t* out_path );
+
+/*
+	Function: dl_path_free
+		Free a path compiled with dl_path_compile.
+*/
+dl_error_t DL_DLL_EXPORT dl_path_free( dl_path_t path );
+
+/*
+	Function: dl_path_get
+		Read the value at path in a loaded instance.
+
+	Parameters:
+		path           - Compiled path.
+		instance       - Loaded instance of the root type of path.
+		out_value      - Buffer to read the value to.
+		out_value_size - Size of out_value, need to match the size of the member-type. Bitfields are read as an unsigned
+		                 integer of size 1, 2, 4 or 8 and strings as a const char*.
+
+	Returns:
+		DL_ERROR_OK on success, DL_ERROR_TYPE_MISMATCH if out_value_size do not match the member, DL_ERROR_INVALID_PARAMETER
+		if an index is out of bounds of an array and DL_ERROR_MEMBER_NOT_FOUND if a null-ptr or a union-member that is
+		not set is found along the path.
+*/
+dl_error_t DL_DLL_EXPORT dl_path_get( dl_path_t path, const void* instance, void* out_value, size_t out_value_size );
+
+/*
+	Function: dl_path_set
+		Write the value at path in a loaded instance.
+
+	Parameters:
+		path       - Compiled path.
+		instance   - Loaded instance of the root type of path.
+		value      - Value to write, same format as for dl_path_get. Bitfields are truncated to the bits of the member.
+		             Strings are written as a const char* that is not copied and need to outlive the instance.
+		value_size - Size of value.
+
+	Returns:
+		Same as dl_path_get.
+*/
+dl_error_t DL_DLL_EXPORT dl_path_set( dl_path_t path, void* instance, const void* value, size_t value_size );
+
+/*
+	Function: dl_path_get_packed
+		Read the value at path in a packed instance without loading it.
+
+	Parameters:
+		path                 - Compiled path.
+		packed_instance      - Packed instance of the root type of path, may use any endian and ptr-size.
+		packed_instance_size - Size of packed_instance.
+		out_value            - Buffer to read the value to, returned in host endian. Strings are returned as a
+		                       const char* into packed_instance.
+		out_value_size       - Size of out_value.
+
+	Returns:
+		Same as dl_path_get, DL_ERROR_MALFORMED_DATA if an offset in packed_instance is out of bounds and
+		DL_ERROR_UNSUPPORTED_OPERATION for compressed or batch-stored instances.
+*/
+dl_error_t DL_DLL_EXPORT dl_path_get_packed( dl_path_t path, const unsigned char* packed_instance, size_t packed_instance_size,
+											 void* out_value, size_t out_value_size );
+
+/*
+	Function: dl_path_set_packed
+		Write the value at path directly in a packed instance, without loading and storing it again.
+
+	Parameters:
+		path                 - Compiled path, need to end in a member of int-, uint-, fp-, enum- or bitfield-type or
+		                       an element of an array of such types.
+		packed_instance      - Packed instance of the root type of path, may use any endian and ptr-size.
+		packed_instance_size - Size of packed_instance.
+		value                - Value to write in host endian, it is converted to the endian of packed_instance.
+		value_size           - Size of value.
+
+	Returns:
+		Same as dl_path_get_packed and DL_ERROR_TYPE_MISMATCH if path ends in a string.
+
+	Note:
+		If the instance was stored with DL_STOREFLAGS_CHECKSUM the checksum is recalculated, which reads all of the
+		instance-data.
+*/
+dl_error_t DL_DLL_EXPORT dl_path_set_packed( dl_path_t path, unsigned char* packed_instance, size_t packed_instance_size,
+											 const void* value, size_t value_size );
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif // DL_DL_PATH_H_INCLUDED
@@ -38,6 +38,7 @@ typedef struct dl_type_info
 	unsigned int is_extern : 1;
 	unsigned int is_union : 1;
 	unsigned int should_verify : 1;
+	uint32_t     layout_fingerprint; // hash of size, alignment, member-names, -types and -offsets of the type and all types reachable from it.
 } dl_type_info_t;
 
 /*
@@ -55,6 +55,34 @@ dl_error_t DL_DLL_EXPORT dl_txt_pack( dl_ctx_t dl_ctx, const char* txt_instance,
 */
 dl_error_t DL_DLL_EXPORT dl_txt_pack_calc_size( dl_ctx_t dl_ctx, const char* txt_instance, size_t* out_instance_size, dl_pack_flags_t pack_flags = DL_PACKFLAGS_NONE );
 
+/*
+	Function: dl_txt_pack_layers
+		Pack a set of txt-documents, describing the same root type, into one binary blob where later documents override
+		members set by earlier documents. Use this to pack configs built as a base document plus overrides.
+
+	Parameters:
+		dl_ctx          - Context to use.
+		txt_layers      - Array of zero-terminated strings with txt-data, ordered from lowest to highest precedence.
+		layer_count     - Number of strings in txt_layers, at most 32.
+		out_buffer      - Buffer to pack data to, can be 0x0 if out_buffer_size is 0 to only calculate packed size.
+		out_buffer_size - Size of out_buffer.
+		produced_bytes  - Number of bytes that would have been written to out_buffer if it was large enough.
+		pack_flags      - Flags to use when packing, see dl_txt_pack.
+
+	Returns:
+		DL_ERROR_OK on success, DL_ERROR_INVALID_PARAMETER if layer_count is 0 or to large and DL_ERROR_TYPE_MISMATCH if
+		the documents has different root types. Other errors are the same as for dl_txt_pack.
+
+	Note:
+		Each member is taken from the last layer that sets it, members of struct-type that are set as maps in more than one
+		layer are merged member by member in the same way. Everything else, such as arrays, strings and unions, is replaced
+		as a whole. Default-values are only used for members not set by any layer.
+		Each layer has its own "__subdata"-section and names used by pointers are only looked up in the layer they
+		are set in. Subdata only used by overridden members is ignored.
+		The instance after pack will be in current platform endian.
+*/
+dl_error_t DL_DLL_EXPORT dl_txt_pack_layers( dl_ctx_t dl_ctx, const char** txt_layers, unsigned int layer_count, unsigned char* out_buffer, size_t out_buffer_size, size_t* produced_bytes, dl_pack_flags_t pack_flags = DL_PACKFLAGS_NONE );
+
 /*
 	Function: dl_txt_unpack
 		Unpack binary packed instance to text-format.
@@ -173,6 +173,289 @@ dl_error_t DL_DLL_EXPORT dl_util_store_to_stream( dl_ctx_t    dl_ctx,     dl_typ
 									dl_endian_t out_endian, size_t              out_ptr_size,
 									const void* out_instance, dl_allocator *allocator );
 
+/*
+	Group: Stream
+		A dl-stream is a file of length-prefixed packed instances, appended one after another.
+
+		The file starts with a small stream-header and each record is a record-header with the size and root-type
+		of the instance followed by the packed instance itself, padded so that the instance-data of each packed
+		instance is 16-byte aligned within the file. Types with a larger alignment than that have to be loaded to
+		a separate buffer instead of inplace. Records are written by a buffered writer and read via an iterator
+		over the memory-mapped file so scanning a stream do not result in any syscalls or copies per record.
+*/
+
+/*
+	Struct: dl_util_stream_writer_t
+		Handle to a stream opened for appending.
+*/
+typedef struct dl_util_stream_writer* dl_util_stream_writer_t;
+
+/*
+	Struct: dl_util_stream_reader_t
+		Handle to a stream opened for reading.
+*/
+typedef struct dl_util_stream_reader* dl_util_stream_reader_t;
+
+/*
+	Struct: dl_util_stream_record_t
+		One record read from a stream.
+
+	Members:
+		type                 - Root type of the packed instance.
+		packed_instance      - Ptr to the packed instance. Points into a private (copy-on-write) mapping of the file
+		                       and can be passed directly to dl_instance_load_inplace. Valid until the reader is closed.
+		packed_instance_size - Size of packed_instance.
+		index                - Index of the record in the stream, counting from 0.
+*/
+typedef struct dl_util_stream_record
+{
+	dl_typeid_t    type;
+	unsigned char* packed_instance;
+	size_t         packed_instance_size;
+	size_t         index;
+} dl_util_stream_record_t;
+
+/*
+	Function: dl_util_stream_writer_open
+		Open a stream-file for appending, the file is created if it do not exist.
+
+	Parameters:
+		filename      - Path to file to append to.
+		buffer_size   - Number of bytes to buffer before writing to file, 0 selects a default size.
+		sync_interval - Number of appended records between each data-sync (fdatasync) of the file, 0 to only
+		                sync on dl_util_stream_writer_flush and dl_util_stream_writer_close.
+		allocator     - Allocator used for the writer. 0x0 / nullpointer is also valid and will default to
+		                using malloc (default behavior of dl).
+		out_writer    - Ptr to fill with opened writer.
+
+	Returns:
+		DL_ERROR_OK on success, DL_ERROR_UTIL_FILE_NOT_FOUND if the file could not be opened and
+		DL_ERROR_MALFORMED_DATA if the file exists but is not a dl-stream.
+*/
+dl_error_t DL_DLL_EXPORT dl_util_stream_writer_open( const char*   filename,  size_t buffer_size, unsigned int sync_interval,
+													 dl_allocator* allocator, dl_util_stream_writer_t* out_writer );
+
+/*
+	Function: dl_util_stream_writer_append
+		Append an already packed instance to the stream.
+
+	Parameters:
+		writer               - Writer to append to.
+		packed_instance      - Packed instance to append.
+		packed_instance_size - Size of packed_instance.
+
+	Returns:
+		DL_ERROR_OK on success, DL_ERROR_MALFORMED_DATA if packed_instance is not a packed instance and
+		DL_ERROR_UTIL_IO_ERROR if writing to file failed.
+*/
+dl_error_t DL_DLL_EXPORT dl_util_stream_writer_append( dl_util_stream_writer_t writer, const unsigned char* packed_instance, size_t packed_instance_size );
+
+/*
+	Function: dl_util_stream_writer_append_instance
+		Store an instance and append it to the stream. The instance is stored directly to the write-buffer if
+		it fits.
+
+	Parameters:
+		writer   - Writer to append to.
+		dl_ctx   - Context to use for operations.
+		type     - Type of instance.
+		instance - Instance to store.
+
+	Returns:
+		DL_ERROR_OK on success.
+*/
+dl_error_t DL_DLL_EXPORT dl_util_stream_writer_append_instance( dl_util_stream_writer_t writer, dl_ctx_t dl_ctx, dl_typeid_t type, const void* instance );
+
+/*
+	Function: dl_util_stream_writer_flush
+		Write all buffered records to file and sync the file to disk.
+*/
+dl_error_t DL_DLL_EXPORT dl_util_stream_writer_flush( dl_util_stream_writer_t writer );
+
+/*
+	Function: dl_util_stream_writer_close
+		Flush and close writer.
+*/
+dl_error_t DL_DLL_EXPORT dl_util_stream_writer_close( dl_util_stream_writer_t writer );
+
+/*
+	Function: dl_util_stream_reader_open
+		Open a stream-file for reading by mapping it to memory.
+
+	Parameters:
+		filename   - Path to file to read.
+		allocator  - Allocator used for the reader. 0x0 / nullpointer is also valid and will default to
+		             using malloc (default behavior of dl).
+		out_reader - Ptr to fill with opened reader.
+
+	Returns:
+		DL_ERROR_OK on success, DL_ERROR_UTIL_FILE_NOT_FOUND if the file could not be opened or mapped and
+		DL_ERROR_MALFORMED_DATA if the file is not a dl-stream.
+*/
+dl_error_t DL_DLL_EXPORT dl_util_stream_reader_open( const char* filename, dl_allocator* allocator, dl_util_stream_reader_t* out_reader );
+
+/*
+	Function: dl_util_stream_reader_next
+		Read the next record from a stream.
+
+	Parameters:
+		reader     - Reader to read from.
+		out_record - Ptr to fill with read record.
+
+	Returns:
+		DL_ERROR_OK on success, DL_ERROR_UTIL_END_OF_STREAM when there are no more records and
+		DL_ERROR_MALFORMED_DATA if the next record is broken, for example by a partially written tail.
+*/
+dl_error_t DL_DLL_EXPORT dl_util_stream_reader_next( dl_util_stream_reader_t reader, dl_util_stream_record_t* out_record );
+
+/*
+	Function: dl_util_stream_reader_build_index
+		Build a sparse index over the stream to make dl_util_stream_reader_seek fast. Only the record-headers
+		are read when building the index.
+
+	Parameters:
+		reader   - Reader to build index for.
+		interval - Store the position of every interval:th record.
+
+	Returns:
+		DL_ERROR_OK on success.
+*/
+dl_error_t DL_DLL_EXPORT dl_util_stream_reader_build_index( dl_util_stream_reader_t reader, unsigned int interval );
+
+/*
+	Function: dl_util_stream_reader_seek
+		Position reader so that the next call to dl_util_stream_reader_next returns record with index record_index.
+		Without an index the stream is walked from the current position, or from the start if record_index is
+		before the current position.
+
+	Returns:
+		DL_ERROR_OK on success, DL_ERROR_UTIL_END_OF_STREAM if the stream has fewer records.
+*/
+dl_error_t DL_DLL_EXPORT dl_util_stream_reader_seek( dl_util_stream_reader_t reader, size_t record_index );
+
+/*
+	Function: dl_util_stream_reader_close
+		Close reader and unmap the file, all records read from the reader are invalid after this call.
+*/
+void DL_DLL_EXPORT dl_util_stream_reader_close( dl_util_stream_reader_t reader );
+
+/*
+	Group: Archive
+		A dl-archive is a single file with many named packed instances.
+
+		The file starts with a header and a table of contents with name, root-type, offset and size of each packed
+		instance. The toc has a hash-table on the names so lookup by name is O(1). Each packed instance is
+		stored so that its instance-data is 16-byte aligned in the file so it can be loaded inplace directly in
+		the memory-mapped file.
+*/
+
+/*
+	Struct: dl_util_archive_t
+		Handle to an opened archive.
+*/
+typedef struct dl_util_archive* dl_util_archive_t;
+
+/*
+	Struct: dl_util_archive_entry_t
+		Information about one packed instance in an archive.
+
+	Members:
+		name                 - Name of the entry.
+		type                 - Root type of the packed instance.
+		packed_instance_size - Size of the packed instance.
+*/
+typedef struct dl_util_archive_entry
+{
+	const char*  name;
+	dl_typeid_t  type;
+	size_t       packed_instance_size;
+} dl_util_archive_entry_t;
+
+/*
+	Function: dl_util_archive_write
+		Write an archive with packed instances to file.
+
+	Parameters:
+		filename              - Path to file to write.
+		names                 - Name of each packed instance, names are required to be unique.
+		packed_instances      - Packed instances to write.
+		packed_instance_sizes - Size of each packed instance.
+		count                 - Number of packed instances.
+		out_endian            - Endian of the toc, should match the endian of the packed instances.
+
+	Returns:
+		DL_ERROR_OK on success, DL_ERROR_INVALID_PARAMETER if a name is used more than once and
+		DL_ERROR_MALFORMED_DATA if one of the packed instances is not a packed instance.
+*/
+dl_error_t DL_DLL_EXPORT dl_util_archive_write( const char*           filename,
+												const char**          names,
+												const unsigned char** packed_instances,
+												const size_t*         packed_instance_sizes,
+												unsigned int          count,
+												dl_endian_t           out_endian );
+
+/*
+	Function: dl_util_archive_open
+		Open an archive by mapping the file to memory.
+
+	Parameters:
+		filename    - Path to archive to open.
+		allocator   - Allocator used for the archive. 0x0 / nullpointer is also valid and will default to
+		              using malloc (default behavior of dl).
+		out_archive - Ptr to fill with opened archive.
+
+	Returns:
+		DL_ERROR_OK on success, DL_ERROR_UTIL_FILE_NOT_FOUND if the file could not be opened and
+		DL_ERROR_MALFORMED_DATA if the file is not a dl-archive.
+*/
+dl_error_t DL_DLL_EXPORT dl_util_archive_open( const char* filename, dl_allocator* allocator, dl_util_archive_t* out_archive );
+
+/*
+	Function: dl_util_archive_load
+		Load a named instance from an archive. The instance is loaded inplace in the mapped file so no data
+		is copied, loading the same name again will return the same instance. Compressed instances are
+		decompressed to memory allocated by the archive.
+
+	Parameters:
+		dl_ctx       - Context to use for operations.
+		archive      - Archive to load from.
+		type         - Type expected to be found in archive, set to 0 if not known.
+		name         - Name of instance to load.
+		out_instance - Ptr to fill with loaded instance, valid until the archive is closed.
+		out_type     - TypeID of loaded instance, can be set to 0x0.
+
+	Returns:
+		DL_ERROR_OK on success, DL_ERROR_UTIL_FILE_NOT_FOUND if there is no instance with the name in
+		the archive and DL_ERROR_TYPE_MISMATCH if the instance is not of type.
+*/
+dl_error_t DL_DLL_EXPORT dl_util_archive_load( dl_ctx_t          dl_ctx,
+											   dl_util_archive_t archive,
+											   dl_typeid_t       type,
+											   const char*       name,
+											   void**            out_instance,
+											   dl_typeid_t*      out_type );
+
+/*
+	Function: dl_util_archive_entry_count
+		Returns the number of packed instances in archive.
+*/
+unsigned int DL_DLL_EXPORT dl_util_archive_entry_count( dl_util_archive_t archive );
+
+/*
+	Function: dl_util_archive_get_entry
+		Fetch information about entry with index in archive, entries are in the order they were written.
+
+	Returns:
+		DL_ERROR_OK on success, DL_ERROR_INVALID_PARAMETER if index is out of range.
+*/
+dl_error_t DL_DLL_EXPORT dl_util_archive_get_entry( dl_util_archive_t archive, unsigned int index, dl_util_archive_entry_t* out_entry );
+
+/*
+	Function: dl_util_archive_close
+		Close archive and unmap the file, all instances loaded from the archive are invalid after this call.
+*/
+void DL_DLL_EXPORT dl_util_archive_close( dl_util_archive_t archive );
+
 #ifdef __cplusplus
 }
 #endif  // __cplusplus
@@ -0,0 +1,130 @@
+/* copyright (c) 2010 Fredrik Kihlander, see LICENSE for more info */
+
+#ifndef CONTAINER_HASH_TABLE_H_INCLUDED
+#define CONTAINER_HASH_TABLE_H_INCLUDED
+
+#include "../dl_alloc.h"
+#include "../dl_assert.h"
+
+#include <stdint.h>
+
+/*
+	Struct: dl_hash_table
+		Open addressing hash-table used internally in dl to find already seen data.
+		The table do not hash anything by itself, the user supplies the hash of each
+		value and a compare-functor when looking up values. This way the same table can
+		be used to lookup strings, pointers or any other data.
+
+		Memory is allocated from the supplied allocator and the table grows when it is
+		half full. T is required to be a POD-type.
+*/
+template <typename T>
+struct dl_hash_table
+{
+	struct slot
+	{
+		uint32_t hash;
+		uint32_t used;
+		T        value;
+	};
+
+	dl_allocator* alloc;
+	slot*         slots;
+	size_t        capacity; // always a power of 2 or 0.
+	size_t        count;
+
+	void init( dl_allocator* allocator )
+	{
+		alloc    = allocator;
+		slots    = 0x0;
+		capacity = 0;
+		count    = 0;
+	}
+
+	void destroy()
+	{
+		if( slots != 0x0 )
+			dl_free( alloc, slots );
+		slots    = 0x0;
+		capacity = 0;
+		count    = 0;
+	}
+
+	/*
+		Function: find
+			Find value with hash, eq( const T& ) is called for each value with the same hash to check
+			if it is equal to the value searched for.
+
+		Returns:
+			Ptr to found value or 0x0 if not found.
+	*/
+	template <typename EQ>
+	T* find( uint32_t hash, EQ& eq )
+	{
+		if( count == 0 )
+			return 0x0;
+
+		size_t mask = capacity - 1;
+		for( size_t i = hash & mask; slots[i].used; i = ( i + 1 ) & mask )
+			if( slots[i].hash == hash && eq( slots[i].value ) )
+				return &slots[i].value;
+
+		return 0x0;
+	}
+
+	/*
+		Function: insert
+			Insert value with hash, no check for duplicates is done.
+
+		Returns:
+			false if the table failed to grow.
+	*/
+	bool insert( uint32_t hash, const T& value )
+	{
+		if( ( count + 1 ) * 2 > capacity && !grow() )
+			return false;
+
+		insert_no_grow( hash, value );
+		return true;
+	}
+
+private:
+	void insert_no_grow( uint32_t hash, const T& value )
+	{
+		size_t mask = capacity - 1;
+		size_t i = hash & mask;
+		while( slots[i].used )
+			i = ( i + 1 ) & mask;
+
+		slots[i].hash  = hash;
+		slots[i].used  = 1;
+		slots[i].value = value;
+		++count;
+	}
+
+	bool grow()
+	{
+		size_t new_capacity = capacity == 0 ? 64 : capacity * 2;
+		slot*  new_slots    = (slot*)dl_alloc( alloc, new_capacity * sizeof(slot) );
+		if( new_slots == 0x0 )
+			return false;
+		memset( new_slots, 0x0, new_capacity * sizeof(slot) );
+
+		slot*  old_slots    = slots;
+		size_t old_capacity = capacity;
+
+		slots    = new_slots;
+		capacity = new_capacity;
+		count    = 0;
+
+		for( size_t i = 0; i < old_capacity; ++i )
+			if( old_slots[i].used )
+				insert_no_grow( old_slots[i].hash, old_slots[i].value );
+
+		if( old_slots != 0x0 )
+			dl_free( alloc, old_slots );
+		return true;
+	}
+};
+
+#endif // CONTAINER_HASH_TABLE_H_INCLUDED
@@ -4,6 +4,7 @@
 #include "dl_patch_ptr.h"
 
 #include "container/dl_array.h"
+#include "container/dl_hash_table.h"
 
 #include <dl/dl.h>
 
@@ -39,105 +40,585 @@ dl_error_t dl_context_destroy(dl_ctx_t dl_ctx)
 	dl_free( &dl_ctx->alloc, dl_ctx->enum_alias_descs );
 	dl_free( &dl_ctx->alloc, dl_ctx->typedata_strings );
 	dl_free( &dl_ctx->alloc, dl_ctx->default_data );
+	dl_free( &dl_ctx->alloc, dl_ctx->type_fingerprints );
+	dl_free( &dl_ctx->alloc, dl_ctx->type_default_templates );
+	dl_free( &dl_ctx->alloc, dl_ctx->default_template_data );
 	dl_free( &dl_ctx->alloc, dl_ctx );
 	return DL_ERROR_OK;
 }
 
-dl_error_t dl_instance_load( dl_ctx_t             dl_ctx,          dl_typeid_t  type_id,
-                             void*                instance,        size_t instance_size,
-                             const unsigned char* packed_instance, size_t packed_instance_size,
-                             size_t*              consumed )
+void* dl_context_alloc( dl_ctx_t dl_ctx, size_t size )
+{
+	return dl_alloc( &dl_ctx->alloc, size );
+}
+
+void dl_context_free( dl_ctx_t dl_ctx, void* ptr )
+{
+	if( ptr != 0x0 )
+		dl_free( &dl_ctx->alloc, ptr );
+}
+
+static bool dl_internal_verify_checksum( const dl_data_header* header, const uint8_t* data, const dl_load_params_t* load_params )
+{
+	if( load_params == 0x0 || ( load_params->flags & DL_LOADFLAGS_VERIFY_CHECKSUM ) == 0 )
+		return true;
+	if( ( header->flags & DL_DATA_HEADER_FLAG_CHECKSUM ) == 0 )
+		return true;
+	return dl_internal_crc32c( data, (size_t)dl_internal_header_instance_size( header ) ) == header->checksum;
+}
+
+static size_t dl_internal_validate_size( const dl_data_header* header, const dl_load_params_t* load_params )
+{
+	if( load_params == 0x0 || ( load_params->flags & DL_LOADFLAGS_VALIDATE ) == 0 )
+		return 0;
+	size_t size = (size_t)dl_internal_header_instance_size( header );
+	return size > 0 ? size : 1; // 0 would disable validation.
+}
+
+dl_error_t dl_instance_load_ex( dl_ctx_t             dl_ctx,          dl_typeid_t  type_id,
+                                void*                instance,        size_t instance_size,
+                                const unsigned char* packed_instance, size_t packed_instance_size,
+                                size_t*              consumed,
+                                const dl_load_params_t* load_params )
 {
 	dl_data_header* header = (dl_data_header*)packed_instance;
 
 	if( packed_instance_size < sizeof(dl_data_header) ) return DL_ERROR_MALFORMED_DATA;
 	if( header->id == DL_INSTANCE_ID_SWAPED )          return DL_ERROR_ENDIAN_MISMATCH;
 	if( header->id != DL_INSTANCE_ID )                 return DL_ERROR_MALFORMED_DATA;
-	if( header->version != DL_INSTANCE_VERSION )       return DL_ERROR_VERSION_MISMATCH;
+	if( !dl_internal_is_instance_version( header->version ) ) return DL_ERROR_VERSION_MISMATCH;
 	if( header->root_instance_type != type_id )        return DL_ERROR_TYPE_MISMATCH;
-	if( header->instance_size > instance_size )        return DL_ERROR_BUFFER_TO_SMALL;
+	if( header->flags & DL_DATA_HEADER_FLAG_BATCH )    return DL_ERROR_UNSUPPORTED_OPERATION;
+	if( dl_internal_header_instance_size( header ) > instance_size ) return DL_ERROR_BUFFER_TO_SMALL;
 
 	const dl_type_desc* root_type = dl_internal_find_type( dl_ctx, header->root_instance_type );
 	if( root_type == 0x0 )
 		return DL_ERROR_TYPE_NOT_FOUND;
 
+	dl_error_t err = dl_internal_check_fingerprint( dl_ctx, root_type, header, packed_instance, packed_instance_size, false );
+	if( err != DL_ERROR_OK )
+		return err;
+
 	// TODO: Temporary disabled due to CL doing some magic stuff!!!
 	// Structs allocated on qstack seems to be unaligned!!!
 	// if( !dl_internal_is_align( instance, pType->m_Alignment[DL_PTR_SIZE_HOST] ) )
 	//	return DL_ERROR_BAD_ALIGNMENT;
 
-	// TODO: memmove here is a hack, should only need memcpy but due to abuse of dl_instance_load in dl_util.cpp
-	// memmove is needed!
-	memmove( instance, packed_instance + sizeof(dl_data_header), header->instance_size );
+	size_t data_size        = (size_t)dl_internal_header_instance_size( header );
+	size_t packed_data_size = data_size;
+	size_t fingerprint_size = dl_internal_header_fingerprint_size( header );
+	if( header->flags & DL_DATA_HEADER_FLAG_COMPRESSED )
+	{
+		// decompress straight to the instance-buffer.
+		size_t data_offset = sizeof(dl_data_header) + fingerprint_size;
+		err = dl_internal_decompress_instance_data( packed_instance + data_offset, packed_instance_size - data_offset, data_size, false,
+													(uint8_t*)instance, 0, 0xFFFFFFFF, &packed_data_size );
+		if( err != DL_ERROR_OK )
+			return err;
+	}
+	else
+	{
+		if( packed_instance_size - sizeof(dl_data_header) < data_size + fingerprint_size )
+			return DL_ERROR_MALFORMED_DATA;
+
+		// TODO: memmove here is a hack, should only need memcpy but due to abuse of dl_instance_load in dl_util.cpp
+		// memmove is needed!
+		memmove( instance, packed_instance + sizeof(dl_data_header), data_size );
+	}
+
+	if( !dl_internal_verify_checksum( header, (const uint8_t*)instance, load_params ) )
+		return DL_ERROR_CHECKSUM_MISMATCH;
 
-	dl_internal_patch_instance( dl_ctx, root_type, (uint8_t*)instance, 0x0, (uintptr_t)instance );
+	err = dl_internal_patch_instance( dl_ctx, root_type, (uint8_t*)instance, 0x0, (uintptr_t)instance,
+									  ( header->flags & DL_DATA_HEADER_FLAG_SHARED_SUBDATA ) != 0,
+									  dl_internal_validate_size( header, load_params ) );
+	if( err != DL_ERROR_OK )
+		return err;
 
 	if( consumed )
-		*consumed = (size_t)header->instance_size + sizeof(dl_data_header);
+		*consumed = packed_data_size + sizeof(dl_data_header) + fingerprint_size;
 
 	return DL_ERROR_OK;
 }
 
-dl_error_t DL_DLL_EXPORT dl_instance_load_inplace( dl_ctx_t       dl_ctx,          dl_typeid_t type_id,
-												   unsigned char* packed_instance, size_t      packed_instance_size,
-												   void**         loaded_instance, size_t*     consumed)
+dl_error_t dl_instance_load( dl_ctx_t             dl_ctx,          dl_typeid_t  type_id,
+                             void*                instance,        size_t instance_size,
+                             const unsigned char* packed_instance, size_t packed_instance_size,
+                             size_t*              consumed )
+{
+	return dl_instance_load_ex( dl_ctx, type_id, instance, instance_size, packed_instance, packed_instance_size, consumed, 0x0 );
+}
+
+dl_error_t dl_instance_load_inplace_ex( dl_ctx_t       dl_ctx,          dl_typeid_t type_id,
+										unsigned char* packed_instance, size_t      packed_instance_size,
+										void**         loaded_instance, size_t*     consumed,
+										const dl_load_params_t* load_params )
 {
 	dl_data_header* header = (dl_data_header*)packed_instance;
 
 	if( packed_instance_size < sizeof(dl_data_header) ) return DL_ERROR_MALFORMED_DATA;
 	if( header->id == DL_INSTANCE_ID_SWAPED )           return DL_ERROR_ENDIAN_MISMATCH;
 	if( header->id != DL_INSTANCE_ID )                  return DL_ERROR_MALFORMED_DATA;
-	if( header->version != DL_INSTANCE_VERSION )        return DL_ERROR_VERSION_MISMATCH;
+	if( !dl_internal_is_instance_version( header->version ) ) return DL_ERROR_VERSION_MISMATCH;
 	if( header->root_instance_type != type_id )         return DL_ERROR_TYPE_MISMATCH;
+	if( header->flags & DL_DATA_HEADER_FLAG_BATCH )     return DL_ERROR_UNSUPPORTED_OPERATION;
+	if( header->flags & DL_DATA_HEADER_FLAG_COMPRESSED ) return DL_ERROR_UNSUPPORTED_OPERATION;
 
 	const dl_type_desc* type = dl_internal_find_type(dl_ctx, header->root_instance_type);
 	if( type == 0x0 )
 		return DL_ERROR_TYPE_NOT_FOUND;
 
+	dl_error_t err = dl_internal_check_fingerprint( dl_ctx, type, header, packed_instance, packed_instance_size, false );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	uint64_t data_size        = dl_internal_header_instance_size( header );
+	size_t   fingerprint_size = dl_internal_header_fingerprint_size( header );
+	if( packed_instance_size - sizeof(dl_data_header) < data_size + fingerprint_size )
+		return DL_ERROR_MALFORMED_DATA;
+
 	uint8_t* instance_ptr = packed_instance + sizeof(dl_data_header);
-	dl_internal_patch_instance( dl_ctx, type, instance_ptr, 0x0, (uintptr_t)instance_ptr );
+	if( !dl_internal_verify_checksum( header, instance_ptr, load_params ) )
+		return DL_ERROR_CHECKSUM_MISMATCH;
+
+	err = dl_internal_patch_instance( dl_ctx, type, instance_ptr, 0x0, (uintptr_t)instance_ptr,
+									  ( header->flags & DL_DATA_HEADER_FLAG_SHARED_SUBDATA ) != 0,
+									  dl_internal_validate_size( header, load_params ) );
+	if( err != DL_ERROR_OK )
+		return err;
 
 	*loaded_instance = instance_ptr;
 
 	if( consumed )
-		*consumed = header->instance_size + sizeof(dl_data_header);
+		*consumed = (size_t)data_size + sizeof(dl_data_header) + fingerprint_size;
+
+	return DL_ERROR_OK;
+}
+
+dl_error_t DL_DLL_EXPORT dl_instance_load_inplace( dl_ctx_t       dl_ctx,          dl_typeid_t type_id,
+												   unsigned char* packed_instance, size_t      packed_instance_size,
+												   void**         loaded_instance, size_t*     consumed)
+{
+	return dl_instance_load_inplace_ex( dl_ctx, type_id, packed_instance, packed_instance_size, loaded_instance, consumed, 0x0 );
+}
+
+dl_error_t dl_instance_load_batch( dl_ctx_t             dl_ctx,          dl_typeid_t   type_id,
+								   void*                buffer,          size_t        buffer_size,
+								   const unsigned char* packed_instance, size_t        packed_instance_size,
+								   void**               loaded_instances, unsigned int max_instances,
+								   unsigned int*        instance_count,  size_t*       consumed )
+{
+	dl_data_header* header = (dl_data_header*)packed_instance;
+
+	if( packed_instance_size < sizeof(dl_data_header) )  return DL_ERROR_MALFORMED_DATA;
+	if( header->id == DL_INSTANCE_ID_SWAPED )           return DL_ERROR_ENDIAN_MISMATCH;
+	if( header->id != DL_INSTANCE_ID )                  return DL_ERROR_MALFORMED_DATA;
+	if( !dl_internal_is_instance_version( header->version ) ) return DL_ERROR_VERSION_MISMATCH;
+	if( header->root_instance_type != type_id )         return DL_ERROR_TYPE_MISMATCH;
+	if( ( header->flags & DL_DATA_HEADER_FLAG_BATCH ) == 0 ) return DL_ERROR_UNSUPPORTED_OPERATION;
+	if( dl_internal_header_instance_size( header ) > buffer_size ) return DL_ERROR_BUFFER_TO_SMALL;
+
+	size_t data_size = (size_t)dl_internal_header_instance_size( header );
+	if( data_size < sizeof(uint32_t) )                  return DL_ERROR_MALFORMED_DATA;
+
+	const dl_type_desc* root_type = dl_internal_find_type( dl_ctx, header->root_instance_type );
+	if( root_type == 0x0 )
+		return DL_ERROR_TYPE_NOT_FOUND;
+
+	dl_error_t err = dl_internal_check_fingerprint( dl_ctx, root_type, header, packed_instance, packed_instance_size, false );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	size_t         fingerprint_size = dl_internal_header_fingerprint_size( header );
+	const uint8_t* packed_data      = packed_instance + sizeof(dl_data_header);
+	size_t         packed_data_size = data_size;
+	if( header->flags & DL_DATA_HEADER_FLAG_COMPRESSED )
+	{
+		// decompress straight to buffer and patch it there.
+		size_t data_offset = sizeof(dl_data_header) + fingerprint_size;
+		err = dl_internal_decompress_instance_data( packed_instance + data_offset, packed_instance_size - data_offset, data_size, false,
+													(uint8_t*)buffer, 0, 0xFFFFFFFF, &packed_data_size );
+		if( err != DL_ERROR_OK )
+			return err;
+		packed_data = (const uint8_t*)buffer;
+	}
+	else if( packed_instance_size - sizeof(dl_data_header) < data_size + fingerprint_size )
+		return DL_ERROR_MALFORMED_DATA;
+	uint32_t count = *(const uint32_t*)packed_data;
+	if( instance_count )
+		*instance_count = count;
+
+	if( (uint64_t)sizeof(uint32_t) * ( 1 + (uint64_t)count ) > data_size ) return DL_ERROR_MALFORMED_DATA;
+	if( count > max_instances ) return DL_ERROR_BUFFER_TO_SMALL;
+
+	const uint32_t* offsets = (const uint32_t*)packed_data + 1;
+	for( uint32_t i = 0; i < count; ++i )
+		if( (size_t)offsets[i] + root_type->size[DL_PTR_SIZE_HOST] > data_size )
+			return DL_ERROR_MALFORMED_DATA;
+
+	if( packed_data != buffer )
+		memmove( buffer, packed_data, data_size );
+
+	uint8_t* data = (uint8_t*)buffer;
+	offsets = (const uint32_t*)data + 1;
+	err = dl_internal_patch_instance_batch( dl_ctx, root_type, data, offsets, count, ( header->flags & DL_DATA_HEADER_FLAG_SHARED_SUBDATA ) != 0 );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	for( uint32_t i = 0; i < count; ++i )
+		loaded_instances[i] = data + offsets[i];
+
+	if( consumed )
+		*consumed = packed_data_size + sizeof(dl_data_header) + fingerprint_size;
 
 	return DL_ERROR_OK;
 }
 
+// Content hashing and comparison of native instances, used by DL_STOREFLAGS_MERGE_IDENTICAL_SUBDATA to find
+// subdata that has already been written. Strings are compared by content, pointers by address (all pointers to the
+// same instance are stored as one already) and everything else by value, padding and unused bits are not compared.
+static uint32_t dl_internal_subdata_hash( dl_ctx_t dl_ctx, dl_type_storage_t storage_type, const dl_type_desc* sub_type, const uint8_t* data, uint32_t count );
+static bool     dl_internal_subdata_equal( dl_ctx_t dl_ctx, dl_type_storage_t storage_type, const dl_type_desc* sub_type, const uint8_t* a, const uint8_t* b, uint32_t count );
+
+static uint32_t dl_internal_struct_hash( dl_ctx_t dl_ctx, const dl_type_desc* type, const uint8_t* data );
+static bool     dl_internal_struct_equal( dl_ctx_t dl_ctx, const dl_type_desc* type, const uint8_t* a, const uint8_t* b );
+
+static uint32_t dl_internal_str_hash( const char* str )
+{
+	return str == 0x0 ? 0xFFFFFFFF : dl_internal_hash_string( str );
+}
+
+static bool dl_internal_str_equal( const char* a, const char* b )
+{
+	if( a == b )
+		return true;
+	if( a == 0x0 || b == 0x0 )
+		return false;
+	return strcmp( a, b ) == 0;
+}
+
+static uint32_t dl_internal_member_hash( dl_ctx_t dl_ctx, const dl_member_desc* member, const uint8_t* data )
+{
+	dl_type_storage_t storage_type = member->StorageType();
+	switch( member->AtomType() )
+	{
+		case DL_TYPE_ATOM_POD:
+			if( storage_type == DL_TYPE_STORAGE_STRUCT )
+				return dl_internal_struct_hash( dl_ctx, dl_internal_find_type( dl_ctx, member->type_id ), data );
+			if( storage_type == DL_TYPE_STORAGE_STR )
+				return dl_internal_str_hash( *(const char**)data );
+			break;
+		case DL_TYPE_ATOM_INLINE_ARRAY:
+			if( storage_type == DL_TYPE_STORAGE_STRUCT || storage_type == DL_TYPE_STORAGE_STR )
+				return dl_internal_subdata_hash( dl_ctx, storage_type, dl_internal_find_type( dl_ctx, member->type_id ), data, member->inline_array_cnt() );
+			break;
+		case DL_TYPE_ATOM_ARRAY:
+			return dl_internal_subdata_hash( dl_ctx, storage_type, dl_internal_find_type( dl_ctx, member->type_id ), *(const uint8_t**)data, *(const uint32_t*)( data + sizeof(void*) ) );
+		case DL_TYPE_ATOM_BITFIELD:
+			return dl_internal_hash_combine( member->bitfield_offset(), (uint32_t)dl_internal_read_host_bitfield( member, data ) );
+		default:
+			break;
+	}
+	return dl_internal_hash_buffer( data, member->size[DL_PTR_SIZE_HOST] );
+}
+
+static bool dl_internal_member_equal( dl_ctx_t dl_ctx, const dl_member_desc* member, const uint8_t* a, const uint8_t* b )
+{
+	dl_type_storage_t storage_type = member->StorageType();
+	switch( member->AtomType() )
+	{
+		case DL_TYPE_ATOM_POD:
+			if( storage_type == DL_TYPE_STORAGE_STRUCT )
+				return dl_internal_struct_equal( dl_ctx, dl_internal_find_type( dl_ctx, member->type_id ), a, b );
+			if( storage_type == DL_TYPE_STORAGE_STR )
+				return dl_internal_str_equal( *(const char**)a, *(const char**)b );
+			break;
+		case DL_TYPE_ATOM_INLINE_ARRAY:
+			if( storage_type == DL_TYPE_STORAGE_STRUCT || storage_type == DL_TYPE_STORAGE_STR )
+				return dl_internal_subdata_equal( dl_ctx, storage_type, dl_internal_find_type( dl_ctx, member->type_id ), a, b, member->inline_array_cnt() );
+			break;
+		case DL_TYPE_ATOM_ARRAY:
+		{
+			uint32_t count = *(const uint32_t*)( a + sizeof(void*) );
+			if( count != *(const uint32_t*)( b + sizeof(void*) ) )
+				return false;
+			const uint8_t* array_a = *(const uint8_t**)a;
+			const uint8_t* array_b = *(const uint8_t**)b;
+			return array_a == array_b || dl_internal_subdata_equal( dl_ctx, storage_type, dl_internal_find_type( dl_ctx, member->type_id ), array_a, array_b, count );
+		}
+		case DL_TYPE_ATOM_BITFIELD:
+			return dl_internal_read_host_bitfield( member, a ) == dl_internal_read_host_bitfield( member, b );
+		default:
+			break;
+	}
+	return memcmp( a, b, member->size[DL_PTR_SIZE_HOST] ) == 0;
+}
+
+static uint32_t dl_internal_struct_hash( dl_ctx_t dl_ctx, const dl_type_desc* type, const uint8_t* data )
+{
+	if( dl_internal_type_is_flat( dl_ctx, type, DL_HASHFLAGS_NONE ) )
+		return dl_internal_hash_buffer( data, type->size[DL_PTR_SIZE_HOST] );
+
+	if( type->flags & DL_TYPE_FLAG_IS_UNION )
+	{
+		uint32_t union_type = *(const uint32_t*)( data + dl_internal_union_type_offset( dl_ctx, type, DL_PTR_SIZE_HOST ) );
+		const dl_member_desc* member = dl_internal_union_type_to_member( dl_ctx, type, union_type );
+		return dl_internal_hash_combine( union_type, dl_internal_member_hash( dl_ctx, member, data + member->offset[DL_PTR_SIZE_HOST] ) );
+	}
+
+	uint32_t hash = 0;
+	for( uint32_t member_index = 0; member_index < type->member_count; ++member_index )
+	{
+		const dl_member_desc* member = dl_get_type_member( dl_ctx, type, member_index );
+		hash = dl_internal_hash_combine( hash, dl_internal_member_hash( dl_ctx, member, data + member->offset[DL_PTR_SIZE_HOST] ) );
+	}
+	return hash;
+}
+
+static bool dl_internal_struct_equal( dl_ctx_t dl_ctx, const dl_type_desc* type, const uint8_t* a, const uint8_t* b )
+{
+	if( dl_internal_type_is_flat( dl_ctx, type, DL_HASHFLAGS_NONE ) )
+		return memcmp( a, b, type->size[DL_PTR_SIZE_HOST] ) == 0;
+
+	if( type->flags & DL_TYPE_FLAG_IS_UNION )
+	{
+		size_t type_offset = dl_internal_union_type_offset( dl_ctx, type, DL_PTR_SIZE_HOST );
+		uint32_t union_type = *(const uint32_t*)( a + type_offset );
+		if( union_type != *(const uint32_t*)( b + type_offset ) )
+			return false;
+		const dl_member_desc* member = dl_internal_union_type_to_member( dl_ctx, type, union_type );
+		return dl_internal_member_equal( dl_ctx, member, a + member->offset[DL_PTR_SIZE_HOST], b + member->offset[DL_PTR_SIZE_HOST] );
+	}
+
+	for( uint32_t member_index = 0; member_index < type->member_count; ++member_index )
+	{
+		const dl_member_desc* member = dl_get_type_member( dl_ctx, type, member_index );
+		if( !dl_internal_member_equal( dl_ctx, member, a + member->offset[DL_PTR_SIZE_HOST], b + member->offset[DL_PTR_SIZE_HOST] ) )
+			return false;
+	}
+	return true;
+}
+
+static uint32_t dl_internal_subdata_hash( dl_ctx_t dl_ctx, dl_type_storage_t storage_type, const dl_type_desc* sub_type, const uint8_t* data, uint32_t count )
+{
+	uint32_t hash = count;
+	switch( storage_type )
+	{
+		case DL_TYPE_STORAGE_STRUCT:
+			for( uint32_t elem = 0; elem < count; ++elem )
+				hash = dl_internal_hash_combine( hash, dl_internal_struct_hash( dl_ctx, sub_type, data + (size_t)elem * sub_type->size[DL_PTR_SIZE_HOST] ) );
+			break;
+		case DL_TYPE_STORAGE_STR:
+			for( uint32_t elem = 0; elem < count; ++elem )
+				hash = dl_internal_hash_combine( hash, dl_internal_str_hash( ((const char**)data)[elem] ) );
+			break;
+		default: // pods and pointers, pointers are compared by address.
+			hash = dl_internal_hash_combine( hash, dl_internal_hash_buffer( data, count * dl_pod_size( storage_type ) ) );
+			break;
+	}
+	return hash;
+}
+
+static bool dl_internal_subdata_equal( dl_ctx_t dl_ctx, dl_type_storage_t storage_type, const dl_type_desc* sub_type, const uint8_t* a, const uint8_t* b, uint32_t count )
+{
+	switch( storage_type )
+	{
+		case DL_TYPE_STORAGE_STRUCT:
+		{
+			size_t size = sub_type->size[DL_PTR_SIZE_HOST];
+			for( uint32_t elem = 0; elem < count; ++elem )
+				if( !dl_internal_struct_equal( dl_ctx, sub_type, a + elem * size, b + elem * size ) )
+					return false;
+			return true;
+		}
+		case DL_TYPE_STORAGE_STR:
+			for( uint32_t elem = 0; elem < count; ++elem )
+				if( !dl_internal_str_equal( ((const char**)a)[elem], ((const char**)b)[elem] ) )
+					return false;
+			return true;
+		default:
+			return memcmp( a, b, count * dl_pod_size( storage_type ) ) == 0;
+	}
+}
+
 struct CDLBinStoreContext
 {
-	CDLBinStoreContext( uint8_t* out_data, size_t out_data_size, bool is_dummy )
+	CDLBinStoreContext( dl_ctx_t dl_ctx, uint8_t* out_data, size_t out_data_size, bool is_dummy, unsigned int store_flags, dl_endian_t target_endian, dl_ptr_size_t target_ptr_size )
 	{
-		dl_binary_writer_init( &writer, out_data, out_data_size, is_dummy, DL_ENDIAN_HOST, DL_ENDIAN_HOST, DL_PTR_SIZE_HOST );
-		num_written_ptrs = 0;
+		dl_binary_writer_init( &writer, out_data, out_data_size, is_dummy, DL_ENDIAN_HOST, target_endian, target_ptr_size );
+		writer.zero_reserved = ( store_flags & DL_STOREFLAGS_CANONICAL ) != 0;
+		flags = store_flags;
+		shared_subdata = false;
+		out_of_memory = false;
+		write_loaded = false;
+		loaded_base = 0;
+		ctx = dl_ctx;
+		written_ptrs.init( &dl_ctx->alloc );
+		written_strings.init( &dl_ctx->alloc );
+		written_subdata.init( &dl_ctx->alloc );
+		written_aliases.init( &dl_ctx->alloc );
 	}
 
-	uintptr_t FindWrittenPtr( void* ptr )
+	~CDLBinStoreContext()
+	{
+		written_ptrs.destroy();
+		written_strings.destroy();
+		written_subdata.destroy();
+		written_aliases.destroy();
+	}
+
+	// true if the instance is stored with the same layout as it has in memory.
+	bool IsHostLayout() const
+	{
+		return writer.target_endian == DL_ENDIAN_HOST && writer.ptr_size == DL_PTR_SIZE_HOST;
+	}
+
+	// write ptr to data at offset, as an absolute address if writing a loaded instance.
+	void WritePtr( uintptr_t offset )
 	{
-		for( int i = 0; i < num_written_ptrs; ++i )
-			if( written_ptrs[i].ptr == ptr )
-				return written_ptrs[i].pos;
+		if( write_loaded )
+			offset = offset == DL_NULL_PTR_OFFSET[ DL_PTR_SIZE_HOST ] ? 0 : loaded_base + offset;
+		dl_binary_writer_write_ptr( &writer, offset );
+	}
+
+	struct written_ptr
+	{
+		const void* ptr;
+		uintptr_t   pos;
+	};
 
-		return (uintptr_t)-1;
+	struct written_ptr_eq
+	{
+		const void* ptr;
+		bool operator()( const written_ptr& wp ) const { return wp.ptr == ptr; }
+	};
+
+	uintptr_t FindWrittenPtr( void* ptr )
+	{
+		written_ptr_eq eq = { ptr };
+		written_ptr* wp = written_ptrs.find( dl_internal_hash_ptr( ptr ), eq );
+		return wp == 0x0 ? (uintptr_t)-1 : wp->pos;
 	}
 
 	void AddWrittenPtr( const void* ptr, uintptr_t pos )
 	{
-		DL_ASSERT( num_written_ptrs < (int)DL_ARRAY_LENGTH(written_ptrs) );
-		written_ptrs[num_written_ptrs].ptr = ptr;
-		written_ptrs[num_written_ptrs].pos = pos;
-		++num_written_ptrs;
+		written_ptr wp = { ptr, pos };
+		if( !written_ptrs.insert( dl_internal_hash_ptr( ptr ), wp ) )
+			out_of_memory = true;
 	}
 
-	dl_binary_writer writer;
+	struct written_string
+	{
+		const char* str; // first stored string with this content, used to compare against.
+		size_t      len;
+		uintptr_t   pos;
+	};
+
+	struct written_string_eq
+	{
+		const char* str;
+		size_t      len;
+		bool operator()( const written_string& ws ) const { return ws.len == len && memcmp( ws.str, str, len ) == 0; }
+	};
+
+	uintptr_t FindWrittenString( const char* str, size_t len, uint32_t hash )
+	{
+		written_string_eq eq = { str, len };
+		written_string* ws = written_strings.find( hash, eq );
+		return ws == 0x0 ? (uintptr_t)-1 : ws->pos;
+	}
+
+	void AddWrittenString( const char* str, size_t len, uint32_t hash, uintptr_t pos )
+	{
+		written_string ws = { str, len, pos };
+		written_strings.insert( hash, ws ); // on out of memory the string will just not be shared.
+	}
 
-	struct
+	// strings and array-data already written, keyed by address so that members referencing the same memory
+	// still reference the same memory after load. Strings are stored with count 0 to separate them from arrays.
+	struct written_alias
 	{
+		const void* data;
+		uint32_t    count;
+		uint32_t    type; // storage-type of string or array.
+		dl_typeid_t type_id;
 		uintptr_t   pos;
-		const void* ptr;
-	} written_ptrs[128];
-	int num_written_ptrs;
+	};
+
+	struct written_alias_eq
+	{
+		const written_alias& alias;
+		bool operator()( const written_alias& wa ) const
+		{
+			return wa.data == alias.data && wa.count == alias.count && wa.type == alias.type && wa.type_id == alias.type_id;
+		}
+	};
+
+	static uint32_t AliasHash( const written_alias& alias )
+	{
+		return dl_internal_hash_combine( dl_internal_hash_ptr( alias.data ), alias.count );
+	}
+
+	uintptr_t FindWrittenAlias( const written_alias& alias )
+	{
+		written_alias_eq eq = { alias };
+		written_alias* wa = written_aliases.find( AliasHash( alias ), eq );
+		return wa == 0x0 ? (uintptr_t)-1 : wa->pos;
+	}
+
+	void AddWrittenAlias( const written_alias& alias )
+	{
+		written_aliases.insert( AliasHash( alias ), alias ); // on out of memory the data will just be written again.
+	}
+
+	struct written_subdata_entry
+	{
+		const uint8_t*      data; // first stored subdata with this content, used to compare against.
+		dl_type_storage_t   storage_type;
+		const dl_type_desc* sub_type;
+		uint32_t            count;
+		bool                is_array;
+		uintptr_t           pos;
+	};
+
+	struct written_subdata_eq
+	{
+		dl_ctx_t                     ctx;
+		const written_subdata_entry& entry;
+		bool operator()( const written_subdata_entry& ws ) const
+		{
+			return ws.is_array     == entry.is_array &&
+				   ws.storage_type == entry.storage_type &&
+				   ws.sub_type     == entry.sub_type &&
+				   ws.count        == entry.count &&
+				   dl_internal_subdata_equal( ctx, ws.storage_type, ws.sub_type, ws.data, entry.data, ws.count );
+		}
+	};
+
+	uintptr_t FindWrittenSubdata( const written_subdata_entry& entry, uint32_t hash )
+	{
+		written_subdata_eq eq = { ctx, entry };
+		written_subdata_entry* ws = written_subdata.find( hash, eq );
+		return ws == 0x0 ? (uintptr_t)-1 : ws->pos;
+	}
+
+	void AddWrittenSubdata( const written_subdata_entry& entry, uint32_t hash )
+	{
+		written_subdata.insert( hash, entry ); // on out of memory the subdata will just not be shared.
+	}
+
+	dl_binary_writer writer;
+	unsigned int     flags;
+	dl_ctx_t         ctx;
+	bool             shared_subdata; // set if any array-data is referenced from more than one member.
+	bool             out_of_memory;  // set if memory for tracking written pointers could not be allocated.
+	bool             write_loaded;   // set if writing a loaded instance, i.e. ptrs are written as addresses, see dl_instance_copy.
+	uintptr_t        loaded_base;    // address the loaded instance is written to.
+
+	dl_hash_table<written_ptr>           written_ptrs;
+	dl_hash_table<written_string>        written_strings;
+	dl_hash_table<written_subdata_entry> written_subdata;
+	dl_hash_table<written_alias>         written_aliases;
 };
 
 static void dl_internal_store_string( const uint8_t* instance, CDLBinStoreContext* store_ctx )
@@ -145,15 +626,44 @@ static void dl_internal_store_string( const uint8_t* instance, CDLBinStoreContex
 	char* str = *(char**)instance;
 	if( str == 0x0 )
 	{
-		dl_binary_writer_write( &store_ctx->writer, &DL_NULL_PTR_OFFSET[ DL_PTR_SIZE_HOST ], sizeof(uintptr_t) );
+		store_ctx->WritePtr( DL_NULL_PTR_OFFSET[ store_ctx->writer.ptr_size ] );
 		return;
 	}
+
+	CDLBinStoreContext::written_alias alias = { str, 0, DL_TYPE_STORAGE_STR, 0, 0 };
+	uintptr_t offset = store_ctx->FindWrittenAlias( alias );
+	if( offset != (uintptr_t)-1 )
+	{
+		store_ctx->WritePtr( offset );
+		return;
+	}
+
+	size_t   len  = strlen(str);
+	uint32_t hash = 0;
+	if( store_ctx->flags & DL_STOREFLAGS_INTERN_STRINGS )
+	{
+		hash = dl_internal_hash_buffer( (const uint8_t*)str, len );
+		offset = store_ctx->FindWrittenString( str, len, hash );
+		if( offset != (uintptr_t)-1 )
+		{
+			alias.pos = offset;
+			store_ctx->AddWrittenAlias( alias );
+			store_ctx->WritePtr( offset );
+			return;
+		}
+	}
+
 	uintptr_t pos = dl_binary_writer_tell( &store_ctx->writer );
 	dl_binary_writer_seek_end( &store_ctx->writer );
-	uintptr_t offset = dl_binary_writer_tell( &store_ctx->writer );
-	dl_binary_writer_write( &store_ctx->writer, str, strlen(str) + 1 );
+	offset = dl_binary_writer_tell( &store_ctx->writer );
+	dl_binary_writer_write( &store_ctx->writer, str, len + 1 );
 	dl_binary_writer_seek_set( &store_ctx->writer, pos );
-	dl_binary_writer_write( &store_ctx->writer, &offset, sizeof(uintptr_t) );
+	store_ctx->WritePtr( offset );
+
+	alias.pos = offset;
+	store_ctx->AddWrittenAlias( alias );
+	if( store_ctx->flags & DL_STOREFLAGS_INTERN_STRINGS )
+		store_ctx->AddWrittenString( str, len, hash, offset );
 }
 
 static dl_error_t dl_internal_instance_store( dl_ctx_t dl_ctx, const dl_type_desc* type, uint8_t* instance, CDLBinStoreContext* store_ctx );
@@ -162,20 +672,35 @@ static void dl_internal_store_ptr( dl_ctx_t dl_ctx, uint8_t* instance, const dl_
 {
 	uint8_t* data = *(uint8_t**)instance;
 	uintptr_t offset = store_ctx->FindWrittenPtr( data );
+	dl_ptr_size_t ptr_size = store_ctx->writer.ptr_size;
 
 	if( data == 0x0 ) // Null-pointer, store pint(-1) to signal to patching!
 	{
 		DL_ASSERT(offset == (uintptr_t)-1 && "This pointer should not have been found among the written ptrs!");
-		// keep the -1 in Offset and store it to ptr.
+		offset = DL_NULL_PTR_OFFSET[ ptr_size ];
 	}
 	else if( offset == (uintptr_t)-1 ) // has not been written yet!
 	{
+		CDLBinStoreContext::written_subdata_entry entry = { data, DL_TYPE_STORAGE_STRUCT, sub_type, 1, false, 0 };
+		uint32_t hash = 0;
+		if( store_ctx->flags & DL_STOREFLAGS_MERGE_IDENTICAL_SUBDATA )
+		{
+			hash = dl_internal_subdata_hash( dl_ctx, DL_TYPE_STORAGE_STRUCT, sub_type, data, 1 );
+			offset = store_ctx->FindWrittenSubdata( entry, hash );
+			if( offset != (uintptr_t)-1 )
+			{
+				store_ctx->AddWrittenPtr( data, offset );
+				store_ctx->WritePtr( offset );
+				return;
+			}
+		}
+
 		uintptr_t pos = dl_binary_writer_tell( &store_ctx->writer );
 		dl_binary_writer_seek_end( &store_ctx->writer );
 
 		// const dl_type_desc* sub_type = dl_internal_find_type( dl_ctx, member->type_id );
-		uintptr_t size = dl_internal_align_up( sub_type->size[DL_PTR_SIZE_HOST], sub_type->alignment[DL_PTR_SIZE_HOST] );
-		dl_binary_writer_align( &store_ctx->writer, sub_type->alignment[DL_PTR_SIZE_HOST] );
+		uintptr_t size = dl_internal_align_up( sub_type->size[ptr_size], sub_type->alignment[ptr_size] );
+		dl_binary_writer_align( &store_ctx->writer, sub_type->alignment[ptr_size] );
 
 		offset = dl_binary_writer_tell( &store_ctx->writer );
 
@@ -183,26 +708,38 @@ static void dl_internal_store_ptr( dl_ctx_t dl_ctx, uint8_t* instance, const dl_
 		dl_binary_writer_reserve( &store_ctx->writer, size ); // reserve space for ptr so subdata is placed correctly
 
 		store_ctx->AddWrittenPtr(data, offset);
+		if( store_ctx->flags & DL_STOREFLAGS_MERGE_IDENTICAL_SUBDATA )
+		{
+			entry.pos = offset;
+			store_ctx->AddWrittenSubdata( entry, hash );
+		}
 
 		dl_internal_instance_store(dl_ctx, sub_type, data, store_ctx);
 
 		dl_binary_writer_seek_set( &store_ctx->writer, pos );
 	}
 
-	dl_binary_writer_write( &store_ctx->writer, &offset, sizeof(uintptr_t) );
+	store_ctx->WritePtr( offset );
 }
 
-static void dl_internal_store_array( dl_ctx_t dl_ctx, dl_type_storage_t storage_type, const dl_type_desc* sub_type, uint8_t* instance, uint32_t count, uintptr_t size, CDLBinStoreContext* store_ctx )
+static void dl_internal_store_array( dl_ctx_t dl_ctx, dl_type_storage_t storage_type, const dl_type_desc* sub_type, uint8_t* instance, uint32_t count, CDLBinStoreContext* store_ctx )
 {
 	switch( storage_type )
 	{
 		case DL_TYPE_STORAGE_STRUCT:
 		{
 			uintptr_t size_ = sub_type->size[DL_PTR_SIZE_HOST];
-			if( sub_type->flags & DL_TYPE_FLAG_HAS_SUBDATA )
+			// a canonical store write member by member to not copy padding from instance.
+			if( ( sub_type->flags & DL_TYPE_FLAG_HAS_SUBDATA ) || !store_ctx->IsHostLayout() || ( store_ctx->flags & DL_STOREFLAGS_CANONICAL ) )
 			{
+				dl_ptr_size_t ptr_size = store_ctx->writer.ptr_size;
+				uintptr_t array_pos   = dl_binary_writer_tell( &store_ctx->writer );
+				uintptr_t target_size = dl_internal_align_up( sub_type->size[ptr_size], sub_type->alignment[ptr_size] );
 				for (uint32_t elem = 0; elem < count; ++elem)
+				{
+					dl_binary_writer_seek_set( &store_ctx->writer, array_pos + elem * target_size );
 					dl_internal_instance_store(dl_ctx, sub_type, instance + (elem * size_), store_ctx);
+				}
 			}
 			else
 				dl_binary_writer_write( &store_ctx->writer, instance, count * size_ );
@@ -217,15 +754,38 @@ static void dl_internal_store_array( dl_ctx_t dl_ctx, dl_type_storage_t storage_
 				dl_internal_store_ptr( dl_ctx, instance + (elem * sizeof(void*)), sub_type, store_ctx );
 			break;
 		default: // default is a standard pod-type
-			dl_binary_writer_write( &store_ctx->writer, instance, count * size );
+			dl_binary_writer_write_array( &store_ctx->writer, instance, count, dl_pod_size( storage_type ) );
 			break;
 	}
 }
 
+static void dl_internal_store_bitfield( const dl_member_desc* first_bf_member, uint32_t bf_member_count, uint8_t* instance, CDLBinStoreContext* store_ctx )
+{
+	dl_binary_writer* writer = &store_ctx->writer;
+	if( writer->source_endian == writer->target_endian && ( store_ctx->flags & DL_STOREFLAGS_CANONICAL ) == 0 )
+	{
+		dl_binary_writer_write( writer, instance, first_bf_member->size[DL_PTR_SIZE_HOST] );
+		return;
+	}
+
+	// bits are placed differently on the target, move them before swapping. Only the bits of the members are moved
+	// so this also clears unused bits for a canonical store.
+	switch( first_bf_member->size[DL_PTR_SIZE_HOST] )
+	{
+		case 1: { uint8_t  val = dl_internal_convert_bitfield_format( *(uint8_t*) instance, first_bf_member, bf_member_count, writer->source_endian, writer->target_endian ); dl_binary_writer_write_1byte( writer, &val ); } break;
+		case 2: { uint16_t val = dl_internal_convert_bitfield_format( *(uint16_t*)instance, first_bf_member, bf_member_count, writer->source_endian, writer->target_endian ); dl_binary_writer_write_2byte( writer, &val ); } break;
+		case 4: { uint32_t val = dl_internal_convert_bitfield_format( *(uint32_t*)instance, first_bf_member, bf_member_count, writer->source_endian, writer->target_endian ); dl_binary_writer_write_4byte( writer, &val ); } break;
+		case 8: { uint64_t val = dl_internal_convert_bitfield_format( *(uint64_t*)instance, first_bf_member, bf_member_count, writer->source_endian, writer->target_endian ); dl_binary_writer_write_8byte( writer, &val ); } break;
+		default:
+			DL_ASSERT(false && "Not supported pod-size or bitfield-size!");
+	}
+}
+
 static dl_error_t dl_internal_store_member( dl_ctx_t dl_ctx, const dl_member_desc* member, uint8_t* instance, CDLBinStoreContext* store_ctx )
 {
 	dl_type_atom_t    atom_type    = member->AtomType();
 	dl_type_storage_t storage_type = member->StorageType();
+	dl_ptr_size_t     ptr_size     = store_ctx->writer.ptr_size;
 
 	switch ( atom_type )
 	{
@@ -260,7 +820,7 @@ static dl_error_t dl_internal_store_member( dl_ctx_t dl_ctx, const dl_member_des
 				break;
 				default: // default is a standard pod-type
 					DL_ASSERT( member->IsSimplePod() );
-					dl_binary_writer_write( &store_ctx->writer, instance, member->size[DL_PTR_SIZE_HOST] );
+					dl_binary_writer_write_swap( &store_ctx->writer, instance, member->size[DL_PTR_SIZE_HOST] );
 					break;
 			}
 		}
@@ -281,9 +841,9 @@ static dl_error_t dl_internal_store_member( dl_ctx_t dl_ctx, const dl_member_des
 				}
 			}
 			else if( storage_type != DL_TYPE_STORAGE_STR )
-				count = member->size[DL_PTR_SIZE_HOST];
+				count = member->size[DL_PTR_SIZE_HOST] / (uint32_t)dl_pod_size( storage_type );
 
-			dl_internal_store_array( dl_ctx, storage_type, sub_type, instance, count, 1, store_ctx );
+			dl_internal_store_array( dl_ctx, storage_type, sub_type, instance, count, store_ctx );
 		}
 		return DL_ERROR_OK;
 
@@ -298,48 +858,82 @@ static dl_error_t dl_internal_store_member( dl_ctx_t dl_ctx, const dl_member_des
 			uintptr_t offset = 0;
 
 			if( count == 0 )
-				offset = DL_NULL_PTR_OFFSET[ DL_PTR_SIZE_HOST ];
+				offset = DL_NULL_PTR_OFFSET[ ptr_size ];
 			else
 			{
-				uintptr_t pos = dl_binary_writer_tell( &store_ctx->writer );
-				dl_binary_writer_seek_end( &store_ctx->writer );
+				uint8_t* data = *(uint8_t**)data_ptr;
+				uint32_t alignment;
 
 				switch(storage_type)
 				{
 					case DL_TYPE_STORAGE_STRUCT:
-						sub_type = dl_internal_find_type( dl_ctx, member->type_id );
-						size = dl_internal_align_up( sub_type->size[DL_PTR_SIZE_HOST], sub_type->alignment[DL_PTR_SIZE_HOST] );
-						dl_binary_writer_align( &store_ctx->writer, sub_type->alignment[DL_PTR_SIZE_HOST] );
+						sub_type  = dl_internal_find_type( dl_ctx, member->type_id );
+						size      = dl_internal_align_up( sub_type->size[ptr_size], sub_type->alignment[ptr_size] );
+						alignment = sub_type->alignment[ptr_size];
 						break;
 					case DL_TYPE_STORAGE_PTR:
 						sub_type = dl_internal_find_type( dl_ctx, member->type_id );
 						/*fallthrough*/
+					case DL_TYPE_STORAGE_STR:
+						size      = dl_internal_ptr_size( ptr_size );
+						alignment = (uint32_t)size;
+						break;
 					default:
-						size = dl_pod_size( member->StorageType() );
-						dl_binary_writer_align( &store_ctx->writer, size );
+						size      = dl_pod_size( member->StorageType() );
+						alignment = (uint32_t)size;
 				}
 
-				offset = dl_binary_writer_tell( &store_ctx->writer );
+				CDLBinStoreContext::written_alias alias = { data, count, (uint32_t)storage_type, member->type_id, 0 };
+				CDLBinStoreContext::written_subdata_entry entry = { data, storage_type, sub_type, count, true, 0 };
+				uint32_t hash = 0;
+				offset = store_ctx->FindWrittenAlias( alias );
+				if( offset == (uintptr_t)-1 && ( store_ctx->flags & DL_STOREFLAGS_MERGE_IDENTICAL_SUBDATA ) )
+				{
+					hash   = dl_internal_subdata_hash( dl_ctx, storage_type, sub_type, data, count );
+					offset = store_ctx->FindWrittenSubdata( entry, hash );
+					if( offset != (uintptr_t)-1 )
+					{
+						alias.pos = offset;
+						store_ctx->AddWrittenAlias( alias );
+					}
+				}
 
-				// write data!
-				dl_binary_writer_reserve( &store_ctx->writer, count * size ); // reserve space for array so subdata is placed correctly
+				if( offset != (uintptr_t)-1 )
+					store_ctx->shared_subdata = true;
+				else
+				{
+					uintptr_t pos = dl_binary_writer_tell( &store_ctx->writer );
+					dl_binary_writer_seek_end( &store_ctx->writer );
+					dl_binary_writer_align( &store_ctx->writer, alignment );
 
-				uint8_t* data = *(uint8_t**)data_ptr;
+					offset = dl_binary_writer_tell( &store_ctx->writer );
 
-				dl_internal_store_array( dl_ctx, storage_type, sub_type, data, count, size, store_ctx );
-				dl_binary_writer_seek_set( &store_ctx->writer, pos );
+					// write data!
+					dl_binary_writer_reserve( &store_ctx->writer, count * size ); // reserve space for array so subdata is placed correctly
+
+					alias.pos = offset;
+					store_ctx->AddWrittenAlias( alias );
+					if( store_ctx->flags & DL_STOREFLAGS_MERGE_IDENTICAL_SUBDATA )
+					{
+						entry.pos = offset;
+						store_ctx->AddWrittenSubdata( entry, hash );
+					}
+
+					dl_internal_store_array( dl_ctx, storage_type, sub_type, data, count, store_ctx );
+					dl_binary_writer_seek_set( &store_ctx->writer, pos );
+				}
 			}
 
 			// make room for ptr
-			dl_binary_writer_write( &store_ctx->writer, &offset, sizeof(uintptr_t) );
+			store_ctx->WritePtr( offset );
 
 			// write count
-			dl_binary_writer_write( &store_ctx->writer, &count, sizeof(uint32_t) );
+			dl_binary_writer_write_4byte( &store_ctx->writer, &count );
 		}
 		return DL_ERROR_OK;
 
 		case DL_TYPE_ATOM_BITFIELD:
-			dl_binary_writer_write( &store_ctx->writer, instance, member->size[DL_PTR_SIZE_HOST] );
+			dl_internal_store_bitfield( member, 1, instance, store_ctx );
 		break;
 
 		default:
@@ -352,9 +946,9 @@ static dl_error_t dl_internal_store_member( dl_ctx_t dl_ctx, const dl_member_des
 
 static dl_error_t dl_internal_instance_store( dl_ctx_t dl_ctx, const dl_type_desc* type, uint8_t* instance, CDLBinStoreContext* store_ctx )
 {
-	bool last_was_bitfield = false;
+	dl_ptr_size_t ptr_size = store_ctx->writer.ptr_size;
 
-	dl_binary_writer_align( &store_ctx->writer, type->alignment[DL_PTR_SIZE_HOST] );
+	dl_binary_writer_align( &store_ctx->writer, type->alignment[ptr_size] );
 
 	uintptr_t instance_pos = dl_binary_writer_tell( &store_ctx->writer );
 	if( type->flags & DL_TYPE_FLAG_IS_UNION )
@@ -369,82 +963,221 @@ static dl_error_t dl_internal_instance_store( dl_ctx_t dl_ctx, const dl_type_des
 		if( err != DL_ERROR_OK )
 			return err;
 
-		dl_binary_writer_seek_set( &store_ctx->writer, instance_pos + type_offset );
-		dl_binary_writer_write_uint32( &store_ctx->writer, union_type );
+		dl_binary_writer_seek_set( &store_ctx->writer, instance_pos + dl_internal_union_type_offset( dl_ctx, type, ptr_size ) );
+		dl_binary_writer_write_4byte( &store_ctx->writer, &union_type );
 	}
 	else
 	{
 		for( uint32_t member_index = 0; member_index < type->member_count; ++member_index )
 		{
 			const dl_member_desc* member = dl_get_type_member( dl_ctx, type, member_index );
+			dl_binary_writer_seek_set( &store_ctx->writer, instance_pos + member->offset[ptr_size] );
 
-			if( !last_was_bitfield || member->AtomType() != DL_TYPE_ATOM_BITFIELD )
+			if( member->AtomType() == DL_TYPE_ATOM_BITFIELD )
 			{
-				dl_binary_writer_seek_set( &store_ctx->writer, instance_pos + member->offset[DL_PTR_SIZE_HOST] );
-				dl_error_t err = dl_internal_store_member( dl_ctx, member, instance + member->offset[DL_PTR_SIZE_HOST], store_ctx );
-				if( err != DL_ERROR_OK )
-					return err;
+				// all bitfield-members in a row share storage and are written at once.
+				uint32_t bf_member_count = 1;
+				while( member_index + bf_member_count < type->member_count &&
+					   dl_get_type_member( dl_ctx, type, member_index + bf_member_count )->AtomType() == DL_TYPE_ATOM_BITFIELD )
+					++bf_member_count;
+
+				dl_internal_store_bitfield( member, bf_member_count, instance + member->offset[DL_PTR_SIZE_HOST], store_ctx );
+				member_index += bf_member_count - 1;
+				continue;
 			}
 
-			last_was_bitfield = member->AtomType() == DL_TYPE_ATOM_BITFIELD;
+			dl_error_t err = dl_internal_store_member( dl_ctx, member, instance + member->offset[DL_PTR_SIZE_HOST], store_ctx );
+			if( err != DL_ERROR_OK )
+				return err;
 		}
 	}
 
 	return DL_ERROR_OK;
 }
 
-dl_error_t dl_instance_store( dl_ctx_t       dl_ctx,     dl_typeid_t type_id,         const void* instance,
-							  unsigned char* out_buffer, size_t      out_buffer_size, size_t*     produced_bytes )
+static dl_error_t dl_internal_store_instances( dl_ctx_t       dl_ctx,     dl_typeid_t type_id,         const uint8_t* instances, uint32_t instance_count, bool batch,
+											   unsigned char* out_buffer, size_t      out_buffer_size, size_t*        produced_bytes,
+											   const dl_store_params_t* store_params )
 {
 	if( out_buffer_size > 0 && out_buffer_size <= sizeof(dl_data_header) )
 		return DL_ERROR_BUFFER_TO_SMALL;
 
+	dl_store_params_t default_params;
+	if( store_params == 0x0 )
+	{
+		DL_STORE_PARAMS_SET_DEFAULT( default_params );
+		store_params = &default_params;
+	}
+
+	dl_ptr_size_t target_ptr_size;
+	switch( store_params->target_ptr_size )
+	{
+		case 4: target_ptr_size = DL_PTR_SIZE_32BIT; break;
+		case 8: target_ptr_size = DL_PTR_SIZE_64BIT; break;
+		default: return DL_ERROR_INVALID_PARAMETER;
+	}
+
 	const dl_type_desc* type = dl_internal_find_type( dl_ctx, type_id );
 	if( type == 0x0 )
 		return DL_ERROR_TYPE_NOT_FOUND;
 
-	// write header
-	dl_data_header header;
-	header.id = DL_INSTANCE_ID;
-	header.version = DL_INSTANCE_VERSION;
-	header.root_instance_type = type_id;
-	header.instance_size = 0;
-	header.is_64_bit_ptr = sizeof(void*) == 8 ? 1 : 0;
-	header.pad[0] = header.pad[1] = header.pad[2] = 0;
-
 	unsigned char* store_ctx_buffer      = 0x0;
 	size_t         store_ctx_buffer_size = 0;
 	bool           store_ctx_is_dummy    = out_buffer_size == 0;
 
 	if( out_buffer_size > 0 )
 	{
-		memcpy(out_buffer, &header, sizeof(dl_data_header));
 		store_ctx_buffer      = out_buffer + sizeof(dl_data_header);
 		store_ctx_buffer_size = out_buffer_size - sizeof(dl_data_header);
 	}
 
-	CDLBinStoreContext store_context( store_ctx_buffer, store_ctx_buffer_size, store_ctx_is_dummy );
+	CDLBinStoreContext store_context( dl_ctx, store_ctx_buffer, store_ctx_buffer_size, store_ctx_is_dummy, store_params->flags, store_params->target_endian, target_ptr_size );
+
+	// a batch starts with the instance-count followed by the offset to each instance.
+	if( batch )
+		dl_binary_writer_reserve( &store_context.writer, sizeof(uint32_t) * ( 1 + (size_t)instance_count ) );
+
+	// all root-instances are placed and registered before any of them is stored so that pointers between
+	// the instances in a batch is stored as pointers to the other root and not as a copy.
+	size_t   root_stride = dl_internal_align_up( type->size[target_ptr_size], type->alignment[target_ptr_size] );
+	dl_binary_writer_seek_end( &store_context.writer );
+	dl_binary_writer_align( &store_context.writer, type->alignment[target_ptr_size] );
+	size_t   roots_pos   = dl_binary_writer_tell( &store_context.writer );
+
+	// the batch offset-table stores the offset to each root in 32 bits.
+	if( instance_count > 0 && roots_pos + root_stride * ( instance_count - 1 ) > 0xFFFFFFFF )
+		return DL_ERROR_UNSUPPORTED_OPERATION;
+
+	if( instance_count > 0 )
+		dl_binary_writer_reserve( &store_context.writer, root_stride * ( instance_count - 1 ) + type->size[target_ptr_size] );
+
+	for( uint32_t i = 0; i < instance_count; ++i )
+	{
+		uint32_t instance_pos = (uint32_t)( roots_pos + root_stride * i );
+		store_context.AddWrittenPtr( instances + (size_t)i * type->size[DL_PTR_SIZE_HOST], instance_pos ); // if pointer refere to root-node, it can be found at its offset
+
+		if( batch )
+		{
+			dl_binary_writer_seek_set( &store_context.writer, sizeof(uint32_t) * ( 1 + (size_t)i ) );
+			dl_binary_writer_write_4byte( &store_context.writer, &instance_pos );
+		}
+	}
+
+	dl_error_t err = DL_ERROR_OK;
+	for( uint32_t i = 0; i < instance_count && err == DL_ERROR_OK; ++i )
+	{
+		dl_binary_writer_seek_set( &store_context.writer, roots_pos + root_stride * i );
+		err = dl_internal_instance_store( dl_ctx, type, (uint8_t*)instances + (size_t)i * type->size[DL_PTR_SIZE_HOST], &store_context );
+	}
+
+	if( batch )
+	{
+		dl_binary_writer_seek_set( &store_context.writer, 0 );
+		dl_binary_writer_write_4byte( &store_context.writer, &instance_count );
+	}
+
+	if( store_context.out_of_memory )
+		return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+
+	dl_binary_writer_seek_end( &store_context.writer );
+	size_t instance_size    = dl_binary_writer_tell( &store_context.writer );
+	size_t fingerprint_size = ( store_params->flags & DL_STOREFLAGS_LAYOUT_FINGERPRINT ) ? sizeof(uint32_t) : 0;
+
+	if( produced_bytes )
+		*produced_bytes = instance_size + sizeof(dl_data_header) + fingerprint_size;
+
+	// offsets in 32-bit ptrs can not address more than 4GB.
+	if( instance_size > DL_INSTANCE_MAX_SIZE || ( target_ptr_size == DL_PTR_SIZE_32BIT && instance_size > 0xFFFFFFFF ) )
+		return DL_ERROR_UNSUPPORTED_OPERATION;
+
+	if( out_buffer_size > 0 && instance_size + fingerprint_size > store_ctx_buffer_size )
+		return DL_ERROR_BUFFER_TO_SMALL;
+
+	// write header
+	if( out_buffer_size > 0 )
+	{
+		dl_data_header header;
+		memset( &header, 0x0, sizeof(dl_data_header) );
+		header.id                 = DL_INSTANCE_ID;
+		header.root_instance_type = type_id;
+		dl_internal_header_set_instance_size( &header, instance_size );
+		header.is_64_bit_ptr      = target_ptr_size == DL_PTR_SIZE_64BIT ? 1 : 0;
+		header.flags              = store_context.shared_subdata ? DL_DATA_HEADER_FLAG_SHARED_SUBDATA : 0;
+		if( batch )
+			header.flags |= DL_DATA_HEADER_FLAG_BATCH;
+		if( store_params->flags & DL_STOREFLAGS_CHECKSUM )
+		{
+			header.flags   |= DL_DATA_HEADER_FLAG_CHECKSUM;
+			header.checksum = dl_internal_crc32c( store_ctx_buffer, instance_size );
+		}
+		if( fingerprint_size > 0 )
+		{
+			header.flags |= DL_DATA_HEADER_FLAG_FINGERPRINT;
+			uint32_t fingerprint = dl_internal_type_fingerprint( dl_ctx, type );
+			if( store_params->target_endian != DL_ENDIAN_HOST )
+				fingerprint = dl_swap_endian_uint32( fingerprint );
+			memcpy( store_ctx_buffer + instance_size, &fingerprint, sizeof(uint32_t) );
+		}
+
+		if( store_params->target_endian != DL_ENDIAN_HOST )
+			dl_swap_header( &header );
+
+		memcpy( out_buffer, &header, sizeof(dl_data_header) );
+	}
+
+	return err;
+}
+
+dl_error_t dl_instance_store_ex( dl_ctx_t       dl_ctx,     dl_typeid_t type_id,         const void* instance,
+								 unsigned char* out_buffer, size_t      out_buffer_size, size_t*     produced_bytes,
+								 const dl_store_params_t* store_params )
+{
+	return dl_internal_store_instances( dl_ctx, type_id, (const uint8_t*)instance, 1, false, out_buffer, out_buffer_size, produced_bytes, store_params );
+}
+
+dl_error_t dl_instance_store_batch( dl_ctx_t       dl_ctx,     dl_typeid_t type_id,         const void* instances, unsigned int instance_count,
+									unsigned char* out_buffer, size_t      out_buffer_size, size_t*     produced_bytes,
+									const dl_store_params_t* store_params )
+{
+	return dl_internal_store_instances( dl_ctx, type_id, (const uint8_t*)instances, instance_count, true, out_buffer, out_buffer_size, produced_bytes, store_params );
+}
+
+dl_error_t dl_instance_copy( dl_ctx_t dl_ctx,     dl_typeid_t type_id,         const void* instance,
+							 void*    out_buffer, size_t      out_buffer_size, size_t*     produced_bytes )
+{
+	const dl_type_desc* type = dl_internal_find_type( dl_ctx, type_id );
+	if( type == 0x0 )
+		return DL_ERROR_TYPE_NOT_FOUND;
+
+	// the copy is stored as a packed instance in host-layout, but with ptrs written as addresses in out_buffer.
+	CDLBinStoreContext store_context( dl_ctx, (uint8_t*)out_buffer, out_buffer_size, out_buffer_size == 0, DL_STOREFLAGS_NONE, DL_ENDIAN_HOST, DL_PTR_SIZE_HOST );
+	store_context.write_loaded = true;
+	store_context.loaded_base  = (uintptr_t)out_buffer;
 
 	dl_binary_writer_reserve( &store_context.writer, type->size[DL_PTR_SIZE_HOST] );
-	store_context.AddWrittenPtr(instance, 0); // if pointer refere to root-node, it can be found at offset 0
+	store_context.AddWrittenPtr( instance, 0 );
 
 	dl_error_t err = dl_internal_instance_store( dl_ctx, type, (uint8_t*)instance, &store_context );
+	if( store_context.out_of_memory )
+		return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
 
-	// write instance size!
-	dl_data_header* out_header = (dl_data_header*)out_buffer;
 	dl_binary_writer_seek_end( &store_context.writer );
-	if( out_buffer )
-		out_header->instance_size = (uint32_t)dl_binary_writer_tell( &store_context.writer );
-
+	size_t copy_size = dl_binary_writer_tell( &store_context.writer );
 	if( produced_bytes )
-		*produced_bytes = (uint32_t)dl_binary_writer_tell( &store_context.writer ) + sizeof(dl_data_header);
+		*produced_bytes = copy_size;
 
-	if( out_buffer_size > 0 && out_header->instance_size > out_buffer_size )
+	if( out_buffer_size > 0 && copy_size > out_buffer_size )
 		return DL_ERROR_BUFFER_TO_SMALL;
 
 	return err;
 }
 
+dl_error_t dl_instance_store( dl_ctx_t       dl_ctx,     dl_typeid_t type_id,         const void* instance,
+							  unsigned char* out_buffer, size_t      out_buffer_size, size_t*     produced_bytes )
+{
+	return dl_instance_store_ex( dl_ctx, type_id, instance, out_buffer, out_buffer_size, produced_bytes, 0x0 );
+}
+
 dl_error_t dl_instance_calc_size( dl_ctx_t dl_ctx, dl_typeid_t type, void* instance, size_t* out_size )
 {
 	return dl_instance_store( dl_ctx, type, instance, 0x0, 0, out_size );
@@ -485,6 +1218,11 @@ const char* dl_error_to_string( dl_error_t error )
 
 		DL_ERR_TO_STR(DL_ERROR_UTIL_FILE_NOT_FOUND);
 		DL_ERR_TO_STR(DL_ERROR_UTIL_FILE_TYPE_MISMATCH);
+		DL_ERR_TO_STR(DL_ERROR_UTIL_END_OF_STREAM);
+		DL_ERR_TO_STR(DL_ERROR_UTIL_IO_ERROR);
+		DL_ERR_TO_STR(DL_ERROR_CHECKSUM_MISMATCH);
+		DL_ERR_TO_STR(DL_ERROR_TYPE_LAYOUT_MISMATCH);
+		DL_ERR_TO_STR(DL_ERROR_MEMBER_NOT_FOUND);
 
 		DL_ERR_TO_STR(DL_ERROR_INTERNAL_ERROR);
 		default: return "Unknown error!";
@@ -496,23 +1234,29 @@ dl_error_t dl_instance_get_info( const unsigned char* packed_instance, size_t pa
 {
 	dl_data_header* header = (dl_data_header*)packed_instance;
 
-	if( packed_instance_size < sizeof(dl_data_header) && header->id != DL_INSTANCE_ID_SWAPED && header->id != DL_INSTANCE_ID )
+	if( packed_instance_size < sizeof(dl_data_header) )
+		return DL_ERROR_MALFORMED_DATA;
+	if( header->id != DL_INSTANCE_ID_SWAPED && header->id != DL_INSTANCE_ID )
 		return DL_ERROR_MALFORMED_DATA;
-	if(header->version != DL_INSTANCE_VERSION && header->version != DL_INSTANCE_VERSION_SWAPED)
+	if( !dl_internal_is_instance_version( header->version ) && !dl_internal_is_instance_version_swaped( header->version ) )
 		return DL_ERROR_VERSION_MISMATCH;
 
+	dl_data_header host_header = *header;
+	if( header->id == DL_INSTANCE_ID_SWAPED )
+		dl_swap_header( &host_header );
+
 	out_info->ptrsize   = header->is_64_bit_ptr ? 8 : 4;
-	if( header->id == DL_INSTANCE_ID )
-	{
-		out_info->load_size = header->instance_size;
-		out_info->endian    = DL_ENDIAN_HOST;
-		out_info->root_type = header->root_instance_type ;
-	}
-	else
+	out_info->load_size = (size_t)dl_internal_header_instance_size( &host_header );
+	out_info->endian    = header->id == DL_INSTANCE_ID ? DL_ENDIAN_HOST : dl_other_endian( DL_ENDIAN_HOST );
+	out_info->root_type = host_header.root_instance_type;
+
+	out_info->layout_fingerprint = 0;
+	uint64_t fingerprint_offset  = dl_internal_header_fingerprint_offset( &host_header );
+	if( ( host_header.flags & DL_DATA_HEADER_FLAG_FINGERPRINT ) && fingerprint_offset + sizeof(uint32_t) <= packed_instance_size )
 	{
-		out_info->load_size = dl_swap_endian_uint32( header->instance_size );
-		out_info->endian    = dl_other_endian( DL_ENDIAN_HOST );
-		out_info->root_type = dl_swap_endian_uint32( header->root_instance_type );
+		memcpy( &out_info->layout_fingerprint, packed_instance + fingerprint_offset, sizeof(uint32_t) );
+		if( header->id == DL_INSTANCE_ID_SWAPED )
+			out_info->layout_fingerprint = dl_swap_endian_uint32( out_info->layout_fingerprint );
 	}
 
 	return DL_ERROR_OK;
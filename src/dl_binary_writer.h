@@ -22,6 +22,7 @@ struct dl_binary_writer
 	size_t        needed_size;
 	uint8_t*      data;
 	size_t        data_size;
+	bool          zero_reserved; // zero-fill memory on dl_binary_writer_reserve.
 };
 
 static inline void dl_binary_writer_init( dl_binary_writer* writer,
@@ -37,6 +38,7 @@ static inline void dl_binary_writer_init( dl_binary_writer* writer,
 	writer->needed_size    = 0;
 	writer->data           = out_data;
 	writer->data_size      = out_data_size;
+	writer->zero_reserved  = false;
 }
 
 static inline void   dl_binary_writer_seek_set( dl_binary_writer* writer, size_t pos ) { writer->pos  = pos;                 DL_LOG_BIN_WRITER_VERBOSE("Seek Set: " DL_PINT_FMT_STR, writer->pos); }
@@ -222,6 +224,11 @@ static inline void dl_binary_writer_write_zero( dl_binary_writer* writer, size_t
 static inline void dl_binary_writer_reserve( dl_binary_writer* writer, size_t bytes )
 {
 	DL_LOG_BIN_WRITER_VERBOSE( "Reserve: " DL_PINT_FMT_STR " + " DL_PINT_FMT_STR, writer->pos, bytes );
+	if( writer->zero_reserved && !writer->dummy && writer->pos < writer->data_size )
+	{
+		size_t end = writer->pos + bytes < writer->data_size ? writer->pos + bytes : writer->data_size;
+		memset( writer->data + writer->pos, 0x0, end - writer->pos );
+	}
 	writer->needed_size = writer->needed_size >= writer->pos + bytes ? writer->needed_size : writer->pos + bytes;
 }
 
@@ -0,0 +1,647 @@
+/* copyright (c) 2010 Fredrik Kihlander, see LICENSE for more info */
+
+#include <dl/dl_builder.h>
+#include "dl_types.h"
+#include "dl_hash.h"
+#include "container/dl_hash_table.h"
+
+struct dl_builder_array
+{
+	size_t   member_pos; // position of the array-member in the instance-data.
+	uint32_t capacity;   // number of elements there is room for at the array-data.
+};
+
+struct dl_builder_array_eq
+{
+	size_t member_pos;
+	bool operator()( const dl_builder_array& array ) const { return array.member_pos == member_pos; }
+};
+
+struct dl_builder
+{
+	dl_ctx_t      ctx;
+	dl_typeid_t   root_type;
+	dl_ptr_size_t ptr_size;
+	uint8_t*      data;      // instance-data of the packed instance being built.
+	size_t        size;
+	size_t        capacity;
+
+	// capacity of each array that has been pushed to or reserved.
+	dl_hash_table<dl_builder_array> arrays;
+
+	// positions of all ptrs set by dl_builder_set_ptr, these might point into array-data that is moved.
+	size_t* set_ptrs;
+	size_t  set_ptrs_count;
+	size_t  set_ptrs_capacity;
+
+	uint64_t NullOffset() const { return DL_NULL_PTR_OFFSET[ptr_size]; }
+	size_t   PtrSize()    const { return ptr_size == DL_PTR_SIZE_64BIT ? 8 : 4; }
+
+	uint64_t ReadPtr( size_t pos ) const
+	{
+		if( ptr_size == DL_PTR_SIZE_32BIT )
+		{
+			uint32_t offset;
+			memcpy( &offset, data + pos, sizeof(offset) );
+			return offset;
+		}
+		uint64_t offset;
+		memcpy( &offset, data + pos, sizeof(offset) );
+		return offset;
+	}
+
+	void WritePtr( size_t pos, uint64_t offset )
+	{
+		if( ptr_size == DL_PTR_SIZE_32BIT )
+		{
+			uint32_t offset32 = (uint32_t)offset;
+			memcpy( data + pos, &offset32, sizeof(offset32) );
+		}
+		else
+			memcpy( data + pos, &offset, sizeof(offset) );
+	}
+
+	// add size zeroed bytes aligned to alignment at the end of the instance-data.
+	bool Append( size_t bytes, size_t alignment, size_t* out_pos )
+	{
+		size_t pos  = dl_internal_align_up( size, alignment );
+		size_t need = pos + bytes;
+		if( need > capacity )
+		{
+			size_t new_capacity = capacity * 2 > need ? capacity * 2 : need;
+			uint8_t* new_data = (uint8_t*)dl_alloc( &ctx->alloc, new_capacity );
+			if( new_data == 0x0 )
+				return false;
+			if( data != 0x0 )
+			{
+				memcpy( new_data, data, size );
+				dl_free( &ctx->alloc, data );
+			}
+			data     = new_data;
+			capacity = new_capacity;
+		}
+		memset( data + size, 0x0, need - size );
+		size     = need;
+		*out_pos = pos;
+		return true;
+	}
+
+	bool TrackSetPtr( size_t pos )
+	{
+		if( set_ptrs_count == set_ptrs_capacity )
+		{
+			size_t new_capacity = set_ptrs_capacity == 0 ? 16 : set_ptrs_capacity * 2;
+			size_t* new_set_ptrs = (size_t*)dl_alloc( &ctx->alloc, new_capacity * sizeof(size_t) );
+			if( new_set_ptrs == 0x0 )
+				return false;
+			if( set_ptrs != 0x0 )
+			{
+				memcpy( new_set_ptrs, set_ptrs, set_ptrs_count * sizeof(size_t) );
+				dl_free( &ctx->alloc, set_ptrs );
+			}
+			set_ptrs          = new_set_ptrs;
+			set_ptrs_capacity = new_capacity;
+		}
+		set_ptrs[set_ptrs_count++] = pos;
+		return true;
+	}
+
+	// stop tracking set ptrs in [begin, end), i.e. when that memory is reused by another union-member.
+	void UntrackSetPtrs( size_t begin, size_t end )
+	{
+		size_t kept = 0;
+		for( size_t i = 0; i < set_ptrs_count; ++i )
+			if( set_ptrs[i] < begin || set_ptrs[i] >= end )
+				set_ptrs[kept++] = set_ptrs[i];
+		set_ptrs_count = kept;
+	}
+
+	// array-data in [begin, end) has been copied to new_begin, move set ptrs stored in the data and rewrite set ptrs
+	// pointing into it.
+	void MoveSetPtrs( size_t begin, size_t end, size_t new_begin )
+	{
+		for( size_t i = 0; i < set_ptrs_count; ++i )
+			if( set_ptrs[i] >= begin && set_ptrs[i] < end )
+				set_ptrs[i] = set_ptrs[i] - begin + new_begin;
+
+		// a ptr tracked more than once is only rewritten once as the new data never overlap the old.
+		for( size_t i = 0; i < set_ptrs_count; ++i )
+		{
+			uint64_t offset = ReadPtr( set_ptrs[i] );
+			if( offset >= begin && offset < end )
+				WritePtr( set_ptrs[i], offset - begin + new_begin );
+		}
+	}
+};
+
+static size_t dl_internal_builder_element_size( dl_builder_t builder, dl_type_storage_t storage, const dl_type_desc* sub_type )
+{
+	switch( storage )
+	{
+		case DL_TYPE_STORAGE_STRUCT: return dl_internal_align_up( sub_type->size[builder->ptr_size], sub_type->alignment[builder->ptr_size] );
+		case DL_TYPE_STORAGE_STR:
+		case DL_TYPE_STORAGE_PTR:    return builder->PtrSize();
+		default:                     return dl_pod_size( storage );
+	}
+}
+
+static size_t dl_internal_builder_element_alignment( dl_builder_t builder, dl_type_storage_t storage, const dl_type_desc* sub_type )
+{
+	switch( storage )
+	{
+		case DL_TYPE_STORAGE_STRUCT: return sub_type->alignment[builder->ptr_size];
+		case DL_TYPE_STORAGE_STR:
+		case DL_TYPE_STORAGE_PTR:    return builder->PtrSize();
+		default:                     return dl_pod_size( storage );
+	}
+}
+
+static void dl_internal_builder_init_struct( dl_builder_t builder, const dl_type_desc* type, size_t pos );
+
+// initialize an element of a member to unset in zeroed memory, i.e. set strings and ptrs to null.
+static void dl_internal_builder_init_element( dl_builder_t builder, dl_type_storage_t storage, const dl_type_desc* sub_type, size_t pos )
+{
+	switch( storage )
+	{
+		case DL_TYPE_STORAGE_STRUCT: dl_internal_builder_init_struct( builder, sub_type, pos ); break;
+		case DL_TYPE_STORAGE_STR:
+		case DL_TYPE_STORAGE_PTR:    builder->WritePtr( pos, builder->NullOffset() ); break;
+		default: break;
+	}
+}
+
+static void dl_internal_builder_init_member( dl_builder_t builder, const dl_member_desc* member, size_t pos )
+{
+	dl_type_storage_t   storage  = member->StorageType();
+	const dl_type_desc* sub_type = storage == DL_TYPE_STORAGE_STRUCT ? dl_internal_find_type( builder->ctx, member->type_id ) : 0x0;
+	switch( member->AtomType() )
+	{
+		case DL_TYPE_ATOM_POD:
+			dl_internal_builder_init_element( builder, storage, sub_type, pos );
+			break;
+		case DL_TYPE_ATOM_INLINE_ARRAY:
+		{
+			size_t elem_size = dl_internal_builder_element_size( builder, storage, sub_type );
+			size_t count     = member->size[builder->ptr_size] / elem_size;
+			for( size_t elem = 0; elem < count; ++elem )
+				dl_internal_builder_init_element( builder, storage, sub_type, pos + elem * elem_size );
+		}
+		break;
+		case DL_TYPE_ATOM_ARRAY:
+			builder->WritePtr( pos, builder->NullOffset() );
+			break;
+		default:
+			break;
+	}
+}
+
+static void dl_internal_builder_select_union_member( dl_builder_t builder, const dl_type_desc* type, size_t pos, uint32_t member_index )
+{
+	size_t   type_offset = dl_internal_union_type_offset( builder->ctx, type, builder->ptr_size );
+	uint32_t union_type  = dl_internal_typeid_of( builder->ctx, type ) + member_index + 1;
+	memset( builder->data + pos, 0x0, type_offset );
+	memcpy( builder->data + pos + type_offset, &union_type, sizeof(uint32_t) );
+
+	const dl_member_desc* member = dl_get_type_member( builder->ctx, type, member_index );
+	dl_internal_builder_init_member( builder, member, pos + member->offset[builder->ptr_size] );
+}
+
+static void dl_internal_builder_init_struct( dl_builder_t builder, const dl_type_desc* type, size_t pos )
+{
+	// an unset union is set to its first member to always be valid.
+	if( type->flags & DL_TYPE_FLAG_IS_UNION )
+	{
+		dl_internal_builder_select_union_member( builder, type, pos, 0 );
+		return;
+	}
+
+	for( uint32_t member_index = 0; member_index < type->member_count; ++member_index )
+	{
+		const dl_member_desc* member = dl_get_type_member( builder->ctx, type, member_index );
+		dl_internal_builder_init_member( builder, member, pos + member->offset[builder->ptr_size] );
+	}
+}
+
+static dl_error_t dl_internal_builder_find_member( dl_builder_t builder, const dl_builder_struct_t* parent, dl_member_handle_t member, const dl_member_desc** out_member, size_t* out_pos )
+{
+	if( parent->type != member.type )
+		return DL_ERROR_TYPE_MISMATCH;
+
+	const dl_type_desc* type = dl_internal_find_type( builder->ctx, parent->type );
+	if( type == 0x0 )
+		return DL_ERROR_TYPE_NOT_FOUND;
+	if( member.member_index >= type->member_count )
+		return DL_ERROR_MEMBER_NOT_FOUND;
+
+	const dl_member_desc* member_desc = dl_get_type_member( builder->ctx, type, member.member_index );
+	if( type->flags & DL_TYPE_FLAG_IS_UNION )
+	{
+		uint32_t union_type;
+		memcpy( &union_type, builder->data + parent->offset + dl_internal_union_type_offset( builder->ctx, type, builder->ptr_size ), sizeof(uint32_t) );
+		if( union_type != dl_internal_typeid_of( builder->ctx, type ) + member.member_index + 1 )
+		{
+			builder->UntrackSetPtrs( parent->offset, parent->offset + dl_internal_union_type_offset( builder->ctx, type, builder->ptr_size ) );
+			dl_internal_builder_select_union_member( builder, type, parent->offset, member.member_index );
+		}
+	}
+
+	*out_member = member_desc;
+	*out_pos    = parent->offset + member_desc->offset[builder->ptr_size];
+	return DL_ERROR_OK;
+}
+
+// find the position of element index of the member at member_pos.
+static dl_error_t dl_internal_builder_find_element( dl_builder_t builder, const dl_member_desc* member, size_t member_pos, unsigned int index, const dl_type_desc* sub_type, size_t* out_pos )
+{
+	dl_type_storage_t storage = member->StorageType();
+	switch( member->AtomType() )
+	{
+		case DL_TYPE_ATOM_POD:
+			if( index != 0 )
+				return DL_ERROR_INVALID_PARAMETER;
+			*out_pos = member_pos;
+			return DL_ERROR_OK;
+		case DL_TYPE_ATOM_INLINE_ARRAY:
+		{
+			size_t elem_size = dl_internal_builder_element_size( builder, storage, sub_type );
+			if( index >= member->size[builder->ptr_size] / elem_size )
+				return DL_ERROR_INVALID_PARAMETER;
+			*out_pos = member_pos + index * elem_size;
+			return DL_ERROR_OK;
+		}
+		case DL_TYPE_ATOM_ARRAY:
+		{
+			uint32_t count;
+			memcpy( &count, builder->data + member_pos + builder->PtrSize(), sizeof(uint32_t) );
+			if( index >= count )
+				return DL_ERROR_INVALID_PARAMETER;
+			*out_pos = (size_t)builder->ReadPtr( member_pos ) + index * dl_internal_builder_element_size( builder, storage, sub_type );
+			return DL_ERROR_OK;
+		}
+		default:
+			return DL_ERROR_TYPE_MISMATCH;
+	}
+}
+
+// find the element index of a member with the expected storage.
+static dl_error_t dl_internal_builder_find_typed_element( dl_builder_t builder, const dl_builder_struct_t* parent, dl_member_handle_t member, unsigned int index, dl_type_storage_t storage,
+														 const dl_member_desc** out_member, size_t* out_pos )
+{
+	const dl_member_desc* member_desc;
+	size_t member_pos;
+	dl_error_t err = dl_internal_builder_find_member( builder, parent, member, &member_desc, &member_pos );
+	if( err != DL_ERROR_OK )
+		return err;
+	if( member_desc->StorageType() != storage )
+		return DL_ERROR_TYPE_MISMATCH;
+
+	const dl_type_desc* sub_type = 0x0;
+	if( storage == DL_TYPE_STORAGE_STRUCT )
+	{
+		sub_type = dl_internal_find_type( builder->ctx, member_desc->type_id );
+		if( sub_type == 0x0 )
+			return DL_ERROR_TYPE_NOT_FOUND;
+	}
+
+	*out_member = member_desc;
+	return dl_internal_builder_find_element( builder, member_desc, member_pos, index, sub_type, out_pos );
+}
+
+dl_error_t dl_builder_begin( dl_ctx_t dl_ctx, dl_typeid_t type_id, unsigned int ptr_size, dl_builder_t* out_builder, dl_builder_struct_t* out_root )
+{
+	dl_ptr_size_t builder_ptr_size;
+	switch( ptr_size )
+	{
+		case 4: builder_ptr_size = DL_PTR_SIZE_32BIT; break;
+		case 8: builder_ptr_size = DL_PTR_SIZE_64BIT; break;
+		default: return DL_ERROR_INVALID_PARAMETER;
+	}
+
+	const dl_type_desc* type = dl_internal_find_type( dl_ctx, type_id );
+	if( type == 0x0 )
+		return DL_ERROR_TYPE_NOT_FOUND;
+
+	dl_builder_t builder = (dl_builder_t)dl_alloc( &dl_ctx->alloc, sizeof(dl_builder) );
+	if( builder == 0x0 )
+		return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+
+	builder->ctx       = dl_ctx;
+	builder->root_type = type_id;
+	builder->ptr_size  = builder_ptr_size;
+	builder->data      = 0x0;
+	builder->size      = 0;
+	builder->capacity  = 0;
+	builder->arrays.init( &dl_ctx->alloc );
+	builder->set_ptrs          = 0x0;
+	builder->set_ptrs_count    = 0;
+	builder->set_ptrs_capacity = 0;
+
+	size_t root_pos;
+	if( !builder->Append( type->size[builder_ptr_size], type->alignment[builder_ptr_size], &root_pos ) )
+	{
+		dl_builder_free( builder );
+		return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+	}
+	dl_internal_builder_init_struct( builder, type, root_pos );
+
+	out_root->offset = root_pos;
+	out_root->type   = type_id;
+	*out_builder = builder;
+	return DL_ERROR_OK;
+}
+
+dl_error_t dl_builder_set( dl_builder_t builder, const dl_builder_struct_t* parent, dl_member_handle_t member, unsigned int index, const void* value, size_t value_size )
+{
+	const dl_member_desc* member_desc;
+	size_t member_pos;
+	dl_error_t err = dl_internal_builder_find_member( builder, parent, member, &member_desc, &member_pos );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	uint8_t* data = builder->data + member_pos;
+	if( member_desc->AtomType() == DL_TYPE_ATOM_BITFIELD )
+	{
+		uint32_t size = member_desc->size[builder->ptr_size];
+		if( index != 0 )
+			return DL_ERROR_INVALID_PARAMETER;
+		if( value_size != size )
+			return DL_ERROR_TYPE_MISMATCH;
+
+		uint64_t bf_value   = 0;
+		uint64_t bf_storage = 0;
+		uint32_t bits       = member_desc->bitfield_bits();
+		uint64_t offset     = dl_bf_offset( DL_ENDIAN_HOST, size, member_desc->bitfield_offset(), bits );
+		switch( size )
+		{
+			case 1: { uint8_t  v; memcpy( &v, value, size ); bf_value = v; memcpy( &v, data, size ); bf_storage = v; } break;
+			case 2: { uint16_t v; memcpy( &v, value, size ); bf_value = v; memcpy( &v, data, size ); bf_storage = v; } break;
+			case 4: { uint32_t v; memcpy( &v, value, size ); bf_value = v; memcpy( &v, data, size ); bf_storage = v; } break;
+			case 8: { uint64_t v; memcpy( &v, value, size ); bf_value = v; memcpy( &v, data, size ); bf_storage = v; } break;
+			default: return DL_ERROR_TYPE_MISMATCH;
+		}
+
+		bf_storage = DL_INSERT_BITS( bf_storage, bf_value, offset, (uint64_t)bits );
+		switch( size )
+		{
+			case 1: { uint8_t  v = (uint8_t) bf_storage; memcpy( data, &v, size ); } break;
+			case 2: { uint16_t v = (uint16_t)bf_storage; memcpy( data, &v, size ); } break;
+			case 4: { uint32_t v = (uint32_t)bf_storage; memcpy( data, &v, size ); } break;
+			case 8: {                                    memcpy( data, &bf_storage, size ); } break;
+		}
+		return DL_ERROR_OK;
+	}
+
+	dl_type_storage_t storage = member_desc->StorageType();
+	if( storage == DL_TYPE_STORAGE_STRUCT || storage == DL_TYPE_STORAGE_STR || storage == DL_TYPE_STORAGE_PTR || value_size != dl_pod_size( storage ) )
+		return DL_ERROR_TYPE_MISMATCH;
+
+	size_t elem_pos;
+	err = dl_internal_builder_find_element( builder, member_desc, member_pos, index, 0x0, &elem_pos );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	memcpy( builder->data + elem_pos, value, value_size );
+	return DL_ERROR_OK;
+}
+
+dl_error_t dl_builder_set_string( dl_builder_t builder, const dl_builder_struct_t* parent, dl_member_handle_t member, unsigned int index, const char* str )
+{
+	const dl_member_desc* member_desc;
+	size_t elem_pos;
+	dl_error_t err = dl_internal_builder_find_typed_element( builder, parent, member, index, DL_TYPE_STORAGE_STR, &member_desc, &elem_pos );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	if( str == 0x0 )
+	{
+		builder->WritePtr( elem_pos, builder->NullOffset() );
+		return DL_ERROR_OK;
+	}
+
+	size_t len = strlen( str );
+	size_t str_pos;
+	if( !builder->Append( len + 1, 1, &str_pos ) )
+		return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+	memcpy( builder->data + str_pos, str, len );
+	builder->WritePtr( elem_pos, str_pos );
+	return DL_ERROR_OK;
+}
+
+dl_error_t dl_builder_set_ptr( dl_builder_t builder, const dl_builder_struct_t* parent, dl_member_handle_t member, unsigned int index, const dl_builder_struct_t* target )
+{
+	const dl_member_desc* member_desc;
+	size_t elem_pos;
+	dl_error_t err = dl_internal_builder_find_typed_element( builder, parent, member, index, DL_TYPE_STORAGE_PTR, &member_desc, &elem_pos );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	if( target == 0x0 )
+	{
+		builder->WritePtr( elem_pos, builder->NullOffset() );
+		return DL_ERROR_OK;
+	}
+
+	if( target->type != member_desc->type_id )
+		return DL_ERROR_TYPE_MISMATCH;
+	if( target->offset >= builder->size )
+		return DL_ERROR_INVALID_PARAMETER;
+	if( !builder->TrackSetPtr( elem_pos ) )
+		return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+	builder->WritePtr( elem_pos, target->offset );
+	return DL_ERROR_OK;
+}
+
+dl_error_t dl_builder_struct( dl_builder_t builder, const dl_builder_struct_t* parent, dl_member_handle_t member, unsigned int index, dl_builder_struct_t* out_struct )
+{
+	const dl_member_desc* member_desc;
+	size_t member_pos;
+	dl_error_t err = dl_internal_builder_find_member( builder, parent, member, &member_desc, &member_pos );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	dl_type_storage_t storage = member_desc->StorageType();
+	if( storage != DL_TYPE_STORAGE_STRUCT && storage != DL_TYPE_STORAGE_PTR )
+		return DL_ERROR_TYPE_MISMATCH;
+
+	const dl_type_desc* sub_type = dl_internal_find_type( builder->ctx, member_desc->type_id );
+	if( sub_type == 0x0 )
+		return DL_ERROR_TYPE_NOT_FOUND;
+
+	size_t elem_pos;
+	err = dl_internal_builder_find_element( builder, member_desc, member_pos, index, storage == DL_TYPE_STORAGE_STRUCT ? sub_type : 0x0, &elem_pos );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	if( storage == DL_TYPE_STORAGE_PTR )
+	{
+		uint64_t offset = builder->ReadPtr( elem_pos );
+		if( offset == builder->NullOffset() )
+		{
+			size_t struct_pos;
+			if( !builder->Append( sub_type->size[builder->ptr_size], sub_type->alignment[builder->ptr_size], &struct_pos ) )
+				return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+			dl_internal_builder_init_struct( builder, sub_type, struct_pos );
+			builder->WritePtr( elem_pos, struct_pos );
+			offset = struct_pos;
+		}
+		elem_pos = (size_t)offset;
+	}
+
+	out_struct->offset = elem_pos;
+	out_struct->type   = member_desc->type_id;
+	return DL_ERROR_OK;
+}
+
+// make room for capacity elements in the array-member at member_pos, moving the array-data to the end of the
+// instance-data if it can not grow in place.
+static dl_error_t dl_internal_builder_grow_array( dl_builder_t builder, const dl_member_desc* member, size_t member_pos, uint32_t capacity, dl_builder_array** out_array )
+{
+	dl_builder_array_eq eq = { member_pos };
+	uint32_t hash = dl_internal_hash_buffer( (const uint8_t*)&member_pos, sizeof(member_pos) );
+	dl_builder_array* array = builder->arrays.find( hash, eq );
+
+	uint32_t count;
+	memcpy( &count, builder->data + member_pos + builder->PtrSize(), sizeof(uint32_t) );
+	if( array == 0x0 )
+	{
+		dl_builder_array new_array = { member_pos, count };
+		if( !builder->arrays.insert( hash, new_array ) )
+			return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+		array = builder->arrays.find( hash, eq );
+	}
+	*out_array = array;
+
+	if( capacity <= array->capacity )
+		return DL_ERROR_OK;
+
+	dl_type_storage_t   storage   = member->StorageType();
+	const dl_type_desc* sub_type  = 0x0;
+	if( storage == DL_TYPE_STORAGE_STRUCT )
+	{
+		sub_type = dl_internal_find_type( builder->ctx, member->type_id );
+		if( sub_type == 0x0 )
+			return DL_ERROR_TYPE_NOT_FOUND;
+	}
+	size_t elem_size = dl_internal_builder_element_size( builder, storage, sub_type );
+	size_t data_pos  = array->capacity > 0 ? (size_t)builder->ReadPtr( member_pos ) : 0;
+
+	size_t new_pos;
+	if( array->capacity > 0 && data_pos + array->capacity * elem_size == builder->size )
+	{
+		if( !builder->Append( ( capacity - array->capacity ) * elem_size, 1, &new_pos ) )
+			return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+		new_pos = data_pos;
+	}
+	else
+	{
+		if( !builder->Append( capacity * elem_size, dl_internal_builder_element_alignment( builder, storage, sub_type ), &new_pos ) )
+			return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+		if( count > 0 )
+		{
+			memcpy( builder->data + new_pos, builder->data + data_pos, count * elem_size );
+			builder->MoveSetPtrs( data_pos, data_pos + count * elem_size, new_pos );
+		}
+		builder->WritePtr( member_pos, new_pos );
+	}
+
+	array->capacity = capacity;
+	return DL_ERROR_OK;
+}
+
+static dl_error_t dl_internal_builder_find_array( dl_builder_t builder, const dl_builder_struct_t* parent, dl_member_handle_t member, const dl_member_desc** out_member, size_t* out_pos )
+{
+	dl_error_t err = dl_internal_builder_find_member( builder, parent, member, out_member, out_pos );
+	if( err != DL_ERROR_OK )
+		return err;
+	if( (*out_member)->AtomType() != DL_TYPE_ATOM_ARRAY )
+		return DL_ERROR_TYPE_MISMATCH;
+	return DL_ERROR_OK;
+}
+
+dl_error_t dl_builder_push( dl_builder_t builder, const dl_builder_struct_t* parent, dl_member_handle_t member, unsigned int* out_index )
+{
+	const dl_member_desc* member_desc;
+	size_t member_pos;
+	dl_error_t err = dl_internal_builder_find_array( builder, parent, member, &member_desc, &member_pos );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	uint32_t count;
+	memcpy( &count, builder->data + member_pos + builder->PtrSize(), sizeof(uint32_t) );
+	if( count == 0xFFFFFFFF )
+		return DL_ERROR_INVALID_PARAMETER;
+
+	dl_builder_array* array;
+	err = dl_internal_builder_grow_array( builder, member_desc, member_pos, count, &array );
+	if( err != DL_ERROR_OK )
+		return err;
+	if( count == array->capacity )
+	{
+		uint32_t capacity = count < 4 ? 4 : ( count > 0x7FFFFFFF ? 0xFFFFFFFF : count * 2 );
+		err = dl_internal_builder_grow_array( builder, member_desc, member_pos, capacity, &array );
+		if( err != DL_ERROR_OK )
+			return err;
+	}
+
+	dl_type_storage_t   storage  = member_desc->StorageType();
+	const dl_type_desc* sub_type = storage == DL_TYPE_STORAGE_STRUCT ? dl_internal_find_type( builder->ctx, member_desc->type_id ) : 0x0;
+	size_t elem_pos = (size_t)builder->ReadPtr( member_pos ) + count * dl_internal_builder_element_size( builder, storage, sub_type );
+	memset( builder->data + elem_pos, 0x0, dl_internal_builder_element_size( builder, storage, sub_type ) );
+	dl_internal_builder_init_element( builder, storage, sub_type, elem_pos );
+
+	++count;
+	memcpy( builder->data + member_pos + builder->PtrSize(), &count, sizeof(uint32_t) );
+	if( out_index )
+		*out_index = count - 1;
+	return DL_ERROR_OK;
+}
+
+dl_error_t dl_builder_reserve( dl_builder_t builder, const dl_builder_struct_t* parent, dl_member_handle_t member, unsigned int capacity )
+{
+	const dl_member_desc* member_desc;
+	size_t member_pos;
+	dl_error_t err = dl_internal_builder_find_array( builder, parent, member, &member_desc, &member_pos );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	dl_builder_array* array;
+	return dl_internal_builder_grow_array( builder, member_desc, member_pos, capacity, &array );
+}
+
+dl_error_t dl_builder_finish( dl_builder_t builder, unsigned char* out_buffer, size_t out_buffer_size, size_t* produced_bytes )
+{
+	size_t instance_size = builder->size;
+	if( produced_bytes )
+		*produced_bytes = sizeof(dl_data_header) + instance_size;
+
+	// offsets in 32-bit ptrs can not address more than 4GB.
+	if( instance_size > DL_INSTANCE_MAX_SIZE || ( builder->ptr_size == DL_PTR_SIZE_32BIT && instance_size > 0xFFFFFFFF ) )
+		return DL_ERROR_UNSUPPORTED_OPERATION;
+
+	if( out_buffer_size == 0 )
+		return DL_ERROR_OK;
+	if( out_buffer_size < sizeof(dl_data_header) + instance_size )
+		return DL_ERROR_BUFFER_TO_SMALL;
+
+	dl_data_header header;
+	memset( &header, 0x0, sizeof(dl_data_header) );
+	header.id                 = DL_INSTANCE_ID;
+	header.root_instance_type = builder->root_type;
+	dl_internal_header_set_instance_size( &header, instance_size );
+	header.is_64_bit_ptr      = builder->ptr_size == DL_PTR_SIZE_64BIT ? 1 : 0;
+	memcpy( out_buffer, &header, sizeof(dl_data_header) );
+	memcpy( out_buffer + sizeof(dl_data_header), builder->data, instance_size );
+	return DL_ERROR_OK;
+}
+
+dl_error_t dl_builder_free( dl_builder_t builder )
+{
+	dl_ctx_t dl_ctx = builder->ctx;
+	builder->arrays.destroy();
+	if( builder->set_ptrs != 0x0 )
+		dl_free( &dl_ctx->alloc, builder->set_ptrs );
+	if( builder->data != 0x0 )
+		dl_free( &dl_ctx->alloc, builder->data );
+	dl_free( &dl_ctx->alloc, builder );
+	return DL_ERROR_OK;
+}
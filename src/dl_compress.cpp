@@ -0,0 +1,443 @@
+/* copyright (c) 2010 Fredrik Kihlander, see LICENSE for more info */
+
+#include <dl/dl_compress.h>
+#include "dl_types.h"
+
+/*
+	A compressed instance is laid out as:
+		dl_data_header            - header of the packed instance with DL_DATA_HEADER_FLAG_COMPRESSED set.
+		uint32_t block_size       - size of each decompressed block.
+		uint32_t block_count
+		uint32_t[block_count]     - compressed size of each block, DL_COMPRESS_BLOCK_RAW is set if the block is stored uncompressed.
+		compressed blocks
+
+	Everything is stored in the same endian as the header. Each block is compressed on its own with a byte-oriented
+	LZ77-codec, sequences of token, literals, 16-bit offset and match-length, so blocks can be decompressed in any order.
+*/
+
+static const uint32_t DL_COMPRESS_BLOCK_SIZE = 64 * 1024;
+static const uint32_t DL_COMPRESS_BLOCK_RAW  = 0x80000000;
+
+static const size_t   DL_LZ_MIN_MATCH     = 4;
+static const size_t   DL_LZ_MAX_OFFSET    = 0xFFFF;
+static const size_t   DL_LZ_LAST_LITERALS = 5; // the last bytes of a block are always stored as literals.
+static const uint32_t DL_LZ_HASH_BITS     = 12;
+
+static inline uint32_t dl_lz_read32( const uint8_t* p )
+{
+	uint32_t v;
+	memcpy( &v, p, sizeof(v) );
+	return v;
+}
+
+static inline uint32_t dl_lz_hash( uint32_t v )
+{
+	return ( v * 2654435761u ) >> ( 32 - DL_LZ_HASH_BITS );
+}
+
+static inline uint8_t* dl_lz_write_length( uint8_t* op, uint8_t* op_end, size_t len )
+{
+	for( ; len >= 255; len -= 255 )
+	{
+		if( op == op_end )
+			return 0x0;
+		*op++ = 255;
+	}
+	if( op == op_end )
+		return 0x0;
+	*op++ = (uint8_t)len;
+	return op;
+}
+
+static inline uint8_t* dl_lz_write_literals( uint8_t* op, uint8_t* op_end, const uint8_t* literals, size_t lit_len, size_t match_len )
+{
+	if( op == op_end )
+		return 0x0;
+
+	uint8_t* token = op++;
+	*token = (uint8_t)( ( lit_len >= 15 ? 15 : lit_len ) << 4 ) | (uint8_t)( match_len >= 15 ? 15 : match_len );
+	if( lit_len >= 15 && ( op = dl_lz_write_length( op, op_end, lit_len - 15 ) ) == 0x0 )
+		return 0x0;
+	if( (size_t)( op_end - op ) < lit_len )
+		return 0x0;
+
+	memcpy( op, literals, lit_len );
+	return op + lit_len;
+}
+
+/*
+	Compress in to out, returns compressed size or 0 if the compressed data do not fit in out_size bytes.
+*/
+static size_t dl_lz_compress( const uint8_t* in, size_t in_size, uint8_t* out, size_t out_size )
+{
+	uint32_t table[1 << DL_LZ_HASH_BITS];
+	memset( table, 0xFF, sizeof(table) );
+
+	const uint8_t* ip     = in;
+	const uint8_t* anchor = in;
+	const uint8_t* in_end = in + in_size;
+	uint8_t*       op     = out;
+	uint8_t*       op_end = out + out_size;
+
+	if( in_size > DL_LZ_LAST_LITERALS + DL_LZ_MIN_MATCH )
+	{
+		const uint8_t* match_limit = in_end - DL_LZ_LAST_LITERALS;
+		const uint8_t* ip_limit    = match_limit - DL_LZ_MIN_MATCH;
+
+		while( ip <= ip_limit )
+		{
+			uint32_t seq     = dl_lz_read32( ip );
+			uint32_t hash    = dl_lz_hash( seq );
+			uint32_t ref_pos = table[hash];
+			table[hash] = (uint32_t)( ip - in );
+
+			if( ref_pos == 0xFFFFFFFF || (size_t)( ip - in ) - ref_pos > DL_LZ_MAX_OFFSET || dl_lz_read32( in + ref_pos ) != seq )
+			{
+				++ip;
+				continue;
+			}
+
+			const uint8_t* ref = in + ref_pos;
+			size_t match_len = DL_LZ_MIN_MATCH;
+			while( ip + match_len < match_limit && ref[match_len] == ip[match_len] )
+				++match_len;
+
+			size_t ml = match_len - DL_LZ_MIN_MATCH;
+			op = dl_lz_write_literals( op, op_end, anchor, (size_t)( ip - anchor ), ml );
+			if( op == 0x0 || op_end - op < 2 )
+				return 0;
+
+			size_t offset = (size_t)( ip - ref );
+			*op++ = (uint8_t)( offset & 0xFF );
+			*op++ = (uint8_t)( offset >> 8 );
+			if( ml >= 15 && ( op = dl_lz_write_length( op, op_end, ml - 15 ) ) == 0x0 )
+				return 0;
+
+			ip    += match_len;
+			anchor = ip;
+		}
+	}
+
+	// the last sequence only has literals.
+	op = dl_lz_write_literals( op, op_end, anchor, (size_t)( in_end - anchor ), 0 );
+	return op == 0x0 ? 0 : (size_t)( op - out );
+}
+
+static inline bool dl_lz_read_length( const uint8_t** ip, const uint8_t* ip_end, size_t* len )
+{
+	uint8_t b;
+	do
+	{
+		if( *ip == ip_end )
+			return false;
+		b = *(*ip)++;
+		*len += b;
+	}
+	while( b == 255 );
+	return true;
+}
+
+/*
+	Decompress in to out, returns false if in is malformed or do not decompress to exactly out_size bytes.
+*/
+static bool dl_lz_decompress( const uint8_t* in, size_t in_size, uint8_t* out, size_t out_size )
+{
+	const uint8_t* ip     = in;
+	const uint8_t* ip_end = in + in_size;
+	uint8_t*       op     = out;
+	uint8_t*       op_end = out + out_size;
+
+	while( ip < ip_end )
+	{
+		uint8_t token = *ip++;
+
+		size_t lit_len = token >> 4;
+		if( lit_len == 15 && !dl_lz_read_length( &ip, ip_end, &lit_len ) )
+			return false;
+		if( (size_t)( ip_end - ip ) < lit_len || (size_t)( op_end - op ) < lit_len )
+			return false;
+
+		memcpy( op, ip, lit_len );
+		op += lit_len;
+		ip += lit_len;
+
+		if( ip == ip_end )
+			break;
+
+		if( ip_end - ip < 2 )
+			return false;
+		size_t offset = (size_t)ip[0] | ( (size_t)ip[1] << 8 );
+		ip += 2;
+
+		size_t match_len = token & 15;
+		if( match_len == 15 && !dl_lz_read_length( &ip, ip_end, &match_len ) )
+			return false;
+		match_len += DL_LZ_MIN_MATCH;
+
+		if( offset == 0 || offset > (size_t)( op - out ) || (size_t)( op_end - op ) < match_len )
+			return false;
+
+		const uint8_t* match = op - offset;
+		if( offset >= match_len )
+			memcpy( op, match, match_len );
+		else
+			for( size_t i = 0; i < match_len; ++i ) // overlapping match, repeat pattern.
+				op[i] = match[i];
+		op += match_len;
+	}
+
+	return op == op_end;
+}
+
+static inline uint32_t dl_internal_compress_read_u32( const uint8_t* p, bool swap )
+{
+	uint32_t v;
+	memcpy( &v, p, sizeof(v) );
+	return swap ? dl_swap_endian_uint32( v ) : v;
+}
+
+static inline void dl_internal_compress_write_u32( uint8_t* p, uint32_t v, bool swap )
+{
+	if( swap )
+		v = dl_swap_endian_uint32( v );
+	memcpy( p, &v, sizeof(v) );
+}
+
+dl_error_t dl_internal_decompress_instance_data( const uint8_t* data,        size_t   data_size,   uint64_t instance_size, bool    swap,
+												 uint8_t*       out_data,    uint32_t first_block, uint32_t block_count,   size_t* consumed )
+{
+	if( data_size < sizeof(uint32_t) * 2 )
+		return DL_ERROR_MALFORMED_DATA;
+
+	uint32_t block_size  = dl_internal_compress_read_u32( data, swap );
+	uint32_t num_blocks  = dl_internal_compress_read_u32( data + sizeof(uint32_t), swap );
+	if( block_size == 0 || num_blocks != ( instance_size + block_size - 1 ) / block_size )
+		return DL_ERROR_MALFORMED_DATA;
+
+	size_t pos = sizeof(uint32_t) * ( 2 + (size_t)num_blocks );
+	if( data_size < pos )
+		return DL_ERROR_MALFORMED_DATA;
+
+	uint64_t last_block = block_count == 0xFFFFFFFF ? num_blocks : (uint64_t)first_block + block_count;
+	if( first_block > num_blocks || last_block > num_blocks )
+		return DL_ERROR_INVALID_PARAMETER;
+
+	for( uint32_t block = 0; block < num_blocks; ++block )
+	{
+		if( block >= last_block && consumed == 0x0 )
+			break;
+
+		uint32_t entry = dl_internal_compress_read_u32( data + sizeof(uint32_t) * ( 2 + (size_t)block ), swap );
+		size_t   size  = entry & ~DL_COMPRESS_BLOCK_RAW;
+		if( data_size - pos < size )
+			return DL_ERROR_MALFORMED_DATA;
+
+		if( block >= first_block && block < last_block )
+		{
+			size_t   block_start = (size_t)block * block_size;
+			size_t   raw_size    = instance_size - block_start < block_size ? (size_t)( instance_size - block_start ) : block_size;
+			uint8_t* out         = out_data + block_start;
+
+			if( entry & DL_COMPRESS_BLOCK_RAW )
+			{
+				if( size != raw_size )
+					return DL_ERROR_MALFORMED_DATA;
+				memcpy( out, data + pos, size );
+			}
+			else if( !dl_lz_decompress( data + pos, size, out, raw_size ) )
+				return DL_ERROR_MALFORMED_DATA;
+		}
+
+		pos += size;
+	}
+
+	if( consumed )
+		*consumed = pos;
+	return DL_ERROR_OK;
+}
+
+/*
+	Read and validate header of packed instance, out_header is returned in host endian.
+*/
+static dl_error_t dl_internal_compress_read_header( const unsigned char* packed, size_t packed_size, dl_data_header* out_header, bool* out_swap )
+{
+	if( packed_size < sizeof(dl_data_header) )
+		return DL_ERROR_MALFORMED_DATA;
+
+	memcpy( out_header, packed, sizeof(dl_data_header) );
+	*out_swap = out_header->id == DL_INSTANCE_ID_SWAPED;
+	if( !*out_swap && out_header->id != DL_INSTANCE_ID )
+		return DL_ERROR_MALFORMED_DATA;
+
+	if( *out_swap )
+		dl_swap_header( out_header );
+
+	if( !dl_internal_is_instance_version( out_header->version ) )
+		return DL_ERROR_VERSION_MISMATCH;
+	return DL_ERROR_OK;
+}
+
+dl_error_t dl_compress( dl_ctx_t             dl_ctx,
+						const unsigned char* packed_instance, size_t  packed_instance_size,
+						unsigned char*       out_buffer,      size_t  out_buffer_size,
+						size_t*              produced_bytes )
+{
+	dl_data_header header;
+	bool swap;
+	dl_error_t err = dl_internal_compress_read_header( packed_instance, packed_instance_size, &header, &swap );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	if( header.flags & DL_DATA_HEADER_FLAG_COMPRESSED )
+		return DL_ERROR_UNSUPPORTED_OPERATION;
+	size_t instance_size    = (size_t)dl_internal_header_instance_size( &header );
+	size_t fingerprint_size = dl_internal_header_fingerprint_size( &header );
+	if( packed_instance_size - sizeof(dl_data_header) < dl_internal_header_instance_size( &header ) + fingerprint_size )
+		return DL_ERROR_MALFORMED_DATA;
+
+	uint64_t block_count_64 = ( (uint64_t)instance_size + DL_COMPRESS_BLOCK_SIZE - 1 ) / DL_COMPRESS_BLOCK_SIZE;
+	if( block_count_64 > 0xFFFFFFFE )
+		return DL_ERROR_UNSUPPORTED_OPERATION;
+
+	uint32_t block_count = (uint32_t)block_count_64;
+	size_t   table_pos   = sizeof(dl_data_header) + fingerprint_size; // the fingerprint is moved to directly after the header.
+	size_t   pos         = table_pos + sizeof(uint32_t) * ( 2 + (size_t)block_count );
+
+	// only write if all of the header and block-table fit, otherwise just calculate the size.
+	bool write = out_buffer_size >= pos;
+
+	uint8_t* block_buffer = (uint8_t*)dl_alloc( &dl_ctx->alloc, DL_COMPRESS_BLOCK_SIZE );
+	if( block_buffer == 0x0 )
+		return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+
+	const uint8_t* data = packed_instance + sizeof(dl_data_header);
+	for( uint32_t block = 0; block < block_count; ++block )
+	{
+		size_t         block_start = (size_t)block * DL_COMPRESS_BLOCK_SIZE;
+		size_t         raw_size    = instance_size - block_start < DL_COMPRESS_BLOCK_SIZE ? instance_size - block_start : DL_COMPRESS_BLOCK_SIZE;
+		const uint8_t* raw         = data + block_start;
+
+		// only keep the compressed block if it is smaller than the raw data.
+		size_t         size  = dl_lz_compress( raw, raw_size, block_buffer, raw_size - 1 );
+		const uint8_t* src   = block_buffer;
+		uint32_t       entry = (uint32_t)size;
+		if( size == 0 )
+		{
+			size  = raw_size;
+			src   = raw;
+			entry = (uint32_t)raw_size | DL_COMPRESS_BLOCK_RAW;
+		}
+
+		if( write && pos + size <= out_buffer_size )
+		{
+			memcpy( out_buffer + pos, src, size );
+			dl_internal_compress_write_u32( out_buffer + table_pos + sizeof(uint32_t) * ( 2 + (size_t)block ), entry, swap );
+		}
+
+		pos += size;
+	}
+
+	dl_free( &dl_ctx->alloc, block_buffer );
+
+	if( produced_bytes )
+		*produced_bytes = pos;
+
+	if( out_buffer_size == 0 )
+		return DL_ERROR_OK;
+	if( pos > out_buffer_size )
+		return DL_ERROR_BUFFER_TO_SMALL;
+
+	memcpy( out_buffer, packed_instance, sizeof(dl_data_header) );
+	((dl_data_header*)out_buffer)->flags |= DL_DATA_HEADER_FLAG_COMPRESSED;
+	memcpy( out_buffer + sizeof(dl_data_header), packed_instance + sizeof(dl_data_header) + instance_size, fingerprint_size );
+	dl_internal_compress_write_u32( out_buffer + table_pos,                    DL_COMPRESS_BLOCK_SIZE, swap );
+	dl_internal_compress_write_u32( out_buffer + table_pos + sizeof(uint32_t), block_count,            swap );
+	return DL_ERROR_OK;
+}
+
+static dl_error_t dl_internal_decompress( const unsigned char* compressed,  size_t   compressed_size,
+										  unsigned char*       out_buffer,  size_t   out_buffer_size,
+										  uint32_t             first_block, uint32_t block_count,
+										  size_t*              produced_bytes )
+{
+	dl_data_header header;
+	bool swap;
+	dl_error_t err = dl_internal_compress_read_header( compressed, compressed_size, &header, &swap );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	if( ( header.flags & DL_DATA_HEADER_FLAG_COMPRESSED ) == 0 )
+		return DL_ERROR_UNSUPPORTED_OPERATION;
+
+	uint64_t instance_size     = dl_internal_header_instance_size( &header );
+	size_t   fingerprint_size  = dl_internal_header_fingerprint_size( &header );
+	size_t   decompressed_size = sizeof(dl_data_header) + (size_t)instance_size + fingerprint_size;
+	if( compressed_size < sizeof(dl_data_header) + fingerprint_size )
+		return DL_ERROR_MALFORMED_DATA;
+	if( produced_bytes )
+		*produced_bytes = decompressed_size;
+
+	if( out_buffer_size == 0 && produced_bytes != 0x0 )
+		return DL_ERROR_OK;
+	if( out_buffer_size < decompressed_size )
+		return DL_ERROR_BUFFER_TO_SMALL;
+
+	size_t data_offset = sizeof(dl_data_header) + fingerprint_size;
+	err = dl_internal_decompress_instance_data( compressed + data_offset, compressed_size - data_offset, instance_size, swap,
+												out_buffer + sizeof(dl_data_header), first_block, block_count, 0x0 );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	if( first_block == 0 )
+	{
+		memcpy( out_buffer, compressed, sizeof(dl_data_header) );
+		((dl_data_header*)out_buffer)->flags &= (uint8_t)~DL_DATA_HEADER_FLAG_COMPRESSED;
+		memcpy( out_buffer + sizeof(dl_data_header) + instance_size, compressed + sizeof(dl_data_header), fingerprint_size );
+	}
+	return DL_ERROR_OK;
+}
+
+dl_error_t dl_decompress( dl_ctx_t             dl_ctx,
+						  const unsigned char* compressed, size_t compressed_size,
+						  unsigned char*       out_buffer, size_t out_buffer_size,
+						  size_t*              produced_bytes )
+{
+	(void)dl_ctx;
+	return dl_internal_decompress( compressed, compressed_size, out_buffer, out_buffer_size, 0, 0xFFFFFFFF, produced_bytes );
+}
+
+dl_error_t dl_decompress_blocks( dl_ctx_t             dl_ctx,
+								 const unsigned char* compressed,  size_t       compressed_size,
+								 unsigned char*       out_buffer,  size_t       out_buffer_size,
+								 unsigned int         first_block, unsigned int block_count )
+{
+	(void)dl_ctx;
+	if( block_count == 0xFFFFFFFF )
+		return DL_ERROR_INVALID_PARAMETER;
+	return dl_internal_decompress( compressed, compressed_size, out_buffer, out_buffer_size, first_block, block_count, 0x0 );
+}
+
+dl_error_t dl_compressed_get_info( const unsigned char* compressed, size_t compressed_size, dl_compressed_info_t* out_info )
+{
+	dl_data_header header;
+	bool swap;
+	dl_error_t err = dl_internal_compress_read_header( compressed, compressed_size, &header, &swap );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	out_info->is_compressed     = ( header.flags & DL_DATA_HEADER_FLAG_COMPRESSED ) != 0 ? 1 : 0;
+	size_t fingerprint_size     = dl_internal_header_fingerprint_size( &header );
+	out_info->decompressed_size = sizeof(dl_data_header) + (size_t)dl_internal_header_instance_size( &header ) + fingerprint_size;
+	out_info->block_size        = 0;
+	out_info->block_count       = 0;
+
+	if( out_info->is_compressed )
+	{
+		size_t table_pos = sizeof(dl_data_header) + fingerprint_size;
+		if( compressed_size < table_pos + sizeof(uint32_t) * 2 )
+			return DL_ERROR_MALFORMED_DATA;
+		out_info->block_size  = dl_internal_compress_read_u32( compressed + table_pos,                    swap );
+		out_info->block_count = dl_internal_compress_read_u32( compressed + table_pos + sizeof(uint32_t), swap );
+	}
+	return DL_ERROR_OK;
+}
@@ -70,14 +70,6 @@ public:
 	CArrayStatic<PatchPos, 256> m_lPatchOffset;
 };
 
-static inline void dl_swap_header( dl_data_header* header )
-{
-	header->id                 = dl_swap_endian_uint32( header->id );
-	header->version            = dl_swap_endian_uint32( header->version );
-	header->root_instance_type = dl_swap_endian_uint32( header->root_instance_type );
-	header->instance_size      = dl_swap_endian_uint32( header->instance_size );
-}
-
 static uintptr_t dl_internal_read_ptr_data( const uint8_t* data,
 								            dl_endian_t    src_endian,
 								            dl_ptr_size_t  ptr_size )
@@ -108,16 +100,6 @@ static uintptr_t dl_internal_read_ptr_data( const uint8_t* data,
 	return 0;
 }
 
-static size_t dl_internal_ptr_size(dl_ptr_size_t size_enum)
-{
-	switch(size_enum)
-	{
-		case DL_PTR_SIZE_32BIT: return 4;
-		case DL_PTR_SIZE_64BIT: return 8;
-		default: DL_ASSERT(false, "unknown ptr size!"); return 0;
-	}
-}
-
 static void dl_internal_read_array_data( const uint8_t* array_data,
 										 uintptr_t*     offset,
 										 uint32_t*      count,
@@ -181,7 +163,11 @@ static void dl_internal_convert_collect_instances_from_str( const uint8_t*
 																  SConvertContext&      convert_ctx )
 {
 	uintptr_t offset = dl_internal_read_ptr_data( member_data, convert_ctx.src_endian, convert_ctx.src_ptr_size );
-	if(offset != DL_NULL_PTR_OFFSET[convert_ctx.src_ptr_size])
+	if(offset == DL_NULL_PTR_OFFSET[convert_ctx.src_ptr_size])
+		return;
+
+	// strings might be shared if the instance was stored with DL_STOREFLAGS_INTERN_STRINGS, only convert them once.
+	if(!convert_ctx.IsSwapped(base_data + offset))
 		convert_ctx.instances.Add(SInstance(base_data + offset, 0x0, 1337, dl_make_type(DL_TYPE_ATOM_POD, DL_TYPE_STORAGE_STR)));
 }
 
@@ -211,8 +197,8 @@ static void dl_internal_convert_collect_instances_from_struct_array( dl_ctx_t
 																	 const uint8_t*      base_data,
 																	 SConvertContext&    convert_ctx )
 {
-	uint32_t elem_size = sub_type->size[convert_ctx.src_ptr_size];
-	for( uint32_t elem = 0; elem < array_count; ++elem )
+	uintptr_t elem_size = sub_type->size[convert_ctx.src_ptr_size];
+	for( uintptr_t elem = 0; elem < array_count; ++elem )
 		dl_internal_convert_collect_instances(ctx, sub_type, array_data + (elem * elem_size), base_data, convert_ctx);
 }
 
@@ -318,6 +304,10 @@ static dl_error_t dl_internal_convert_collect_instances_from_member( dl_ctx_t
 			const uint8_t* array_data = base_data + offset;
 			const dl_type_desc* sub_type = 0x0;
 
+			// array-data might be shared between members if stored with DL_STOREFLAGS_MERGE_IDENTICAL_SUBDATA.
+			if(convert_ctx.IsSwapped(array_data))
+				break;
+
 			switch(storage_type)
 			{
 				case DL_TYPE_STORAGE_STR:
@@ -376,6 +366,8 @@ static dl_error_t dl_internal_convert_collect_instances( dl_ctx_t            dl_
 
 		// find member index from union type ...
 		uint32_t union_type = *((uint32_t*)(instance + type_offset));
+		if( convert_ctx.src_endian != DL_ENDIAN_HOST )
+			union_type = dl_swap_endian_uint32( union_type );
 		const dl_member_desc* member = dl_internal_union_type_to_member(dl_ctx, type, union_type);
 		const uint8_t* member_data = instance + member->offset[convert_ctx.src_ptr_size];
 
@@ -397,57 +389,36 @@ static dl_error_t dl_internal_convert_collect_instances( dl_ctx_t            dl_
 	return DL_ERROR_OK;
 }
 
-template<typename T>
-static T dl_convert_bf_format( T old_val, const dl_member_desc* bf_members, uint32_t bf_members_count, SConvertContext* conv_ctx )
-{
-	T new_val = 0;
-
-	for( uint32_t i = 0; i < bf_members_count; ++i )
-	{
-		const dl_member_desc& bf_member = bf_members[i];
-
-		uint32_t bf_bits         = bf_member.bitfield_bits();
-		uint32_t bf_offset       = bf_member.bitfield_offset();
-		uint32_t bf_source_offset = dl_bf_offset( conv_ctx->src_endian, sizeof(T), bf_offset, bf_bits );
-		uint32_t bf_target_offset = dl_bf_offset( conv_ctx->tgt_endian, sizeof(T), bf_offset, bf_bits );
-
- 		T extracted = (T)DL_EXTRACT_BITS( old_val, T(bf_source_offset), T(bf_bits) );
- 		new_val     = (T)DL_INSERT_BITS ( new_val, extracted, T(bf_target_offset), T(bf_bits) );
-	}
-
-	return new_val;
-}
-
 static uint8_t dl_convert_bit_field_format_uint8( uint8_t old_value, const dl_member_desc* first_bf_member, uint32_t num_bf_member, SConvertContext* conv_ctx )
 {
 	if( conv_ctx->src_endian != DL_ENDIAN_HOST )
-		return dl_swap_endian_uint8( dl_convert_bf_format( dl_swap_endian_uint8( old_value ), first_bf_member, num_bf_member, conv_ctx ) );
+		return dl_swap_endian_uint8( dl_internal_convert_bitfield_format( dl_swap_endian_uint8( old_value ), first_bf_member, num_bf_member, conv_ctx->src_endian, conv_ctx->tgt_endian ) );
 
-	return dl_convert_bf_format( old_value, first_bf_member, num_bf_member, conv_ctx );
+	return dl_internal_convert_bitfield_format( old_value, first_bf_member, num_bf_member, conv_ctx->src_endian, conv_ctx->tgt_endian );
 }
 
 static uint16_t dl_convert_bit_field_format_uint16( uint16_t old_value, const dl_member_desc* first_bf_member, uint32_t num_bf_member, SConvertContext* conv_ctx )
 {
 	if( conv_ctx->src_endian != DL_ENDIAN_HOST )
-		return dl_swap_endian_uint16( dl_convert_bf_format( dl_swap_endian_uint16( old_value ), first_bf_member, num_bf_member, conv_ctx ) );
+		return dl_swap_endian_uint16( dl_internal_convert_bitfield_format( dl_swap_endian_uint16( old_value ), first_bf_member, num_bf_member, conv_ctx->src_endian, conv_ctx->tgt_endian ) );
 
-	return dl_convert_bf_format( old_value, first_bf_member, num_bf_member, conv_ctx );
+	return dl_internal_convert_bitfield_format( old_value, first_bf_member, num_bf_member, conv_ctx->src_endian, conv_ctx->tgt_endian );
 }
 
 static uint32_t dl_convert_bit_field_format_uint32( uint32_t old_value, const dl_member_desc* first_bf_member, uint32_t num_bf_member, SConvertContext* conv_ctx )
 {
 	if( conv_ctx->src_endian != DL_ENDIAN_HOST )
-		return dl_swap_endian_uint32( dl_convert_bf_format( dl_swap_endian_uint32( old_value ), first_bf_member, num_bf_member, conv_ctx ) );
+		return dl_swap_endian_uint32( dl_internal_convert_bitfield_format( dl_swap_endian_uint32( old_value ), first_bf_member, num_bf_member, conv_ctx->src_endian, conv_ctx->tgt_endian ) );
 
-	return dl_convert_bf_format( old_value, first_bf_member, num_bf_member, conv_ctx );
+	return dl_internal_convert_bitfield_format( old_value, first_bf_member, num_bf_member, conv_ctx->src_endian, conv_ctx->tgt_endian );
 }
 
 static uint64_t dl_convert_bit_field_format_uint64( uint64_t old_value, const dl_member_desc* first_bf_member, uint32_t num_bf_member, SConvertContext* conv_ctx )
 {
 	if( conv_ctx->src_endian != DL_ENDIAN_HOST )
-		return dl_swap_endian_uint64( dl_convert_bf_format( dl_swap_endian_uint64( old_value ), first_bf_member, num_bf_member, conv_ctx ) );
+		return dl_swap_endian_uint64( dl_internal_convert_bitfield_format( dl_swap_endian_uint64( old_value ), first_bf_member, num_bf_member, conv_ctx->src_endian, conv_ctx->tgt_endian ) );
 
-	return dl_convert_bf_format( old_value, first_bf_member, num_bf_member, conv_ctx );
+	return dl_internal_convert_bitfield_format( old_value, first_bf_member, num_bf_member, conv_ctx->src_endian, conv_ctx->tgt_endian );
 }
 
 static void dl_internal_convert_save_patch_pos( SConvertContext* conv_ctx, dl_binary_writer* writer, size_t patch_pos, uintptr_t offset )
@@ -625,6 +596,8 @@ static dl_error_t dl_internal_convert_write_struct( dl_ctx_t            dl_ctx,
 		size_t tgt_type_offset = dl_internal_union_type_offset( dl_ctx, type, conv_ctx.target_ptr_size );
 
 		uint32_t union_type = *((uint32_t*)(instance + src_type_offset));
+		if( conv_ctx.src_endian != DL_ENDIAN_HOST )
+			union_type = dl_swap_endian_uint32( union_type );
 		const dl_member_desc* member = dl_internal_union_type_to_member(dl_ctx, type, union_type);
 		const uint8_t* member_data = instance + member->offset[conv_ctx.src_ptr_size];
 
@@ -635,7 +608,7 @@ static dl_error_t dl_internal_convert_write_struct( dl_ctx_t            dl_ctx,
 
 		dl_binary_writer_seek_set( writer, pos + tgt_type_offset );
 		dl_binary_writer_align( writer, 4 );
-		dl_binary_writer_write_uint32( writer, union_type );
+		dl_binary_writer_write_uint32( writer, conv_ctx.tgt_endian != DL_ENDIAN_HOST ? dl_swap_endian_uint32( union_type ) : union_type );
 	}
 	else
 	{
@@ -845,7 +818,7 @@ dl_error_t dl_internal_convert_no_header( dl_ctx_t       dl_ctx,
 	}
 
 	dl_binary_writer_seek_end( &writer );
-	*needed_size = (unsigned int)dl_binary_writer_tell( &writer );
+	*needed_size = dl_binary_writer_tell( &writer );
 
 	return err;
 }
@@ -861,11 +834,13 @@ static dl_error_t dl_internal_convert_instance( dl_ctx_t       dl_ctx,
 	if( packed_instance_size < sizeof(dl_data_header) )             return DL_ERROR_MALFORMED_DATA;
 	if( header->id != DL_INSTANCE_ID &&
 		header->id != DL_INSTANCE_ID_SWAPED )                       return DL_ERROR_MALFORMED_DATA;
-	if( header->version != DL_INSTANCE_VERSION &&
-		header->version != DL_INSTANCE_VERSION_SWAPED )             return DL_ERROR_VERSION_MISMATCH;
+	if( !dl_internal_is_instance_version( header->version ) &&
+		!dl_internal_is_instance_version_swaped( header->version ) ) return DL_ERROR_VERSION_MISMATCH;
 	if( header->root_instance_type != type &&
 		header->root_instance_type != dl_swap_endian_uint32(type) ) return DL_ERROR_TYPE_MISMATCH;
 	if( out_ptr_size != 4 && out_ptr_size != 8 )                    return DL_ERROR_INVALID_PARAMETER;
+	if( header->flags & DL_DATA_HEADER_FLAG_BATCH )                 return DL_ERROR_UNSUPPORTED_OPERATION;
+	if( header->flags & DL_DATA_HEADER_FLAG_COMPRESSED )            return DL_ERROR_UNSUPPORTED_OPERATION;
 
 	dl_ptr_size_t src_ptr_size = header->is_64_bit_ptr != 0 ? DL_PTR_SIZE_64BIT : DL_PTR_SIZE_32BIT;
 	dl_ptr_size_t dst_ptr_size;
@@ -892,13 +867,26 @@ static dl_error_t dl_internal_convert_instance( dl_ctx_t       dl_ctx,
 		return DL_ERROR_OK;
 	}
 
+	uint8_t header_flags = header->flags; // read before conversion since header might be overwritten by an inplace conversion.
+
 	dl_typeid_t root_type_id = src_endian != DL_ENDIAN_HOST ? dl_swap_endian_uint32( header->root_instance_type ) : header->root_instance_type;
 
 	const dl_type_desc* root_type = dl_internal_find_type(dl_ctx, root_type_id);
 	if(root_type == 0x0)
 		return DL_ERROR_TYPE_NOT_FOUND;
 
-	dl_error_t err = dl_internal_convert_no_header( dl_ctx,
+	dl_data_header host_header = *header;
+	if( src_endian != DL_ENDIAN_HOST )
+		dl_swap_header( &host_header );
+
+	dl_error_t err = dl_internal_check_fingerprint( dl_ctx, root_type, &host_header, packed_instance, packed_instance_size, src_endian != DL_ENDIAN_HOST );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	// the fingerprint do not depend on ptr-size so it is just moved to the end of the converted data.
+	size_t fingerprint_size = dl_internal_header_fingerprint_size( header );
+
+	err = dl_internal_convert_no_header( dl_ctx,
 												    packed_instance + sizeof(dl_data_header),
 												    packed_instance + sizeof(dl_data_header),
 												    out_instance == 0x0 ? 0x0 : out_instance + sizeof(dl_data_header),
@@ -911,20 +899,38 @@ static dl_error_t dl_internal_convert_instance( dl_ctx_t       dl_ctx,
 												    root_type,
 												    0u );
 
+	// offsets in 32-bit ptrs can not address more than 4GB.
+	if( err == DL_ERROR_OK && dst_ptr_size == DL_PTR_SIZE_32BIT && *out_size > 0xFFFFFFFF )
+		return DL_ERROR_UNSUPPORTED_OPERATION;
+
+	if( err == DL_ERROR_OK && out_instance != 0x0 && sizeof(dl_data_header) + *out_size + fingerprint_size > out_instance_size )
+		err = DL_ERROR_BUFFER_TO_SMALL;
+
 	if(out_instance != 0x0)
 	{
 		dl_data_header* new_header = (dl_data_header*)out_instance;
+		memset( new_header, 0x0, sizeof(dl_data_header) );
 		new_header->id                 = DL_INSTANCE_ID;
-		new_header->version            = DL_INSTANCE_VERSION;
 		new_header->root_instance_type = type;
-		new_header->instance_size      = uint32_t(*out_size);
+		dl_internal_header_set_instance_size( new_header, *out_size );
 		new_header->is_64_bit_ptr      = out_ptr_size == 4 ? 0 : 1;
+		new_header->flags              = header_flags;
+		if( ( header_flags & DL_DATA_HEADER_FLAG_CHECKSUM ) && err == DL_ERROR_OK )
+			new_header->checksum = dl_internal_crc32c( out_instance + sizeof(dl_data_header), *out_size ); // checksum is of the converted data.
+
+		if( fingerprint_size > 0 && err == DL_ERROR_OK )
+		{
+			uint32_t fingerprint = dl_internal_type_fingerprint( dl_ctx, root_type );
+			if( DL_ENDIAN_HOST != out_endian )
+				fingerprint = dl_swap_endian_uint32( fingerprint );
+			memcpy( out_instance + sizeof(dl_data_header) + *out_size, &fingerprint, sizeof(uint32_t) );
+		}
 
 		if(DL_ENDIAN_HOST != out_endian)
 			dl_swap_header(new_header);
 	}
 
-	*out_size += sizeof(dl_data_header);
+	*out_size += sizeof(dl_data_header) + fingerprint_size;
 	return err;
 }
 
@@ -0,0 +1,114 @@
+/* copyright (c) 2010 Fredrik Kihlander, see LICENSE for more info */
+
+#include <string.h>
+
+#include "dl_hash.h"
+
+/*
+	CRC32C (Castagnoli) used to checksum packed instances. Uses the crc32-instruction from SSE4.2 if the cpu
+	supports it and falls back to table-based slicing-by-8 otherwise, both produce the same checksum.
+*/
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#  include <intrin.h>
+#  include <nmmintrin.h>
+#  define DL_CRC32C_HAS_SSE42
+#  define DL_CRC32C_SSE42_FUNC
+#elif ( defined(__GNUC__) || defined(__clang__) ) && defined(__x86_64__)
+#  include <nmmintrin.h>
+#  define DL_CRC32C_HAS_SSE42
+#  define DL_CRC32C_SSE42_FUNC __attribute__((target("sse4.2")))
+#endif
+
+static const uint32_t DL_CRC32C_POLY = 0x82F63B78; // reversed castagnoli-polynomial.
+
+struct dl_crc32c_tables
+{
+	uint32_t t[8][256];
+
+	dl_crc32c_tables()
+	{
+		for( uint32_t i = 0; i < 256; ++i )
+		{
+			uint32_t crc = i;
+			for( int bit = 0; bit < 8; ++bit )
+				crc = ( crc >> 1 ) ^ ( DL_CRC32C_POLY & ( 0u - ( crc & 1 ) ) );
+			t[0][i] = crc;
+		}
+
+		for( uint32_t i = 0; i < 256; ++i )
+			for( int slice = 1; slice < 8; ++slice )
+				t[slice][i] = ( t[slice - 1][i] >> 8 ) ^ t[0][t[slice - 1][i] & 0xFF];
+	}
+};
+
+static uint32_t dl_internal_crc32c_sliced( uint32_t crc, const uint8_t* data, size_t size )
+{
+	static const dl_crc32c_tables tables;
+	const uint32_t (*t)[256] = tables.t;
+
+	while( size >= 8 )
+	{
+		// read bytes one by one to get the same result on all endians.
+		uint32_t one = crc ^ ( (uint32_t)data[0] | ( (uint32_t)data[1] << 8 ) | ( (uint32_t)data[2] << 16 ) | ( (uint32_t)data[3] << 24 ) );
+		uint32_t two =         (uint32_t)data[4] | ( (uint32_t)data[5] << 8 ) | ( (uint32_t)data[6] << 16 ) | ( (uint32_t)data[7] << 24 );
+		crc = t[7][one & 0xFF] ^ t[6][( one >> 8 ) & 0xFF] ^ t[5][( one >> 16 ) & 0xFF] ^ t[4][one >> 24] ^
+			  t[3][two & 0xFF] ^ t[2][( two >> 8 ) & 0xFF] ^ t[1][( two >> 16 ) & 0xFF] ^ t[0][two >> 24];
+		data += 8;
+		size -= 8;
+	}
+
+	while( size-- > 0 )
+		crc = ( crc >> 8 ) ^ t[0][( crc ^ *data++ ) & 0xFF];
+
+	return crc;
+}
+
+#if defined(DL_CRC32C_HAS_SSE42)
+
+DL_CRC32C_SSE42_FUNC static uint32_t dl_internal_crc32c_sse42( uint32_t crc, const uint8_t* data, size_t size )
+{
+	uint64_t crc64 = crc;
+	while( size >= 8 )
+	{
+		uint64_t v;
+		memcpy( &v, data, sizeof(v) );
+		crc64 = _mm_crc32_u64( crc64, v );
+		data += 8;
+		size -= 8;
+	}
+
+	crc = (uint32_t)crc64;
+	while( size-- > 0 )
+		crc = _mm_crc32_u8( crc, *data++ );
+
+	return crc;
+}
+
+static bool dl_internal_cpu_has_sse42()
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid( info, 1 );
+	return ( info[2] & ( 1 << 20 ) ) != 0;
+#else
+	return __builtin_cpu_supports( "sse4.2" ) != 0;
+#endif
+}
+
+#endif // defined(DL_CRC32C_HAS_SSE42)
+
+uint32_t dl_internal_crc32c_software( const uint8_t* data, size_t size )
+{
+	return ~dl_internal_crc32c_sliced( 0xFFFFFFFF, data, size );
+}
+
+uint32_t dl_internal_crc32c( const uint8_t* data, size_t size )
+{
+#if defined(DL_CRC32C_HAS_SSE42)
+	static const bool has_sse42 = dl_internal_cpu_has_sse42();
+	if( has_sse42 )
+		return ~dl_internal_crc32c_sse42( 0xFFFFFFFF, data, size );
+#endif
+	return dl_internal_crc32c_software( data, size );
+}
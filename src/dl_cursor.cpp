@@ -0,0 +1,359 @@
+/* copyright (c) 2010 Fredrik Kihlander, see LICENSE for more info */
+
+#include <dl/dl_cursor.h>
+#include "dl_types.h"
+#include "dl_hash.h"
+
+#include <string.h>
+
+/*
+	All reads are done on the unpatched instance-data, i.e. ptrs are offsets from the start of the instance-data, and
+	all offsets are validated against data_size before they are followed since the data is never patched or verified
+	as a whole.
+*/
+
+static inline dl_ptr_size_t dl_cursor_ptr_size( const dl_cursor_t* cursor )
+{
+	return cursor->ptr_size == 4 ? DL_PTR_SIZE_32BIT : DL_PTR_SIZE_64BIT;
+}
+
+static inline bool dl_cursor_in_bounds( const dl_cursor_t* cursor, uint64_t offset, uint64_t size )
+{
+	return offset <= cursor->data_size && size <= cursor->data_size - offset;
+}
+
+static bool dl_cursor_read_ptr( const dl_cursor_t* cursor, size_t pos, uint64_t* out_offset, bool* out_is_null )
+{
+	if( !dl_cursor_in_bounds( cursor, pos, cursor->ptr_size ) )
+		return false;
+
+	uint64_t offset;
+	if( cursor->ptr_size == 4 )
+	{
+		uint32_t offset32;
+		memcpy( &offset32, cursor->data + pos, sizeof(uint32_t) );
+		*out_is_null = offset32 == 0xFFFFFFFF;
+		offset = offset32;
+	}
+	else
+	{
+		memcpy( &offset, cursor->data + pos, sizeof(uint64_t) );
+		*out_is_null = offset == UINT64_MAX;
+	}
+	*out_offset = offset;
+	return true;
+}
+
+static size_t dl_cursor_element_size( const dl_cursor_t* cursor, const dl_member_desc* member )
+{
+	switch( member->StorageType() )
+	{
+		case DL_TYPE_STORAGE_STR:
+		case DL_TYPE_STORAGE_PTR:
+			return cursor->ptr_size;
+		case DL_TYPE_STORAGE_STRUCT:
+		{
+			const dl_type_desc* sub_type = dl_internal_find_type( cursor->ctx, member->type_id );
+			return sub_type == 0x0 ? 0 : sub_type->size[dl_cursor_ptr_size( cursor )];
+		}
+		default:
+			return dl_pod_size( member->StorageType() );
+	}
+}
+
+/*
+	Find member of the struct the cursor points to and its position in cursor->data.
+*/
+static dl_error_t dl_cursor_find_member( const dl_cursor_t* cursor, dl_member_handle_t handle, const dl_member_desc** out_member, size_t* out_member_pos )
+{
+	if( cursor->data == 0x0 )
+		return DL_ERROR_INVALID_PARAMETER;
+	if( handle.type != cursor->type )
+		return DL_ERROR_TYPE_MISMATCH;
+
+	const dl_type_desc* type = dl_internal_find_type( cursor->ctx, cursor->type );
+	if( type == 0x0 )
+		return DL_ERROR_TYPE_NOT_FOUND;
+	if( handle.member_index >= type->member_count )
+		return DL_ERROR_MEMBER_NOT_FOUND;
+
+	dl_ptr_size_t ptr_size = dl_cursor_ptr_size( cursor );
+	if( type->flags & DL_TYPE_FLAG_IS_UNION )
+	{
+		size_t type_pos = cursor->offset + dl_internal_union_type_offset( cursor->ctx, type, ptr_size );
+		if( !dl_cursor_in_bounds( cursor, type_pos, sizeof(uint32_t) ) )
+			return DL_ERROR_MALFORMED_DATA;
+
+		uint32_t union_type;
+		memcpy( &union_type, cursor->data + type_pos, sizeof(uint32_t) );
+		if( union_type != dl_internal_typeid_of( cursor->ctx, type ) + handle.member_index + 1 )
+			return DL_ERROR_MEMBER_NOT_FOUND;
+	}
+
+	const dl_member_desc* member = dl_get_type_member( cursor->ctx, type, handle.member_index );
+	*out_member     = member;
+	*out_member_pos = cursor->offset + member->offset[ptr_size];
+	return DL_ERROR_OK;
+}
+
+static dl_error_t dl_cursor_read_array_header( const dl_cursor_t* cursor, size_t member_pos, uint64_t* out_offset, uint32_t* out_count )
+{
+	bool is_null;
+	if( !dl_cursor_read_ptr( cursor, member_pos, out_offset, &is_null ) ||
+		!dl_cursor_in_bounds( cursor, member_pos + cursor->ptr_size, sizeof(uint32_t) ) )
+		return DL_ERROR_MALFORMED_DATA;
+
+	memcpy( out_count, cursor->data + member_pos + cursor->ptr_size, sizeof(uint32_t) );
+	if( is_null && *out_count > 0 )
+		return DL_ERROR_MALFORMED_DATA;
+	return DL_ERROR_OK;
+}
+
+/*
+	Find the position in cursor->data of element index of member. Members that are not arrays only have element 0.
+*/
+static dl_error_t dl_cursor_find_element( const dl_cursor_t* cursor, dl_member_handle_t handle, unsigned int index, const dl_member_desc** out_member, size_t* out_pos )
+{
+	size_t member_pos;
+	dl_error_t err = dl_cursor_find_member( cursor, handle, out_member, &member_pos );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	const dl_member_desc* member = *out_member;
+	switch( member->AtomType() )
+	{
+		case DL_TYPE_ATOM_POD:
+		case DL_TYPE_ATOM_BITFIELD:
+			if( index != 0 )
+				return DL_ERROR_INVALID_PARAMETER;
+			*out_pos = member_pos;
+			return DL_ERROR_OK;
+		case DL_TYPE_ATOM_INLINE_ARRAY:
+			if( index >= member->inline_array_cnt() )
+				return DL_ERROR_INVALID_PARAMETER;
+			*out_pos = member_pos + dl_cursor_element_size( cursor, member ) * index;
+			return DL_ERROR_OK;
+		case DL_TYPE_ATOM_ARRAY:
+		{
+			uint64_t array_offset;
+			uint32_t count;
+			err = dl_cursor_read_array_header( cursor, member_pos, &array_offset, &count );
+			if( err != DL_ERROR_OK )
+				return err;
+			if( index >= count )
+				return DL_ERROR_INVALID_PARAMETER;
+
+			uint64_t element_size = dl_cursor_element_size( cursor, member );
+			if( !dl_cursor_in_bounds( cursor, array_offset, element_size * count ) )
+				return DL_ERROR_MALFORMED_DATA;
+
+			*out_pos = (size_t)( array_offset + element_size * index );
+			return DL_ERROR_OK;
+		}
+		default:
+			return DL_ERROR_MALFORMED_DATA;
+	}
+}
+
+dl_error_t dl_cursor_init( dl_ctx_t             dl_ctx,          dl_typeid_t type,
+						   const unsigned char* packed_instance, size_t      packed_instance_size,
+						   dl_cursor_t*         out_cursor )
+{
+	if( packed_instance_size < sizeof(dl_data_header) ) return DL_ERROR_MALFORMED_DATA;
+
+	dl_data_header header;
+	memcpy( &header, packed_instance, sizeof(dl_data_header) );
+	if( header.id == DL_INSTANCE_ID_SWAPED )                 return DL_ERROR_ENDIAN_MISMATCH;
+	if( header.id != DL_INSTANCE_ID )                        return DL_ERROR_MALFORMED_DATA;
+	if( !dl_internal_is_instance_version( header.version ) ) return DL_ERROR_VERSION_MISMATCH;
+	if( header.root_instance_type != type )                  return DL_ERROR_TYPE_MISMATCH;
+	if( header.flags & DL_DATA_HEADER_FLAG_BATCH )           return DL_ERROR_UNSUPPORTED_OPERATION;
+	if( header.flags & DL_DATA_HEADER_FLAG_COMPRESSED )      return DL_ERROR_UNSUPPORTED_OPERATION;
+
+	const dl_type_desc* root_type = dl_internal_find_type( dl_ctx, type );
+	if( root_type == 0x0 )
+		return DL_ERROR_TYPE_NOT_FOUND;
+
+	dl_error_t err = dl_internal_check_fingerprint( dl_ctx, root_type, &header, packed_instance, packed_instance_size, false );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	uint64_t instance_size = dl_internal_header_instance_size( &header );
+	if( instance_size > packed_instance_size - sizeof(dl_data_header) )
+		return DL_ERROR_MALFORMED_DATA;
+
+	dl_ptr_size_t ptr_size = header.is_64_bit_ptr ? DL_PTR_SIZE_64BIT : DL_PTR_SIZE_32BIT;
+	if( root_type->size[ptr_size] > instance_size )
+		return DL_ERROR_MALFORMED_DATA;
+
+	out_cursor->ctx       = dl_ctx;
+	out_cursor->data      = packed_instance + sizeof(dl_data_header);
+	out_cursor->data_size = (size_t)instance_size;
+	out_cursor->offset    = 0;
+	out_cursor->type      = type;
+	out_cursor->ptr_size  = header.is_64_bit_ptr ? 8 : 4;
+	return DL_ERROR_OK;
+}
+
+dl_error_t dl_cursor_member_handle( dl_ctx_t dl_ctx, dl_typeid_t type, const char* member_name, dl_member_handle_t* out_handle )
+{
+	const dl_type_desc* type_desc = dl_internal_find_type( dl_ctx, type );
+	if( type_desc == 0x0 )
+		return DL_ERROR_TYPE_NOT_FOUND;
+
+	unsigned int member_index = dl_internal_find_member( dl_ctx, type_desc, dl_internal_hash_string( member_name ) );
+	if( member_index >= type_desc->member_count )
+		return DL_ERROR_MEMBER_NOT_FOUND;
+
+	out_handle->type         = type;
+	out_handle->member_index = member_index;
+	return DL_ERROR_OK;
+}
+
+dl_error_t dl_cursor_array_count( const dl_cursor_t* cursor, dl_member_handle_t member, unsigned int* out_count )
+{
+	const dl_member_desc* member_desc;
+	size_t member_pos;
+	dl_error_t err = dl_cursor_find_member( cursor, member, &member_desc, &member_pos );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	switch( member_desc->AtomType() )
+	{
+		case DL_TYPE_ATOM_INLINE_ARRAY:
+			*out_count = member_desc->inline_array_cnt();
+			return DL_ERROR_OK;
+		case DL_TYPE_ATOM_ARRAY:
+		{
+			uint64_t array_offset;
+			uint32_t count;
+			err = dl_cursor_read_array_header( cursor, member_pos, &array_offset, &count );
+			if( err != DL_ERROR_OK )
+				return err;
+			*out_count = count;
+			return DL_ERROR_OK;
+		}
+		default:
+			return DL_ERROR_TYPE_MISMATCH;
+	}
+}
+
+dl_error_t dl_cursor_read( const dl_cursor_t* cursor, dl_member_handle_t member, unsigned int index, void* out_value, size_t out_value_size )
+{
+	const dl_member_desc* member_desc;
+	size_t pos;
+	dl_error_t err = dl_cursor_find_element( cursor, member, index, &member_desc, &pos );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	dl_type_storage_t storage = member_desc->StorageType();
+	if( storage == DL_TYPE_STORAGE_STR || storage == DL_TYPE_STORAGE_PTR || storage == DL_TYPE_STORAGE_STRUCT )
+		return DL_ERROR_TYPE_MISMATCH;
+
+	size_t value_size = dl_pod_size( storage );
+	if( !dl_cursor_in_bounds( cursor, pos, value_size ) )
+		return DL_ERROR_MALFORMED_DATA;
+
+	if( member_desc->AtomType() != DL_TYPE_ATOM_BITFIELD )
+	{
+		if( out_value_size != value_size )
+			return DL_ERROR_TYPE_MISMATCH;
+		memcpy( out_value, cursor->data + pos, value_size );
+		return DL_ERROR_OK;
+	}
+
+	uint64_t storage_value = 0;
+	switch( storage )
+	{
+		case DL_TYPE_STORAGE_UINT8:  { uint8_t  v; memcpy( &v, cursor->data + pos, sizeof(v) ); storage_value = v; } break;
+		case DL_TYPE_STORAGE_UINT16: { uint16_t v; memcpy( &v, cursor->data + pos, sizeof(v) ); storage_value = v; } break;
+		case DL_TYPE_STORAGE_UINT32: { uint32_t v; memcpy( &v, cursor->data + pos, sizeof(v) ); storage_value = v; } break;
+		case DL_TYPE_STORAGE_UINT64: { uint64_t v; memcpy( &v, cursor->data + pos, sizeof(v) ); storage_value = v; } break;
+		default:
+			return DL_ERROR_MALFORMED_DATA;
+	}
+
+	uint32_t bf_bits = member_desc->bitfield_bits();
+	uint64_t value   = DL_EXTRACT_BITS( storage_value, (uint64_t)dl_bf_offset( DL_ENDIAN_HOST, sizeof(uint8_t), member_desc->bitfield_offset(), bf_bits ), (uint64_t)bf_bits );
+	switch( out_value_size )
+	{
+		case 1: { uint8_t  v = (uint8_t) value; memcpy( out_value, &v, sizeof(v) ); } break;
+		case 2: { uint16_t v = (uint16_t)value; memcpy( out_value, &v, sizeof(v) ); } break;
+		case 4: { uint32_t v = (uint32_t)value; memcpy( out_value, &v, sizeof(v) ); } break;
+		case 8: memcpy( out_value, &value, sizeof(value) ); break;
+		default:
+			return DL_ERROR_TYPE_MISMATCH;
+	}
+	return DL_ERROR_OK;
+}
+
+dl_error_t dl_cursor_read_string( const dl_cursor_t* cursor, dl_member_handle_t member, unsigned int index, const char** out_str )
+{
+	const dl_member_desc* member_desc;
+	size_t pos;
+	dl_error_t err = dl_cursor_find_element( cursor, member, index, &member_desc, &pos );
+	if( err != DL_ERROR_OK )
+		return err;
+	if( member_desc->StorageType() != DL_TYPE_STORAGE_STR )
+		return DL_ERROR_TYPE_MISMATCH;
+
+	uint64_t str_offset;
+	bool is_null;
+	if( !dl_cursor_read_ptr( cursor, pos, &str_offset, &is_null ) )
+		return DL_ERROR_MALFORMED_DATA;
+
+	if( is_null )
+	{
+		*out_str = 0x0;
+		return DL_ERROR_OK;
+	}
+
+	// ... the string need to be terminated inside the instance ...
+	if( str_offset >= cursor->data_size || memchr( cursor->data + str_offset, '\0', cursor->data_size - (size_t)str_offset ) == 0x0 )
+		return DL_ERROR_MALFORMED_DATA;
+
+	*out_str = (const char*)( cursor->data + str_offset );
+	return DL_ERROR_OK;
+}
+
+dl_error_t dl_cursor_struct( const dl_cursor_t* cursor, dl_member_handle_t member, unsigned int index, dl_cursor_t* out_cursor )
+{
+	const dl_member_desc* member_desc;
+	size_t pos;
+	dl_error_t err = dl_cursor_find_element( cursor, member, index, &member_desc, &pos );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	dl_type_storage_t storage = member_desc->StorageType();
+	if( storage != DL_TYPE_STORAGE_STRUCT && storage != DL_TYPE_STORAGE_PTR )
+		return DL_ERROR_TYPE_MISMATCH;
+
+	const dl_type_desc* sub_type = dl_internal_find_type( cursor->ctx, member_desc->type_id );
+	if( sub_type == 0x0 )
+		return DL_ERROR_TYPE_NOT_FOUND;
+
+	*out_cursor = *cursor;
+	out_cursor->type = member_desc->type_id;
+
+	if( storage == DL_TYPE_STORAGE_PTR )
+	{
+		uint64_t struct_offset;
+		bool is_null;
+		if( !dl_cursor_read_ptr( cursor, pos, &struct_offset, &is_null ) )
+			return DL_ERROR_MALFORMED_DATA;
+
+		if( is_null )
+		{
+			out_cursor->data   = 0x0;
+			out_cursor->offset = 0;
+			return DL_ERROR_OK;
+		}
+		pos = (size_t)struct_offset;
+	}
+
+	if( !dl_cursor_in_bounds( cursor, pos, sub_type->size[dl_cursor_ptr_size( cursor )] ) )
+		return DL_ERROR_MALFORMED_DATA;
+
+	out_cursor->offset = pos;
+	return DL_ERROR_OK;
+}
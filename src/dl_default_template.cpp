@@ -0,0 +1,134 @@
+/* copyright (c) 2010 Fredrik Kihlander, see LICENSE for more info */
+
+#include <string.h>
+
+#include "dl_types.h"
+
+/*
+	The default-template of a type is the host-ptr-size image of an instance of the type where all members with a
+	default-value has been set to that value. dl_txt_pack start out each struct with a copy of the template so that only
+	members that are actually set in the text and defaults with subdata, i.e. that need ptr-patching, has to be written
+	member by member.
+*/
+
+static uint64_t dl_internal_read_bitfield_storage( dl_type_storage_t storage, const uint8_t* data )
+{
+	switch( storage )
+	{
+		case DL_TYPE_STORAGE_UINT8:  { uint8_t  v; memcpy( &v, data, sizeof(v) ); return v; }
+		case DL_TYPE_STORAGE_UINT16: { uint16_t v; memcpy( &v, data, sizeof(v) ); return v; }
+		case DL_TYPE_STORAGE_UINT32: { uint32_t v; memcpy( &v, data, sizeof(v) ); return v; }
+		case DL_TYPE_STORAGE_UINT64: { uint64_t v; memcpy( &v, data, sizeof(v) ); return v; }
+		default:
+			DL_ASSERT( false && "This should not happen!" );
+			return 0;
+	}
+}
+
+static void dl_internal_write_bitfield_storage( dl_type_storage_t storage, uint8_t* data, uint64_t value )
+{
+	switch( storage )
+	{
+		case DL_TYPE_STORAGE_UINT8:  { uint8_t  v = (uint8_t) value; memcpy( data, &v, sizeof(v) ); } break;
+		case DL_TYPE_STORAGE_UINT16: { uint16_t v = (uint16_t)value; memcpy( data, &v, sizeof(v) ); } break;
+		case DL_TYPE_STORAGE_UINT32: { uint32_t v = (uint32_t)value; memcpy( data, &v, sizeof(v) ); } break;
+		case DL_TYPE_STORAGE_UINT64: { uint64_t v = (uint64_t)value; memcpy( data, &v, sizeof(v) ); } break;
+		default:
+			DL_ASSERT( false && "This should not happen!" );
+			break;
+	}
+}
+
+static uint32_t dl_internal_build_default_template( dl_ctx_t dl_ctx, const dl_type_desc* type, uint8_t* out_template )
+{
+	uint32_t flags = DL_DEFAULT_TEMPLATE_FLAG_ALL_MEMBERS_DEFAULTED;
+	memset( out_template, 0x0, type->size[DL_PTR_SIZE_HOST] );
+
+	for( uint32_t i = 0; i < type->member_count; ++i )
+	{
+		const dl_member_desc* member = dl_get_type_member( dl_ctx, type, i );
+		if( member->default_value_offset == UINT32_MAX )
+		{
+			flags &= ~(uint32_t)DL_DEFAULT_TEMPLATE_FLAG_ALL_MEMBERS_DEFAULTED;
+			continue;
+		}
+
+		const uint8_t* default_value = dl_ctx->default_data + member->default_value_offset;
+		uint8_t*       member_data   = out_template + member->offset[DL_PTR_SIZE_HOST];
+
+		if( member->AtomType() == DL_TYPE_ATOM_BITFIELD )
+		{
+			uint32_t bf_bits   = member->bitfield_bits();
+			uint32_t bf_offset = dl_bf_offset( DL_ENDIAN_HOST, sizeof(uint8_t), member->bitfield_offset(), bf_bits );
+
+			uint64_t value   = DL_EXTRACT_BITS( dl_internal_read_bitfield_storage( member->StorageType(), default_value ), (uint64_t)bf_offset, (uint64_t)bf_bits );
+			uint64_t current = dl_internal_read_bitfield_storage( member->StorageType(), member_data );
+			dl_internal_write_bitfield_storage( member->StorageType(), member_data, DL_INSERT_BITS( current, value, (uint64_t)bf_offset, (uint64_t)bf_bits ) );
+			continue;
+		}
+
+		// ... defaults with subdata are written by the user of the template since they need patching, the copied value
+		//     is overwritten at that point ...
+		memcpy( member_data, default_value, member->size[DL_PTR_SIZE_HOST] );
+		if( member->size[DL_PTR_SIZE_HOST] != member->default_value_size )
+			flags |= DL_DEFAULT_TEMPLATE_FLAG_HAS_SUBDATA;
+	}
+	return flags;
+}
+
+dl_error_t dl_internal_update_type_default_templates( dl_ctx_t dl_ctx )
+{
+	unsigned int type_count = dl_ctx->type_count;
+
+	dl_free( &dl_ctx->alloc, dl_ctx->type_default_templates );
+	dl_free( &dl_ctx->alloc, dl_ctx->default_template_data );
+	dl_ctx->type_default_templates      = 0x0;
+	dl_ctx->type_default_template_count = 0;
+	dl_ctx->default_template_data       = 0x0;
+	if( type_count == 0 )
+		return DL_ERROR_OK;
+
+	size_t data_size = 0;
+	for( unsigned int i = 0; i < type_count; ++i )
+	{
+		const dl_type_desc* type = dl_ctx->type_descs + i;
+		if( type->flags & DL_TYPE_FLAG_IS_UNION )
+			continue;
+		data_size = dl_internal_align_up( data_size, 8 ) + type->size[DL_PTR_SIZE_HOST];
+	}
+
+	if( data_size > UINT32_MAX )
+		return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+
+	dl_type_default_template* templates = (dl_type_default_template*)dl_alloc( &dl_ctx->alloc, sizeof(dl_type_default_template) * type_count );
+	uint8_t* data = data_size > 0 ? (uint8_t*)dl_alloc( &dl_ctx->alloc, data_size ) : 0x0;
+	if( templates == 0x0 || ( data_size > 0 && data == 0x0 ) )
+	{
+		if( templates ) dl_free( &dl_ctx->alloc, templates );
+		if( data )      dl_free( &dl_ctx->alloc, data );
+		return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+	}
+
+	size_t pos = 0;
+	for( unsigned int i = 0; i < type_count; ++i )
+	{
+		const dl_type_desc* type = dl_ctx->type_descs + i;
+		if( type->flags & DL_TYPE_FLAG_IS_UNION )
+		{
+			// ... unions are packed member by member, no template.
+			templates[i].offset = UINT32_MAX;
+			templates[i].flags  = 0;
+			continue;
+		}
+
+		pos = dl_internal_align_up( pos, 8 );
+		templates[i].offset = (uint32_t)pos;
+		templates[i].flags  = dl_internal_build_default_template( dl_ctx, type, data + pos );
+		pos += type->size[DL_PTR_SIZE_HOST];
+	}
+
+	dl_ctx->type_default_templates      = templates;
+	dl_ctx->type_default_template_count = type_count;
+	dl_ctx->default_template_data       = data;
+	return DL_ERROR_OK;
+}
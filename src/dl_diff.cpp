@@ -0,0 +1,783 @@
+/* copyright (c) 2010 Fredrik Kihlander, see LICENSE for more info */
+
+#include <dl/dl_diff.h>
+#include "dl_types.h"
+#include "dl_binary_writer.h"
+#include "container/dl_hash_table.h"
+
+/*
+	A diff is laid out as:
+		dl_diff_header
+		struct-diff of the root instance, or the complete new instance as a packed instance if DL_DIFF_FLAG_FULL is set.
+
+	struct-diff:      records of uint32 member-index followed by a member-diff, ended by DL_DIFF_END. For unions
+	                  DL_DIFF_UNION_SWITCH is set in the member-index if the active member changed, the member-diff
+	                  is then calculated against a zeroed member.
+	member-diff:      bitfields as uint64 value, pods as the new value, strings as a string, structs and pointers
+	                  as a struct-diff of the struct or the instance pointed to and inline arrays as element-diffs.
+	                  Arrays as uint32 DL_DIFF_ARRAY_EDIT followed by element-diffs if the element-count is unchanged,
+	                  otherwise as uint32 DL_DIFF_ARRAY_SPLICE followed by uint32 start, removed count and inserted
+	                  count and the inserted elements.
+	element-diffs:    records of uint32 element-index followed by a member-diff of the element, ended by DL_DIFF_END.
+	inserted element: pods as the value, strings as a string and structs as a struct-diff against a zeroed struct.
+	string:           uint32 length, DL_DIFF_NULL_STR for null, followed by the characters without terminating zero.
+
+	Everything is stored unaligned in the endian of the platform that calculated the diff.
+*/
+
+struct dl_diff_header
+{
+	uint32_t    id;
+	uint32_t    version;
+	dl_typeid_t root_type;
+	uint32_t    flags;
+};
+
+static const uint32_t DL_DIFF_ID           = ('D'<< 24) | ('L' << 16) | ('D' << 8) | 'F';
+static const uint32_t DL_DIFF_VERSION      = 1;
+static const uint32_t DL_DIFF_FLAG_FULL    = 1 << 0;
+
+static const uint32_t DL_DIFF_END          = 0xFFFFFFFF;
+static const uint32_t DL_DIFF_NULL_STR     = 0xFFFFFFFF;
+static const uint32_t DL_DIFF_UNION_SWITCH = 0x80000000;
+static const uint32_t DL_DIFF_ARRAY_EDIT   = 0;
+static const uint32_t DL_DIFF_ARRAY_SPLICE = 1;
+
+static size_t dl_internal_diff_element_size( dl_type_storage_t storage, const dl_type_desc* sub_type )
+{
+	switch( storage )
+	{
+		case DL_TYPE_STORAGE_STRUCT: return sub_type->size[DL_PTR_SIZE_HOST];
+		case DL_TYPE_STORAGE_STR:
+		case DL_TYPE_STORAGE_PTR:    return sizeof(void*);
+		default:                     return dl_pod_size( storage );
+	}
+}
+
+static const dl_type_desc* dl_internal_diff_sub_type( dl_ctx_t dl_ctx, const dl_member_desc* member )
+{
+	dl_type_storage_t storage = member->StorageType();
+	if( storage == DL_TYPE_STORAGE_STRUCT || storage == DL_TYPE_STORAGE_PTR )
+		return dl_internal_find_type( dl_ctx, member->type_id );
+	return 0x0;
+}
+
+struct dl_diff_ptr_match
+{
+	const void* ptr;
+	const void* other; // ptr in the other instance that ptr was matched against.
+};
+
+struct dl_diff_ptr_match_eq
+{
+	const void* ptr;
+	bool operator()( const dl_diff_ptr_match& match ) const { return match.ptr == ptr; }
+};
+
+struct dl_diff_ctx
+{
+	dl_ctx_t         ctx;
+	dl_binary_writer writer;
+	bool             full;          // the ptrs of the instance changed, the complete new instance is stored.
+	bool             out_of_memory;
+	uint8_t*         zero;          // zeroed memory of the size of the largest type, inserted structs are diffed against it.
+
+	// pointed to instances that has been diffed, from old to new and new to old.
+	dl_hash_table<dl_diff_ptr_match> matched_old;
+	dl_hash_table<dl_diff_ptr_match> matched_new;
+
+	void Write32( uint32_t value ) { dl_binary_writer_write( &writer, &value, sizeof(value) ); }
+
+	// drop everything written after pos, used when a member turned out to be unchanged.
+	void Rewind( size_t pos )
+	{
+		writer.pos         = pos;
+		writer.needed_size = pos;
+	}
+};
+
+static bool dl_internal_diff_struct( dl_diff_ctx* d, const dl_type_desc* type, const uint8_t* a, const uint8_t* b );
+
+static bool dl_internal_diff_str_equal( const char* a, const char* b )
+{
+	if( a == b )
+		return true;
+	if( a == 0x0 || b == 0x0 )
+		return false;
+	return strcmp( a, b ) == 0;
+}
+
+static void dl_internal_diff_write_str( dl_diff_ctx* d, const char* str )
+{
+	if( str == 0x0 )
+	{
+		d->Write32( DL_DIFF_NULL_STR );
+		return;
+	}
+	uint32_t len = (uint32_t)strlen( str );
+	d->Write32( len );
+	dl_binary_writer_write( &d->writer, str, len );
+}
+
+static bool dl_internal_diff_ptr( dl_diff_ctx* d, const dl_type_desc* type, const uint8_t* a, const uint8_t* b )
+{
+	if( d->full )
+		return false;
+
+	if( a == 0x0 || b == 0x0 )
+	{
+		d->full = a != b;
+		return false;
+	}
+
+	dl_diff_ptr_match_eq eq_a = { a };
+	const dl_diff_ptr_match* match = d->matched_old.find( dl_internal_hash_ptr( a ), eq_a );
+	if( match != 0x0 )
+	{
+		// already diffed where it was first found.
+		d->full = match->other != b;
+		return false;
+	}
+
+	dl_diff_ptr_match_eq eq_b = { b };
+	if( d->matched_new.find( dl_internal_hash_ptr( b ), eq_b ) != 0x0 )
+	{
+		d->full = true; // b was pointed to from another place in old.
+		return false;
+	}
+
+	dl_diff_ptr_match match_a = { a, b };
+	dl_diff_ptr_match match_b = { b, a };
+	if( !d->matched_old.insert( dl_internal_hash_ptr( a ), match_a ) || !d->matched_new.insert( dl_internal_hash_ptr( b ), match_b ) )
+	{
+		d->out_of_memory = true;
+		return false;
+	}
+	return dl_internal_diff_struct( d, type, a, b );
+}
+
+// write the diff from element a to element b, returns false and writes nothing useful if they are equal.
+static bool dl_internal_diff_element( dl_diff_ctx* d, dl_type_storage_t storage, const dl_type_desc* sub_type, const uint8_t* a, const uint8_t* b )
+{
+	switch( storage )
+	{
+		case DL_TYPE_STORAGE_STRUCT:
+			return dl_internal_diff_struct( d, sub_type, a, b );
+		case DL_TYPE_STORAGE_PTR:
+			return dl_internal_diff_ptr( d, sub_type, *(const uint8_t**)a, *(const uint8_t**)b );
+		case DL_TYPE_STORAGE_STR:
+			if( dl_internal_diff_str_equal( *(const char**)a, *(const char**)b ) )
+				return false;
+			dl_internal_diff_write_str( d, *(const char**)b );
+			return true;
+		default:
+		{
+			size_t size = dl_pod_size( storage );
+			if( memcmp( a, b, size ) == 0 )
+				return false;
+			dl_binary_writer_write( &d->writer, b, size );
+			return true;
+		}
+	}
+}
+
+static bool dl_internal_diff_element_changed( dl_diff_ctx* d, dl_type_storage_t storage, const dl_type_desc* sub_type, const uint8_t* a, const uint8_t* b )
+{
+	size_t mark = dl_binary_writer_tell( &d->writer );
+	bool changed = dl_internal_diff_element( d, storage, sub_type, a, b );
+	d->Rewind( mark );
+	return changed;
+}
+
+static bool dl_internal_diff_elements( dl_diff_ctx* d, dl_type_storage_t storage, const dl_type_desc* sub_type, const uint8_t* a, const uint8_t* b, uint32_t count )
+{
+	size_t elem_size = dl_internal_diff_element_size( storage, sub_type );
+	bool   changed   = false;
+	for( uint32_t elem = 0; elem < count; ++elem )
+	{
+		size_t mark = dl_binary_writer_tell( &d->writer );
+		d->Write32( elem );
+		if( dl_internal_diff_element( d, storage, sub_type, a + elem * elem_size, b + elem * elem_size ) )
+			changed = true;
+		else
+			d->Rewind( mark );
+	}
+	d->Write32( DL_DIFF_END );
+	return changed;
+}
+
+static bool dl_internal_diff_array( dl_diff_ctx* d, dl_type_storage_t storage, const dl_type_desc* sub_type, const uint8_t* a, const uint8_t* b )
+{
+	const uint8_t* data_a  = *(const uint8_t**)a;
+	const uint8_t* data_b  = *(const uint8_t**)b;
+	uint32_t       count_a = *(const uint32_t*)( a + sizeof(void*) );
+	uint32_t       count_b = *(const uint32_t*)( b + sizeof(void*) );
+
+	size_t mark = dl_binary_writer_tell( &d->writer );
+	if( count_a == count_b )
+	{
+		d->Write32( DL_DIFF_ARRAY_EDIT );
+		if( dl_internal_diff_elements( d, storage, sub_type, data_a, data_b, count_a ) )
+			return true;
+		d->Rewind( mark );
+		return false;
+	}
+
+	if( storage == DL_TYPE_STORAGE_PTR )
+	{
+		d->full = true;
+		return false;
+	}
+
+	// replace everything between the equal elements at the start and end of the arrays.
+	size_t   elem_size = dl_internal_diff_element_size( storage, sub_type );
+	uint32_t min_count = count_a < count_b ? count_a : count_b;
+	uint32_t prefix    = 0;
+	while( prefix < min_count && !dl_internal_diff_element_changed( d, storage, sub_type, data_a + prefix * elem_size, data_b + prefix * elem_size ) )
+		++prefix;
+	uint32_t suffix = 0;
+	while( suffix < min_count - prefix && !dl_internal_diff_element_changed( d, storage, sub_type, data_a + ( count_a - 1 - suffix ) * elem_size, data_b + ( count_b - 1 - suffix ) * elem_size ) )
+		++suffix;
+
+	uint32_t inserted = count_b - prefix - suffix;
+	d->Write32( DL_DIFF_ARRAY_SPLICE );
+	d->Write32( prefix );
+	d->Write32( count_a - prefix - suffix );
+	d->Write32( inserted );
+	for( uint32_t elem = prefix; elem < prefix + inserted; ++elem )
+	{
+		const uint8_t* elem_b = data_b + elem * elem_size;
+		switch( storage )
+		{
+			case DL_TYPE_STORAGE_STRUCT: dl_internal_diff_struct( d, sub_type, d->zero, elem_b ); break;
+			case DL_TYPE_STORAGE_STR:    dl_internal_diff_write_str( d, *(const char**)elem_b );  break;
+			default:                     dl_binary_writer_write( &d->writer, elem_b, elem_size ); break;
+		}
+	}
+	return true;
+}
+
+static bool dl_internal_diff_member( dl_diff_ctx* d, const dl_member_desc* member, const uint8_t* a, const uint8_t* b )
+{
+	switch( member->AtomType() )
+	{
+		case DL_TYPE_ATOM_POD:
+			return dl_internal_diff_element( d, member->StorageType(), dl_internal_diff_sub_type( d->ctx, member ), a, b );
+		case DL_TYPE_ATOM_INLINE_ARRAY:
+			return dl_internal_diff_elements( d, member->StorageType(), dl_internal_diff_sub_type( d->ctx, member ), a, b, member->inline_array_cnt() );
+		case DL_TYPE_ATOM_ARRAY:
+			return dl_internal_diff_array( d, member->StorageType(), dl_internal_diff_sub_type( d->ctx, member ), a, b );
+		case DL_TYPE_ATOM_BITFIELD:
+		{
+			uint64_t value = dl_internal_read_host_bitfield( member, b );
+			if( dl_internal_read_host_bitfield( member, a ) == value )
+				return false;
+			dl_binary_writer_write( &d->writer, &value, sizeof(value) );
+			return true;
+		}
+		default:
+			DL_ASSERT( false && "Invalid ATOM-type!" );
+			return false;
+	}
+}
+
+static bool dl_internal_diff_struct( dl_diff_ctx* d, const dl_type_desc* type, const uint8_t* a, const uint8_t* b )
+{
+	bool changed = false;
+	if( type->flags & DL_TYPE_FLAG_IS_UNION )
+	{
+		size_t   type_offset  = dl_internal_union_type_offset( d->ctx, type, DL_PTR_SIZE_HOST );
+		uint32_t union_type_a = *(const uint32_t*)( a + type_offset );
+		uint32_t union_type_b = *(const uint32_t*)( b + type_offset );
+		uint32_t member_index = union_type_b - dl_internal_typeid_of( d->ctx, type ) - 1;
+		if( member_index < type->member_count )
+		{
+			const dl_member_desc* member = dl_get_type_member( d->ctx, type, member_index );
+			size_t offset = member->offset[DL_PTR_SIZE_HOST];
+			size_t mark   = dl_binary_writer_tell( &d->writer );
+			if( union_type_a != union_type_b )
+			{
+				d->Write32( member_index | DL_DIFF_UNION_SWITCH );
+				dl_internal_diff_member( d, member, d->zero + offset, b + offset );
+				changed = true;
+			}
+			else
+			{
+				d->Write32( member_index );
+				changed = dl_internal_diff_member( d, member, a + offset, b + offset );
+				if( !changed )
+					d->Rewind( mark );
+			}
+		}
+	}
+	else
+	{
+		for( uint32_t member_index = 0; member_index < type->member_count; ++member_index )
+		{
+			const dl_member_desc* member = dl_get_type_member( d->ctx, type, member_index );
+			size_t mark = dl_binary_writer_tell( &d->writer );
+			d->Write32( member_index );
+			if( dl_internal_diff_member( d, member, a + member->offset[DL_PTR_SIZE_HOST], b + member->offset[DL_PTR_SIZE_HOST] ) )
+				changed = true;
+			else
+				d->Rewind( mark );
+		}
+	}
+	d->Write32( DL_DIFF_END );
+	return changed;
+}
+
+dl_error_t dl_instance_diff( dl_ctx_t       dl_ctx,   dl_typeid_t type_id,       const void* old_instance, const void* new_instance,
+							 unsigned char* out_diff, size_t      out_diff_size, size_t*     produced_bytes )
+{
+	const dl_type_desc* type = dl_internal_find_type( dl_ctx, type_id );
+	if( type == 0x0 )
+		return DL_ERROR_TYPE_NOT_FOUND;
+
+	size_t zero_size = 0;
+	for( unsigned int i = 0; i < dl_ctx->type_count; ++i )
+		if( dl_ctx->type_descs[i].size[DL_PTR_SIZE_HOST] > zero_size )
+			zero_size = dl_ctx->type_descs[i].size[DL_PTR_SIZE_HOST];
+
+	dl_diff_ctx d;
+	d.ctx           = dl_ctx;
+	d.full          = false;
+	d.out_of_memory = false;
+	d.zero          = (uint8_t*)dl_alloc( &dl_ctx->alloc, zero_size );
+	if( d.zero == 0x0 )
+		return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+	memset( d.zero, 0x0, zero_size );
+	d.matched_old.init( &dl_ctx->alloc );
+	d.matched_new.init( &dl_ctx->alloc );
+
+	dl_binary_writer_init( &d.writer, out_diff, out_diff_size, out_diff_size == 0, DL_ENDIAN_HOST, DL_ENDIAN_HOST, DL_PTR_SIZE_HOST );
+	dl_binary_writer_reserve( &d.writer, sizeof(dl_diff_header) );
+	dl_binary_writer_seek_end( &d.writer );
+
+	dl_internal_diff_struct( &d, type, (const uint8_t*)old_instance, (const uint8_t*)new_instance );
+
+	d.matched_old.destroy();
+	d.matched_new.destroy();
+	dl_free( &dl_ctx->alloc, d.zero );
+	if( d.out_of_memory )
+		return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+
+	dl_diff_header header;
+	header.id        = DL_DIFF_ID;
+	header.version   = DL_DIFF_VERSION;
+	header.root_type = type_id;
+	header.flags     = 0;
+
+	size_t diff_size = dl_binary_writer_needed_size( &d.writer );
+	if( d.full )
+	{
+		// the pointers changed, store the complete new instance after the header instead.
+		size_t packed_size = 0;
+		dl_error_t err = dl_instance_store( dl_ctx, type_id, new_instance, 0x0, 0, &packed_size );
+		if( err != DL_ERROR_OK )
+			return err;
+
+		header.flags = DL_DIFF_FLAG_FULL;
+		diff_size    = sizeof(dl_diff_header) + packed_size;
+		if( out_diff_size >= diff_size )
+		{
+			err = dl_instance_store( dl_ctx, type_id, new_instance, out_diff + sizeof(dl_diff_header), packed_size, 0x0 );
+			if( err != DL_ERROR_OK )
+				return err;
+		}
+	}
+
+	if( produced_bytes )
+		*produced_bytes = diff_size;
+
+	if( out_diff_size > 0 && diff_size > out_diff_size )
+		return DL_ERROR_BUFFER_TO_SMALL;
+
+	if( out_diff_size > 0 )
+		memcpy( out_diff, &header, sizeof(dl_diff_header) );
+	return DL_ERROR_OK;
+}
+
+struct dl_diff_apply_alloc
+{
+	dl_diff_apply_alloc* next;
+	uint8_t              pad[8]; // keep the memory after the header aligned to 16 bytes.
+};
+
+struct dl_diff_apply_ctx
+{
+	dl_ctx_t             ctx;
+	const uint8_t*       diff;
+	size_t               diff_size;
+	size_t               pos;
+	dl_diff_apply_alloc* allocs; // arrays and strings allocated by the diff, freed when the result has been written.
+
+	bool Read( void* out, size_t size )
+	{
+		if( diff_size - pos < size )
+			return false;
+		memcpy( out, diff + pos, size );
+		pos += size;
+		return true;
+	}
+
+	bool Read32( uint32_t* out ) { return Read( out, sizeof(uint32_t) ); }
+
+	uint8_t* Alloc( size_t size )
+	{
+		dl_diff_apply_alloc* alloc = (dl_diff_apply_alloc*)dl_alloc( &ctx->alloc, sizeof(dl_diff_apply_alloc) + size );
+		if( alloc == 0x0 )
+			return 0x0;
+		alloc->next = allocs;
+		allocs      = alloc;
+		uint8_t* data = (uint8_t*)( alloc + 1 );
+		memset( data, 0x0, size );
+		return data;
+	}
+
+	void FreeAll()
+	{
+		while( allocs != 0x0 )
+		{
+			dl_diff_apply_alloc* next = allocs->next;
+			dl_free( &ctx->alloc, allocs );
+			allocs = next;
+		}
+	}
+};
+
+static dl_error_t dl_internal_diff_apply_struct( dl_diff_apply_ctx* a, const dl_type_desc* type, uint8_t* data );
+
+static dl_error_t dl_internal_diff_apply_str( dl_diff_apply_ctx* a, uint8_t* data )
+{
+	uint32_t len;
+	if( !a->Read32( &len ) )
+		return DL_ERROR_MALFORMED_DATA;
+	if( len == DL_DIFF_NULL_STR )
+	{
+		*(char**)data = 0x0;
+		return DL_ERROR_OK;
+	}
+	if( a->diff_size - a->pos < len )
+		return DL_ERROR_MALFORMED_DATA;
+
+	char* str = (char*)a->Alloc( (size_t)len + 1 );
+	if( str == 0x0 )
+		return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+	a->Read( str, len );
+	*(char**)data = str;
+	return DL_ERROR_OK;
+}
+
+static dl_error_t dl_internal_diff_apply_element( dl_diff_apply_ctx* a, dl_type_storage_t storage, const dl_type_desc* sub_type, uint8_t* data )
+{
+	switch( storage )
+	{
+		case DL_TYPE_STORAGE_STRUCT:
+			return dl_internal_diff_apply_struct( a, sub_type, data );
+		case DL_TYPE_STORAGE_PTR:
+		{
+			uint8_t* target = *(uint8_t**)data;
+			if( target == 0x0 )
+				return DL_ERROR_MALFORMED_DATA;
+			return dl_internal_diff_apply_struct( a, sub_type, target );
+		}
+		case DL_TYPE_STORAGE_STR:
+			return dl_internal_diff_apply_str( a, data );
+		default:
+			return a->Read( data, dl_pod_size( storage ) ) ? DL_ERROR_OK : DL_ERROR_MALFORMED_DATA;
+	}
+}
+
+static dl_error_t dl_internal_diff_apply_elements( dl_diff_apply_ctx* a, dl_type_storage_t storage, const dl_type_desc* sub_type, uint8_t* data, uint32_t count )
+{
+	size_t elem_size = dl_internal_diff_element_size( storage, sub_type );
+	while( true )
+	{
+		uint32_t elem;
+		if( !a->Read32( &elem ) )
+			return DL_ERROR_MALFORMED_DATA;
+		if( elem == DL_DIFF_END )
+			return DL_ERROR_OK;
+		if( elem >= count )
+			return DL_ERROR_MALFORMED_DATA;
+
+		dl_error_t err = dl_internal_diff_apply_element( a, storage, sub_type, data + elem * elem_size );
+		if( err != DL_ERROR_OK )
+			return err;
+	}
+}
+
+static dl_error_t dl_internal_diff_apply_array( dl_diff_apply_ctx* a, dl_type_storage_t storage, const dl_type_desc* sub_type, uint8_t* member_data )
+{
+	uint8_t** data  = (uint8_t**)member_data;
+	uint32_t* count = (uint32_t*)( member_data + sizeof(void*) );
+
+	uint32_t kind;
+	if( !a->Read32( &kind ) )
+		return DL_ERROR_MALFORMED_DATA;
+	if( kind == DL_DIFF_ARRAY_EDIT )
+	{
+		// array-data might be shared with other members, i.e. by DL_STOREFLAGS_MERGE_IDENTICAL_SUBDATA, so elements are
+		// edited in a copy of the array.
+		if( *count > 0 )
+		{
+			size_t   elem_size = dl_internal_diff_element_size( storage, sub_type );
+			uint8_t* new_data  = a->Alloc( (size_t)*count * elem_size );
+			if( new_data == 0x0 )
+				return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+			memcpy( new_data, *data, (size_t)*count * elem_size );
+			*data = new_data;
+		}
+		return dl_internal_diff_apply_elements( a, storage, sub_type, *data, *count );
+	}
+	if( kind != DL_DIFF_ARRAY_SPLICE )
+		return DL_ERROR_MALFORMED_DATA;
+
+	uint32_t start, removed, inserted;
+	if( !a->Read32( &start ) || !a->Read32( &removed ) || !a->Read32( &inserted ) )
+		return DL_ERROR_MALFORMED_DATA;
+	// each inserted element is at least one byte in the diff.
+	if( start > *count || removed > *count - start || inserted > a->diff_size - a->pos || ( storage == DL_TYPE_STORAGE_PTR && inserted > 0 ) )
+		return DL_ERROR_MALFORMED_DATA;
+
+	size_t   elem_size = dl_internal_diff_element_size( storage, sub_type );
+	uint32_t kept      = *count - start - removed;
+	uint64_t new_count = (uint64_t)*count - removed + inserted;
+	if( new_count > 0xFFFFFFFF )
+		return DL_ERROR_MALFORMED_DATA;
+
+	uint8_t* new_data = 0x0;
+	if( new_count > 0 )
+	{
+		new_data = a->Alloc( (size_t)new_count * elem_size );
+		if( new_data == 0x0 )
+			return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+		if( start > 0 )
+			memcpy( new_data, *data, start * elem_size );
+		if( kept > 0 )
+			memcpy( new_data + ( (size_t)start + inserted ) * elem_size, *data + ( (size_t)start + removed ) * elem_size, kept * elem_size );
+	}
+
+	// inserted elements are zeroed and the diff is applied on top of that.
+	for( uint32_t elem = start; elem < start + inserted; ++elem )
+	{
+		dl_error_t err = dl_internal_diff_apply_element( a, storage, sub_type, new_data + elem * elem_size );
+		if( err != DL_ERROR_OK )
+			return err;
+	}
+
+	*data  = new_data;
+	*count = (uint32_t)new_count;
+	return DL_ERROR_OK;
+}
+
+static void dl_internal_diff_write_host_bitfield( const dl_member_desc* member, uint8_t* data, uint64_t value )
+{
+	uint32_t size   = member->size[DL_PTR_SIZE_HOST];
+	uint32_t bits   = member->bitfield_bits();
+	uint64_t offset = dl_bf_offset( DL_ENDIAN_HOST, size, member->bitfield_offset(), bits );
+	switch( size )
+	{
+		case 1: *(uint8_t*)data  = (uint8_t) DL_INSERT_BITS( (uint64_t)*(uint8_t*)data,  value, offset, (uint64_t)bits ); break;
+		case 2: *(uint16_t*)data = (uint16_t)DL_INSERT_BITS( (uint64_t)*(uint16_t*)data, value, offset, (uint64_t)bits ); break;
+		case 4: *(uint32_t*)data = (uint32_t)DL_INSERT_BITS( (uint64_t)*(uint32_t*)data, value, offset, (uint64_t)bits ); break;
+		case 8: *(uint64_t*)data =           DL_INSERT_BITS( *(uint64_t*)data,           value, offset, (uint64_t)bits ); break;
+		default: DL_ASSERT( false && "This should not happen!" ); break;
+	}
+}
+
+static dl_error_t dl_internal_diff_apply_member( dl_diff_apply_ctx* a, const dl_member_desc* member, uint8_t* data )
+{
+	const dl_type_desc* sub_type = dl_internal_diff_sub_type( a->ctx, member );
+	switch( member->AtomType() )
+	{
+		case DL_TYPE_ATOM_POD:
+			return dl_internal_diff_apply_element( a, member->StorageType(), sub_type, data );
+		case DL_TYPE_ATOM_INLINE_ARRAY:
+			return dl_internal_diff_apply_elements( a, member->StorageType(), sub_type, data, member->inline_array_cnt() );
+		case DL_TYPE_ATOM_ARRAY:
+			return dl_internal_diff_apply_array( a, member->StorageType(), sub_type, data );
+		case DL_TYPE_ATOM_BITFIELD:
+		{
+			uint64_t value;
+			if( !a->Read( &value, sizeof(value) ) )
+				return DL_ERROR_MALFORMED_DATA;
+			dl_internal_diff_write_host_bitfield( member, data, value );
+			return DL_ERROR_OK;
+		}
+		default:
+			DL_ASSERT( false && "Invalid ATOM-type!" );
+			return DL_ERROR_INTERNAL_ERROR;
+	}
+}
+
+static dl_error_t dl_internal_diff_apply_struct( dl_diff_apply_ctx* a, const dl_type_desc* type, uint8_t* data )
+{
+	bool is_union = ( type->flags & DL_TYPE_FLAG_IS_UNION ) != 0;
+	while( true )
+	{
+		uint32_t member_index;
+		if( !a->Read32( &member_index ) )
+			return DL_ERROR_MALFORMED_DATA;
+		if( member_index == DL_DIFF_END )
+			return DL_ERROR_OK;
+
+		bool union_switch = is_union && ( member_index & DL_DIFF_UNION_SWITCH ) != 0;
+		if( union_switch )
+			member_index &= ~DL_DIFF_UNION_SWITCH;
+		if( member_index >= type->member_count )
+			return DL_ERROR_MALFORMED_DATA;
+
+		if( is_union )
+		{
+			size_t   type_offset = dl_internal_union_type_offset( a->ctx, type, DL_PTR_SIZE_HOST );
+			uint32_t union_type  = dl_internal_typeid_of( a->ctx, type ) + member_index + 1;
+			if( union_switch )
+			{
+				memset( data, 0x0, type->size[DL_PTR_SIZE_HOST] );
+				memcpy( data + type_offset, &union_type, sizeof(uint32_t) );
+			}
+			else if( *(const uint32_t*)( data + type_offset ) != union_type )
+				return DL_ERROR_MALFORMED_DATA;
+		}
+
+		const dl_member_desc* member = dl_get_type_member( a->ctx, type, member_index );
+		dl_error_t err = dl_internal_diff_apply_member( a, member, data + member->offset[DL_PTR_SIZE_HOST] );
+		if( err != DL_ERROR_OK )
+			return err;
+	}
+}
+
+static dl_error_t dl_internal_diff_read_header( const unsigned char* diff, size_t diff_size, dl_typeid_t type_id, dl_diff_header* header )
+{
+	if( diff_size < sizeof(dl_diff_header) )
+		return DL_ERROR_MALFORMED_DATA;
+	memcpy( header, diff, sizeof(dl_diff_header) );
+	if( header->id == dl_swap_endian_uint32( DL_DIFF_ID ) )
+		return DL_ERROR_ENDIAN_MISMATCH;
+	if( header->id != DL_DIFF_ID )
+		return DL_ERROR_MALFORMED_DATA;
+	if( header->version != DL_DIFF_VERSION )
+		return DL_ERROR_VERSION_MISMATCH;
+	if( header->root_type != type_id )
+		return DL_ERROR_TYPE_MISMATCH;
+	return DL_ERROR_OK;
+}
+
+// apply the struct-diff after the header to root, a loaded instance owned by the caller.
+static dl_error_t dl_internal_diff_apply( dl_diff_apply_ctx* a, dl_ctx_t dl_ctx, const dl_type_desc* type, uint8_t* root, const unsigned char* diff, size_t diff_size )
+{
+	a->ctx       = dl_ctx;
+	a->diff      = diff;
+	a->diff_size = diff_size;
+	a->pos       = sizeof(dl_diff_header);
+	a->allocs    = 0x0;
+
+	dl_error_t err = dl_internal_diff_apply_struct( a, type, root );
+	if( err == DL_ERROR_OK && a->pos != a->diff_size )
+		err = DL_ERROR_MALFORMED_DATA;
+	return err;
+}
+
+dl_error_t dl_instance_apply_diff( dl_ctx_t    dl_ctx,       dl_typeid_t          type_id,
+								   const void* instance,     const unsigned char* diff,              size_t  diff_size,
+								   void*       out_instance, size_t               out_instance_size, size_t* produced_bytes )
+{
+	const dl_type_desc* type = dl_internal_find_type( dl_ctx, type_id );
+	if( type == 0x0 )
+		return DL_ERROR_TYPE_NOT_FOUND;
+
+	dl_diff_header header;
+	dl_error_t err = dl_internal_diff_read_header( diff, diff_size, type_id, &header );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	if( header.flags & DL_DIFF_FLAG_FULL )
+	{
+		const unsigned char* packed      = diff + sizeof(dl_diff_header);
+		size_t               packed_size = diff_size - sizeof(dl_diff_header);
+		dl_instance_info_t   info;
+		err = dl_instance_get_info( packed, packed_size, &info );
+		if( err != DL_ERROR_OK )
+			return err;
+		if( produced_bytes )
+			*produced_bytes = info.load_size;
+		if( out_instance_size == 0 )
+			return DL_ERROR_OK;
+		return dl_instance_load( dl_ctx, type_id, out_instance, out_instance_size, packed, packed_size, 0x0 );
+	}
+
+	// the diff is applied to a copy of instance and the result is copied again to get a compact result.
+	size_t copy_size = 0;
+	err = dl_instance_copy( dl_ctx, type_id, instance, 0x0, 0, &copy_size );
+	if( err != DL_ERROR_OK )
+		return err;
+	uint8_t* copy = (uint8_t*)dl_alloc( &dl_ctx->alloc, copy_size );
+	if( copy == 0x0 )
+		return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+
+	dl_diff_apply_ctx a;
+	a.allocs = 0x0;
+	err = dl_instance_copy( dl_ctx, type_id, instance, copy, copy_size, 0x0 );
+	if( err == DL_ERROR_OK )
+		err = dl_internal_diff_apply( &a, dl_ctx, type, copy, diff, diff_size );
+	if( err == DL_ERROR_OK )
+		err = dl_instance_copy( dl_ctx, type_id, copy, out_instance, out_instance_size, produced_bytes );
+
+	a.FreeAll();
+	dl_free( &dl_ctx->alloc, copy );
+	return err;
+}
+
+dl_error_t dl_instance_apply_diff_packed( dl_ctx_t             dl_ctx,          dl_typeid_t          type_id,
+										  const unsigned char* packed_instance, size_t               packed_instance_size,
+										  const unsigned char* diff,            size_t               diff_size,
+										  unsigned char*       out_buffer,      size_t               out_buffer_size,
+										  size_t*              produced_bytes )
+{
+	const dl_type_desc* type = dl_internal_find_type( dl_ctx, type_id );
+	if( type == 0x0 )
+		return DL_ERROR_TYPE_NOT_FOUND;
+
+	dl_diff_header header;
+	dl_error_t err = dl_internal_diff_read_header( diff, diff_size, type_id, &header );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	if( header.flags & DL_DIFF_FLAG_FULL )
+	{
+		size_t packed_size = diff_size - sizeof(dl_diff_header);
+		if( produced_bytes )
+			*produced_bytes = packed_size;
+		if( out_buffer_size == 0 )
+			return DL_ERROR_OK;
+		if( out_buffer_size < packed_size )
+			return DL_ERROR_BUFFER_TO_SMALL;
+		memcpy( out_buffer, diff + sizeof(dl_diff_header), packed_size );
+		return DL_ERROR_OK;
+	}
+
+	dl_instance_info_t info;
+	err = dl_instance_get_info( packed_instance, packed_instance_size, &info );
+	if( err != DL_ERROR_OK )
+		return err;
+	if( info.root_type != type_id )
+		return DL_ERROR_TYPE_MISMATCH;
+
+	uint8_t* loaded = (uint8_t*)dl_alloc( &dl_ctx->alloc, info.load_size );
+	if( loaded == 0x0 )
+		return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+
+	dl_diff_apply_ctx a;
+	a.allocs = 0x0;
+	err = dl_instance_load( dl_ctx, type_id, loaded, info.load_size, packed_instance, packed_instance_size, 0x0 );
+	if( err == DL_ERROR_OK )
+		err = dl_internal_diff_apply( &a, dl_ctx, type, loaded, diff, diff_size );
+	if( err == DL_ERROR_OK )
+		err = dl_instance_store( dl_ctx, type_id, loaded, out_buffer, out_buffer_size, produced_bytes );
+
+	a.FreeAll();
+	dl_free( &dl_ctx->alloc, loaded );
+	return err;
+}
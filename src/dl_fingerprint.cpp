@@ -0,0 +1,122 @@
+/* copyright (c) 2010 Fredrik Kihlander, see LICENSE for more info */
+
+#include <string.h>
+
+#include "dl_types.h"
+#include "dl_hash.h"
+#include "dl_swap.h"
+
+/*
+	The layout-fingerprint of a type is a combination of the "local" fingerprint of the type itself and of all types
+	reachable from it via members, arrays and pointers. The local fingerprint covers size and alignment of the type and
+	name, type, size and offset of each member, for both 32- and 64-bit ptrs so that it is the same for instances stored
+	with any ptr-size. Reachable types are combined in an order-independent way so that the fingerprint do not depend on
+	the order types were loaded in and is well defined for types that reference themselves.
+*/
+
+static uint32_t dl_internal_local_fingerprint( dl_ctx_t dl_ctx, const dl_type_desc* type )
+{
+	uint32_t hash = dl_internal_hash_combine( 0, type->flags & DL_TYPE_FLAG_IS_UNION );
+	hash = dl_internal_hash_combine( hash, type->size[DL_PTR_SIZE_32BIT] );
+	hash = dl_internal_hash_combine( hash, type->size[DL_PTR_SIZE_64BIT] );
+	hash = dl_internal_hash_combine( hash, type->alignment[DL_PTR_SIZE_32BIT] );
+	hash = dl_internal_hash_combine( hash, type->alignment[DL_PTR_SIZE_64BIT] );
+	hash = dl_internal_hash_combine( hash, type->member_count );
+
+	for( uint32_t i = 0; i < type->member_count; ++i )
+	{
+		const dl_member_desc* member = dl_get_type_member( dl_ctx, type, i );
+		hash = dl_internal_hash_combine( hash, dl_internal_hash_string( dl_internal_member_name( dl_ctx, member ) ) );
+		hash = dl_internal_hash_combine( hash, (uint32_t)member->type );
+		hash = dl_internal_hash_combine( hash, member->type_id );
+		hash = dl_internal_hash_combine( hash, member->size[DL_PTR_SIZE_32BIT] );
+		hash = dl_internal_hash_combine( hash, member->size[DL_PTR_SIZE_64BIT] );
+		hash = dl_internal_hash_combine( hash, member->offset[DL_PTR_SIZE_32BIT] );
+		hash = dl_internal_hash_combine( hash, member->offset[DL_PTR_SIZE_64BIT] );
+	}
+	return hash;
+}
+
+dl_error_t dl_internal_update_type_fingerprints( dl_ctx_t dl_ctx )
+{
+	unsigned int type_count = dl_ctx->type_count;
+
+	dl_free( &dl_ctx->alloc, dl_ctx->type_fingerprints );
+	dl_ctx->type_fingerprints = 0x0;
+	if( type_count == 0 )
+		return DL_ERROR_OK;
+
+	uint32_t* fingerprints = (uint32_t*)dl_alloc( &dl_ctx->alloc, sizeof(uint32_t) * type_count );
+	uint32_t* scratch      = (uint32_t*)dl_alloc( &dl_ctx->alloc, sizeof(uint32_t) * type_count * 3 );
+	if( fingerprints == 0x0 || scratch == 0x0 )
+	{
+		if( fingerprints ) dl_free( &dl_ctx->alloc, fingerprints );
+		if( scratch )      dl_free( &dl_ctx->alloc, scratch );
+		return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+	}
+
+	uint32_t* local   = scratch;                  // local fingerprint of each type.
+	uint32_t* visited = scratch + type_count;     // index of the last root-type + 1 that reached each type.
+	uint32_t* stack   = scratch + type_count * 2;
+
+	for( unsigned int i = 0; i < type_count; ++i )
+		local[i] = dl_internal_local_fingerprint( dl_ctx, dl_ctx->type_descs + i );
+	memset( visited, 0x0, sizeof(uint32_t) * type_count );
+
+	for( unsigned int root = 0; root < type_count; ++root )
+	{
+		uint32_t mark = root + 1;
+		uint32_t reachable = 0;
+		unsigned int stack_size = 0;
+		stack[stack_size++] = root;
+		visited[root] = mark;
+
+		while( stack_size > 0 )
+		{
+			const dl_type_desc* type = dl_ctx->type_descs + stack[--stack_size];
+			for( uint32_t i = 0; i < type->member_count; ++i )
+			{
+				const dl_member_desc* member = dl_get_type_member( dl_ctx, type, i );
+				dl_type_storage_t storage = member->StorageType();
+				if( storage != DL_TYPE_STORAGE_STRUCT && storage != DL_TYPE_STORAGE_PTR )
+					continue;
+
+				const dl_type_desc* sub_type = dl_internal_find_type( dl_ctx, member->type_id );
+				if( sub_type == 0x0 )
+					continue;
+
+				uint32_t sub_index = (uint32_t)( sub_type - dl_ctx->type_descs );
+				if( visited[sub_index] == mark )
+					continue;
+
+				visited[sub_index] = mark;
+				stack[stack_size++] = sub_index;
+				reachable += dl_internal_hash_combine( dl_ctx->type_ids[sub_index], local[sub_index] );
+			}
+		}
+
+		fingerprints[root] = dl_internal_hash_combine( local[root], reachable );
+	}
+
+	dl_free( &dl_ctx->alloc, scratch );
+	dl_ctx->type_fingerprints = fingerprints;
+	return DL_ERROR_OK;
+}
+
+dl_error_t dl_internal_check_fingerprint( dl_ctx_t dl_ctx, const dl_type_desc* type, const dl_data_header* header,
+										  const uint8_t* packed_instance, size_t packed_instance_size, bool swap )
+{
+	if( ( header->flags & DL_DATA_HEADER_FLAG_FINGERPRINT ) == 0 )
+		return DL_ERROR_OK;
+
+	uint64_t offset = dl_internal_header_fingerprint_offset( header );
+	if( offset + sizeof(uint32_t) > packed_instance_size )
+		return DL_ERROR_MALFORMED_DATA;
+
+	uint32_t fingerprint;
+	memcpy( &fingerprint, packed_instance + offset, sizeof(uint32_t) );
+	if( swap )
+		fingerprint = dl_swap_endian_uint32( fingerprint );
+
+	return fingerprint == dl_internal_type_fingerprint( dl_ctx, type ) ? DL_ERROR_OK : DL_ERROR_TYPE_LAYOUT_MISMATCH;
+}
@@ -3,12 +3,14 @@
 
 #include <dl/dl_defines.h>
 
+#include <string.h>
+
 // TODO: replace with murmur3
 
 static inline uint32_t dl_internal_hash_buffer( const uint8_t* buffer, size_t bytes )
 {
 	uint32_t hash = 5381;
-	for (unsigned int i = 0; i < bytes; i++)
+	for (size_t i = 0; i < bytes; i++)
 		hash = (hash * uint32_t(33)) + *((uint8_t*)buffer + i);
 	return hash - 5381;
 }
@@ -21,5 +23,105 @@ static inline uint32_t dl_internal_hash_string( const char* str )
 	return hash - 5381; // So empty string == 0
 }
 
+static inline uint32_t dl_internal_hash_combine( uint32_t seed, uint32_t hash )
+{
+	return seed ^ ( hash + 0x9e3779b9 + ( seed << 6 ) + ( seed >> 2 ) );
+}
+
+static inline uint32_t dl_internal_hash_ptr( const void* ptr )
+{
+	uint64_t p = (uint64_t)(uintptr_t)ptr;
+	return (uint32_t)( ( p ^ ( p >> 32 ) ) * 2654435761u );
+}
+
+/*
+	Streaming 64-bit hash, processes 8 bytes at a time. The result only depends on the bytes fed to it and not on how
+	they were split between calls to dl_internal_hash64_update, so data can be hashed in one large block or member
+	by member with the same result.
+*/
+struct dl_hash64
+{
+	uint64_t hash;
+	uint64_t total_bytes;
+	uint32_t tail_bytes;
+	uint8_t  tail[8];
+};
+
+static inline uint64_t dl_internal_rotl64( uint64_t v, int bits ) { return ( v << bits ) | ( v >> ( 64 - bits ) ); }
+
+static inline uint64_t dl_internal_hash64_round( uint64_t hash, uint64_t word )
+{
+	word *= 0xC2B2AE3D27D4EB4FULL;
+	word  = dl_internal_rotl64( word, 31 );
+	word *= 0x9E3779B185EBCA87ULL;
+	hash ^= word;
+	return dl_internal_rotl64( hash, 27 ) * 0x9E3779B185EBCA87ULL + 0x85EBCA77C2B2AE63ULL;
+}
+
+static inline void dl_internal_hash64_init( dl_hash64* h, uint64_t seed )
+{
+	h->hash        = seed + 0x27D4EB2F165667C5ULL;
+	h->total_bytes = 0;
+	h->tail_bytes  = 0;
+}
+
+static inline void dl_internal_hash64_update( dl_hash64* h, const void* data, size_t bytes )
+{
+	const uint8_t* p   = (const uint8_t*)data;
+	const uint8_t* end = p + bytes;
+	h->total_bytes += bytes;
+
+	// ... finish a word started by an earlier update ...
+	if( h->tail_bytes != 0 )
+	{
+		while( p != end && h->tail_bytes != 8 )
+			h->tail[h->tail_bytes++] = *p++;
+		if( h->tail_bytes != 8 )
+			return;
+		uint64_t word;
+		memcpy( &word, h->tail, sizeof(word) );
+		h->hash       = dl_internal_hash64_round( h->hash, word );
+		h->tail_bytes = 0;
+	}
+
+	for( ; end - p >= 8; p += 8 )
+	{
+		uint64_t word;
+		memcpy( &word, p, sizeof(word) );
+		h->hash = dl_internal_hash64_round( h->hash, word );
+	}
+
+	while( p != end )
+		h->tail[h->tail_bytes++] = *p++;
+}
+
+static inline uint64_t dl_internal_hash64_final( const dl_hash64* h )
+{
+	uint64_t hash = h->hash ^ h->total_bytes;
+	if( h->tail_bytes != 0 )
+	{
+		uint64_t word = 0;
+		for( uint32_t i = 0; i < h->tail_bytes; ++i )
+			word |= (uint64_t)h->tail[i] << ( 8 * i );
+		hash = dl_internal_rotl64( hash ^ ( word * 0x27D4EB2F165667C5ULL ), 11 ) * 0x9E3779B185EBCA87ULL;
+	}
+
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDULL;
+	hash ^= hash >> 33;
+	hash *= 0xC4CEB9FE1A85EC53ULL;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+/*
+	CRC32C (Castagnoli) of buffer, see dl_crc32c.cpp.
+*/
+uint32_t dl_internal_crc32c( const uint8_t* buffer, size_t bytes );
+
+/*
+	Same as dl_internal_crc32c but always uses the table-based implementation, exposed to test it on cpus with SSE4.2.
+*/
+uint32_t dl_internal_crc32c_software( const uint8_t* buffer, size_t bytes );
 
 #endif // DL_HASH_H_INCLUDED
@@ -0,0 +1,468 @@
+/* copyright (c) 2010 Fredrik Kihlander, see LICENSE for more info */
+
+#include "dl_types.h"
+#include "dl_hash.h"
+#include "container/dl_hash_table.h"
+
+/*
+	Structural hashing and comparison of loaded instances, see dl_instance_hash and dl_instance_equal.
+
+	The hash is built by feeding the value of each member to a dl_hash64 in member order, padding is never fed to it.
+	Since dl_hash64 do not care about how the bytes are split between updates, members that follow each other without
+	padding can be fed as one block, and arrays of types without padding or members that need special treatment in
+	one go, without changing the result.
+
+	Pointers are followed the first time they are seen and referenced by the order they were first seen in after that,
+	this keeps the hash stable for cycles and shared instances.
+*/
+
+static const uint32_t DL_HASH_PTR_NULL = 0;
+static const uint32_t DL_HASH_PTR_NEW  = 1; // followed by the instance, all other values are 2 + index of a visited ptr.
+
+static inline bool dl_internal_hash_is_float( dl_type_storage_t storage )
+{
+	return storage == DL_TYPE_STORAGE_FP32 || storage == DL_TYPE_STORAGE_FP64;
+}
+
+static inline uint32_t dl_internal_hash_canonical_fp32( const uint8_t* data )
+{
+	float f;
+	memcpy( &f, data, sizeof(f) );
+	if( f != f )
+		return 0x7FC00000;
+	if( f == 0.0f )
+		return 0;
+	uint32_t bits;
+	memcpy( &bits, &f, sizeof(bits) );
+	return bits;
+}
+
+static inline uint64_t dl_internal_hash_canonical_fp64( const uint8_t* data )
+{
+	double d;
+	memcpy( &d, data, sizeof(d) );
+	if( d != d )
+		return 0x7FF8000000000000ULL;
+	if( d == 0.0 )
+		return 0;
+	uint64_t bits;
+	memcpy( &bits, &d, sizeof(bits) );
+	return bits;
+}
+
+bool dl_internal_type_is_flat( dl_ctx_t dl_ctx, const dl_type_desc* type, unsigned int flags )
+{
+	if( type->flags & ( DL_TYPE_FLAG_HAS_SUBDATA | DL_TYPE_FLAG_IS_UNION ) )
+		return false;
+
+	uint32_t end = 0;
+	for( uint32_t member_index = 0; member_index < type->member_count; ++member_index )
+	{
+		const dl_member_desc* member = dl_get_type_member( dl_ctx, type, member_index );
+		if( member->AtomType() == DL_TYPE_ATOM_BITFIELD || member->offset[DL_PTR_SIZE_HOST] != end )
+			return false;
+
+		dl_type_storage_t storage = member->StorageType();
+		if( ( flags & DL_HASHFLAGS_CANONICAL_FLOATS ) && dl_internal_hash_is_float( storage ) )
+			return false;
+		if( storage == DL_TYPE_STORAGE_STRUCT && !dl_internal_type_is_flat( dl_ctx, dl_internal_find_type( dl_ctx, member->type_id ), flags ) )
+			return false;
+
+		end += member->size[DL_PTR_SIZE_HOST];
+	}
+	return end == type->size[DL_PTR_SIZE_HOST];
+}
+
+struct dl_hash_visited_ptr
+{
+	const void* ptr;
+	uint32_t    index;
+};
+
+struct dl_hash_visited_ptr_eq
+{
+	const void* ptr;
+	bool operator()( const dl_hash_visited_ptr& vp ) const { return vp.ptr == ptr; }
+};
+
+struct dl_instance_hasher
+{
+	dl_ctx_t     ctx;
+	unsigned int flags;
+	dl_hash64    hash;
+	bool         out_of_memory;
+
+	dl_hash_table<dl_hash_visited_ptr> visited;
+
+	// start and end of the current run of members without padding that has not been fed to hash yet.
+	const uint8_t* run_start;
+	const uint8_t* run_end;
+
+	void Flush()
+	{
+		if( run_start != run_end )
+			dl_internal_hash64_update( &hash, run_start, (size_t)( run_end - run_start ) );
+		run_start = run_end = 0x0;
+	}
+
+	void Add( const void* data, size_t size )
+	{
+		if( (const uint8_t*)data != run_end )
+		{
+			Flush();
+			run_start = (const uint8_t*)data;
+		}
+		run_end = (const uint8_t*)data + size;
+	}
+
+	void AddValue( const void* data, size_t size )
+	{
+		Flush();
+		dl_internal_hash64_update( &hash, data, size );
+	}
+};
+
+static void dl_internal_hash_struct( dl_instance_hasher* h, const dl_type_desc* type, const uint8_t* data );
+
+static void dl_internal_hash_str( dl_instance_hasher* h, const char* str )
+{
+	uint64_t len = str == 0x0 ? 0 : (uint64_t)strlen( str ) + 1;
+	h->AddValue( &len, sizeof(len) );
+	if( str != 0x0 )
+		h->AddValue( str, (size_t)len - 1 );
+}
+
+static void dl_internal_hash_ptr_target( dl_instance_hasher* h, const dl_type_desc* type, const uint8_t* ptr )
+{
+	uint32_t tag = DL_HASH_PTR_NULL;
+	if( ptr != 0x0 )
+	{
+		dl_hash_visited_ptr_eq eq = { ptr };
+		const dl_hash_visited_ptr* vp = h->visited.find( dl_internal_hash_ptr( ptr ), eq );
+		tag = vp == 0x0 ? DL_HASH_PTR_NEW : vp->index + 2;
+	}
+	h->AddValue( &tag, sizeof(tag) );
+	if( tag != DL_HASH_PTR_NEW )
+		return;
+
+	dl_hash_visited_ptr vp = { ptr, (uint32_t)h->visited.count };
+	if( !h->visited.insert( dl_internal_hash_ptr( ptr ), vp ) )
+	{
+		h->out_of_memory = true;
+		return;
+	}
+	dl_internal_hash_struct( h, type, ptr );
+}
+
+static void dl_internal_hash_elements( dl_instance_hasher* h, dl_type_storage_t storage, dl_typeid_t type_id, const uint8_t* data, uint32_t count )
+{
+	switch( storage )
+	{
+		case DL_TYPE_STORAGE_STRUCT:
+		{
+			const dl_type_desc* sub_type = dl_internal_find_type( h->ctx, type_id );
+			size_t size = sub_type->size[DL_PTR_SIZE_HOST];
+			if( count > 1 && dl_internal_type_is_flat( h->ctx, sub_type, h->flags ) )
+				h->Add( data, count * size );
+			else
+				for( uint32_t elem = 0; elem < count; ++elem )
+					dl_internal_hash_struct( h, sub_type, data + elem * size );
+			break;
+		}
+		case DL_TYPE_STORAGE_STR:
+			for( uint32_t elem = 0; elem < count; ++elem )
+				dl_internal_hash_str( h, ( (const char**)data )[elem] );
+			break;
+		case DL_TYPE_STORAGE_PTR:
+		{
+			const dl_type_desc* sub_type = dl_internal_find_type( h->ctx, type_id );
+			for( uint32_t elem = 0; elem < count; ++elem )
+				dl_internal_hash_ptr_target( h, sub_type, ( (const uint8_t**)data )[elem] );
+			break;
+		}
+		case DL_TYPE_STORAGE_FP32:
+			if( h->flags & DL_HASHFLAGS_CANONICAL_FLOATS )
+			{
+				for( uint32_t elem = 0; elem < count; ++elem )
+				{
+					uint32_t bits = dl_internal_hash_canonical_fp32( data + elem * sizeof(float) );
+					h->AddValue( &bits, sizeof(bits) );
+				}
+				break;
+			}
+			h->Add( data, count * sizeof(float) );
+			break;
+		case DL_TYPE_STORAGE_FP64:
+			if( h->flags & DL_HASHFLAGS_CANONICAL_FLOATS )
+			{
+				for( uint32_t elem = 0; elem < count; ++elem )
+				{
+					uint64_t bits = dl_internal_hash_canonical_fp64( data + elem * sizeof(double) );
+					h->AddValue( &bits, sizeof(bits) );
+				}
+				break;
+			}
+			h->Add( data, count * sizeof(double) );
+			break;
+		default:
+			h->Add( data, count * dl_pod_size( storage ) );
+			break;
+	}
+}
+
+static void dl_internal_hash_member( dl_instance_hasher* h, const dl_member_desc* member, const uint8_t* data )
+{
+	switch( member->AtomType() )
+	{
+		case DL_TYPE_ATOM_POD:
+			dl_internal_hash_elements( h, member->StorageType(), member->type_id, data, 1 );
+			break;
+		case DL_TYPE_ATOM_INLINE_ARRAY:
+			dl_internal_hash_elements( h, member->StorageType(), member->type_id, data, member->inline_array_cnt() );
+			break;
+		case DL_TYPE_ATOM_ARRAY:
+		{
+			uint32_t count = *(const uint32_t*)( data + sizeof(void*) );
+			h->AddValue( &count, sizeof(count) );
+			dl_internal_hash_elements( h, member->StorageType(), member->type_id, *(const uint8_t**)data, count );
+			break;
+		}
+		case DL_TYPE_ATOM_BITFIELD:
+		{
+			uint64_t value = dl_internal_read_host_bitfield( member, data );
+			h->AddValue( &value, sizeof(value) );
+			break;
+		}
+		default:
+			DL_ASSERT( false && "Invalid ATOM-type!" );
+			break;
+	}
+}
+
+static void dl_internal_hash_struct( dl_instance_hasher* h, const dl_type_desc* type, const uint8_t* data )
+{
+	if( type->flags & DL_TYPE_FLAG_IS_UNION )
+	{
+		uint32_t union_type   = *(const uint32_t*)( data + dl_internal_union_type_offset( h->ctx, type, DL_PTR_SIZE_HOST ) );
+		uint32_t member_index = union_type - dl_internal_typeid_of( h->ctx, type ) - 1;
+		h->AddValue( &member_index, sizeof(member_index) );
+		if( member_index < type->member_count )
+		{
+			const dl_member_desc* member = dl_get_type_member( h->ctx, type, member_index );
+			dl_internal_hash_member( h, member, data + member->offset[DL_PTR_SIZE_HOST] );
+		}
+		return;
+	}
+
+	for( uint32_t member_index = 0; member_index < type->member_count; ++member_index )
+	{
+		const dl_member_desc* member = dl_get_type_member( h->ctx, type, member_index );
+		dl_internal_hash_member( h, member, data + member->offset[DL_PTR_SIZE_HOST] );
+	}
+}
+
+dl_error_t dl_instance_hash( dl_ctx_t dl_ctx, dl_typeid_t type_id, const void* instance, unsigned int flags, uint64_t* out_hash )
+{
+	const dl_type_desc* type = dl_internal_find_type( dl_ctx, type_id );
+	if( type == 0x0 )
+		return DL_ERROR_TYPE_NOT_FOUND;
+
+	dl_instance_hasher h;
+	h.ctx           = dl_ctx;
+	h.flags         = flags;
+	h.out_of_memory = false;
+	h.run_start     = 0x0;
+	h.run_end       = 0x0;
+	h.visited.init( &dl_ctx->alloc );
+	dl_internal_hash64_init( &h.hash, 0 );
+
+	dl_internal_hash_struct( &h, type, (const uint8_t*)instance );
+	h.Flush();
+	h.visited.destroy();
+
+	if( h.out_of_memory )
+		return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+
+	*out_hash = dl_internal_hash64_final( &h.hash );
+	return DL_ERROR_OK;
+}
+
+struct dl_equal_visited_ptr
+{
+	const void* ptr;
+	const void* other; // the ptr that ptr was matched against in the other instance.
+};
+
+struct dl_equal_visited_ptr_eq
+{
+	const void* ptr;
+	bool operator()( const dl_equal_visited_ptr& vp ) const { return vp.ptr == ptr; }
+};
+
+struct dl_instance_comparer
+{
+	dl_ctx_t     ctx;
+	unsigned int flags;
+	bool         out_of_memory;
+
+	// matched ptrs from a to b and b to a, a ptr can only be matched against one other ptr.
+	dl_hash_table<dl_equal_visited_ptr> visited_a;
+	dl_hash_table<dl_equal_visited_ptr> visited_b;
+};
+
+static bool dl_internal_equal_struct( dl_instance_comparer* c, const dl_type_desc* type, const uint8_t* a, const uint8_t* b );
+
+static bool dl_internal_equal_str( const char* a, const char* b )
+{
+	if( a == b )
+		return true;
+	if( a == 0x0 || b == 0x0 )
+		return false;
+	return strcmp( a, b ) == 0;
+}
+
+static bool dl_internal_equal_ptr_target( dl_instance_comparer* c, const dl_type_desc* type, const uint8_t* a, const uint8_t* b )
+{
+	if( a == 0x0 || b == 0x0 )
+		return a == b;
+
+	dl_equal_visited_ptr_eq eq_a = { a };
+	const dl_equal_visited_ptr* vp_a = c->visited_a.find( dl_internal_hash_ptr( a ), eq_a );
+	if( vp_a != 0x0 )
+		return vp_a->other == b;
+
+	dl_equal_visited_ptr_eq eq_b = { b };
+	if( c->visited_b.find( dl_internal_hash_ptr( b ), eq_b ) != 0x0 )
+		return false; // b is already matched against another ptr in a.
+
+	dl_equal_visited_ptr match_a = { a, b };
+	dl_equal_visited_ptr match_b = { b, a };
+	if( !c->visited_a.insert( dl_internal_hash_ptr( a ), match_a ) || !c->visited_b.insert( dl_internal_hash_ptr( b ), match_b ) )
+	{
+		c->out_of_memory = true;
+		return false;
+	}
+	return dl_internal_equal_struct( c, type, a, b );
+}
+
+static bool dl_internal_equal_elements( dl_instance_comparer* c, dl_type_storage_t storage, dl_typeid_t type_id, const uint8_t* a, const uint8_t* b, uint32_t count )
+{
+	switch( storage )
+	{
+		case DL_TYPE_STORAGE_STRUCT:
+		{
+			const dl_type_desc* sub_type = dl_internal_find_type( c->ctx, type_id );
+			size_t size = sub_type->size[DL_PTR_SIZE_HOST];
+			if( count > 1 && dl_internal_type_is_flat( c->ctx, sub_type, c->flags ) )
+				return memcmp( a, b, count * size ) == 0;
+			for( uint32_t elem = 0; elem < count; ++elem )
+				if( !dl_internal_equal_struct( c, sub_type, a + elem * size, b + elem * size ) )
+					return false;
+			return true;
+		}
+		case DL_TYPE_STORAGE_STR:
+			for( uint32_t elem = 0; elem < count; ++elem )
+				if( !dl_internal_equal_str( ( (const char**)a )[elem], ( (const char**)b )[elem] ) )
+					return false;
+			return true;
+		case DL_TYPE_STORAGE_PTR:
+		{
+			const dl_type_desc* sub_type = dl_internal_find_type( c->ctx, type_id );
+			for( uint32_t elem = 0; elem < count; ++elem )
+				if( !dl_internal_equal_ptr_target( c, sub_type, ( (const uint8_t**)a )[elem], ( (const uint8_t**)b )[elem] ) )
+					return false;
+			return true;
+		}
+		case DL_TYPE_STORAGE_FP32:
+			if( c->flags & DL_HASHFLAGS_CANONICAL_FLOATS )
+			{
+				for( uint32_t elem = 0; elem < count; ++elem )
+					if( dl_internal_hash_canonical_fp32( a + elem * sizeof(float) ) != dl_internal_hash_canonical_fp32( b + elem * sizeof(float) ) )
+						return false;
+				return true;
+			}
+			return memcmp( a, b, count * sizeof(float) ) == 0;
+		case DL_TYPE_STORAGE_FP64:
+			if( c->flags & DL_HASHFLAGS_CANONICAL_FLOATS )
+			{
+				for( uint32_t elem = 0; elem < count; ++elem )
+					if( dl_internal_hash_canonical_fp64( a + elem * sizeof(double) ) != dl_internal_hash_canonical_fp64( b + elem * sizeof(double) ) )
+						return false;
+				return true;
+			}
+			return memcmp( a, b, count * sizeof(double) ) == 0;
+		default:
+			return memcmp( a, b, count * dl_pod_size( storage ) ) == 0;
+	}
+}
+
+static bool dl_internal_equal_member( dl_instance_comparer* c, const dl_member_desc* member, const uint8_t* a, const uint8_t* b )
+{
+	switch( member->AtomType() )
+	{
+		case DL_TYPE_ATOM_POD:
+			return dl_internal_equal_elements( c, member->StorageType(), member->type_id, a, b, 1 );
+		case DL_TYPE_ATOM_INLINE_ARRAY:
+			return dl_internal_equal_elements( c, member->StorageType(), member->type_id, a, b, member->inline_array_cnt() );
+		case DL_TYPE_ATOM_ARRAY:
+		{
+			uint32_t count = *(const uint32_t*)( a + sizeof(void*) );
+			if( count != *(const uint32_t*)( b + sizeof(void*) ) )
+				return false;
+			return dl_internal_equal_elements( c, member->StorageType(), member->type_id, *(const uint8_t**)a, *(const uint8_t**)b, count );
+		}
+		case DL_TYPE_ATOM_BITFIELD:
+			return dl_internal_read_host_bitfield( member, a ) == dl_internal_read_host_bitfield( member, b );
+		default:
+			DL_ASSERT( false && "Invalid ATOM-type!" );
+			return false;
+	}
+}
+
+static bool dl_internal_equal_struct( dl_instance_comparer* c, const dl_type_desc* type, const uint8_t* a, const uint8_t* b )
+{
+	if( type->flags & DL_TYPE_FLAG_IS_UNION )
+	{
+		size_t   type_offset  = dl_internal_union_type_offset( c->ctx, type, DL_PTR_SIZE_HOST );
+		uint32_t union_type   = *(const uint32_t*)( a + type_offset );
+		if( union_type != *(const uint32_t*)( b + type_offset ) )
+			return false;
+		uint32_t member_index = union_type - dl_internal_typeid_of( c->ctx, type ) - 1;
+		if( member_index >= type->member_count )
+			return true;
+		const dl_member_desc* member = dl_get_type_member( c->ctx, type, member_index );
+		return dl_internal_equal_member( c, member, a + member->offset[DL_PTR_SIZE_HOST], b + member->offset[DL_PTR_SIZE_HOST] );
+	}
+
+	for( uint32_t member_index = 0; member_index < type->member_count; ++member_index )
+	{
+		const dl_member_desc* member = dl_get_type_member( c->ctx, type, member_index );
+		if( !dl_internal_equal_member( c, member, a + member->offset[DL_PTR_SIZE_HOST], b + member->offset[DL_PTR_SIZE_HOST] ) )
+			return false;
+	}
+	return true;
+}
+
+dl_error_t dl_instance_equal( dl_ctx_t dl_ctx, dl_typeid_t type_id, const void* a, const void* b, unsigned int flags, int* out_equal )
+{
+	const dl_type_desc* type = dl_internal_find_type( dl_ctx, type_id );
+	if( type == 0x0 )
+		return DL_ERROR_TYPE_NOT_FOUND;
+
+	dl_instance_comparer c;
+	c.ctx           = dl_ctx;
+	c.flags         = flags;
+	c.out_of_memory = false;
+	c.visited_a.init( &dl_ctx->alloc );
+	c.visited_b.init( &dl_ctx->alloc );
+
+	bool equal = dl_internal_equal_struct( &c, type, (const uint8_t*)a, (const uint8_t*)b );
+	c.visited_a.destroy();
+	c.visited_b.destroy();
+
+	if( c.out_of_memory )
+		return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+
+	*out_equal = equal ? 1 : 0;
+	return DL_ERROR_OK;
+}
@@ -0,0 +1,814 @@
+/* copyright (c) 2010 Fredrik Kihlander, see LICENSE for more info */
+
+#include "dl_types.h"
+#include "dl_binary_writer.h"
+#include "dl_patch_ptr.h"
+#include "container/dl_hash_table.h"
+
+#include <dl/dl_convert.h>
+#include <dl/dl_cursor.h>
+
+/*
+	Migration of packed instances between two versions of a type-library. The old instance-data is read as it is
+	stored, without copying or patching it, and the new instance is written in one pass in the layout of the new
+	context. Members are matched by name-hash, the mapping from new to old members is only built once per type.
+*/
+
+struct dl_migrated_data
+{
+	uintptr_t   old_offset;
+	uint32_t    count;   // 0 for strings and pointers.
+	uint32_t    storage; // storage-type in the new instance.
+	dl_typeid_t type_id;
+	uintptr_t   new_pos;
+};
+
+struct dl_migrated_data_eq
+{
+	const dl_migrated_data& data;
+	bool operator()( const dl_migrated_data& md ) const
+	{
+		return md.old_offset == data.old_offset && md.count == data.count && md.storage == data.storage && md.type_id == data.type_id;
+	}
+};
+
+struct dl_migrate_ctx
+{
+	dl_ctx_t         old_ctx;
+	dl_ctx_t         new_ctx;
+	const uint8_t*   src;      // old instance-data, all offsets in it are relative to this.
+	size_t           src_size;
+	dl_ptr_size_t    src_ptr_size;
+	dl_binary_writer writer;
+	bool             shared_subdata;
+
+	const dl_type_desc** old_types;  // old type that member_map was built for, per type in new_ctx.
+	uint32_t*            member_map; // index of old member for each member in new_ctx, >= member_count if not in old type.
+
+	dl_hash_table<dl_migrated_data> migrated; // strings, arrays and ptrs already written, keyed by old offset.
+
+	uintptr_t FindMigrated( const dl_migrated_data& data )
+	{
+		dl_migrated_data_eq eq = { data };
+		dl_migrated_data* md = migrated.find( MigratedHash( data ), eq );
+		return md == 0x0 ? (uintptr_t)-1 : md->new_pos;
+	}
+
+	bool AddMigrated( const dl_migrated_data& data )
+	{
+		return migrated.insert( MigratedHash( data ), data );
+	}
+
+	static uint32_t MigratedHash( const dl_migrated_data& data )
+	{
+		return dl_internal_hash_combine( dl_internal_hash_combine( (uint32_t)data.old_offset, (uint32_t)( (uint64_t)data.old_offset >> 32 ) ), data.count );
+	}
+};
+
+struct dl_migrate_scalar
+{
+	enum { INT, UINT, FP } kind;
+	union
+	{
+		int64_t  i;
+		uint64_t u;
+		double   f;
+	};
+};
+
+template<typename T>
+static inline T dl_internal_migrate_load( const uint8_t* data )
+{
+	T val;
+	memcpy( &val, data, sizeof(T) );
+	return val;
+}
+
+template<typename T>
+static inline T dl_internal_migrate_cast( const dl_migrate_scalar& val )
+{
+	switch( val.kind )
+	{
+		case dl_migrate_scalar::INT:  return (T)val.i;
+		case dl_migrate_scalar::UINT: return (T)val.u;
+		default:                      return (T)val.f;
+	}
+}
+
+static inline bool dl_internal_migrate_is_number( dl_type_storage_t storage )
+{
+	return storage != DL_TYPE_STORAGE_STR && storage != DL_TYPE_STORAGE_PTR && storage != DL_TYPE_STORAGE_STRUCT;
+}
+
+static inline bool dl_internal_migrate_is_scalar( const dl_member_desc* member )
+{
+	return member->AtomType() == DL_TYPE_ATOM_BITFIELD ||
+		 ( member->AtomType() == DL_TYPE_ATOM_POD && dl_internal_migrate_is_number( member->StorageType() ) );
+}
+
+static inline bool dl_internal_migrate_src_range( dl_migrate_ctx* ctx, uintptr_t offset, uint64_t size )
+{
+	return offset <= ctx->src_size && size <= ctx->src_size - offset;
+}
+
+/// read ptr from old instance-data, returns (uintptr_t)-1 for null.
+static uintptr_t dl_internal_migrate_read_ptr( dl_migrate_ctx* ctx, uintptr_t offset )
+{
+	if( ctx->src_ptr_size == DL_PTR_SIZE_32BIT )
+	{
+		uint32_t ptr = dl_internal_migrate_load<uint32_t>( ctx->src + offset );
+		return ptr == (uint32_t)DL_NULL_PTR_OFFSET[DL_PTR_SIZE_32BIT] ? (uintptr_t)-1 : (uintptr_t)ptr;
+	}
+	return (uintptr_t)dl_internal_migrate_load<uint64_t>( ctx->src + offset );
+}
+
+/// zero [pos, pos + size) in the new instance, size is only reserved if it do not fit in the out-buffer.
+static void dl_internal_migrate_write_zero( dl_binary_writer* writer, uintptr_t pos, size_t size )
+{
+	dl_binary_writer_seek_set( writer, pos );
+	if( writer->dummy || pos + size > writer->data_size )
+		dl_binary_writer_reserve( writer, size );
+	else
+		dl_binary_writer_write_zero( writer, size );
+}
+
+static dl_migrate_scalar dl_internal_migrate_read_pod( dl_type_storage_t storage, const uint8_t* data )
+{
+	dl_migrate_scalar val;
+	val.kind = dl_migrate_scalar::INT;
+	switch( storage )
+	{
+		case DL_TYPE_STORAGE_INT8:
+		case DL_TYPE_STORAGE_ENUM_INT8:   val.i = dl_internal_migrate_load<int8_t> ( data ); break;
+		case DL_TYPE_STORAGE_INT16:
+		case DL_TYPE_STORAGE_ENUM_INT16:  val.i = dl_internal_migrate_load<int16_t>( data ); break;
+		case DL_TYPE_STORAGE_INT32:
+		case DL_TYPE_STORAGE_ENUM_INT32:  val.i = dl_internal_migrate_load<int32_t>( data ); break;
+		case DL_TYPE_STORAGE_INT64:
+		case DL_TYPE_STORAGE_ENUM_INT64:  val.i = dl_internal_migrate_load<int64_t>( data ); break;
+		case DL_TYPE_STORAGE_FP32:        val.kind = dl_migrate_scalar::FP; val.f = dl_internal_migrate_load<float>( data ); break;
+		case DL_TYPE_STORAGE_FP64:        val.kind = dl_migrate_scalar::FP; val.f = dl_internal_migrate_load<double>( data ); break;
+		default:
+			val.kind = dl_migrate_scalar::UINT;
+			switch( dl_pod_size( storage ) )
+			{
+				case 1: val.u = dl_internal_migrate_load<uint8_t> ( data ); break;
+				case 2: val.u = dl_internal_migrate_load<uint16_t>( data ); break;
+				case 4: val.u = dl_internal_migrate_load<uint32_t>( data ); break;
+				default: val.u = dl_internal_migrate_load<uint64_t>( data ); break;
+			}
+			break;
+	}
+	return val;
+}
+
+static uint64_t dl_internal_migrate_read_bitfield_storage( const uint8_t* data, uint32_t size )
+{
+	switch( size )
+	{
+		case 1: return dl_internal_migrate_load<uint8_t> ( data );
+		case 2: return dl_internal_migrate_load<uint16_t>( data );
+		case 4: return dl_internal_migrate_load<uint32_t>( data );
+		case 8: return dl_internal_migrate_load<uint64_t>( data );
+		default:
+			DL_ASSERT( false && "This should not happen!" );
+			return 0;
+	}
+}
+
+/// read a scalar, pod or bitfield, member from data.
+static dl_migrate_scalar dl_internal_migrate_read_scalar( const dl_member_desc* member, const uint8_t* data )
+{
+	if( member->AtomType() != DL_TYPE_ATOM_BITFIELD )
+		return dl_internal_migrate_read_pod( member->StorageType(), data );
+
+	uint32_t size    = member->size[DL_PTR_SIZE_HOST];
+	uint32_t bits    = member->bitfield_bits();
+	uint32_t offset  = dl_bf_offset( DL_ENDIAN_HOST, size, member->bitfield_offset(), bits );
+	uint64_t storage = dl_internal_migrate_read_bitfield_storage( data, size );
+
+	dl_migrate_scalar val;
+	val.kind = dl_migrate_scalar::UINT;
+	val.u    = DL_EXTRACT_BITS( storage, uint64_t(offset), uint64_t(bits) );
+	return val;
+}
+
+static void dl_internal_migrate_write_pod( dl_binary_writer* writer, dl_type_storage_t storage, uintptr_t pos, const dl_migrate_scalar& val )
+{
+	dl_binary_writer_seek_set( writer, pos );
+	switch( storage )
+	{
+		case DL_TYPE_STORAGE_INT8:
+		case DL_TYPE_STORAGE_ENUM_INT8:   dl_binary_writer_write_int8  ( writer, dl_internal_migrate_cast<int8_t>  ( val ) ); break;
+		case DL_TYPE_STORAGE_INT16:
+		case DL_TYPE_STORAGE_ENUM_INT16:  dl_binary_writer_write_int16 ( writer, dl_internal_migrate_cast<int16_t> ( val ) ); break;
+		case DL_TYPE_STORAGE_INT32:
+		case DL_TYPE_STORAGE_ENUM_INT32:  dl_binary_writer_write_int32 ( writer, dl_internal_migrate_cast<int32_t> ( val ) ); break;
+		case DL_TYPE_STORAGE_INT64:
+		case DL_TYPE_STORAGE_ENUM_INT64:  dl_binary_writer_write_int64 ( writer, dl_internal_migrate_cast<int64_t> ( val ) ); break;
+		case DL_TYPE_STORAGE_UINT8:
+		case DL_TYPE_STORAGE_ENUM_UINT8:  dl_binary_writer_write_uint8 ( writer, dl_internal_migrate_cast<uint8_t> ( val ) ); break;
+		case DL_TYPE_STORAGE_UINT16:
+		case DL_TYPE_STORAGE_ENUM_UINT16: dl_binary_writer_write_uint16( writer, dl_internal_migrate_cast<uint16_t>( val ) ); break;
+		case DL_TYPE_STORAGE_UINT32:
+		case DL_TYPE_STORAGE_ENUM_UINT32: dl_binary_writer_write_uint32( writer, dl_internal_migrate_cast<uint32_t>( val ) ); break;
+		case DL_TYPE_STORAGE_UINT64:
+		case DL_TYPE_STORAGE_ENUM_UINT64: dl_binary_writer_write_uint64( writer, dl_internal_migrate_cast<uint64_t>( val ) ); break;
+		case DL_TYPE_STORAGE_FP32:        dl_binary_writer_write_fp32  ( writer, dl_internal_migrate_cast<float>   ( val ) ); break;
+		case DL_TYPE_STORAGE_FP64:        dl_binary_writer_write_fp64  ( writer, dl_internal_migrate_cast<double>  ( val ) ); break;
+		default:
+			DL_ASSERT( false && "This should not happen!" );
+			break;
+	}
+}
+
+/// write a scalar, pod or bitfield, member at pos in the new instance. Other bitfields sharing storage with member are kept.
+static void dl_internal_migrate_write_scalar( dl_binary_writer* writer, const dl_member_desc* member, uintptr_t pos, const dl_migrate_scalar& val )
+{
+	if( member->AtomType() != DL_TYPE_ATOM_BITFIELD )
+	{
+		dl_internal_migrate_write_pod( writer, member->StorageType(), pos, val );
+		return;
+	}
+
+	uint32_t size    = member->size[DL_PTR_SIZE_HOST];
+	uint32_t bits    = member->bitfield_bits();
+	uint32_t offset  = dl_bf_offset( DL_ENDIAN_HOST, size, member->bitfield_offset(), bits );
+	uint64_t storage = 0;
+	if( !writer->dummy && pos + size <= writer->data_size )
+		storage = dl_internal_migrate_read_bitfield_storage( writer->data + pos, size );
+
+	storage = DL_INSERT_BITS( storage, dl_internal_migrate_cast<uint64_t>( val ), uint64_t(offset), uint64_t(bits) );
+
+	dl_binary_writer_seek_set( writer, pos );
+	switch( size )
+	{
+		case 1: dl_binary_writer_write_uint8 ( writer, (uint8_t) storage ); break;
+		case 2: dl_binary_writer_write_uint16( writer, (uint16_t)storage ); break;
+		case 4: dl_binary_writer_write_uint32( writer, (uint32_t)storage ); break;
+		case 8: dl_binary_writer_write_uint64( writer, storage );           break;
+		default:
+			DL_ASSERT( false && "This should not happen!" );
+			break;
+	}
+}
+
+static dl_error_t dl_internal_migrate_write_default( dl_migrate_ctx* ctx, const dl_member_desc* member, uintptr_t pos )
+{
+	dl_binary_writer* writer        = &ctx->writer;
+	const uint8_t*    default_value = ctx->new_ctx->default_data + member->default_value_offset;
+	uint32_t          member_size   = member->size[DL_PTR_SIZE_HOST];
+
+	if( member->AtomType() == DL_TYPE_ATOM_BITFIELD )
+	{
+		dl_internal_migrate_write_scalar( writer, member, pos, dl_internal_migrate_read_scalar( member, default_value ) );
+		return DL_ERROR_OK;
+	}
+
+	dl_binary_writer_seek_set( writer, pos );
+	dl_binary_writer_write( writer, default_value, member_size );
+
+	if( member->default_value_size <= member_size )
+		return DL_ERROR_OK;
+
+	// the default-value is stored as an unpatched instance with the member at offset 0 followed by its subdata, place it
+	// so that the subdata keep its alignment and patch the offsets in it to be relative to the new instance.
+	size_t    end  = dl_binary_writer_needed_size( writer );
+	uintptr_t base = dl_internal_align_up( end > member_size ? end - member_size : 0, 8 );
+	if( base + member_size > end )
+		dl_internal_migrate_write_zero( writer, end, base + member_size - end );
+
+	dl_binary_writer_seek_set( writer, base + member_size );
+	dl_binary_writer_write( writer, default_value + member_size, member->default_value_size - member_size );
+
+	if( !writer->dummy && base + member->default_value_size <= writer->data_size )
+		return dl_internal_patch_member( ctx->new_ctx, member, writer->data + pos, (uintptr_t)writer->data, base );
+	return DL_ERROR_OK;
+}
+
+/// size and alignment of one array-element of storage in ctx.
+static uint32_t dl_internal_migrate_element_size( dl_ctx_t ctx, dl_type_storage_t storage, dl_typeid_t type_id, dl_ptr_size_t ptr_size, uint32_t* alignment )
+{
+	switch( storage )
+	{
+		case DL_TYPE_STORAGE_STRUCT:
+		{
+			const dl_type_desc* type = dl_internal_find_type( ctx, type_id );
+			if( type == 0x0 )
+				return 0;
+			*alignment = type->alignment[ptr_size];
+			return dl_internal_align_up( type->size[ptr_size], type->alignment[ptr_size] );
+		}
+		case DL_TYPE_STORAGE_STR:
+		case DL_TYPE_STORAGE_PTR:
+			*alignment = (uint32_t)dl_internal_ptr_size( ptr_size );
+			return *alignment;
+		default:
+			*alignment = (uint32_t)dl_pod_size( storage );
+			return *alignment;
+	}
+}
+
+static dl_error_t dl_internal_migrate_struct( dl_migrate_ctx* ctx, const dl_type_desc* old_type, const dl_type_desc* new_type, uintptr_t src_offset, uintptr_t dst_pos );
+
+static dl_error_t dl_internal_migrate_string( dl_migrate_ctx* ctx, uintptr_t src_offset, uintptr_t dst_pos )
+{
+	uintptr_t old_offset = dl_internal_migrate_read_ptr( ctx, src_offset );
+	uintptr_t new_offset = DL_NULL_PTR_OFFSET[DL_PTR_SIZE_HOST];
+	if( old_offset != (uintptr_t)-1 )
+	{
+		dl_migrated_data data = { old_offset, 0, DL_TYPE_STORAGE_STR, 0, 0 };
+		new_offset = ctx->FindMigrated( data );
+		if( new_offset == (uintptr_t)-1 )
+		{
+			if( old_offset >= ctx->src_size )
+				return DL_ERROR_MALFORMED_DATA;
+
+			const uint8_t* str = ctx->src + old_offset;
+			const uint8_t* str_end = (const uint8_t*)memchr( str, '\0', ctx->src_size - old_offset );
+			if( str_end == 0x0 )
+				return DL_ERROR_MALFORMED_DATA;
+
+			dl_binary_writer_seek_end( &ctx->writer );
+			new_offset = dl_binary_writer_tell( &ctx->writer );
+			dl_binary_writer_write( &ctx->writer, str, (size_t)( str_end - str ) + 1 );
+
+			data.new_pos = new_offset;
+			if( !ctx->AddMigrated( data ) )
+				return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+		}
+	}
+
+	dl_binary_writer_seek_set( &ctx->writer, dst_pos );
+	dl_binary_writer_write_ptr( &ctx->writer, new_offset );
+	return DL_ERROR_OK;
+}
+
+static dl_error_t dl_internal_migrate_ptr( dl_migrate_ctx* ctx, dl_typeid_t type_id, uintptr_t src_offset, uintptr_t dst_pos )
+{
+	uintptr_t old_offset = dl_internal_migrate_read_ptr( ctx, src_offset );
+	uintptr_t new_offset = DL_NULL_PTR_OFFSET[DL_PTR_SIZE_HOST];
+	if( old_offset != (uintptr_t)-1 )
+	{
+		dl_migrated_data data = { old_offset, 0, DL_TYPE_STORAGE_PTR, type_id, 0 };
+		new_offset = ctx->FindMigrated( data );
+		if( new_offset == (uintptr_t)-1 )
+		{
+			const dl_type_desc* old_type = dl_internal_find_type( ctx->old_ctx, type_id );
+			const dl_type_desc* new_type = dl_internal_find_type( ctx->new_ctx, type_id );
+			if( old_type == 0x0 || new_type == 0x0 )
+				return DL_ERROR_TYPE_NOT_FOUND;
+
+			dl_binary_writer_seek_end( &ctx->writer );
+			dl_binary_writer_align( &ctx->writer, new_type->alignment[DL_PTR_SIZE_HOST] );
+			new_offset = dl_binary_writer_tell( &ctx->writer );
+			dl_binary_writer_reserve( &ctx->writer, dl_internal_align_up( new_type->size[DL_PTR_SIZE_HOST], new_type->alignment[DL_PTR_SIZE_HOST] ) );
+
+			// registered before the struct is migrated so that cycles end up pointing to the same instance.
+			data.new_pos = new_offset;
+			if( !ctx->AddMigrated( data ) )
+				return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+
+			dl_error_t err = dl_internal_migrate_struct( ctx, old_type, new_type, old_offset, new_offset );
+			if( err != DL_ERROR_OK )
+				return err;
+		}
+	}
+
+	dl_binary_writer_seek_set( &ctx->writer, dst_pos );
+	dl_binary_writer_write_ptr( &ctx->writer, new_offset );
+	return DL_ERROR_OK;
+}
+
+static dl_error_t dl_internal_migrate_element( dl_migrate_ctx*   ctx,
+											   dl_type_storage_t old_storage, dl_type_storage_t new_storage, dl_typeid_t type_id,
+											   uintptr_t         src_offset,  uintptr_t         dst_pos )
+{
+	switch( new_storage )
+	{
+		case DL_TYPE_STORAGE_STRUCT:
+		{
+			const dl_type_desc* old_type = dl_internal_find_type( ctx->old_ctx, type_id );
+			const dl_type_desc* new_type = dl_internal_find_type( ctx->new_ctx, type_id );
+			if( old_type == 0x0 || new_type == 0x0 )
+				return DL_ERROR_TYPE_NOT_FOUND;
+			return dl_internal_migrate_struct( ctx, old_type, new_type, src_offset, dst_pos );
+		}
+		case DL_TYPE_STORAGE_STR:
+			return dl_internal_migrate_string( ctx, src_offset, dst_pos );
+		case DL_TYPE_STORAGE_PTR:
+			return dl_internal_migrate_ptr( ctx, type_id, src_offset, dst_pos );
+		default:
+			dl_internal_migrate_write_pod( &ctx->writer, new_storage, dst_pos, dl_internal_migrate_read_pod( old_storage, ctx->src + src_offset ) );
+			return DL_ERROR_OK;
+	}
+}
+
+static dl_error_t dl_internal_migrate_array( dl_migrate_ctx* ctx, const dl_member_desc* old_member, const dl_member_desc* new_member, uintptr_t src_offset, uintptr_t dst_pos )
+{
+	dl_type_storage_t old_storage = old_member->StorageType();
+	dl_type_storage_t new_storage = new_member->StorageType();
+
+	uintptr_t old_offset = dl_internal_migrate_read_ptr( ctx, src_offset );
+	uint32_t  count      = dl_internal_migrate_load<uint32_t>( ctx->src + src_offset + dl_internal_ptr_size( ctx->src_ptr_size ) );
+	uintptr_t new_offset = DL_NULL_PTR_OFFSET[DL_PTR_SIZE_HOST];
+
+	if( count == 0 || old_offset == (uintptr_t)-1 )
+		count = 0;
+	else
+	{
+		dl_migrated_data data = { old_offset, count, (uint32_t)new_storage, new_member->type_id, 0 };
+		new_offset = ctx->FindMigrated( data );
+		if( new_offset != (uintptr_t)-1 )
+			ctx->shared_subdata = true;
+		else
+		{
+			uint32_t old_alignment = 1;
+			uint32_t new_alignment = 1;
+			uint32_t old_size = dl_internal_migrate_element_size( ctx->old_ctx, old_storage, old_member->type_id, ctx->src_ptr_size, &old_alignment );
+			uint32_t new_size = dl_internal_migrate_element_size( ctx->new_ctx, new_storage, new_member->type_id, DL_PTR_SIZE_HOST,  &new_alignment );
+			if( old_size == 0 || new_size == 0 )
+				return DL_ERROR_TYPE_NOT_FOUND;
+			if( !dl_internal_migrate_src_range( ctx, old_offset, (uint64_t)count * old_size ) )
+				return DL_ERROR_MALFORMED_DATA;
+
+			dl_binary_writer_seek_end( &ctx->writer );
+			dl_binary_writer_align( &ctx->writer, new_alignment );
+			new_offset = dl_binary_writer_tell( &ctx->writer );
+			dl_binary_writer_reserve( &ctx->writer, (size_t)count * new_size );
+
+			data.new_pos = new_offset;
+			if( !ctx->AddMigrated( data ) )
+				return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+
+			for( uint32_t elem = 0; elem < count; ++elem )
+			{
+				dl_error_t err = dl_internal_migrate_element( ctx, old_storage, new_storage, new_member->type_id,
+															  old_offset + (uintptr_t)elem * old_size, new_offset + (uintptr_t)elem * new_size );
+				if( err != DL_ERROR_OK )
+					return err;
+			}
+		}
+	}
+
+	dl_binary_writer_seek_set( &ctx->writer, dst_pos );
+	dl_binary_writer_write_ptr( &ctx->writer, new_offset );
+	dl_binary_writer_write_uint32( &ctx->writer, count );
+	return DL_ERROR_OK;
+}
+
+static uint32_t dl_internal_migrate_inline_array_count( const dl_member_desc* member, dl_ptr_size_t ptr_size )
+{
+	dl_type_storage_t storage = member->StorageType();
+	if( dl_internal_migrate_is_number( storage ) )
+		return member->size[ptr_size] / (uint32_t)dl_pod_size( storage );
+	return member->inline_array_cnt();
+}
+
+static dl_error_t dl_internal_migrate_member( dl_migrate_ctx* ctx,
+											  const dl_member_desc* old_member, uintptr_t src_offset,
+											  const dl_member_desc* new_member, uintptr_t dst_pos )
+{
+	if( dl_internal_migrate_is_scalar( old_member ) && dl_internal_migrate_is_scalar( new_member ) )
+	{
+		dl_internal_migrate_write_scalar( &ctx->writer, new_member, dst_pos, dl_internal_migrate_read_scalar( old_member, ctx->src + src_offset ) );
+		return DL_ERROR_OK;
+	}
+
+	dl_type_atom_t    atom        = new_member->AtomType();
+	dl_type_storage_t old_storage = old_member->StorageType();
+	dl_type_storage_t new_storage = new_member->StorageType();
+
+	bool compatible = old_member->AtomType() == atom &&
+					  ( ( dl_internal_migrate_is_number( old_storage ) && dl_internal_migrate_is_number( new_storage ) ) ||
+						( old_storage == new_storage && ( new_storage == DL_TYPE_STORAGE_STR || old_member->type_id == new_member->type_id ) ) );
+	if( !compatible )
+	{
+		dl_log_error( ctx->new_ctx, "member %s has changed to a type that it can not be migrated to", dl_internal_member_name( ctx->new_ctx, new_member ) );
+		return DL_ERROR_TYPE_MISMATCH;
+	}
+
+	switch( atom )
+	{
+		case DL_TYPE_ATOM_POD:
+			return dl_internal_migrate_element( ctx, old_storage, new_storage, new_member->type_id, src_offset, dst_pos );
+
+		case DL_TYPE_ATOM_INLINE_ARRAY:
+		{
+			uint32_t old_alignment = 1;
+			uint32_t new_alignment = 1;
+			uint32_t old_size  = dl_internal_migrate_element_size( ctx->old_ctx, old_storage, old_member->type_id, ctx->src_ptr_size, &old_alignment );
+			uint32_t new_size  = dl_internal_migrate_element_size( ctx->new_ctx, new_storage, new_member->type_id, DL_PTR_SIZE_HOST,  &new_alignment );
+			uint32_t old_count = dl_internal_migrate_inline_array_count( old_member, ctx->src_ptr_size );
+			uint32_t new_count = dl_internal_migrate_inline_array_count( new_member, DL_PTR_SIZE_HOST );
+			if( old_size == 0 || new_size == 0 )
+				return DL_ERROR_TYPE_NOT_FOUND;
+
+			// elements added to the array are left as 0 from when the struct was cleared.
+			uint32_t count = old_count < new_count ? old_count : new_count;
+			for( uint32_t elem = 0; elem < count; ++elem )
+			{
+				dl_error_t err = dl_internal_migrate_element( ctx, old_storage, new_storage, new_member->type_id,
+															  src_offset + (uintptr_t)elem * old_size, dst_pos + (uintptr_t)elem * new_size );
+				if( err != DL_ERROR_OK )
+					return err;
+			}
+			return DL_ERROR_OK;
+		}
+
+		case DL_TYPE_ATOM_ARRAY:
+			return dl_internal_migrate_array( ctx, old_member, new_member, src_offset, dst_pos );
+
+		default:
+			DL_ASSERT( false && "Invalid ATOM-type!" );
+			return DL_ERROR_INTERNAL_ERROR;
+	}
+}
+
+static const uint32_t* dl_internal_migrate_member_map( dl_migrate_ctx* ctx, const dl_type_desc* old_type, const dl_type_desc* new_type )
+{
+	size_t    type_index = (size_t)( new_type - ctx->new_ctx->type_descs );
+	uint32_t* map        = ctx->member_map + new_type->member_start;
+	if( ctx->old_types[type_index] != old_type )
+	{
+		for( uint32_t i = 0; i < new_type->member_count; ++i )
+		{
+			const dl_member_desc* member = dl_get_type_member( ctx->new_ctx, new_type, i );
+			map[i] = dl_internal_find_member( ctx->old_ctx, old_type, dl_internal_hash_string( dl_internal_member_name( ctx->new_ctx, member ) ) );
+		}
+		ctx->old_types[type_index] = old_type;
+	}
+	return map;
+}
+
+static dl_error_t dl_internal_migrate_union( dl_migrate_ctx* ctx, const dl_type_desc* old_type, const dl_type_desc* new_type, uintptr_t src_offset, uintptr_t dst_pos )
+{
+	uintptr_t old_type_offset = src_offset + dl_internal_union_type_offset( ctx->old_ctx, old_type, ctx->src_ptr_size );
+	if( !dl_internal_migrate_src_range( ctx, old_type_offset, sizeof(uint32_t) ) )
+		return DL_ERROR_MALFORMED_DATA;
+
+	uint32_t old_index = dl_internal_migrate_load<uint32_t>( ctx->src + old_type_offset ) - dl_internal_typeid_of( ctx->old_ctx, old_type ) - 1;
+	if( old_index >= old_type->member_count )
+		return DL_ERROR_MALFORMED_DATA;
+
+	const uint32_t* map = dl_internal_migrate_member_map( ctx, old_type, new_type );
+	uint32_t new_index = 0;
+	while( new_index < new_type->member_count && map[new_index] != old_index )
+		++new_index;
+
+	const dl_member_desc* old_member = dl_get_type_member( ctx->old_ctx, old_type, old_index );
+
+	if( new_index >= new_type->member_count )
+	{
+		dl_log_error( ctx->new_ctx, "union %s do not have member %s anymore", dl_internal_type_name( ctx->new_ctx, new_type ), dl_internal_member_name( ctx->old_ctx, old_member ) );
+		return DL_ERROR_TYPE_MISMATCH;
+	}
+
+	const dl_member_desc* new_member = dl_get_type_member( ctx->new_ctx, new_type, new_index );
+	dl_error_t err = dl_internal_migrate_member( ctx, old_member, src_offset + old_member->offset[ctx->src_ptr_size], new_member, dst_pos + new_member->offset[DL_PTR_SIZE_HOST] );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	uint32_t new_union_type = dl_internal_typeid_of( ctx->new_ctx, new_type ) + new_index + 1;
+	dl_binary_writer_seek_set( &ctx->writer, dst_pos + dl_internal_union_type_offset( ctx->new_ctx, new_type, DL_PTR_SIZE_HOST ) );
+	dl_binary_writer_write_uint32( &ctx->writer, new_union_type );
+	return DL_ERROR_OK;
+}
+
+static dl_error_t dl_internal_migrate_struct( dl_migrate_ctx* ctx, const dl_type_desc* old_type, const dl_type_desc* new_type, uintptr_t src_offset, uintptr_t dst_pos )
+{
+	if( !dl_internal_migrate_src_range( ctx, src_offset, old_type->size[ctx->src_ptr_size] ) )
+		return DL_ERROR_MALFORMED_DATA;
+
+	// clear the struct so that padding and bitfields not set by the old instance are 0.
+	dl_internal_migrate_write_zero( &ctx->writer, dst_pos, new_type->size[DL_PTR_SIZE_HOST] );
+
+	if( new_type->flags & DL_TYPE_FLAG_IS_UNION )
+		return dl_internal_migrate_union( ctx, old_type, new_type, src_offset, dst_pos );
+
+	const uint32_t* map = dl_internal_migrate_member_map( ctx, old_type, new_type );
+	for( uint32_t member_index = 0; member_index < new_type->member_count; ++member_index )
+	{
+		const dl_member_desc* new_member = dl_get_type_member( ctx->new_ctx, new_type, member_index );
+		uintptr_t             member_pos = dst_pos + new_member->offset[DL_PTR_SIZE_HOST];
+
+		if( map[member_index] < old_type->member_count )
+		{
+			const dl_member_desc* old_member = dl_get_type_member( ctx->old_ctx, old_type, map[member_index] );
+			dl_error_t err = dl_internal_migrate_member( ctx, old_member, src_offset + old_member->offset[ctx->src_ptr_size], new_member, member_pos );
+			if( err != DL_ERROR_OK )
+				return err;
+		}
+		else if( new_member->default_value_offset != UINT32_MAX )
+		{
+			dl_error_t err = dl_internal_migrate_write_default( ctx, new_member, member_pos );
+			if( err != DL_ERROR_OK )
+				return err;
+		}
+		else
+		{
+			dl_log_error( ctx->new_ctx, "member %s.%s is not in the old type and has no default value", dl_internal_type_name( ctx->new_ctx, new_type ), dl_internal_member_name( ctx->new_ctx, new_member ) );
+			return DL_ERROR_TYPE_MISMATCH;
+		}
+	}
+
+	return DL_ERROR_OK;
+}
+
+/// migrate the struct at src_offset in src as the root of a new instance written to out_data, only the size is
+/// calculated if out_data_size is 0.
+static dl_error_t dl_internal_migrate_instance_data( dl_ctx_t             old_ctx,      dl_ctx_t            new_ctx,
+													 dl_typeid_t          type,
+													 const dl_type_desc*  old_type,     const dl_type_desc* new_type,
+													 const uint8_t*       src,          size_t              src_size,
+													 dl_ptr_size_t        src_ptr_size, uintptr_t           src_offset,
+													 uint8_t*             out_data,     size_t              out_data_size,
+													 size_t*              instance_size, bool*              shared_subdata )
+{
+	dl_migrate_ctx ctx;
+	ctx.old_ctx        = old_ctx;
+	ctx.new_ctx        = new_ctx;
+	ctx.src            = src;
+	ctx.src_size       = src_size;
+	ctx.src_ptr_size   = src_ptr_size;
+	ctx.shared_subdata = false;
+	ctx.old_types      = (const dl_type_desc**)dl_alloc( &new_ctx->alloc, sizeof(dl_type_desc*) * new_ctx->type_count );
+	ctx.member_map     = (uint32_t*)dl_alloc( &new_ctx->alloc, sizeof(uint32_t) * ( new_ctx->member_count > 0 ? new_ctx->member_count : 1 ) );
+	ctx.migrated.init( &new_ctx->alloc );
+
+	dl_binary_writer_init( &ctx.writer, out_data, out_data_size, out_data_size == 0, DL_ENDIAN_HOST, DL_ENDIAN_HOST, DL_PTR_SIZE_HOST );
+
+	dl_error_t err;
+	if( ctx.old_types == 0x0 || ctx.member_map == 0x0 )
+		err = DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+	else
+	{
+		memset( ctx.old_types, 0x0, sizeof(dl_type_desc*) * new_ctx->type_count );
+
+		// ptrs to the root-instance point to offset 0 in the new instance.
+		dl_migrated_data root = { src_offset, 0, DL_TYPE_STORAGE_PTR, type, 0 };
+		dl_binary_writer_reserve( &ctx.writer, new_type->size[DL_PTR_SIZE_HOST] );
+		if( !ctx.AddMigrated( root ) )
+			err = DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+		else
+			err = dl_internal_migrate_struct( &ctx, old_type, new_type, src_offset, 0 );
+	}
+
+	ctx.migrated.destroy();
+	if( ctx.old_types )  dl_free( &new_ctx->alloc, ctx.old_types );
+	if( ctx.member_map ) dl_free( &new_ctx->alloc, ctx.member_map );
+
+	*instance_size  = dl_binary_writer_needed_size( &ctx.writer );
+	*shared_subdata = ctx.shared_subdata;
+	return err;
+}
+
+dl_error_t dl_instance_migrate( dl_ctx_t             old_ctx,         dl_ctx_t    new_ctx,           dl_typeid_t type,
+								const unsigned char* packed_instance, size_t      packed_instance_size,
+								unsigned char*       out_instance,    size_t      out_instance_size,
+								size_t*              produced_bytes )
+{
+	const dl_data_header* header = (const dl_data_header*)packed_instance;
+
+	if( packed_instance_size < sizeof(dl_data_header) ) return DL_ERROR_MALFORMED_DATA;
+	if( header->id == DL_INSTANCE_ID_SWAPED )           return DL_ERROR_ENDIAN_MISMATCH;
+	if( header->id != DL_INSTANCE_ID )                  return DL_ERROR_MALFORMED_DATA;
+	if( !dl_internal_is_instance_version( header->version ) ) return DL_ERROR_VERSION_MISMATCH;
+	if( header->root_instance_type != type )            return DL_ERROR_TYPE_MISMATCH;
+	if( header->flags & ( DL_DATA_HEADER_FLAG_BATCH | DL_DATA_HEADER_FLAG_COMPRESSED ) ) return DL_ERROR_UNSUPPORTED_OPERATION;
+	if( out_instance_size > 0 && out_instance_size <= sizeof(dl_data_header) ) return DL_ERROR_BUFFER_TO_SMALL;
+
+	const dl_type_desc* old_type = dl_internal_find_type( old_ctx, type );
+	const dl_type_desc* new_type = dl_internal_find_type( new_ctx, type );
+	if( old_type == 0x0 || new_type == 0x0 )
+		return DL_ERROR_TYPE_NOT_FOUND;
+
+	dl_error_t err = dl_internal_check_fingerprint( old_ctx, old_type, header, packed_instance, packed_instance_size, false );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	uint64_t data_size = dl_internal_header_instance_size( header );
+	if( packed_instance_size - sizeof(dl_data_header) < data_size )
+		return DL_ERROR_MALFORMED_DATA;
+
+	uint8_t* out_data      = out_instance_size > 0 ? out_instance + sizeof(dl_data_header) : 0x0;
+	size_t   out_data_size = out_instance_size > 0 ? out_instance_size - sizeof(dl_data_header) : 0;
+	size_t   instance_size;
+	bool     shared_subdata;
+	err = dl_internal_migrate_instance_data( old_ctx, new_ctx, type, old_type, new_type,
+											 packed_instance + sizeof(dl_data_header), (size_t)data_size, header->is_64_bit_ptr ? DL_PTR_SIZE_64BIT : DL_PTR_SIZE_32BIT, 0,
+											 out_data, out_data_size, &instance_size, &shared_subdata );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	size_t fingerprint_size = dl_internal_header_fingerprint_size( header );
+
+	if( produced_bytes )
+		*produced_bytes = instance_size + sizeof(dl_data_header) + fingerprint_size;
+
+	if( instance_size > DL_INSTANCE_MAX_SIZE )
+		return DL_ERROR_UNSUPPORTED_OPERATION;
+
+	if( out_instance_size == 0 )
+		return DL_ERROR_OK;
+
+	if( instance_size + fingerprint_size > out_data_size )
+		return DL_ERROR_BUFFER_TO_SMALL;
+
+	// checksum and fingerprint are kept if the old instance had them.
+	dl_data_header new_header;
+	memset( &new_header, 0x0, sizeof(dl_data_header) );
+	new_header.id                 = DL_INSTANCE_ID;
+	new_header.root_instance_type = type;
+	dl_internal_header_set_instance_size( &new_header, instance_size );
+	new_header.is_64_bit_ptr      = DL_PTR_SIZE_HOST == DL_PTR_SIZE_64BIT ? 1 : 0;
+	new_header.flags              = shared_subdata ? DL_DATA_HEADER_FLAG_SHARED_SUBDATA : 0;
+	if( header->flags & DL_DATA_HEADER_FLAG_CHECKSUM )
+	{
+		new_header.flags   |= DL_DATA_HEADER_FLAG_CHECKSUM;
+		new_header.checksum = dl_internal_crc32c( out_data, instance_size );
+	}
+	if( fingerprint_size > 0 )
+	{
+		new_header.flags |= DL_DATA_HEADER_FLAG_FINGERPRINT;
+		uint32_t fingerprint = dl_internal_type_fingerprint( new_ctx, new_type );
+		memcpy( out_data + instance_size, &fingerprint, sizeof(uint32_t) );
+	}
+
+	memcpy( out_instance, &new_header, sizeof(dl_data_header) );
+	return DL_ERROR_OK;
+}
+
+/// resolve a path like "regions[12].navmesh" from the root of cursor, ptrs are followed as the path is walked.
+static dl_error_t dl_internal_subtree_resolve_path( dl_cursor_t* cursor, const char* path )
+{
+	const char* iter = path;
+	while( *iter != '\0' )
+	{
+		const dl_type_desc* type = dl_internal_find_type( cursor->ctx, cursor->type );
+		if( type == 0x0 )
+			return DL_ERROR_TYPE_NOT_FOUND;
+
+		dl_member_handle_t handle;
+		unsigned int index;
+		handle.type = cursor->type;
+		dl_error_t err = dl_internal_parse_path_step( cursor->ctx, type, &iter, &handle.member_index, &index );
+		if( err != DL_ERROR_OK )
+			return err;
+
+		dl_cursor_t sub;
+		err = dl_cursor_struct( cursor, handle, index, &sub );
+		if( err != DL_ERROR_OK )
+			return err;
+		if( sub.data == 0x0 )
+			return DL_ERROR_MEMBER_NOT_FOUND; // null-ptr along the path.
+		*cursor = sub;
+	}
+	return DL_ERROR_OK;
+}
+
+dl_error_t dl_instance_load_subtree( dl_ctx_t             dl_ctx,          dl_typeid_t type,
+									 const unsigned char* packed_instance, size_t      packed_instance_size,
+									 const char*          path,            dl_typeid_t subtree_type,
+									 void*                instance,        size_t      instance_size,
+									 size_t*              produced_bytes )
+{
+	if( path == 0x0 )
+		return DL_ERROR_INVALID_PARAMETER;
+
+	dl_cursor_t cursor;
+	dl_error_t err = dl_cursor_init( dl_ctx, type, packed_instance, packed_instance_size, &cursor );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	err = dl_internal_subtree_resolve_path( &cursor, path );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	if( cursor.type != subtree_type )
+		return DL_ERROR_TYPE_MISMATCH;
+
+	const dl_type_desc* sub_type = dl_internal_find_type( dl_ctx, subtree_type );
+	if( sub_type == 0x0 )
+		return DL_ERROR_TYPE_NOT_FOUND;
+
+	// the subtree is copied to instance with the same graph-copy as migration, but with the same context on both sides.
+	size_t loaded_size;
+	bool   shared_subdata;
+	err = dl_internal_migrate_instance_data( dl_ctx, dl_ctx, subtree_type, sub_type, sub_type,
+											 cursor.data, cursor.data_size, cursor.ptr_size == 8 ? DL_PTR_SIZE_64BIT : DL_PTR_SIZE_32BIT, cursor.offset,
+											 (uint8_t*)instance, instance_size, &loaded_size, &shared_subdata );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	if( produced_bytes )
+		*produced_bytes = loaded_size;
+
+	if( instance_size == 0 )
+		return DL_ERROR_OK;
+
+	if( loaded_size > instance_size )
+		return DL_ERROR_BUFFER_TO_SMALL;
+
+	return dl_internal_patch_instance( dl_ctx, sub_type, (uint8_t*)instance, 0x0, (uintptr_t)instance, shared_subdata );
+}
@@ -1,20 +1,112 @@
 #include "dl_patch_ptr.h"
 #include "dl_types.h"
+#include "dl_hash.h"
+#include "container/dl_hash_table.h"
 
 struct dl_patched_ptrs
 {
 	uint8_t* addresses[128];
 	unsigned int next_addr;
 
-	dl_patched_ptrs()
+	// addresses that did not fit in addresses[], only allocated for big instances.
+	dl_hash_table<uint8_t*> overflow;
+
+	// when set, array-data is tracked as well since it might be shared between members.
+	bool track_arrays;
+
+	// when validating, all offsets are checked against [data, data + data_size) before they are patched and
+	// patched_slots has one bit per pointer-sized slot in data to find slots that would be patched twice.
+	uint8_t*  data;
+	size_t    data_size;
+	uint8_t*  patched_slots;
+	bool      failed;
+	bool      out_of_memory; // failed since an address could not be tracked, the instance is not malformed.
+
+	dl_allocator* alloc;
+
+	struct addr_eq
+	{
+		uint8_t* addr;
+		bool operator()( uint8_t* other ) const { return addr == other; }
+	};
+
+	explicit dl_patched_ptrs( dl_ctx_t ctx, bool track_shared_arrays = false )
 		: next_addr(0)
-	{}
+		, track_arrays(track_shared_arrays)
+		, data(0x0)
+		, data_size(0)
+		, patched_slots(0x0)
+		, failed(false)
+		, out_of_memory(false)
+		, alloc(&ctx->alloc)
+	{
+		overflow.init( &ctx->alloc );
+	}
+
+	~dl_patched_ptrs()
+	{
+		overflow.destroy();
+		dl_free( alloc, patched_slots );
+	}
 
+	bool validate( uint8_t* validate_data, size_t validate_size )
+	{
+		size_t bitmap_size = ( validate_size / sizeof(void*) + 7 ) / 8;
+		patched_slots = (uint8_t*)dl_alloc( alloc, bitmap_size > 0 ? bitmap_size : 1 );
+		if( patched_slots == 0x0 )
+			return false;
+		memset( patched_slots, 0x0, bitmap_size );
+		data      = validate_data;
+		data_size = validate_size;
+		return true;
+	}
+
+	bool validating() const { return data != 0x0; }
+
+	/// check that [offset, offset + size) is within data and that offset is aligned, sets failed if not.
+	bool valid_range( uintptr_t offset, uint64_t size, size_t alignment )
+	{
+		if( offset > data_size || size > data_size - offset || ( offset & ( alignment - 1 ) ) != 0 )
+			failed = true;
+		return !failed;
+	}
+
+	/// mark ptr-slot at slot_data as patched, sets failed if it is not aligned or already patched.
+	bool valid_slot( uint8_t* slot_data )
+	{
+		size_t offset = (size_t)( slot_data - data );
+		if( offset % sizeof(void*) != 0 )
+		{
+			failed = true;
+			return false;
+		}
+
+		size_t  slot = offset / sizeof(void*);
+		uint8_t bit  = (uint8_t)( 1 << ( slot & 7 ) );
+		if( patched_slots[slot / 8] & bit )
+			failed = true;
+		patched_slots[slot / 8] |= bit;
+		return !failed;
+	}
+
+	/// track addr as patched, sets failed if it could not be tracked as addr would then be patched again if reached twice.
 	void add( uint8_t* addr )
 	{
-		DL_ASSERT( next_addr < DL_ARRAY_LENGTH( addresses ) );
 		DL_ASSERT( !patched( addr ) );
-		addresses[next_addr++] = addr;
+		if( next_addr < DL_ARRAY_LENGTH( addresses ) )
+			addresses[next_addr++] = addr;
+		else if( !overflow.insert( dl_internal_hash_ptr( addr ), addr ) )
+		{
+			out_of_memory = true;
+			failed        = true;
+		}
+	}
+
+	dl_error_t error() const
+	{
+		if( out_of_memory )
+			return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+		return failed ? DL_ERROR_MALFORMED_DATA : DL_ERROR_OK;
 	}
 
 	bool patched( uint8_t* addr )
@@ -22,7 +114,9 @@ struct dl_patched_ptrs
 		for( unsigned int i = 0; i < next_addr; ++i )
 			if( addr == addresses[i] )
 				return true;
-		return false;
+
+		addr_eq eq = { addr };
+		return overflow.find( dl_internal_hash_ptr( addr ), eq ) != 0x0;
 	}
 };
 
@@ -51,6 +145,15 @@ static void dl_internal_patch_ptr_instance( dl_ctx_t            ctx,
 											uintptr_t           patch_distance,
 											dl_patched_ptrs*    patched_ptrs )
 {
+	if( patched_ptrs->validating() )
+	{
+		uintptr_t raw = *(uintptr_t*)ptr_data;
+		if( !patched_ptrs->valid_slot( ptr_data ) )
+			return;
+		if( raw != DL_NULL_PTR_OFFSET[DL_PTR_SIZE_HOST] && !patched_ptrs->valid_range( raw, sub_type->size[DL_PTR_SIZE_HOST], sub_type->alignment[DL_PTR_SIZE_HOST] ) )
+			return;
+	}
+
 	uintptr_t offset = dl_internal_patch_ptr( ptr_data, patch_distance );
 	if( offset == 0x0 )
 		return;
@@ -63,10 +166,43 @@ static void dl_internal_patch_ptr_instance( dl_ctx_t            ctx,
 	dl_internal_patch_struct( ctx, sub_type, ptr, base_address, patch_distance, patched_ptrs );
 }
 
-static void dl_internal_patch_str_array( uint8_t* array_data, uint32_t count, uintptr_t patch_distance )
+static void dl_internal_patch_str( uint8_t* str_data, uintptr_t patch_distance, dl_patched_ptrs* patched_ptrs )
+{
+	if( patched_ptrs->validating() )
+	{
+		// the string has to be terminated within the data.
+		uintptr_t raw = *(uintptr_t*)str_data;
+		if( !patched_ptrs->valid_slot( str_data ) )
+			return;
+		if( raw != DL_NULL_PTR_OFFSET[DL_PTR_SIZE_HOST] &&
+			( !patched_ptrs->valid_range( raw, 1, 1 ) || memchr( patched_ptrs->data + raw, '\0', patched_ptrs->data_size - raw ) == 0x0 ) )
+		{
+			patched_ptrs->failed = true;
+			return;
+		}
+	}
+
+	dl_internal_patch_ptr( str_data, patch_distance );
+}
+
+static void dl_internal_patch_str_array( uint8_t* array_data, uint32_t count, uintptr_t patch_distance, dl_patched_ptrs* patched_ptrs )
 {
-	for( uint32_t index = 0; index < count; ++index )
-		dl_internal_patch_ptr( array_data + index * sizeof(char*), patch_distance );
+	for( uint32_t index = 0; index < count && !patched_ptrs->failed; ++index )
+		dl_internal_patch_str( array_data + index * sizeof(char*), patch_distance, patched_ptrs );
+}
+
+/// size and alignment of one element in an array of storage_type.
+static uint32_t dl_internal_array_element_size( dl_ctx_t ctx, const dl_member_desc* member, dl_type_storage_t storage_type, uint32_t* alignment )
+{
+	if( storage_type == DL_TYPE_STORAGE_STRUCT )
+	{
+		const dl_type_desc* sub_type = dl_internal_find_type( ctx, member->type_id );
+		*alignment = sub_type->alignment[DL_PTR_SIZE_HOST];
+		return dl_internal_align_up( sub_type->size[DL_PTR_SIZE_HOST], sub_type->alignment[DL_PTR_SIZE_HOST] );
+	}
+
+	*alignment = (uint32_t)dl_pod_size( storage_type );
+	return *alignment;
 }
 
 static void dl_internal_patch_ptr_array( dl_ctx_t            ctx,
@@ -77,7 +213,7 @@ static void dl_internal_patch_ptr_array( dl_ctx_t            ctx,
 										 uintptr_t           patch_distance,
 										 dl_patched_ptrs*    patched_ptrs )
 {
-	for( uint32_t index = 0; index < count; ++index )
+	for( uint32_t index = 0; index < count && !patched_ptrs->failed; ++index )
 		dl_internal_patch_ptr_instance( ctx, sub_type, array_data + index * sizeof(void*), base_address, patch_distance, patched_ptrs );
 }
 
@@ -89,8 +225,8 @@ static void dl_internal_patch_struct_array( dl_ctx_t            ctx,
 											uintptr_t           patch_distance,
 											dl_patched_ptrs*    patched_ptrs )
 {
-	uint32_t size = dl_internal_align_up( type->size[DL_PTR_SIZE_HOST], type->alignment[DL_PTR_SIZE_HOST] );
-	for( uint32_t index = 0; index < count; ++index )
+	size_t size = dl_internal_align_up( type->size[DL_PTR_SIZE_HOST], type->alignment[DL_PTR_SIZE_HOST] );
+	for( uint32_t index = 0; index < count && !patched_ptrs->failed; ++index )
 	{
 		uint8_t* struct_data = array_data + index * size;
 		dl_internal_patch_struct( ctx, type, struct_data, base_address, patch_distance, patched_ptrs );
@@ -114,7 +250,7 @@ static void dl_internal_patch_member( dl_ctx_t              ctx,
 			switch( storage_type )
 			{
 				case DL_TYPE_STORAGE_STR:
-					dl_internal_patch_ptr( member_data, patch_distance );
+					dl_internal_patch_str( member_data, patch_distance, patched_ptrs );
 				break;
 				case DL_TYPE_STORAGE_PTR:
 					dl_internal_patch_ptr_instance( ctx,
@@ -143,7 +279,7 @@ static void dl_internal_patch_member( dl_ctx_t              ctx,
 			switch( storage_type )
 			{
 				case DL_TYPE_STORAGE_STR:
-					dl_internal_patch_str_array( member_data, member->inline_array_cnt(), patch_distance );
+					dl_internal_patch_str_array( member_data, member->inline_array_cnt(), patch_distance, patched_ptrs );
 				break;
 				case DL_TYPE_STORAGE_PTR:
 					dl_internal_patch_ptr_array( ctx,
@@ -171,19 +307,38 @@ static void dl_internal_patch_member( dl_ctx_t              ctx,
 
 		case DL_TYPE_ATOM_ARRAY:
 		{
-			uintptr_t offset = dl_internal_patch_ptr( member_data, patch_distance );
-
 			union { uint8_t* src; uint32_t ptr; };
 			src = member_data + sizeof( void* );
 			uint32_t count = *(uint32_t*)src;
 
+			if( patched_ptrs->validating() )
+			{
+				uintptr_t raw = *(uintptr_t*)member_data;
+				if( !patched_ptrs->valid_slot( member_data ) )
+					break;
+
+				uint32_t alignment;
+				uint32_t element_size = dl_internal_array_element_size( ctx, member, storage_type, &alignment );
+				if( count != 0 && !patched_ptrs->valid_range( raw, (uint64_t)count * element_size, alignment ) )
+					break;
+			}
+
+			uintptr_t offset = dl_internal_patch_ptr( member_data, patch_distance );
+
 			if( count != 0 )
 			{
 				uint8_t* array_data = (uint8_t*)base_address + offset;
+				if( patched_ptrs->track_arrays )
+				{
+					if( patched_ptrs->patched( array_data ) )
+						break;
+					patched_ptrs->add( array_data );
+				}
+
 				switch( storage_type )
 				{
 					case DL_TYPE_STORAGE_STR:
-						dl_internal_patch_str_array( array_data, count, patch_distance );
+						dl_internal_patch_str_array( array_data, count, patch_distance, patched_ptrs );
 					break;
 					case DL_TYPE_STORAGE_PTR:
 						dl_internal_patch_ptr_array( ctx,
@@ -226,6 +381,12 @@ static void dl_internal_patch_union( dl_ctx_t            ctx,
 
 	// find member index from union type ...
 	uint32_t union_type = *((uint32_t*)(union_data + type_offset));
+	if( patched_ptrs->validating() && union_type - dl_internal_typeid_of( ctx, type ) - 1 >= type->member_count )
+	{
+		patched_ptrs->failed = true;
+		return;
+	}
+
 	const dl_member_desc* member = dl_internal_union_type_to_member(ctx, type, union_type);
 	DL_ASSERT(member->offset[DL_PTR_SIZE_HOST] == 0);
 	dl_internal_patch_member( ctx, member, union_data, base_address, patch_distance, patched_ptrs );
@@ -246,7 +407,7 @@ void dl_internal_patch_struct( dl_ctx_t            ctx,
 		}
 		else
 		{
-			for( uint32_t member_index = 0; member_index < type->member_count; ++member_index )
+			for( uint32_t member_index = 0; member_index < type->member_count && !patched_ptrs->failed; ++member_index )
 			{
 				const dl_member_desc* member = dl_get_type_member( ctx, type, member_index );
 				dl_internal_patch_member( ctx, member, struct_data + member->offset[DL_PTR_SIZE_HOST], base_address, patch_distance, patched_ptrs );
@@ -255,37 +416,85 @@ void dl_internal_patch_struct( dl_ctx_t            ctx,
 	}
 }
 
-void dl_internal_patch_member( dl_ctx_t              ctx,
-							   const dl_member_desc* member,
-							   uint8_t*              member_data,
-							   uintptr_t             base_address,
-							   uintptr_t             patch_distance )
+dl_error_t dl_internal_patch_member( dl_ctx_t              ctx,
+									 const dl_member_desc* member,
+									 uint8_t*              member_data,
+									 uintptr_t             base_address,
+									 uintptr_t             patch_distance )
 {
-	dl_patched_ptrs patched;
+	dl_patched_ptrs patched( ctx );
 	dl_internal_patch_member( ctx, member, member_data, base_address, patch_distance, &patched );
+	return patched.error();
 }
 
-void dl_internal_patch_instance( dl_ctx_t            ctx,
-								 const dl_type_desc* type,
-								 uint8_t*            instance,
-								 uintptr_t           base_address,
-								 uintptr_t           patch_distance )
+static void dl_internal_patch_root( dl_ctx_t            ctx,
+									const dl_type_desc* type,
+									uint8_t*            instance,
+									uintptr_t           base_address,
+									uintptr_t           patch_distance,
+									dl_patched_ptrs*    patched )
 {
-	dl_patched_ptrs patched;
-	patched.add( instance );
-
 	if( type->flags & DL_TYPE_FLAG_IS_UNION )
 	{
-		dl_internal_patch_union(ctx, type, instance, base_address, patch_distance, &patched);
+		dl_internal_patch_union(ctx, type, instance, base_address, patch_distance, patched);
 	}
 	else
 	{
-		for( uint32_t member_index = 0; member_index < type->member_count; ++member_index )
+		for( uint32_t member_index = 0; member_index < type->member_count && !patched->failed; ++member_index )
 		{
 			const dl_member_desc* member = dl_get_type_member( ctx, type, member_index );
 			uint8_t*   member_data = instance + member->offset[DL_PTR_SIZE_HOST];
 
-			dl_internal_patch_member( ctx, member, member_data, base_address, patch_distance, &patched );
+			dl_internal_patch_member( ctx, member, member_data, base_address, patch_distance, patched );
 		}
 	}
 }
+
+dl_error_t dl_internal_patch_instance( dl_ctx_t            ctx,
+									   const dl_type_desc* type,
+									   uint8_t*            instance,
+									   uintptr_t           base_address,
+									   uintptr_t           patch_distance,
+									   bool                shared_subdata,
+									   size_t              validate_size )
+{
+	dl_patched_ptrs patched( ctx, shared_subdata );
+	if( validate_size > 0 )
+	{
+		if( !patched.validate( instance, validate_size ) )
+			return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+		if( !patched.valid_range( 0, type->size[DL_PTR_SIZE_HOST], 1 ) )
+			return DL_ERROR_MALFORMED_DATA;
+	}
+
+	patched.add( instance );
+	dl_internal_patch_root( ctx, type, instance, base_address, patch_distance, &patched );
+	return patched.error();
+}
+
+dl_error_t dl_internal_patch_instance_batch( dl_ctx_t            ctx,
+											 const dl_type_desc* type,
+											 uint8_t*            data,
+											 const uint32_t*     offsets,
+											 uint32_t            instance_count,
+											 bool                shared_subdata,
+											 size_t              validate_size )
+{
+	// all roots are added first so that pointers between instances in the batch do not patch them twice.
+	dl_patched_ptrs patched( ctx, shared_subdata );
+	if( validate_size > 0 )
+	{
+		if( !patched.validate( data, validate_size ) )
+			return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+		for( uint32_t i = 0; i < instance_count; ++i )
+			if( !patched.valid_range( offsets[i], type->size[DL_PTR_SIZE_HOST], type->alignment[DL_PTR_SIZE_HOST] ) )
+				return DL_ERROR_MALFORMED_DATA;
+	}
+
+	for( uint32_t i = 0; i < instance_count; ++i )
+		patched.add( data + offsets[i] );
+
+	for( uint32_t i = 0; i < instance_count && !patched.failed; ++i )
+		dl_internal_patch_root( ctx, type, data + offsets[i], 0x0, (uintptr_t)data, &patched );
+	return patched.error();
+}
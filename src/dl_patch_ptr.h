@@ -11,12 +11,41 @@
  * @param instance pointer to instance to patch.
  * @param base_address base address to patch the pointers against.
  * @param patch_distance distance in bytes to patch all pointers.
+ * @param shared_subdata set if the instance was stored with DL_DATA_HEADER_FLAG_SHARED_SUBDATA, i.e. array-data might
+ *                       be referenced from multiple members and should only be patched once.
+ * @param validate_size if not 0, all offsets, counts, strings and union-types are validated to be within
+ *                      [instance, instance + validate_size) while patching.
+ * @return DL_ERROR_MALFORMED_DATA if validation failed and DL_ERROR_OUT_OF_LIBRARY_MEMORY if patched pointers could
+ *         not be tracked, the instance is then partially patched.
  */
-void dl_internal_patch_instance( dl_ctx_t            ctx,
-								 const dl_type_desc* type,
-								 uint8_t*            instance,
-								 uintptr_t           base_address,
-								 uintptr_t           patch_distance );
+dl_error_t dl_internal_patch_instance( dl_ctx_t            ctx,
+									   const dl_type_desc* type,
+									   uint8_t*            instance,
+									   uintptr_t           base_address,
+									   uintptr_t           patch_distance,
+									   bool                shared_subdata = false,
+									   size_t              validate_size  = 0 );
+
+/**
+ * Patch all pointers in a batch of instances stored with dl_instance_store_batch.
+ *
+ * @param ctx dl-context containing all types used in type.
+ * @param type type desc of the instances to patch.
+ * @param data pointer to batch-data, all pointers in the batch are stored as offsets from here.
+ * @param offsets offset from data to each instance.
+ * @param instance_count number of instances in the batch.
+ * @param shared_subdata set if the batch was stored with DL_DATA_HEADER_FLAG_SHARED_SUBDATA.
+ * @param validate_size if not 0, the batch is validated to be within [data, data + validate_size) while patching.
+ * @return DL_ERROR_MALFORMED_DATA if validation failed and DL_ERROR_OUT_OF_LIBRARY_MEMORY if patched pointers could
+ *         not be tracked.
+ */
+dl_error_t dl_internal_patch_instance_batch( dl_ctx_t            ctx,
+											 const dl_type_desc* type,
+											 uint8_t*            data,
+											 const uint32_t*     offsets,
+											 uint32_t            instance_count,
+											 bool                shared_subdata,
+											 size_t              validate_size = 0 );
 
 /**
  * Patch all pointers in a member.
@@ -26,11 +55,12 @@ void dl_internal_patch_instance( dl_ctx_t            ctx,
  * @param member_data pointer to member to patch.
  * @param base_address base address to patch the pointers against.
  * @param patch_distance distance in bytes to patch all pointers.
+ * @return DL_ERROR_OUT_OF_LIBRARY_MEMORY if patched pointers could not be tracked.
  */
-void dl_internal_patch_member( dl_ctx_t                ctx,
-								 const dl_member_desc* member,
-								 uint8_t*              member_data,
-								 uintptr_t             base_address,
-								 uintptr_t             patch_distance );
+dl_error_t dl_internal_patch_member( dl_ctx_t              ctx,
+									 const dl_member_desc* member,
+									 uint8_t*              member_data,
+									 uintptr_t             base_address,
+									 uintptr_t             patch_distance );
 
 #endif // DL_PATCH_PTR_H_INCLUDED
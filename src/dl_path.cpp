@@ -0,0 +1,541 @@
+/* copyright (c) 2010 Fredrik Kihlander, see LICENSE for more info */
+
+#include <dl/dl_path.h>
+#include "dl_types.h"
+#include "dl_hash.h"
+#include "dl_swap.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+	All names and layout-data needed to walk a path is resolved by dl_path_compile so that evaluating it only read the
+	data along the path. Packed instances are walked without patching them, as the cursor-functions do, with all offsets
+	validated against the instance-size before they are followed, but they can be of any endian and ptr-size.
+*/
+
+struct dl_path_step
+{
+	uint32_t index;                // element-index of arrays, 0 otherwise.
+	uint32_t offset[2];            // offset of member per ptr-size.
+	uint32_t element_size[2];      // size of one element of member per ptr-size.
+	uint32_t union_type_offset[2];
+	uint32_t union_type;           // value of the union-type if member is a member of a union, 0 otherwise.
+	uint8_t  atom;
+	uint8_t  storage;
+	uint8_t  bf_offset;            // bit-offset of bitfield in host-layout.
+	uint8_t  bf_member_offset;     // bitfield-offset as stored in the member-desc.
+	uint8_t  bf_bits;
+};
+
+struct dl_path
+{
+	dl_ctx_t     ctx;
+	dl_typeid_t  root_type;
+	uint32_t     step_count;
+	dl_path_step steps[1];
+};
+
+dl_error_t dl_internal_parse_path_step( dl_ctx_t dl_ctx, const dl_type_desc* type, const char** path, unsigned int* member_index, unsigned int* index )
+{
+	const char* iter = *path;
+	const char* name = iter;
+	while( *iter != '\0' && *iter != '.' && *iter != '[' )
+		++iter;
+	if( iter == name )
+		return DL_ERROR_INVALID_PARAMETER;
+
+	*member_index = dl_internal_find_member( dl_ctx, type, dl_internal_hash_buffer( (const uint8_t*)name, (size_t)( iter - name ) ) );
+	if( *member_index >= type->member_count )
+		return DL_ERROR_MEMBER_NOT_FOUND;
+
+	const dl_member_desc* member = dl_get_type_member( dl_ctx, type, *member_index );
+	bool is_array = member->AtomType() == DL_TYPE_ATOM_ARRAY || member->AtomType() == DL_TYPE_ATOM_INLINE_ARRAY;
+
+	*index = 0;
+	if( *iter == '[' )
+	{
+		if( !is_array )
+			return DL_ERROR_TYPE_MISMATCH;
+
+		char* index_end;
+		unsigned long parsed = strtoul( iter + 1, &index_end, 10 );
+		if( index_end == iter + 1 || *index_end != ']' || parsed > 0xFFFFFFFF )
+			return DL_ERROR_INVALID_PARAMETER;
+		*index = (unsigned int)parsed;
+		iter = index_end + 1;
+	}
+	else if( is_array )
+		return DL_ERROR_INVALID_PARAMETER; // the path need to select one element of an array.
+
+	if( *iter == '.' )
+	{
+		++iter;
+		if( *iter == '\0' )
+			return DL_ERROR_INVALID_PARAMETER;
+	}
+	else if( *iter != '\0' )
+		return DL_ERROR_INVALID_PARAMETER;
+
+	*path = iter;
+	return DL_ERROR_OK;
+}
+
+static uint32_t dl_path_element_size( dl_ctx_t dl_ctx, const dl_member_desc* member, dl_ptr_size_t ptr_size )
+{
+	switch( member->StorageType() )
+	{
+		case DL_TYPE_STORAGE_STR:
+		case DL_TYPE_STORAGE_PTR:
+			return ptr_size == DL_PTR_SIZE_32BIT ? 4 : 8;
+		case DL_TYPE_STORAGE_STRUCT:
+		{
+			const dl_type_desc* sub_type = dl_internal_find_type( dl_ctx, member->type_id );
+			return sub_type == 0x0 ? 0 : sub_type->size[ptr_size];
+		}
+		default:
+			return (uint32_t)dl_pod_size( member->StorageType() );
+	}
+}
+
+dl_error_t dl_path_compile( dl_ctx_t dl_ctx, dl_typeid_t root_type, const char* path, dl_path_t* out_path )
+{
+	if( path == 0x0 || *path == '\0' )
+		return DL_ERROR_INVALID_PARAMETER;
+
+	uint32_t step_count = 1;
+	for( const char* iter = path; *iter != '\0'; ++iter )
+		if( *iter == '.' )
+			++step_count;
+
+	dl_path* compiled = (dl_path*)dl_alloc( &dl_ctx->alloc, sizeof(dl_path) + sizeof(dl_path_step) * ( step_count - 1 ) );
+	if( compiled == 0x0 )
+		return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+	memset( compiled, 0x0, sizeof(dl_path) + sizeof(dl_path_step) * ( step_count - 1 ) );
+	compiled->ctx        = dl_ctx;
+	compiled->root_type  = root_type;
+	compiled->step_count = step_count;
+
+	dl_error_t  err     = DL_ERROR_OK;
+	dl_typeid_t type_id = root_type;
+	const char* iter    = path;
+	for( uint32_t i = 0; i < step_count && err == DL_ERROR_OK; ++i )
+	{
+		const dl_type_desc* type = dl_internal_find_type( dl_ctx, type_id );
+		if( type == 0x0 )
+		{
+			err = DL_ERROR_TYPE_NOT_FOUND;
+			break;
+		}
+
+		dl_path_step& step = compiled->steps[i];
+		unsigned int member_index;
+		err = dl_internal_parse_path_step( dl_ctx, type, &iter, &member_index, &step.index );
+		if( err != DL_ERROR_OK )
+			break;
+
+		const dl_member_desc* member = dl_get_type_member( dl_ctx, type, member_index );
+		for( int ptr_size = 0; ptr_size < 2; ++ptr_size )
+		{
+			step.offset[ptr_size]       = member->offset[ptr_size];
+			step.element_size[ptr_size] = dl_path_element_size( dl_ctx, member, (dl_ptr_size_t)ptr_size );
+		}
+		step.atom    = (uint8_t)member->AtomType();
+		step.storage = (uint8_t)member->StorageType();
+		if( type->flags & DL_TYPE_FLAG_IS_UNION )
+		{
+			step.union_type_offset[DL_PTR_SIZE_32BIT] = dl_internal_union_type_offset( dl_ctx, type, DL_PTR_SIZE_32BIT );
+			step.union_type_offset[DL_PTR_SIZE_64BIT] = dl_internal_union_type_offset( dl_ctx, type, DL_PTR_SIZE_64BIT );
+			step.union_type = dl_internal_typeid_of( dl_ctx, type ) + member_index + 1;
+		}
+		if( member->AtomType() == DL_TYPE_ATOM_BITFIELD )
+		{
+			step.bf_bits          = (uint8_t)member->bitfield_bits();
+			step.bf_member_offset = (uint8_t)member->bitfield_offset();
+			step.bf_offset        = (uint8_t)dl_bf_offset( DL_ENDIAN_HOST, sizeof(uint8_t), step.bf_member_offset, step.bf_bits );
+		}
+		if( member->AtomType() == DL_TYPE_ATOM_INLINE_ARRAY && step.index >= member->inline_array_cnt() )
+			err = DL_ERROR_INVALID_PARAMETER;
+
+		bool is_last = i == step_count - 1;
+		bool is_struct = member->StorageType() == DL_TYPE_STORAGE_STRUCT || member->StorageType() == DL_TYPE_STORAGE_PTR;
+		if( is_last == is_struct )
+			err = DL_ERROR_TYPE_MISMATCH; // only structs can be followed and only values can be read.
+
+		type_id = member->type_id;
+	}
+
+	if( err != DL_ERROR_OK )
+	{
+		dl_free( &dl_ctx->alloc, compiled );
+		return err;
+	}
+
+	*out_path = compiled;
+	return DL_ERROR_OK;
+}
+
+dl_error_t dl_path_free( dl_path_t path )
+{
+	if( path != 0x0 )
+		dl_free( &path->ctx->alloc, path );
+	return DL_ERROR_OK;
+}
+
+static uint64_t dl_path_read_uint( const uint8_t* data, size_t size )
+{
+	switch( size )
+	{
+		case 1: { uint8_t  v; memcpy( &v, data, sizeof(v) ); return v; }
+		case 2: { uint16_t v; memcpy( &v, data, sizeof(v) ); return v; }
+		case 4: { uint32_t v; memcpy( &v, data, sizeof(v) ); return v; }
+		default: { uint64_t v; memcpy( &v, data, sizeof(v) ); return v; }
+	}
+}
+
+static void dl_path_write_uint( uint8_t* data, size_t size, uint64_t value )
+{
+	switch( size )
+	{
+		case 1: { uint8_t  v = (uint8_t) value; memcpy( data, &v, sizeof(v) ); } break;
+		case 2: { uint16_t v = (uint16_t)value; memcpy( data, &v, sizeof(v) ); } break;
+		case 4: { uint32_t v = (uint32_t)value; memcpy( data, &v, sizeof(v) ); } break;
+		default: memcpy( data, &value, sizeof(value) ); break;
+	}
+}
+
+static uint64_t dl_path_swap_uint( uint64_t value, size_t size )
+{
+	switch( size )
+	{
+		case 1:  return value;
+		case 2:  return dl_swap_endian_uint16( (uint16_t)value );
+		case 4:  return dl_swap_endian_uint32( (uint32_t)value );
+		default: return dl_swap_endian_uint64( value );
+	}
+}
+
+static dl_error_t dl_path_check_value_size( const dl_path_step& leaf, size_t value_size )
+{
+	if( leaf.atom == DL_TYPE_ATOM_BITFIELD )
+		return ( value_size == 1 || value_size == 2 || value_size == 4 || value_size == 8 ) ? DL_ERROR_OK : DL_ERROR_TYPE_MISMATCH;
+	return value_size == leaf.element_size[DL_PTR_SIZE_HOST] ? DL_ERROR_OK : DL_ERROR_TYPE_MISMATCH;
+}
+
+/*
+	Walk path in a loaded instance and return a pointer to the value at the end of it.
+*/
+static dl_error_t dl_path_walk( dl_path_t path, uint8_t* instance, uint8_t** out_value )
+{
+	uint8_t* base = instance;
+	for( uint32_t i = 0; i < path->step_count; ++i )
+	{
+		const dl_path_step& step = path->steps[i];
+		if( step.union_type != 0 )
+		{
+			uint32_t union_type;
+			memcpy( &union_type, base + step.union_type_offset[DL_PTR_SIZE_HOST], sizeof(uint32_t) );
+			if( union_type != step.union_type )
+				return DL_ERROR_MEMBER_NOT_FOUND;
+		}
+
+		uint8_t* elem = base + step.offset[DL_PTR_SIZE_HOST];
+		switch( step.atom )
+		{
+			case DL_TYPE_ATOM_INLINE_ARRAY:
+				elem += (size_t)step.element_size[DL_PTR_SIZE_HOST] * step.index;
+				break;
+			case DL_TYPE_ATOM_ARRAY:
+			{
+				uint8_t* data;
+				uint32_t count;
+				memcpy( &data,  elem,                 sizeof(uint8_t*) );
+				memcpy( &count, elem + sizeof(void*), sizeof(uint32_t) );
+				if( step.index >= count )
+					return DL_ERROR_INVALID_PARAMETER;
+				elem = data + (size_t)step.element_size[DL_PTR_SIZE_HOST] * step.index;
+				break;
+			}
+			default:
+				break;
+		}
+
+		if( i == path->step_count - 1 )
+		{
+			*out_value = elem;
+			break;
+		}
+
+		if( step.storage == DL_TYPE_STORAGE_PTR )
+		{
+			memcpy( &base, elem, sizeof(uint8_t*) );
+			if( base == 0x0 )
+				return DL_ERROR_MEMBER_NOT_FOUND;
+		}
+		else
+			base = elem;
+	}
+	return DL_ERROR_OK;
+}
+
+dl_error_t dl_path_get( dl_path_t path, const void* instance, void* out_value, size_t out_value_size )
+{
+	const dl_path_step& leaf = path->steps[path->step_count - 1];
+	dl_error_t err = dl_path_check_value_size( leaf, out_value_size );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	uint8_t* value;
+	err = dl_path_walk( path, (uint8_t*)instance, &value );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	if( leaf.atom == DL_TYPE_ATOM_BITFIELD )
+	{
+		uint64_t storage_value = dl_path_read_uint( value, dl_pod_size( (dl_type_storage_t)leaf.storage ) );
+		dl_path_write_uint( (uint8_t*)out_value, out_value_size, DL_EXTRACT_BITS( storage_value, (uint64_t)leaf.bf_offset, (uint64_t)leaf.bf_bits ) );
+	}
+	else
+		memcpy( out_value, value, out_value_size );
+	return DL_ERROR_OK;
+}
+
+dl_error_t dl_path_set( dl_path_t path, void* instance, const void* value, size_t value_size )
+{
+	const dl_path_step& leaf = path->steps[path->step_count - 1];
+	dl_error_t err = dl_path_check_value_size( leaf, value_size );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	uint8_t* target;
+	err = dl_path_walk( path, (uint8_t*)instance, &target );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	if( leaf.atom == DL_TYPE_ATOM_BITFIELD )
+	{
+		size_t   storage_size  = dl_pod_size( (dl_type_storage_t)leaf.storage );
+		uint64_t storage_value = dl_path_read_uint( target, storage_size );
+		uint64_t bf_value      = dl_path_read_uint( (const uint8_t*)value, value_size );
+		dl_path_write_uint( target, storage_size, DL_INSERT_BITS( storage_value, bf_value, (uint64_t)leaf.bf_offset, (uint64_t)leaf.bf_bits ) );
+	}
+	else
+		memcpy( target, value, value_size );
+	return DL_ERROR_OK;
+}
+
+struct dl_path_packed
+{
+	dl_data_header header;    // header of the packed instance in host endian.
+	uint8_t*       data;      // instance-data, following the header.
+	size_t         data_size;
+	dl_ptr_size_t  ptr_size;
+	bool           swap;      // instance is not in host endian.
+
+	bool InBounds( uint64_t offset, uint64_t size ) const { return offset <= data_size && size <= data_size - offset; }
+
+	/// read an unsigned integer of size bytes at offset, returned in host endian.
+	uint64_t ReadUInt( uint64_t offset, size_t size ) const
+	{
+		uint64_t value = dl_path_read_uint( data + offset, size );
+		return swap ? dl_path_swap_uint( value, size ) : value;
+	}
+
+	/// read a ptr at offset, returns false for null-ptrs.
+	bool ReadPtr( uint64_t offset, uint64_t* out_offset ) const
+	{
+		*out_offset = ReadUInt( offset, ptr_size == DL_PTR_SIZE_32BIT ? 4 : 8 );
+		return *out_offset != ( ptr_size == DL_PTR_SIZE_32BIT ? 0xFFFFFFFF : UINT64_MAX );
+	}
+};
+
+static dl_error_t dl_path_open_packed( dl_path_t path, const unsigned char* packed_instance, size_t packed_instance_size, dl_path_packed* packed )
+{
+	if( packed_instance_size < sizeof(dl_data_header) ) return DL_ERROR_MALFORMED_DATA;
+
+	memcpy( &packed->header, packed_instance, sizeof(dl_data_header) );
+	packed->swap = packed->header.id == DL_INSTANCE_ID_SWAPED;
+	if( packed->swap )
+		dl_swap_header( &packed->header );
+
+	const dl_data_header& header = packed->header;
+	if( header.id != DL_INSTANCE_ID )                        return DL_ERROR_MALFORMED_DATA;
+	if( !dl_internal_is_instance_version( header.version ) ) return DL_ERROR_VERSION_MISMATCH;
+	if( header.root_instance_type != path->root_type )       return DL_ERROR_TYPE_MISMATCH;
+	if( header.flags & DL_DATA_HEADER_FLAG_BATCH )           return DL_ERROR_UNSUPPORTED_OPERATION;
+	if( header.flags & DL_DATA_HEADER_FLAG_COMPRESSED )      return DL_ERROR_UNSUPPORTED_OPERATION;
+
+	const dl_type_desc* root_type = dl_internal_find_type( path->ctx, path->root_type );
+	if( root_type == 0x0 )
+		return DL_ERROR_TYPE_NOT_FOUND;
+
+	dl_error_t err = dl_internal_check_fingerprint( path->ctx, root_type, &header, packed_instance, packed_instance_size, packed->swap );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	uint64_t instance_size = dl_internal_header_instance_size( &header );
+	if( instance_size > packed_instance_size - sizeof(dl_data_header) )
+		return DL_ERROR_MALFORMED_DATA;
+
+	packed->data      = (uint8_t*)packed_instance + sizeof(dl_data_header);
+	packed->data_size = (size_t)instance_size;
+	packed->ptr_size  = header.is_64_bit_ptr ? DL_PTR_SIZE_64BIT : DL_PTR_SIZE_32BIT;
+	return DL_ERROR_OK;
+}
+
+/*
+	Walk path in a packed instance and return the offset of the value at the end of it.
+*/
+static dl_error_t dl_path_walk_packed( dl_path_t path, const dl_path_packed& packed, uint64_t* out_offset )
+{
+	dl_ptr_size_t ptr_size = packed.ptr_size;
+	uint64_t      ptr_bytes = ptr_size == DL_PTR_SIZE_32BIT ? 4 : 8;
+	uint64_t      base      = 0;
+	for( uint32_t i = 0; i < path->step_count; ++i )
+	{
+		const dl_path_step& step = path->steps[i];
+		if( step.union_type != 0 )
+		{
+			uint64_t type_offset = base + step.union_type_offset[ptr_size];
+			if( !packed.InBounds( type_offset, sizeof(uint32_t) ) )
+				return DL_ERROR_MALFORMED_DATA;
+			if( packed.ReadUInt( type_offset, sizeof(uint32_t) ) != step.union_type )
+				return DL_ERROR_MEMBER_NOT_FOUND;
+		}
+
+		uint64_t elem = base + step.offset[ptr_size];
+		switch( step.atom )
+		{
+			case DL_TYPE_ATOM_INLINE_ARRAY:
+				elem += (uint64_t)step.element_size[ptr_size] * step.index;
+				break;
+			case DL_TYPE_ATOM_ARRAY:
+			{
+				if( !packed.InBounds( elem, ptr_bytes + sizeof(uint32_t) ) )
+					return DL_ERROR_MALFORMED_DATA;
+				uint64_t data;
+				bool     has_data = packed.ReadPtr( elem, &data );
+				uint32_t count    = (uint32_t)packed.ReadUInt( elem + ptr_bytes, sizeof(uint32_t) );
+				if( step.index >= count )
+					return DL_ERROR_INVALID_PARAMETER;
+				if( !has_data || !packed.InBounds( data, (uint64_t)step.element_size[ptr_size] * count ) )
+					return DL_ERROR_MALFORMED_DATA;
+				elem = data + (uint64_t)step.element_size[ptr_size] * step.index;
+				break;
+			}
+			default:
+				break;
+		}
+
+		uint64_t elem_size = step.atom == DL_TYPE_ATOM_BITFIELD ? dl_pod_size( (dl_type_storage_t)step.storage ) : step.element_size[ptr_size];
+		if( !packed.InBounds( elem, elem_size ) )
+			return DL_ERROR_MALFORMED_DATA;
+
+		if( i == path->step_count - 1 )
+		{
+			*out_offset = elem;
+			break;
+		}
+
+		if( step.storage == DL_TYPE_STORAGE_PTR )
+		{
+			if( !packed.ReadPtr( elem, &base ) )
+				return DL_ERROR_MEMBER_NOT_FOUND;
+		}
+		else
+			base = elem;
+	}
+	return DL_ERROR_OK;
+}
+
+/// bit-offset of a bitfield in a packed instance after the storage has been read to host endian.
+static inline uint64_t dl_path_packed_bf_offset( const dl_path_packed& packed, const dl_path_step& leaf )
+{
+	if( !packed.swap )
+		return leaf.bf_offset;
+	return dl_bf_offset( dl_other_endian( DL_ENDIAN_HOST ), (unsigned int)dl_pod_size( (dl_type_storage_t)leaf.storage ), leaf.bf_member_offset, leaf.bf_bits );
+}
+
+dl_error_t dl_path_get_packed( dl_path_t path, const unsigned char* packed_instance, size_t packed_instance_size,
+							   void* out_value, size_t out_value_size )
+{
+	const dl_path_step& leaf = path->steps[path->step_count - 1];
+
+	dl_path_packed packed;
+	dl_error_t err = dl_path_open_packed( path, packed_instance, packed_instance_size, &packed );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	uint64_t offset;
+	err = dl_path_walk_packed( path, packed, &offset );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	if( leaf.storage == DL_TYPE_STORAGE_STR )
+	{
+		if( out_value_size != sizeof(const char*) )
+			return DL_ERROR_TYPE_MISMATCH;
+
+		const char* str = 0x0;
+		uint64_t str_offset;
+		if( packed.ReadPtr( offset, &str_offset ) )
+		{
+			// ... the string need to be terminated inside the instance ...
+			if( str_offset >= packed.data_size || memchr( packed.data + str_offset, '\0', packed.data_size - (size_t)str_offset ) == 0x0 )
+				return DL_ERROR_MALFORMED_DATA;
+			str = (const char*)( packed.data + str_offset );
+		}
+		memcpy( out_value, &str, sizeof(const char*) );
+		return DL_ERROR_OK;
+	}
+
+	err = dl_path_check_value_size( leaf, out_value_size );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	size_t   storage_size = dl_pod_size( (dl_type_storage_t)leaf.storage );
+	uint64_t value        = packed.ReadUInt( offset, storage_size );
+	if( leaf.atom == DL_TYPE_ATOM_BITFIELD )
+		value = DL_EXTRACT_BITS( value, dl_path_packed_bf_offset( packed, leaf ), (uint64_t)leaf.bf_bits );
+	dl_path_write_uint( (uint8_t*)out_value, out_value_size, value );
+	return DL_ERROR_OK;
+}
+
+dl_error_t dl_path_set_packed( dl_path_t path, unsigned char* packed_instance, size_t packed_instance_size,
+							   const void* value, size_t value_size )
+{
+	const dl_path_step& leaf = path->steps[path->step_count - 1];
+	if( leaf.storage == DL_TYPE_STORAGE_STR )
+		return DL_ERROR_TYPE_MISMATCH; // strings can not be resized in place.
+
+	dl_error_t err = dl_path_check_value_size( leaf, value_size );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	dl_path_packed packed;
+	err = dl_path_open_packed( path, packed_instance, packed_instance_size, &packed );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	uint64_t offset;
+	err = dl_path_walk_packed( path, packed, &offset );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	size_t   storage_size = dl_pod_size( (dl_type_storage_t)leaf.storage );
+	uint64_t new_value    = dl_path_read_uint( (const uint8_t*)value, value_size );
+	if( leaf.atom == DL_TYPE_ATOM_BITFIELD )
+		new_value = DL_INSERT_BITS( packed.ReadUInt( offset, storage_size ), new_value, dl_path_packed_bf_offset( packed, leaf ), (uint64_t)leaf.bf_bits );
+	dl_path_write_uint( packed.data + offset, storage_size, packed.swap ? dl_path_swap_uint( new_value, storage_size ) : new_value );
+
+	// ... a stored checksum has to be recalculated to keep the instance loadable with DL_LOADFLAGS_VERIFY_CHECKSUM ...
+	if( packed.header.flags & DL_DATA_HEADER_FLAG_CHECKSUM )
+	{
+		uint32_t checksum = dl_internal_crc32c( packed.data, packed.data_size );
+		if( packed.swap )
+			checksum = dl_swap_endian_uint32( checksum );
+		memcpy( packed_instance + offsetof( dl_data_header, checksum ), &checksum, sizeof(uint32_t) );
+	}
+	return DL_ERROR_OK;
+}
@@ -134,6 +134,15 @@ inline float dl_strtof(const char* str, char** endptr)
 	return res;
 }
 
+#define DL_TXT_PACK_MAX_LAYERS 32
+
+struct dl_txt_pack_layer
+{
+	const char* start;
+	const char* end;
+	const char* subdata_pos;
+};
+
 struct dl_txt_pack_ctx
 {
 	dl_txt_read_ctx read_ctx;
@@ -141,11 +150,16 @@ struct dl_txt_pack_ctx
 	const char* subdata_pos;
 	int subdata_count;
 
+	dl_txt_pack_layer* layers; ///< all documents packed by dl_txt_pack_layers(), 0x0 when packing a single document.
+	int layer_count;
+	int current_layer;         ///< the layer read_ctx currently read from.
+
 	struct
 	{
 		dl_txt_read_substr name;
 		const dl_type_desc* type;
 		size_t patch_pos;
+		int layer;             ///< names of subdata are local to the layer they are referenced from.
 	} subdata[256];
 };
 
@@ -316,6 +330,7 @@ static void dl_txt_pack_eat_and_write_ptr( dl_ctx_t dl_ctx, dl_txt_pack_ctx* pac
 	packctx->subdata[packctx->subdata_count].name = ptr;
 	packctx->subdata[packctx->subdata_count].type = type;
 	packctx->subdata[packctx->subdata_count].patch_pos = patch_pos;
+	packctx->subdata[packctx->subdata_count].layer = packctx->current_layer;
 	++packctx->subdata_count;
 }
 
@@ -462,7 +477,7 @@ static void dl_txt_pack_eat_and_write_array( dl_ctx_t dl_ctx, dl_txt_pack_ctx* p
 			size_t array_pos = dl_binary_writer_tell( packctx->writer ); // TODO: this seek/set dance will only be needed if type has subptrs, optimize by making different code-paths?
 			for( uint32_t i = 0; i < array_length -1; ++i )
 			{
-				dl_binary_writer_seek_set( packctx->writer, array_pos + i * type->size[DL_PTR_SIZE_HOST] );
+				dl_binary_writer_seek_set( packctx->writer, array_pos + (size_t)i * type->size[DL_PTR_SIZE_HOST] );
 				dl_txt_pack_eat_and_write_struct( dl_ctx, packctx, type, pack_flags );
 				dl_txt_eat_char( dl_ctx, &packctx->read_ctx, ',' );
 			}
@@ -594,6 +609,32 @@ const char* dl_txt_skip_string( const char* str, const char* end )
 	return str;
 }
 
+static const char* dl_txt_skip_value( const char* iter, const char* end )
+{
+	iter = dl_txt_skip_white( iter, end );
+	switch( *iter )
+	{
+		case '{': return dl_txt_skip_map( iter, end );
+		case '[': return dl_txt_skip_array( iter, end );
+		case '"':
+		case '\'':
+		{
+			char quote = *iter++;
+			while( iter != end && *iter != quote )
+			{
+				if( *iter == '\\' && iter + 1 != end )
+					++iter;
+				++iter;
+			}
+			return iter == end ? "\0" : iter + 1;
+		}
+		default:
+			while( iter != end && *iter != '\0' && *iter != ',' && *iter != '}' && *iter != ']' && !isspace( *iter ) )
+				++iter;
+			return iter;
+	}
+}
+
 static uint32_t dl_txt_pack_find_array_length( dl_ctx_t dl_ctx, dl_txt_pack_ctx* packctx, const dl_member_desc* member )
 {
 	const char* iter = packctx->read_ctx.iter;
@@ -783,8 +824,26 @@ static void dl_txt_pack_write_default_value( dl_ctx_t              dl_ctx,
 		dl_binary_writer_write( packctx->writer, subdata, member->default_value_size - member_size );
 
 		uint8_t* member_data = packctx->writer->data + member_pos;
-		if( !packctx->writer->dummy )
-			dl_internal_patch_member( dl_ctx, member, member_data, (uintptr_t)packctx->writer->data, subdata_pos - member_size );
+		if( !packctx->writer->dummy &&
+			dl_internal_patch_member( dl_ctx, member, member_data, (uintptr_t)packctx->writer->data, subdata_pos - member_size ) != DL_ERROR_OK )
+			dl_txt_read_failed( dl_ctx, &packctx->read_ctx, DL_ERROR_OUT_OF_LIBRARY_MEMORY, "out of memory while patching default value of member \"%s\"", dl_internal_member_name( dl_ctx, member ) );
+	}
+}
+
+/*
+	Write the defaults that has subdata, and by that is not fully covered by the default-template of type, for all members
+	not set in members_set.
+*/
+static void dl_txt_pack_write_subdata_defaults( dl_ctx_t dl_ctx, dl_txt_pack_ctx* packctx, const dl_type_desc* type, size_t instance_pos, uint64_t members_set )
+{
+	for( uint32_t i = 0; i < type->member_count; ++i )
+	{
+		if( members_set & ( 1ULL << i ) )
+			continue;
+
+		const dl_member_desc* member = dl_get_type_member( dl_ctx, type, i );
+		if( member->default_value_offset != UINT32_MAX && member->default_value_size != member->size[DL_PTR_SIZE_HOST] )
+			dl_txt_pack_write_default_value( dl_ctx, packctx, member, instance_pos + member->offset[DL_PTR_SIZE_HOST] );
 	}
 }
 
@@ -883,17 +942,26 @@ static void dl_txt_pack_member( dl_ctx_t dl_ctx, dl_txt_pack_ctx* packctx, size_
 						const dl_type_desc* sub_type = dl_internal_find_type(dl_ctx, member->type_id);
 
 						// fill missing elements with defaults!
+						uint32_t template_flags = 0;
+						const uint8_t* default_template = dl_internal_type_default_template( dl_ctx, sub_type, &template_flags );
 						size_t current_member_array_position = member_pos + sub_type->size[DL_PTR_SIZE_HOST] * array_length;
 						for(uint32_t i = array_length; i < member->inline_array_cnt(); ++i)
 						{
-							// TODO: this seek/set dance will only be needed if type has subptrs, optimize by making different code-paths?
 							dl_binary_writer_seek_set( packctx->writer, current_member_array_position);
 
-							// TODO: replace with flag DL_FULL_TYPE_DEFAULT saying that all members has default-values.
-							for(uint32_t sub_member_i = 0; sub_member_i < sub_type->member_count; ++sub_member_i)
+							if( default_template )
+							{
+								dl_binary_writer_write( packctx->writer, default_template, sub_type->size[DL_PTR_SIZE_HOST] );
+								if( template_flags & DL_DEFAULT_TEMPLATE_FLAG_HAS_SUBDATA )
+									dl_txt_pack_write_subdata_defaults( dl_ctx, packctx, sub_type, current_member_array_position, 0 );
+							}
+							else
 							{
-								const dl_member_desc* sub_member = dl_get_type_member(dl_ctx, sub_type, sub_member_i);
-								dl_txt_pack_write_default_value(dl_ctx, packctx, sub_member, current_member_array_position + sub_member->offset[DL_PTR_SIZE_HOST]);
+								for(uint32_t sub_member_i = 0; sub_member_i < sub_type->member_count; ++sub_member_i)
+								{
+									const dl_member_desc* sub_member = dl_get_type_member(dl_ctx, sub_type, sub_member_i);
+									dl_txt_pack_write_default_value(dl_ctx, packctx, sub_member, current_member_array_position + sub_member->offset[DL_PTR_SIZE_HOST]);
+								}
 							}
  							current_member_array_position += sub_type->size[DL_PTR_SIZE_HOST];
 						}
@@ -1013,6 +1081,71 @@ static const dl_txt_read_substr dl_txt_eat_object_key( dl_txt_read_ctx* readctx
 	return res;
 }
 
+/*
+	Reserve space for an instance of type at the current writer-position. If defaults are to be written the instance
+	start out as a copy of the default-template of the type so that only set members and defaults with subdata need to be
+	written member by member.
+*/
+static size_t dl_txt_pack_begin_struct( dl_ctx_t dl_ctx, dl_txt_pack_ctx* packctx, const dl_type_desc* type, dl_pack_flags_t pack_flags )
+{
+	size_t instance_pos = dl_binary_writer_tell( packctx->writer );
+	uint32_t template_flags = 0;
+	const uint8_t* default_template = 0x0;
+	if( ( pack_flags & DL_PACKFLAGS_NO_DEFAULTS ) == 0 )
+		default_template = dl_internal_type_default_template( dl_ctx, type, &template_flags );
+
+	if( default_template )
+	{
+		dl_binary_writer_write( packctx->writer, default_template, type->size[DL_PTR_SIZE_HOST] );
+		dl_binary_writer_seek_set( packctx->writer, instance_pos );
+	}
+	dl_binary_writer_reserve( packctx->writer, type->size[DL_PTR_SIZE_HOST] );
+	return instance_pos;
+}
+
+/*
+	Write default-values for all members of the struct at instance_pos not set in members_set, fails if any of them has
+	no default-value.
+*/
+static void dl_txt_pack_write_missing_defaults( dl_ctx_t dl_ctx, dl_txt_pack_ctx* packctx, const dl_type_desc* type, size_t instance_pos, uint64_t members_set, dl_pack_flags_t pack_flags )
+{
+	if( pack_flags & DL_PACKFLAGS_NO_DEFAULTS )
+		return;
+
+	uint32_t template_flags = 0;
+	const uint8_t* default_template = dl_internal_type_default_template( dl_ctx, type, &template_flags );
+	if( default_template )
+	{
+		if( ( template_flags & DL_DEFAULT_TEMPLATE_FLAG_ALL_MEMBERS_DEFAULTED ) == 0 )
+		{
+			for( uint32_t i = 0; i < type->member_count; ++i )
+			{
+				const dl_member_desc* member = dl_get_type_member( dl_ctx, type, i );
+				if( ( members_set & ( 1ULL << i ) ) == 0 && member->default_value_offset == UINT32_MAX )
+					dl_txt_read_failed( dl_ctx, &packctx->read_ctx, DL_ERROR_TXT_MISSING_MEMBER, "member %s.%s is not set and has no default value", dl_internal_type_name( dl_ctx, type ), dl_internal_member_name( dl_ctx, member ) );
+			}
+		}
+
+		if( template_flags & DL_DEFAULT_TEMPLATE_FLAG_HAS_SUBDATA )
+			dl_txt_pack_write_subdata_defaults( dl_ctx, packctx, type, instance_pos, members_set );
+	}
+	else
+	{
+		for( uint32_t i = 0; i < type->member_count; ++i )
+		{
+			if( members_set & ( 1ULL << i ) )
+				continue;
+
+			const dl_member_desc* member = dl_get_type_member( dl_ctx, type, i );
+			if( member->default_value_offset == UINT32_MAX )
+				dl_txt_read_failed( dl_ctx, &packctx->read_ctx, DL_ERROR_TXT_MISSING_MEMBER, "member %s.%s is not set and has no default value", dl_internal_type_name( dl_ctx, type ), dl_internal_member_name( dl_ctx, member ) );
+
+			size_t   member_pos = instance_pos + member->offset[DL_PTR_SIZE_HOST];
+			dl_txt_pack_write_default_value(dl_ctx, packctx, member, member_pos);
+		}
+	}
+}
+
 static void dl_txt_pack_eat_and_write_struct( dl_ctx_t dl_ctx, dl_txt_pack_ctx* packctx, const dl_type_desc* type, dl_pack_flags_t pack_flags )
 {
 	uint64_t members_set = 0;
@@ -1030,8 +1163,7 @@ static void dl_txt_pack_eat_and_write_struct( dl_ctx_t dl_ctx, dl_txt_pack_ctx*
 	dl_txt_eat_char( dl_ctx, &packctx->read_ctx, '{' );
 
 	// ... reserve space for the type ...
-	size_t instance_pos = dl_binary_writer_tell( packctx->writer );
-	dl_binary_writer_reserve( packctx->writer, type->size[DL_PTR_SIZE_HOST] );
+	size_t instance_pos = dl_txt_pack_begin_struct( dl_ctx, packctx, type, pack_flags );
 
 	while( true )
 	{
@@ -1099,26 +1231,18 @@ static void dl_txt_pack_eat_and_write_struct( dl_ctx_t dl_ctx, dl_txt_pack_ctx*
 		dl_binary_writer_seek_set( packctx->writer, instance_pos + type_offset );
 		dl_binary_writer_write_uint32( packctx->writer, dl_internal_typeid_of(dl_ctx, type) + member_index + 1 );
 	}
-	else if( ( pack_flags & DL_PACKFLAGS_NO_DEFAULTS ) == 0 )
-	{
-		for( uint32_t i = 0; i < type->member_count; ++i )
-		{
-			if( members_set & ( 1ULL << i ) )
-				continue;
-
-			const dl_member_desc* member = dl_get_type_member( dl_ctx, type, i );
-			if( member->default_value_offset == UINT32_MAX )
-				dl_txt_read_failed( dl_ctx, &packctx->read_ctx, DL_ERROR_TXT_MISSING_MEMBER, "member %s.%s is not set and has no default value", dl_internal_type_name( dl_ctx, type ), dl_internal_member_name( dl_ctx, member ) );
-
-			size_t   member_pos = instance_pos + member->offset[DL_PTR_SIZE_HOST];
-			dl_txt_pack_write_default_value(dl_ctx, packctx, member, member_pos);
-		}
-	}
+	else
+		dl_txt_pack_write_missing_defaults( dl_ctx, packctx, type, instance_pos, members_set, pack_flags );
 }
 
 static dl_error_t dl_txt_pack_finalize_subdata( dl_ctx_t dl_ctx, dl_txt_pack_ctx* packctx, dl_pack_flags_t pack_flags )
 {
-	if( packctx->subdata_count == 0 )
+	int layer_subdata_count = 0;
+	for( int i = 0; i < packctx->subdata_count; ++i )
+		if( packctx->subdata[i].layer == packctx->current_layer )
+			++layer_subdata_count;
+
+	if( layer_subdata_count == 0 )
 		return DL_ERROR_OK;
 	if( packctx->subdata_pos == 0x0 )
 		dl_txt_read_failed( dl_ctx, &packctx->read_ctx, DL_ERROR_TXT_MISSING_SECTION, "instance has pointers but no \"__subdata\"-member" );
@@ -1152,6 +1276,9 @@ static dl_error_t dl_txt_pack_finalize_subdata( dl_ctx_t dl_ctx, dl_txt_pack_ctx
 		int subdata_item = -1;
 		for( int i = 0; i < packctx->subdata_count; ++i )
 		{
+			if( packctx->subdata[i].layer != packctx->current_layer )
+				continue;
+
 			if( packctx->subdata[i].name.len != subdata_name.len )
 				continue;
 
@@ -1163,7 +1290,17 @@ static dl_error_t dl_txt_pack_finalize_subdata( dl_ctx_t dl_ctx, dl_txt_pack_ctx
 		}
 
 		if( subdata_item < 0 )
-			dl_txt_read_failed( dl_ctx, &packctx->read_ctx, DL_ERROR_MALFORMED_DATA, "non-used subdata." );
+		{
+			// ... when packing layers the members referencing subdata might have been overridden by a later layer ...
+			if( packctx->layers == 0x0 )
+				dl_txt_read_failed( dl_ctx, &packctx->read_ctx, DL_ERROR_MALFORMED_DATA, "non-used subdata." );
+
+			packctx->read_ctx.iter = dl_txt_skip_map( packctx->read_ctx.iter, packctx->read_ctx.end );
+			dl_txt_eat_white( &packctx->read_ctx );
+			if( packctx->read_ctx.iter[0] == ',' )
+				++packctx->read_ctx.iter;
+			continue;
+		}
 		const dl_type_desc* type = packctx->subdata[subdata_item].type;
 
 		dl_binary_writer_seek_end( packctx->writer );
@@ -1189,6 +1326,9 @@ static dl_error_t dl_txt_pack_finalize_subdata( dl_ctx_t dl_ctx, dl_txt_pack_ctx
 
 	for( int i = 0; i < packctx->subdata_count; ++i )
 	{
+		if( packctx->subdata[i].layer != packctx->current_layer )
+			continue;
+
 		bool found = false;
 		for( size_t j = 0; j < subinstances_count; ++j )
 		{
@@ -1210,6 +1350,25 @@ static dl_error_t dl_txt_pack_finalize_subdata( dl_ctx_t dl_ctx, dl_txt_pack_ctx
 	return DL_ERROR_OK;
 }
 
+static const dl_type_desc* dl_txt_pack_eat_root_type( dl_ctx_t dl_ctx, dl_txt_pack_ctx* packctx )
+{
+	// ... find first and only key, the type name of the type to pack ...
+	dl_txt_eat_white( &packctx->read_ctx );
+	dl_txt_read_substr root_type_name = dl_txt_eat_object_key( &packctx->read_ctx );
+	if( root_type_name.str == 0x0 )
+		dl_txt_read_failed( dl_ctx, &packctx->read_ctx, DL_ERROR_MALFORMED_DATA, "expected map-key with root type name" );
+
+	char type_name[1024] = {0}; // TODO: make a dl_internal_find_type_by_name() that take string name.
+	strncpy( type_name, root_type_name.str, (size_t)root_type_name.len );
+	const dl_type_desc* root_type = dl_internal_find_type_by_name( dl_ctx, type_name );
+	if( root_type == 0x0 )
+	{
+		dl_txt_pack_validate_c_symbol_key(dl_ctx, packctx, root_type_name);
+		dl_txt_read_failed( dl_ctx, &packctx->read_ctx, DL_ERROR_TYPE_NOT_FOUND, "root type was set as \"%s\", but no such type was loaded.", type_name );
+	}
+	return root_type;
+}
+
 static const dl_type_desc* dl_txt_pack_inner( dl_ctx_t dl_ctx, dl_txt_pack_ctx* packctx, dl_pack_flags_t pack_flags )
 {
 #if defined(_MSC_VER )
@@ -1224,20 +1383,7 @@ static const dl_type_desc* dl_txt_pack_inner( dl_ctx_t dl_ctx, dl_txt_pack_ctx*
 		// ... find open { for top map
 		dl_txt_eat_char( dl_ctx, &packctx->read_ctx, '{' );
 
-		// ... find first and only key, the type name of the type to pack ...
-		dl_txt_eat_white( &packctx->read_ctx );
-		dl_txt_read_substr root_type_name = dl_txt_eat_object_key( &packctx->read_ctx );
-		if( root_type_name.str == 0x0 )
-			dl_txt_read_failed( dl_ctx, &packctx->read_ctx, DL_ERROR_MALFORMED_DATA, "expected map-key with root type name" );
-
-		char type_name[1024] = {0}; // TODO: make a dl_internal_find_type_by_name() that take string name.
-		strncpy( type_name, root_type_name.str, (size_t)root_type_name.len );
-		const dl_type_desc* root_type = dl_internal_find_type_by_name( dl_ctx, type_name );
-		if( root_type == 0x0 )
-		{
-			dl_txt_pack_validate_c_symbol_key(dl_ctx, packctx, root_type_name);
-			dl_txt_read_failed( dl_ctx, &packctx->read_ctx, DL_ERROR_TYPE_NOT_FOUND, "root type was set as \"%s\", but no such type was loaded.", type_name );
-		}
+		const dl_type_desc* root_type = dl_txt_pack_eat_root_type( dl_ctx, packctx );
 
 		dl_txt_eat_char( dl_ctx, &packctx->read_ctx, ':' );
 		dl_txt_pack_eat_and_write_struct( dl_ctx, packctx, root_type, pack_flags );
@@ -1249,7 +1395,234 @@ static const dl_type_desc* dl_txt_pack_inner( dl_ctx_t dl_ctx, dl_txt_pack_ctx*
 	return 0x0;
 }
 
-dl_error_t dl_txt_pack( dl_ctx_t dl_ctx, const char* txt_instance, unsigned char* out_buffer, size_t out_buffer_size, size_t* produced_bytes, dl_pack_flags_t pack_flags )
+static void dl_txt_pack_switch_layer( dl_txt_pack_ctx* packctx, int layer, const char* iter )
+{
+	packctx->layers[packctx->current_layer].subdata_pos = packctx->subdata_pos;
+	packctx->current_layer  = layer;
+	packctx->subdata_pos    = packctx->layers[layer].subdata_pos;
+	packctx->read_ctx.start = packctx->layers[layer].start;
+	packctx->read_ctx.end   = packctx->layers[layer].end;
+	packctx->read_ctx.iter  = iter;
+}
+
+/*
+	Read the next member-name in a struct-map of the current layer and leave the read-ctx at its value, returns false at
+	the end of the map.
+*/
+static bool dl_txt_pack_layer_next_member( dl_ctx_t dl_ctx, dl_txt_pack_ctx* packctx, dl_txt_read_substr* member_name )
+{
+	dl_txt_eat_white( &packctx->read_ctx );
+	if( *packctx->read_ctx.iter == ',' ) ++packctx->read_ctx.iter;
+	dl_txt_eat_white( &packctx->read_ctx );
+	if( *packctx->read_ctx.iter == '}' )
+		return false;
+
+	*member_name = dl_txt_eat_object_key( &packctx->read_ctx );
+	if( member_name->str == 0x0 )
+		dl_txt_read_failed( dl_ctx, &packctx->read_ctx, DL_ERROR_MALFORMED_DATA, "expected map-key containing member name." );
+
+	dl_txt_eat_char( dl_ctx, &packctx->read_ctx, ':' );
+	dl_txt_eat_white( &packctx->read_ctx );
+	return true;
+}
+
+static void dl_txt_pack_layer_skip_value( dl_ctx_t dl_ctx, dl_txt_pack_ctx* packctx )
+{
+	packctx->read_ctx.iter = dl_txt_skip_value( packctx->read_ctx.iter, packctx->read_ctx.end );
+	if( *packctx->read_ctx.iter == '\0' )
+		dl_txt_read_failed( dl_ctx, &packctx->read_ctx, DL_ERROR_TXT_PARSE_ERROR, "Invalid txt-format, are you missing an '}' or an ']'?" );
+}
+
+/*
+	Find the value of member member_index of type in the struct-map at map in layer, 0x0 if the member is not set there.
+	The map is expected to already have been validated by dl_txt_pack_write_struct_layers.
+*/
+static const char* dl_txt_pack_layer_find_member( dl_ctx_t dl_ctx, dl_txt_pack_ctx* packctx, int layer, const char* map, const dl_type_desc* type, uint32_t member_index )
+{
+	dl_txt_pack_switch_layer( packctx, layer, map );
+	dl_txt_eat_char( dl_ctx, &packctx->read_ctx, '{' );
+
+	dl_txt_read_substr member_name;
+	while( dl_txt_pack_layer_next_member( dl_ctx, packctx, &member_name ) )
+	{
+		if( member_name.str[0] != '_' || member_name.str[1] != '_' )
+		{
+			uint32_t member_name_hash = dl_internal_hash_buffer( (const uint8_t*)member_name.str, (size_t)member_name.len );
+			if( dl_internal_find_member( dl_ctx, type, member_name_hash ) == member_index )
+				return packctx->read_ctx.iter;
+		}
+		dl_txt_pack_layer_skip_value( dl_ctx, packctx );
+	}
+	return 0x0;
+}
+
+/*
+	Pack one instance of type from the struct-maps in layer_maps, one per layer or 0x0 if the layer do not set the
+	instance. Each member is packed from the last layer setting it, except for members that are structs set as maps in
+	several layers that are merged member by member in the same way.
+*/
+static void dl_txt_pack_write_struct_layers( dl_ctx_t dl_ctx, dl_txt_pack_ctx* packctx, const dl_type_desc* type, const char** layer_maps, dl_pack_flags_t pack_flags )
+{
+	if( type->flags & DL_TYPE_FLAG_IS_UNION )
+	{
+		// ... setting a member of a union replaces the entire union, so just use the last layer ...
+		for( int layer = packctx->layer_count - 1; layer >= 0; --layer )
+		{
+			if( layer_maps[layer] == 0x0 )
+				continue;
+			dl_txt_pack_switch_layer( packctx, layer, layer_maps[layer] );
+			dl_txt_pack_eat_and_write_struct( dl_ctx, packctx, type, pack_flags );
+			return;
+		}
+	}
+
+	int         member_layer[64];
+	const char* member_value[64];
+	if( type->member_count > DL_ARRAY_LENGTH( member_layer ) )
+		dl_txt_read_failed( dl_ctx, &packctx->read_ctx, DL_ERROR_UNSUPPORTED_OPERATION, "type %s has to many members to be packed from layers", dl_internal_type_name( dl_ctx, type ) );
+
+	size_t instance_pos = dl_txt_pack_begin_struct( dl_ctx, packctx, type, pack_flags );
+
+	// ... find what layer that sets each member ...
+	uint64_t members_set = 0;
+	for( int layer = 0; layer < packctx->layer_count; ++layer )
+	{
+		if( layer_maps[layer] == 0x0 )
+			continue;
+
+		dl_txt_pack_switch_layer( packctx, layer, layer_maps[layer] );
+		dl_txt_eat_char( dl_ctx, &packctx->read_ctx, '{' );
+
+		uint64_t layer_members_set = 0;
+		dl_txt_read_substr member_name;
+		while( dl_txt_pack_layer_next_member( dl_ctx, packctx, &member_name ) )
+		{
+			if( member_name.str[0] == '_' && member_name.str[1] == '_' )
+			{
+				if( strncmp( "__subdata", member_name.str, 9 ) != 0 )
+					dl_txt_read_failed( dl_ctx, &packctx->read_ctx, DL_ERROR_TXT_INVALID_MEMBER, "type %s has no member named %.*s", dl_internal_type_name( dl_ctx, type ), member_name.len, member_name.str );
+
+				if( packctx->subdata_pos )
+					dl_txt_read_failed( dl_ctx, &packctx->read_ctx, DL_ERROR_MALFORMED_DATA, "\"__subdata\" set twice!" );
+
+				packctx->subdata_pos = packctx->read_ctx.iter;
+				dl_txt_pack_layer_skip_value( dl_ctx, packctx );
+				continue;
+			}
+
+			uint32_t member_name_hash = dl_internal_hash_buffer( (const uint8_t*)member_name.str, (size_t)member_name.len );
+			uint32_t member_index = dl_internal_find_member( dl_ctx, type, member_name_hash );
+			if( member_index > type->member_count )
+			{
+				dl_txt_pack_validate_c_symbol_key(dl_ctx, packctx, member_name);
+				dl_txt_read_failed( dl_ctx, &packctx->read_ctx, DL_ERROR_TXT_INVALID_MEMBER, "type '%s' has no member named '%.*s'", dl_internal_type_name( dl_ctx, type ), member_name.len, member_name.str );
+			}
+
+			uint64_t member_bit = ( 1ULL << member_index );
+			if( member_bit & layer_members_set )
+				dl_txt_read_failed( dl_ctx, &packctx->read_ctx, DL_ERROR_TXT_MEMBER_SET_TWICE, "member '%s.%.*s' is set twice", dl_internal_type_name( dl_ctx, type ), member_name.len, member_name.str );
+			layer_members_set |= member_bit;
+
+			member_layer[member_index] = layer;
+			member_value[member_index] = packctx->read_ctx.iter;
+			dl_txt_pack_layer_skip_value( dl_ctx, packctx );
+		}
+		members_set |= layer_members_set;
+	}
+
+	// ... pack each member from the layer that set it last ...
+	for( uint32_t member_index = 0; member_index < type->member_count; ++member_index )
+	{
+		if( ( members_set & ( 1ULL << member_index ) ) == 0 )
+			continue;
+
+		const dl_member_desc* member = dl_get_type_member( dl_ctx, type, member_index );
+		int         layer = member_layer[member_index];
+		const char* value = member_value[member_index];
+
+		if( member->AtomType() == DL_TYPE_ATOM_POD && member->StorageType() == DL_TYPE_STORAGE_STRUCT && *value == '{' )
+		{
+			// ... collect the maps of this sub-struct from the layers below, a value that is not a map replace the
+			//     entire struct and stops the merge ...
+			const char* sub_maps[DL_TXT_PACK_MAX_LAYERS] = { 0x0 };
+			int sub_map_count = 1;
+			sub_maps[layer] = value;
+			for( int lower_layer = layer - 1; lower_layer >= 0; --lower_layer )
+			{
+				if( layer_maps[lower_layer] == 0x0 )
+					continue;
+				const char* lower_value = dl_txt_pack_layer_find_member( dl_ctx, packctx, lower_layer, layer_maps[lower_layer], type, member_index );
+				if( lower_value == 0x0 )
+					continue;
+				if( *lower_value != '{' )
+					break;
+				sub_maps[lower_layer] = lower_value;
+				++sub_map_count;
+			}
+
+			if( sub_map_count > 1 )
+			{
+				dl_binary_writer_seek_set( packctx->writer, instance_pos + member->offset[DL_PTR_SIZE_HOST] );
+				dl_txt_pack_write_struct_layers( dl_ctx, packctx, dl_internal_find_type( dl_ctx, member->type_id ), sub_maps, pack_flags );
+				continue;
+			}
+		}
+
+		dl_txt_pack_switch_layer( packctx, layer, value );
+		dl_txt_pack_member( dl_ctx, packctx, instance_pos, member, pack_flags );
+	}
+
+	dl_txt_pack_write_missing_defaults( dl_ctx, packctx, type, instance_pos, members_set, pack_flags );
+}
+
+static const dl_type_desc* dl_txt_pack_layers_inner( dl_ctx_t dl_ctx, dl_txt_pack_ctx* packctx, dl_pack_flags_t pack_flags )
+{
+#if defined(_MSC_VER )
+#pragma warning(push)
+#pragma warning(disable:4611)
+#endif
+	if( setjmp( packctx->read_ctx.jumpbuf ) == 0 )
+#if defined(_MSC_VER )
+#pragma warning(pop)
+#endif
+	{
+		// ... find the root-map of each layer, all layers need to have the same root type ...
+		const dl_type_desc* root_type = 0x0;
+		const char* root_maps[DL_TXT_PACK_MAX_LAYERS];
+		for( int layer = 0; layer < packctx->layer_count; ++layer )
+		{
+			dl_txt_pack_switch_layer( packctx, layer, packctx->layers[layer].start );
+			dl_txt_eat_char( dl_ctx, &packctx->read_ctx, '{' );
+
+			const dl_type_desc* layer_type = dl_txt_pack_eat_root_type( dl_ctx, packctx );
+			if( root_type != 0x0 && layer_type != root_type )
+				dl_txt_read_failed( dl_ctx, &packctx->read_ctx, DL_ERROR_TYPE_MISMATCH, "root type of layer %d is \"%s\" but previous layers has root type \"%s\"",
+									layer, dl_internal_type_name( dl_ctx, layer_type ), dl_internal_type_name( dl_ctx, root_type ) );
+			root_type = layer_type;
+
+			dl_txt_eat_char( dl_ctx, &packctx->read_ctx, ':' );
+			dl_txt_eat_white( &packctx->read_ctx );
+			if( *packctx->read_ctx.iter != '{' )
+				dl_txt_read_failed( dl_ctx, &packctx->read_ctx, DL_ERROR_TXT_PARSE_ERROR, "expected '{', the root instance of a layer need to be a map" );
+
+			root_maps[layer] = packctx->read_ctx.iter;
+			dl_txt_pack_layer_skip_value( dl_ctx, packctx );
+			dl_txt_eat_char( dl_ctx, &packctx->read_ctx, '}' );
+		}
+
+		dl_txt_pack_write_struct_layers( dl_ctx, packctx, root_type, root_maps, pack_flags );
+
+		for( int layer = 0; layer < packctx->layer_count; ++layer )
+		{
+			dl_txt_pack_switch_layer( packctx, layer, packctx->layers[layer].start );
+			dl_txt_pack_finalize_subdata( dl_ctx, packctx, pack_flags );
+		}
+		return root_type;
+	}
+	return 0x0;
+}
+
+static dl_error_t dl_txt_pack_internal( dl_ctx_t dl_ctx, const char** txt_layers, unsigned int layer_count, unsigned char* out_buffer, size_t out_buffer_size, size_t* produced_bytes, dl_pack_flags_t pack_flags )
 {
 	dl_binary_writer writer;
 	dl_binary_writer_init( &writer,
@@ -1261,19 +1634,36 @@ dl_error_t dl_txt_pack( dl_ctx_t dl_ctx, const char* txt_instance, unsigned char
 						   DL_PTR_SIZE_HOST );
 	dl_txt_pack_ctx packctx;
 	packctx.writer  = &writer;
-	packctx.read_ctx.start = txt_instance;
-	packctx.read_ctx.end   = txt_instance + strlen(txt_instance); // TODO: pass to function!
-	packctx.read_ctx.iter  = txt_instance;
+	packctx.read_ctx.start = txt_layers[0];
+	packctx.read_ctx.end   = txt_layers[0] + strlen(txt_layers[0]); // TODO: pass to function!
+	packctx.read_ctx.iter  = txt_layers[0];
 	packctx.subdata_pos = 0x0;
 	packctx.subdata_count = 0;
 	packctx.read_ctx.err = DL_ERROR_OK;
+	packctx.layers = 0x0;
+	packctx.layer_count = 1;
+	packctx.current_layer = 0;
+
+	dl_txt_pack_layer layers[DL_TXT_PACK_MAX_LAYERS];
+	if( layer_count > 1 )
+	{
+		for( unsigned int i = 0; i < layer_count; ++i )
+		{
+			layers[i].start       = txt_layers[i];
+			layers[i].end         = txt_layers[i] + strlen(txt_layers[i]);
+			layers[i].subdata_pos = 0x0;
+		}
+		packctx.layers      = layers;
+		packctx.layer_count = (int)layer_count;
+	}
 
 	if(pack_flags & DL_PACKFLAGS_IS_WRITING_TO_EXISTING_INSTANCE) {
 		dl_data_header *existing_header = (dl_data_header *)out_buffer;
-		writer.needed_size = existing_header->instance_size;
+		writer.needed_size = (size_t)dl_internal_header_instance_size( existing_header );
 	}
 
-	const dl_type_desc* root_type = dl_txt_pack_inner( dl_ctx, &packctx, pack_flags );
+	const dl_type_desc* root_type = packctx.layers ? dl_txt_pack_layers_inner( dl_ctx, &packctx, pack_flags )
+	                                               : dl_txt_pack_inner( dl_ctx, &packctx, pack_flags );
 	if( packctx.read_ctx.err == DL_ERROR_OK )
 	{
 		// write header
@@ -1282,15 +1672,14 @@ dl_error_t dl_txt_pack( dl_ctx_t dl_ctx, const char* txt_instance, unsigned char
 			dl_data_header header;
 			memset(&header, 0x0, sizeof(dl_data_header));
 			header.id                 = DL_INSTANCE_ID;
-			header.version            = DL_INSTANCE_VERSION;
 			header.root_instance_type = dl_internal_typeid_of( dl_ctx, root_type );
-			header.instance_size      = (uint32_t)dl_binary_writer_needed_size( &writer );
+			dl_internal_header_set_instance_size( &header, dl_binary_writer_needed_size( &writer ) );
 			header.is_64_bit_ptr      = sizeof(void*) == 8 ? 1 : 0;
 			memcpy( out_buffer, &header, sizeof(dl_data_header) );
 		}
 
 		if( produced_bytes )
-			*produced_bytes = (unsigned int)dl_binary_writer_needed_size( &writer ) + sizeof(dl_data_header);
+			*produced_bytes = dl_binary_writer_needed_size( &writer ) + sizeof(dl_data_header);
 
 	}
 	else
@@ -1300,6 +1689,18 @@ dl_error_t dl_txt_pack( dl_ctx_t dl_ctx, const char* txt_instance, unsigned char
 	return packctx.read_ctx.err;
 }
 
+dl_error_t dl_txt_pack( dl_ctx_t dl_ctx, const char* txt_instance, unsigned char* out_buffer, size_t out_buffer_size, size_t* produced_bytes, dl_pack_flags_t pack_flags )
+{
+	return dl_txt_pack_internal( dl_ctx, &txt_instance, 1, out_buffer, out_buffer_size, produced_bytes, pack_flags );
+}
+
+dl_error_t dl_txt_pack_layers( dl_ctx_t dl_ctx, const char** txt_layers, unsigned int layer_count, unsigned char* out_buffer, size_t out_buffer_size, size_t* produced_bytes, dl_pack_flags_t pack_flags )
+{
+	if( layer_count == 0 || layer_count > DL_TXT_PACK_MAX_LAYERS )
+		return DL_ERROR_INVALID_PARAMETER;
+	return dl_txt_pack_internal( dl_ctx, txt_layers, layer_count, out_buffer, out_buffer_size, produced_bytes, pack_flags );
+}
+
 dl_error_t dl_txt_pack_calc_size( dl_ctx_t dl_ctx, const char* txt_instance, size_t* out_instance_size, dl_pack_flags_t flags )
 {
 	return dl_txt_pack( dl_ctx, txt_instance, 0x0, 0, out_instance_size, flags );
@@ -313,11 +313,11 @@ static void dl_txt_unpack_array( dl_ctx_t dl_ctx,
 			const dl_type_desc* type = dl_internal_find_type( dl_ctx, tid );
 			for( uint32_t i = 0; i < array_count - 1; ++i )
 			{
-				dl_txt_unpack_struct( dl_ctx, unpack_ctx, writer, type, array_data + i * type->size[DL_PTR_SIZE_HOST] );
+				dl_txt_unpack_struct( dl_ctx, unpack_ctx, writer, type, array_data + (size_t)i * type->size[DL_PTR_SIZE_HOST] );
 				dl_binary_writer_write( writer, ", ", 2 );
 
 			}
-			dl_txt_unpack_struct( dl_ctx, unpack_ctx, writer, type, array_data + (array_count - 1) * type->size[DL_PTR_SIZE_HOST] );
+			dl_txt_unpack_struct( dl_ctx, unpack_ctx, writer, type, array_data + (size_t)(array_count - 1) * type->size[DL_PTR_SIZE_HOST] );
 			break;
 		}
 		case DL_TYPE_STORAGE_ENUM_INT8:
@@ -641,7 +641,7 @@ static void dl_txt_unpack_write_subdata( dl_ctx_t dl_ctx, dl_txt_unpack_ctx* unp
 							uint32_t  array_count  = *(uint32_t*)(member_data + sizeof(uintptr_t));
 							const uint8_t* array = unpack_ctx->packed_instance + array_offset;
 							for( uint32_t i = 0; i < array_count; ++i )
-								dl_txt_unpack_write_subdata( dl_ctx, unpack_ctx, writer, subtype, array + i * subtype->size[DL_PTR_SIZE_HOST] );
+								dl_txt_unpack_write_subdata( dl_ctx, unpack_ctx, writer, subtype, array + (size_t)i * subtype->size[DL_PTR_SIZE_HOST] );
 						}
 					}
 					/* fall through */
@@ -756,8 +756,18 @@ dl_error_t dl_txt_unpack( dl_ctx_t dl_ctx,                       dl_typeid_t typ
 	if( packed_instance_size < sizeof(dl_data_header) ) return DL_ERROR_MALFORMED_DATA;
 	if( header->id == DL_INSTANCE_ID_SWAPED )           return DL_ERROR_ENDIAN_MISMATCH;
 	if( header->id != DL_INSTANCE_ID )                  return DL_ERROR_MALFORMED_DATA;
-	if( header->version != DL_INSTANCE_VERSION)         return DL_ERROR_VERSION_MISMATCH;
+	if( !dl_internal_is_instance_version( header->version ) ) return DL_ERROR_VERSION_MISMATCH;
 	if( header->root_instance_type != type )            return DL_ERROR_TYPE_MISMATCH;
+	if( header->flags & DL_DATA_HEADER_FLAG_BATCH )     return DL_ERROR_UNSUPPORTED_OPERATION;
+	if( header->flags & DL_DATA_HEADER_FLAG_COMPRESSED ) return DL_ERROR_UNSUPPORTED_OPERATION;
+
+	const dl_type_desc* root_type = dl_internal_find_type( dl_ctx, header->root_instance_type );
+	if( root_type != 0x0 )
+	{
+		dl_error_t err = dl_internal_check_fingerprint( dl_ctx, root_type, header, packed_instance, packed_instance_size, false );
+		if( err != DL_ERROR_OK )
+			return err;
+	}
 
 	dl_binary_writer writer;
 	dl_binary_writer_init( &writer,
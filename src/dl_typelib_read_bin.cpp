@@ -176,5 +176,13 @@ dl_error_t dl_context_load_type_library( dl_ctx_t dl_ctx, const unsigned char* l
 	dl_ctx->enum_alias_capacity   = dl_ctx->enum_alias_count;
 	dl_ctx->typedata_strings_cap  = dl_ctx->typedata_strings_size;
 
-	return dl_internal_load_type_library_defaults( dl_ctx, lib_data + defaults_offset, header.default_value_size );
+	dl_error_t err = dl_internal_load_type_library_defaults( dl_ctx, lib_data + defaults_offset, header.default_value_size );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	err = dl_internal_update_type_fingerprints( dl_ctx );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	return dl_internal_update_type_default_templates( dl_ctx );
 }
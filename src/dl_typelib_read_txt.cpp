@@ -1244,6 +1244,12 @@ dl_error_t dl_context_load_txt_type_library( dl_ctx_t ctx, const char* lib_data,
 	read_state.err   = DL_ERROR_OK;
 
 	dl_context_load_txt_type_library_inner( ctx, &read_state );
+	if( read_state.err != DL_ERROR_OK )
+		return read_state.err;
 
-	return read_state.err;
+	dl_error_t err = dl_internal_update_type_fingerprints( ctx );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	return dl_internal_update_type_default_templates( ctx );
 }
@@ -49,6 +49,9 @@
 static const uint32_t DL_UNUSED DL_TYPELIB_VERSION         = 4; // format version for type-libraries.
 static const uint32_t DL_UNUSED DL_INSTANCE_VERSION        = 1; // format version for instances.
 static const uint32_t DL_UNUSED DL_INSTANCE_VERSION_SWAPED = dl_swap_endian_uint32( DL_INSTANCE_VERSION );
+static const uint32_t DL_UNUSED DL_INSTANCE_VERSION_LARGE  = 2; // format version for instances with instance-data larger than 4GB.
+static const uint32_t DL_UNUSED DL_INSTANCE_VERSION_LARGE_SWAPED = dl_swap_endian_uint32( DL_INSTANCE_VERSION_LARGE );
+static const uint64_t DL_UNUSED DL_INSTANCE_MAX_SIZE       = ( (uint64_t)1 << 48 ) - 1; // instance_size + instance_size_hi is 48 bits.
 static const uint32_t DL_UNUSED DL_TYPELIB_ID              = ('D'<< 24) | ('L' << 16) | ('T' << 8) | 'L';
 static const uint32_t DL_UNUSED DL_TYPELIB_ID_SWAPED       = dl_swap_endian_uint32( DL_TYPELIB_ID );
 static const uint32_t DL_UNUSED DL_INSTANCE_ID             = ('D'<< 24) | ('L' << 16) | ('D' << 8) | 'L';
@@ -101,6 +104,20 @@ struct dl_typelib_header
 	uint32_t typeinfo_strings_size;
 };
 
+/**
+ * Flags stored in dl_data_header::flags.
+ */
+enum dl_data_header_flags
+{
+	DL_DATA_HEADER_FLAG_SHARED_SUBDATA = 1 << 0, ///< the same array-data might be referenced by multiple members, patching need to keep track of patched arrays.
+	DL_DATA_HEADER_FLAG_BATCH          = 1 << 1, ///< data is a batch stored with dl_instance_store_batch, see dl_instance_load_batch.
+	DL_DATA_HEADER_FLAG_COMPRESSED     = 1 << 2, ///< data is compressed with dl_compress, instance_size is the size of the data when decompressed.
+	DL_DATA_HEADER_FLAG_CHECKSUM       = 1 << 3, ///< checksum holds the CRC32C of the, decompressed, instance-data.
+	DL_DATA_HEADER_FLAG_FINGERPRINT    = 1 << 4, ///< a uint32 layout-fingerprint of the root-type follows the instance-data, or the header if compressed.
+
+	DL_DATA_HEADER_FLAG_DEFAULT = 0,
+};
+
 struct dl_data_header
 {
 	uint32_t    id;
@@ -108,7 +125,9 @@ struct dl_data_header
 	dl_typeid_t root_instance_type;
 	uint32_t    instance_size;
 	uint8_t     is_64_bit_ptr; // currently uses uint8 instead of bitfield to be compiler-compliant.
-	uint8_t     pad[7];
+	uint8_t     flags;         // combination of dl_data_header_flags.
+	uint16_t    instance_size_hi; // bits 32-47 of the instance-size, only used by DL_INSTANCE_VERSION_LARGE.
+	uint32_t    checksum;      // CRC32C of the instance-data if DL_DATA_HEADER_FLAG_CHECKSUM is set, 0 otherwise.
 };
 
 enum dl_ptr_size_t
@@ -235,6 +254,25 @@ struct dl_type_desc
 
 };
 
+/**
+ * Flags describing the default-template of a type, see dl_type_default_template.
+ */
+enum dl_default_template_flags
+{
+	DL_DEFAULT_TEMPLATE_FLAG_ALL_MEMBERS_DEFAULTED = 1 << 0, ///< all members of the type has a default-value.
+	DL_DEFAULT_TEMPLATE_FLAG_HAS_SUBDATA           = 1 << 1, ///< at least one default-value has subdata and need to be written separately.
+};
+
+/**
+ * Host-ptr-size image of a type with all default-values applied, members without default-value are zero. Defaults with
+ * subdata are copied into the template as-is and need to be written with patching by whoever use the template.
+ */
+struct dl_type_default_template
+{
+	uint32_t offset; ///< offset into dl_context::default_template_data or UINT32_MAX if the type has no template.
+	uint32_t flags;  ///< combination of dl_default_template_flags.
+};
+
 struct dl_enum_value_desc
 {
 	uint32_t main_alias;
@@ -294,6 +332,12 @@ struct dl_context
 
 	uint8_t* default_data;
 	size_t   default_data_size;
+
+	uint32_t* type_fingerprints; ///< layout-fingerprint of each type in type_descs, see dl_internal_update_type_fingerprints.
+
+	dl_type_default_template* type_default_templates;      ///< default-template of the first type_default_template_count types in type_descs.
+	unsigned int              type_default_template_count;
+	uint8_t*                  default_template_data;
 };
 
 #if defined( __GNUC__ )
@@ -326,8 +370,127 @@ static inline bool dl_internal_is_align( const void* ptr, size_t alignment ) { r
 */
 inline unsigned int dl_bf_offset( dl_endian_t endian, unsigned int bf_size, unsigned int offset, unsigned int bits ) { return endian == DL_ENDIAN_LITTLE ? offset : ( bf_size * 8 ) - offset - bits; }
 
+/*
+	read the value of a bitfield-member from the storage of its bitfield in a host-layout instance.
+*/
+static inline uint64_t dl_internal_read_host_bitfield( const dl_member_desc* member, const uint8_t* data )
+{
+	uint32_t size    = member->size[DL_PTR_SIZE_HOST];
+	uint32_t bits    = member->bitfield_bits();
+	uint64_t storage = 0;
+	switch( size )
+	{
+		case 1: storage = *(const uint8_t*)data;  break;
+		case 2: storage = *(const uint16_t*)data; break;
+		case 4: storage = *(const uint32_t*)data; break;
+		case 8: storage = *(const uint64_t*)data; break;
+		default: DL_ASSERT( false && "This should not happen!" ); break;
+	}
+	return DL_EXTRACT_BITS( storage, uint64_t( dl_bf_offset( DL_ENDIAN_HOST, size, member->bitfield_offset(), bits ) ), uint64_t(bits) );
+}
+
 static inline dl_endian_t dl_other_endian( dl_endian_t endian ) { return endian == DL_ENDIAN_LITTLE ? DL_ENDIAN_BIG : DL_ENDIAN_LITTLE; }
 
+/*
+	move all bitfield-members in a bitfield-run from the bit-positions used by src_endian to the ones used by tgt_endian.
+	old_val and the returned value is expected to be in host endian.
+*/
+template<typename T>
+static inline T dl_internal_convert_bitfield_format( T old_val, const dl_member_desc* bf_members, uint32_t bf_members_count, dl_endian_t src_endian, dl_endian_t tgt_endian )
+{
+	T new_val = 0;
+
+	for( uint32_t i = 0; i < bf_members_count; ++i )
+	{
+		const dl_member_desc& bf_member = bf_members[i];
+
+		uint32_t bf_bits          = bf_member.bitfield_bits();
+		uint32_t bf_offset        = bf_member.bitfield_offset();
+		uint32_t bf_source_offset = dl_bf_offset( src_endian, sizeof(T), bf_offset, bf_bits );
+		uint32_t bf_target_offset = dl_bf_offset( tgt_endian, sizeof(T), bf_offset, bf_bits );
+
+		T extracted = (T)DL_EXTRACT_BITS( old_val, T(bf_source_offset), T(bf_bits) );
+		new_val     = (T)DL_INSERT_BITS ( new_val, extracted, T(bf_target_offset), T(bf_bits) );
+	}
+
+	return new_val;
+}
+
+static inline void dl_swap_header( dl_data_header* header )
+{
+	header->id                 = dl_swap_endian_uint32( header->id );
+	header->version            = dl_swap_endian_uint32( header->version );
+	header->root_instance_type = dl_swap_endian_uint32( header->root_instance_type );
+	header->instance_size      = dl_swap_endian_uint32( header->instance_size );
+	header->instance_size_hi   = dl_swap_endian_uint16( header->instance_size_hi );
+	header->checksum           = dl_swap_endian_uint32( header->checksum );
+}
+
+static inline bool dl_internal_is_instance_version( uint32_t version )
+{
+	return version == DL_INSTANCE_VERSION || version == DL_INSTANCE_VERSION_LARGE;
+}
+
+static inline bool dl_internal_is_instance_version_swaped( uint32_t version )
+{
+	return version == DL_INSTANCE_VERSION_SWAPED || version == DL_INSTANCE_VERSION_LARGE_SWAPED;
+}
+
+/**
+ * Size of the instance-data of a host-endian header.
+ */
+static inline uint64_t dl_internal_header_instance_size( const dl_data_header* header )
+{
+	if( header->version == DL_INSTANCE_VERSION_LARGE )
+		return (uint64_t)header->instance_size | ( (uint64_t)header->instance_size_hi << 32 );
+	return header->instance_size;
+}
+
+/**
+ * Set size of instance-data and the version needed to store it in a host-endian header. Instances that fit in 32 bits are
+ * still stored as DL_INSTANCE_VERSION so that they can be read by older versions of dl.
+ * Returns false if size do not fit in the header.
+ */
+static inline bool dl_internal_header_set_instance_size( dl_data_header* header, uint64_t size )
+{
+	if( size > DL_INSTANCE_MAX_SIZE )
+		return false;
+	header->version          = size > 0xFFFFFFFF ? DL_INSTANCE_VERSION_LARGE : DL_INSTANCE_VERSION;
+	header->instance_size    = (uint32_t)size;
+	header->instance_size_hi = (uint16_t)( size >> 32 );
+	return true;
+}
+
+/**
+ * Size of the layout-fingerprint stored with the instance, 0 if the instance has no fingerprint.
+ */
+static inline size_t dl_internal_header_fingerprint_size( const dl_data_header* header )
+{
+	return ( header->flags & DL_DATA_HEADER_FLAG_FINGERPRINT ) ? sizeof(uint32_t) : 0;
+}
+
+/**
+ * Offset from the start of the packed instance to the layout-fingerprint of a host-endian header. The fingerprint is
+ * stored after the instance-data so that readers that do not know about it can ignore it, compressed instances store
+ * it directly after the header so that it can be found without reading the block-table.
+ */
+static inline uint64_t dl_internal_header_fingerprint_offset( const dl_data_header* header )
+{
+	if( header->flags & DL_DATA_HEADER_FLAG_COMPRESSED )
+		return sizeof(dl_data_header);
+	return sizeof(dl_data_header) + dl_internal_header_instance_size( header );
+}
+
+static inline size_t dl_internal_ptr_size(dl_ptr_size_t size_enum)
+{
+	switch(size_enum)
+	{
+		case DL_PTR_SIZE_32BIT: return 4;
+		case DL_PTR_SIZE_64BIT: return 8;
+		default: DL_ASSERT(false, "unknown ptr size!"); return 0;
+	}
+}
+
 static inline const dl_type_desc* dl_internal_find_type(dl_ctx_t dl_ctx, dl_typeid_t type_id)
 {
 	// linear search right now!
@@ -403,6 +566,28 @@ static inline dl_typeid_t dl_internal_typeid_of( dl_ctx_t dl_ctx, const dl_type_
 	return dl_ctx->type_ids[ type - dl_ctx->type_descs ];
 }
 
+static inline uint32_t dl_internal_type_fingerprint( dl_ctx_t dl_ctx, const dl_type_desc* type )
+{
+	return dl_ctx->type_fingerprints[ type - dl_ctx->type_descs ];
+}
+
+/**
+ * Return the default-template of type or 0x0 if it has none, see dl_type_default_template.
+ */
+static inline const uint8_t* dl_internal_type_default_template( dl_ctx_t dl_ctx, const dl_type_desc* type, uint32_t* flags )
+{
+	unsigned int type_index = (unsigned int)( type - dl_ctx->type_descs );
+	if( type_index >= dl_ctx->type_default_template_count )
+		return 0x0;
+
+	const dl_type_default_template* tmpl = dl_ctx->type_default_templates + type_index;
+	if( tmpl->offset == UINT32_MAX )
+		return 0x0;
+
+	*flags = tmpl->flags;
+	return dl_ctx->default_template_data + tmpl->offset;
+}
+
 static inline const dl_enum_desc* dl_internal_find_enum( dl_ctx_t dl_ctx, dl_typeid_t type_id )
 {
 	for( unsigned int i = 0; i < dl_ctx->enum_count; ++i )
@@ -487,4 +672,51 @@ static inline bool dl_internal_find_enum_value( dl_ctx_t ctx, const dl_enum_desc
 	return false;
 }
 
+/**
+ * Decompress blocks of compressed instance-data. data points to the data after the dl_data_header and out_data to where the
+ * decompressed instance-data should be written, instance_size is the size from dl_internal_header_instance_size().
+ * block_count == 0xFFFFFFFF decompress all blocks from first_block. consumed is set to the size of the compressed data.
+ * Implemented in dl_compress.cpp.
+ */
+dl_error_t dl_internal_decompress_instance_data( const uint8_t* data,        size_t   data_size,   uint64_t instance_size, bool    swap,
+												 uint8_t*       out_data,    uint32_t first_block, uint32_t block_count,   size_t* consumed );
+
+/**
+ * Recalculate the layout-fingerprint of all types in the context, called each time a type-library has been loaded since
+ * types in the new library might be used by already loaded types.
+ * Implemented in dl_fingerprint.cpp.
+ */
+dl_error_t dl_internal_update_type_fingerprints( dl_ctx_t dl_ctx );
+
+/**
+ * Rebuild the default-template of all types in the context, called each time a type-library has been loaded.
+ * Implemented in dl_default_template.cpp.
+ */
+dl_error_t dl_internal_update_type_default_templates( dl_ctx_t dl_ctx );
+
+/**
+ * Check the layout-fingerprint stored with a packed instance, if any, against type. header is the host-endian version of
+ * the header of packed_instance and swap is true if packed_instance is not in host-endian.
+ * Returns DL_ERROR_TYPE_LAYOUT_MISMATCH if the instance was stored with another layout of type.
+ * Implemented in dl_fingerprint.cpp.
+ */
+dl_error_t dl_internal_check_fingerprint( dl_ctx_t dl_ctx, const dl_type_desc* type, const dl_data_header* header,
+										  const uint8_t* packed_instance, size_t packed_instance_size, bool swap );
+
+/**
+ * Parse the next step of a member-path, "name" or "name[index]" followed by '.' or the end of the path, as a member of
+ * type. *path is advanced to the next step, index is set to 0 for members that are not arrays.
+ * Returns DL_ERROR_INVALID_PARAMETER if the step is malformed or an array is not indexed, DL_ERROR_TYPE_MISMATCH if a
+ * member that is not an array is indexed and DL_ERROR_MEMBER_NOT_FOUND if there is no member with the name.
+ * Implemented in dl_path.cpp.
+ */
+dl_error_t dl_internal_parse_path_step( dl_ctx_t dl_ctx, const dl_type_desc* type, const char** path, unsigned int* member_index, unsigned int* index );
+
+/**
+ * Check if the host-layout of type has no padding, bitfields or members that are not compared bit by bit with
+ * hash_flags from dl_hash_flags_t, i.e. if instances of it can be hashed and compared as one block of memory.
+ * Implemented in dl_instance_hash.cpp.
+ */
+bool dl_internal_type_is_flat( dl_ctx_t dl_ctx, const dl_type_desc* type, unsigned int hash_flags );
+
 #endif // DL_DL_TYPES_H_INCLUDED
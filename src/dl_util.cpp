@@ -3,11 +3,24 @@
 #include <dl/dl_util.h>
 #include <dl/dl_txt.h>
 #include <dl/dl_convert.h>
+#include <dl/dl_compress.h>
 #include "dl_alloc.h"
 #include "dl_types.h"
+#include "dl_hash.h"
 
 #include <stdio.h>
 
+#if defined(_WIN32)
+#  define WIN32_LEAN_AND_MEAN
+#  include <windows.h>
+#  include <io.h>
+#else
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
 static unsigned char* dl_read_entire_stream( dl_allocator *allocator, FILE* file, size_t* out_size )
 {
 	const unsigned int CHUNK_SIZE = 1024;
@@ -87,6 +100,22 @@ dl_error_t dl_util_load_from_stream( dl_ctx_t dl_ctx,       	dl_typeid_t
 			if( type == 0 ) // autodetect filetype
 				type = info.root_type;
 
+			dl_compressed_info_t compressed_info;
+			error = dl_compressed_get_info( file_content, file_size, &compressed_info );
+			if( error != DL_ERROR_OK ) { dl_free( allocator, file_content ); return error; }
+
+			if( compressed_info.is_compressed )
+			{
+				unsigned char* decompressed = (unsigned char*)dl_alloc( allocator, compressed_info.decompressed_size );
+				if( decompressed == 0x0 ) { dl_free( allocator, file_content ); return DL_ERROR_OUT_OF_LIBRARY_MEMORY; }
+				error = dl_decompress( dl_ctx, file_content, file_size, decompressed, compressed_info.decompressed_size, 0x0 );
+				dl_free( allocator, file_content );
+				if( error != DL_ERROR_OK ) { dl_free( allocator, decompressed ); return error; }
+
+				file_content = decompressed;
+				file_size    = compressed_info.decompressed_size;
+			}
+
 			error = dl_convert( dl_ctx, type, file_content, file_size, 0x0, 0, DL_ENDIAN_HOST, sizeof(void*), &load_size );
 
 			if( error != DL_ERROR_OK ) { dl_free( allocator, file_content ); return error; }
@@ -266,3 +295,942 @@ dl_error_t dl_util_store_to_stream( dl_ctx_t    dl_ctx,     dl_typeid_t
 
 	return error;
 }
+
+static const uint32_t DL_UTIL_STREAM_ID               = ('D'<< 24) | ('L' << 16) | ('S' << 8) | 'T';
+static const uint32_t DL_UTIL_STREAM_ID_SWAPED        = dl_swap_endian_uint32( DL_UTIL_STREAM_ID );
+static const uint32_t DL_UTIL_STREAM_VERSION          = 1;
+static const size_t   DL_UTIL_STREAM_ALIGNMENT        = 16; // alignment of each record and of the instance-data of each packed instance in stream.
+static const size_t   DL_UTIL_STREAM_WRITER_BUFFER_SIZE = 64 * 1024;
+
+struct dl_util_stream_header
+{
+	uint32_t id;
+	uint32_t version;
+	uint32_t pad[2]; // first record is DL_UTIL_STREAM_ALIGNMENT aligned.
+};
+
+struct dl_util_stream_record_header
+{
+	uint32_t size; // size of packed instance, excluding padding.
+	uint32_t type; // root-type of packed instance.
+};
+
+// each record starts aligned and the record-header and dl_data_header together are a multiple of the alignment,
+// so the instance-data of each packed instance is aligned as well and can be loaded inplace.
+static inline size_t dl_internal_stream_record_size( size_t packed_size )
+{
+	return dl_internal_align_up( sizeof(dl_util_stream_record_header) + packed_size, DL_UTIL_STREAM_ALIGNMENT );
+}
+
+static int dl_internal_file_datasync( FILE* file )
+{
+#if defined(_WIN32)
+	return _commit( _fileno( file ) );
+#elif defined(__APPLE__)
+	return fsync( fileno( file ) );
+#else
+	return fdatasync( fileno( file ) );
+#endif
+}
+
+/*
+	A file mapped to memory copy-on-write so that packed instances in it can be loaded inplace without
+	modifying the file.
+*/
+struct dl_internal_mapped_file
+{
+	unsigned char* data;
+	size_t         size;
+#if defined(_WIN32)
+	HANDLE         file;
+	HANDLE         mapping;
+#endif
+};
+
+static void dl_internal_mapped_file_close( dl_internal_mapped_file* mf )
+{
+#if defined(_WIN32)
+	if( mf->data )    UnmapViewOfFile( mf->data );
+	if( mf->mapping ) CloseHandle( mf->mapping );
+	if( mf->file != INVALID_HANDLE_VALUE ) CloseHandle( mf->file );
+	mf->file    = INVALID_HANDLE_VALUE;
+	mf->mapping = 0x0;
+#else
+	if( mf->data )
+		munmap( mf->data, mf->size );
+#endif
+	mf->data = 0x0;
+}
+
+/*
+	Map filename, DL_ERROR_MALFORMED_DATA is returned if the file is smaller than min_size.
+	mf is always left in a state where it can be passed to dl_internal_mapped_file_close.
+*/
+static dl_error_t dl_internal_mapped_file_open( dl_internal_mapped_file* mf, const char* filename, size_t min_size )
+{
+	mf->data = 0x0;
+	mf->size = 0;
+#if defined(_WIN32)
+	mf->mapping = 0x0;
+	mf->file = CreateFileA( filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, 0x0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0x0 );
+	if( mf->file == INVALID_HANDLE_VALUE )
+		return DL_ERROR_UTIL_FILE_NOT_FOUND;
+
+	LARGE_INTEGER file_size;
+	if( !GetFileSizeEx( mf->file, &file_size ) )
+		return DL_ERROR_UTIL_IO_ERROR;
+	if( (size_t)file_size.QuadPart < min_size || file_size.QuadPart == 0 )
+		return DL_ERROR_MALFORMED_DATA;
+
+	mf->mapping = CreateFileMappingA( mf->file, 0x0, PAGE_WRITECOPY, 0, 0, 0x0 );
+	if( mf->mapping == 0x0 )
+		return DL_ERROR_UTIL_IO_ERROR;
+
+	mf->data = (unsigned char*)MapViewOfFile( mf->mapping, FILE_MAP_COPY, 0, 0, 0 );
+	if( mf->data == 0x0 )
+		return DL_ERROR_UTIL_IO_ERROR;
+	mf->size = (size_t)file_size.QuadPart;
+#else
+	int fd = open( filename, O_RDONLY );
+	if( fd < 0 )
+		return DL_ERROR_UTIL_FILE_NOT_FOUND;
+
+	struct stat st;
+	if( fstat( fd, &st ) != 0 )
+	{
+		close( fd );
+		return DL_ERROR_UTIL_IO_ERROR;
+	}
+
+	size_t size = (size_t)st.st_size;
+	if( size < min_size || size == 0 )
+	{
+		close( fd );
+		return DL_ERROR_MALFORMED_DATA;
+	}
+
+	void* data = mmap( 0x0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0 );
+	close( fd );
+	if( data == MAP_FAILED )
+		return DL_ERROR_UTIL_IO_ERROR;
+	mf->data = (unsigned char*)data;
+	mf->size = size;
+#endif
+	return DL_ERROR_OK;
+}
+
+struct dl_util_stream_writer
+{
+	dl_allocator   alloc;
+	FILE*          file;
+	unsigned char* buffer;
+	size_t         buffer_size;
+	size_t         buffer_used;
+	unsigned int   sync_interval;
+	unsigned int   unsynced_records;
+};
+
+dl_error_t dl_util_stream_writer_open( const char*   filename,  size_t buffer_size, unsigned int sync_interval,
+									   dl_allocator* allocator, dl_util_stream_writer_t* out_writer )
+{
+	dl_allocator mallocator;
+	if(allocator == 0x0) {
+		dl_allocator_initialize(&mallocator, 0x0, 0x0, 0x0, 0x0);
+		allocator = &mallocator;
+	}
+
+	if( buffer_size == 0 )
+		buffer_size = DL_UTIL_STREAM_WRITER_BUFFER_SIZE;
+	if( buffer_size < sizeof(dl_util_stream_header) )
+		return DL_ERROR_INVALID_PARAMETER;
+
+	// check that an existing file is a stream that can be appended to.
+	bool write_header = true;
+	FILE* existing = fopen( filename, "rb" );
+	if( existing != 0x0 )
+	{
+		dl_util_stream_header header;
+		size_t read = fread( &header, 1, sizeof(header), existing );
+		fclose( existing );
+
+		if( read != 0 )
+		{
+			if( read != sizeof(header) || ( header.id != DL_UTIL_STREAM_ID && header.id != DL_UTIL_STREAM_ID_SWAPED ) )
+				return DL_ERROR_MALFORMED_DATA;
+			if( header.id == DL_UTIL_STREAM_ID_SWAPED )
+				return DL_ERROR_ENDIAN_MISMATCH;
+			if( header.version != DL_UTIL_STREAM_VERSION )
+				return DL_ERROR_VERSION_MISMATCH;
+			write_header = false;
+		}
+	}
+
+	FILE* file = fopen( filename, "ab" );
+	if( file == 0x0 )
+		return DL_ERROR_UTIL_FILE_NOT_FOUND;
+
+	// all writes are buffered by the writer.
+	setvbuf( file, 0x0, _IONBF, 0 );
+
+	dl_util_stream_writer* writer = (dl_util_stream_writer*)dl_alloc( allocator, sizeof(dl_util_stream_writer) );
+	unsigned char*         buffer = (unsigned char*)dl_alloc( allocator, buffer_size );
+	if( writer == 0x0 || buffer == 0x0 )
+	{
+		if( writer ) dl_free( allocator, writer );
+		if( buffer ) dl_free( allocator, buffer );
+		fclose( file );
+		return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+	}
+
+	writer->alloc            = *allocator;
+	writer->file             = file;
+	writer->buffer           = buffer;
+	writer->buffer_size      = buffer_size;
+	writer->buffer_used      = 0;
+	writer->sync_interval    = sync_interval;
+	writer->unsynced_records = 0;
+
+	if( write_header )
+	{
+		dl_util_stream_header header = { DL_UTIL_STREAM_ID, DL_UTIL_STREAM_VERSION, { 0, 0 } };
+		memcpy( writer->buffer, &header, sizeof(header) );
+		writer->buffer_used = sizeof(header);
+	}
+
+	*out_writer = writer;
+	return DL_ERROR_OK;
+}
+
+static dl_error_t dl_internal_stream_writer_write_buffer( dl_util_stream_writer* writer )
+{
+	if( writer->buffer_used == 0 )
+		return DL_ERROR_OK;
+
+	size_t to_write = writer->buffer_used;
+	writer->buffer_used = 0;
+	return fwrite( writer->buffer, 1, to_write, writer->file ) == to_write ? DL_ERROR_OK : DL_ERROR_UTIL_IO_ERROR;
+}
+
+/*
+	Returns ptr to size bytes in the write-buffer, writing buffered data to file if needed.
+	0x0 is returned if size do not fit in the buffer at all.
+*/
+static unsigned char* dl_internal_stream_writer_reserve( dl_util_stream_writer* writer, size_t size, dl_error_t* err )
+{
+	*err = DL_ERROR_OK;
+	if( writer->buffer_used + size > writer->buffer_size )
+		*err = dl_internal_stream_writer_write_buffer( writer );
+
+	if( *err != DL_ERROR_OK || size > writer->buffer_size )
+		return 0x0;
+
+	unsigned char* res = writer->buffer + writer->buffer_used;
+	writer->buffer_used += size;
+	return res;
+}
+
+static dl_error_t dl_internal_stream_writer_record_done( dl_util_stream_writer* writer )
+{
+	++writer->unsynced_records;
+	if( writer->sync_interval != 0 && writer->unsynced_records >= writer->sync_interval )
+		return dl_util_stream_writer_flush( writer );
+	return DL_ERROR_OK;
+}
+
+static dl_error_t dl_internal_stream_writer_append( dl_util_stream_writer* writer, dl_typeid_t type, const unsigned char* packed_instance, size_t packed_instance_size )
+{
+	static const unsigned char PADDING[DL_UTIL_STREAM_ALIGNMENT] = { 0 };
+
+	dl_util_stream_record_header record = { (uint32_t)packed_instance_size, type };
+	size_t record_size  = dl_internal_stream_record_size( packed_instance_size );
+	size_t padding_size = record_size - sizeof(record) - packed_instance_size;
+
+	dl_error_t err;
+	unsigned char* dst = dl_internal_stream_writer_reserve( writer, record_size, &err );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	if( dst != 0x0 )
+	{
+		memcpy( dst, &record, sizeof(record) );
+		memcpy( dst + sizeof(record), packed_instance, packed_instance_size );
+		memset( dst + sizeof(record) + packed_instance_size, 0x0, padding_size );
+	}
+	else
+	{
+		// record is bigger than the buffer, write it directly to file.
+		if( fwrite( &record, 1, sizeof(record), writer->file ) != sizeof(record) ||
+			fwrite( packed_instance, 1, packed_instance_size, writer->file ) != packed_instance_size ||
+			fwrite( PADDING, 1, padding_size, writer->file ) != padding_size )
+			return DL_ERROR_UTIL_IO_ERROR;
+	}
+
+	return dl_internal_stream_writer_record_done( writer );
+}
+
+dl_error_t dl_util_stream_writer_append( dl_util_stream_writer_t writer, const unsigned char* packed_instance, size_t packed_instance_size )
+{
+	if( packed_instance_size < sizeof(dl_data_header) || packed_instance_size > 0xFFFFFFFF )
+		return DL_ERROR_MALFORMED_DATA;
+
+	dl_instance_info_t info;
+	dl_error_t err = dl_instance_get_info( packed_instance, packed_instance_size, &info );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	return dl_internal_stream_writer_append( writer, info.root_type, packed_instance, packed_instance_size );
+}
+
+dl_error_t dl_util_stream_writer_append_instance( dl_util_stream_writer_t writer, dl_ctx_t dl_ctx, dl_typeid_t type, const void* instance )
+{
+	size_t packed_size = 0;
+	dl_error_t err = dl_instance_store( dl_ctx, type, instance, 0x0, 0, &packed_size );
+	if( err != DL_ERROR_OK )
+		return err;
+	if( packed_size > 0xFFFFFFFF ) // record-size is stored in 32 bits.
+		return DL_ERROR_UNSUPPORTED_OPERATION;
+
+	size_t record_size = dl_internal_stream_record_size( packed_size );
+	if( record_size > writer->buffer_size )
+	{
+		unsigned char* packed = (unsigned char*)dl_alloc( &writer->alloc, packed_size );
+		if( packed == 0x0 )
+			return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+
+		err = dl_instance_store( dl_ctx, type, instance, packed, packed_size, 0x0 );
+		if( err == DL_ERROR_OK )
+			err = dl_internal_stream_writer_append( writer, type, packed, packed_size );
+		dl_free( &writer->alloc, packed );
+		return err;
+	}
+
+	// store directly into the write-buffer.
+	unsigned char* dst = dl_internal_stream_writer_reserve( writer, record_size, &err );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	err = dl_instance_store( dl_ctx, type, instance, dst + sizeof(dl_util_stream_record_header), packed_size, 0x0 );
+	if( err != DL_ERROR_OK )
+	{
+		writer->buffer_used -= record_size;
+		return err;
+	}
+
+	dl_util_stream_record_header record = { (uint32_t)packed_size, type };
+	memcpy( dst, &record, sizeof(record) );
+	memset( dst + sizeof(record) + packed_size, 0x0, record_size - sizeof(record) - packed_size );
+
+	return dl_internal_stream_writer_record_done( writer );
+}
+
+dl_error_t dl_util_stream_writer_flush( dl_util_stream_writer_t writer )
+{
+	dl_error_t err = dl_internal_stream_writer_write_buffer( writer );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	writer->unsynced_records = 0;
+	if( fflush( writer->file ) != 0 || dl_internal_file_datasync( writer->file ) != 0 )
+		return DL_ERROR_UTIL_IO_ERROR;
+	return DL_ERROR_OK;
+}
+
+dl_error_t dl_util_stream_writer_close( dl_util_stream_writer_t writer )
+{
+	dl_error_t err = dl_util_stream_writer_flush( writer );
+	if( fclose( writer->file ) != 0 && err == DL_ERROR_OK )
+		err = DL_ERROR_UTIL_IO_ERROR;
+
+	dl_allocator alloc = writer->alloc;
+	dl_free( &alloc, writer->buffer );
+	dl_free( &alloc, writer );
+	return err;
+}
+
+struct dl_util_stream_reader
+{
+	dl_allocator   alloc;
+	unsigned char* data;
+	size_t         size;
+	bool           swap;
+
+	size_t         pos;    // position of next record to read.
+	size_t         record; // index of next record to read.
+
+	size_t*        index; // position of every index_interval:th record.
+	size_t         index_count;
+	size_t         index_interval;
+
+	dl_internal_mapped_file file;
+};
+
+/*
+	Read record-header at pos, returns DL_ERROR_UTIL_END_OF_STREAM if pos is at the end of the stream.
+*/
+static dl_error_t dl_internal_stream_reader_peek( dl_util_stream_reader* reader, size_t pos, dl_util_stream_record_header* out_record )
+{
+	if( pos == reader->size )
+		return DL_ERROR_UTIL_END_OF_STREAM;
+	if( reader->size - pos < sizeof(dl_util_stream_record_header) )
+		return DL_ERROR_MALFORMED_DATA;
+
+	memcpy( out_record, reader->data + pos, sizeof(dl_util_stream_record_header) );
+	if( reader->swap )
+	{
+		out_record->size = dl_swap_endian_uint32( out_record->size );
+		out_record->type = dl_swap_endian_uint32( out_record->type );
+	}
+
+	if( out_record->size < sizeof(dl_data_header) || reader->size - pos - sizeof(dl_util_stream_record_header) < out_record->size )
+		return DL_ERROR_MALFORMED_DATA;
+	return DL_ERROR_OK;
+}
+
+static inline size_t dl_internal_stream_reader_next_pos( dl_util_stream_reader* reader, size_t pos, const dl_util_stream_record_header* record )
+{
+	size_t next = pos + dl_internal_stream_record_size( record->size );
+	return next > reader->size ? reader->size : next; // allow a last record without padding.
+}
+
+dl_error_t dl_util_stream_reader_open( const char* filename, dl_allocator* allocator, dl_util_stream_reader_t* out_reader )
+{
+	dl_allocator mallocator;
+	if(allocator == 0x0) {
+		dl_allocator_initialize(&mallocator, 0x0, 0x0, 0x0, 0x0);
+		allocator = &mallocator;
+	}
+
+	dl_util_stream_reader* reader = (dl_util_stream_reader*)dl_alloc( allocator, sizeof(dl_util_stream_reader) );
+	if( reader == 0x0 )
+		return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+
+	memset( reader, 0x0, sizeof(dl_util_stream_reader) );
+	reader->alloc = *allocator;
+
+	dl_error_t err = dl_internal_mapped_file_open( &reader->file, filename, sizeof(dl_util_stream_header) );
+	if( err == DL_ERROR_OK )
+	{
+		reader->data = reader->file.data;
+		reader->size = reader->file.size;
+
+		dl_util_stream_header header;
+		memcpy( &header, reader->data, sizeof(header) );
+		reader->swap = header.id == DL_UTIL_STREAM_ID_SWAPED;
+
+		if( header.id != DL_UTIL_STREAM_ID && header.id != DL_UTIL_STREAM_ID_SWAPED )
+			err = DL_ERROR_MALFORMED_DATA;
+		else if( ( reader->swap ? dl_swap_endian_uint32( header.version ) : header.version ) != DL_UTIL_STREAM_VERSION )
+			err = DL_ERROR_VERSION_MISMATCH;
+	}
+
+	if( err != DL_ERROR_OK )
+	{
+		dl_internal_mapped_file_close( &reader->file );
+		dl_free( allocator, reader );
+		return err;
+	}
+
+	reader->pos = sizeof(dl_util_stream_header);
+	*out_reader = reader;
+	return DL_ERROR_OK;
+}
+
+dl_error_t dl_util_stream_reader_next( dl_util_stream_reader_t reader, dl_util_stream_record_t* out_record )
+{
+	dl_util_stream_record_header record;
+	dl_error_t err = dl_internal_stream_reader_peek( reader, reader->pos, &record );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	out_record->type                 = record.type;
+	out_record->packed_instance      = reader->data + reader->pos + sizeof(dl_util_stream_record_header);
+	out_record->packed_instance_size = record.size;
+	out_record->index                = reader->record;
+
+	reader->pos = dl_internal_stream_reader_next_pos( reader, reader->pos, &record );
+	++reader->record;
+	return DL_ERROR_OK;
+}
+
+dl_error_t dl_util_stream_reader_build_index( dl_util_stream_reader_t reader, unsigned int interval )
+{
+	if( interval == 0 )
+		return DL_ERROR_INVALID_PARAMETER;
+
+	size_t capacity = 0;
+	if( reader->index )
+		dl_free( &reader->alloc, reader->index );
+	reader->index          = 0x0;
+	reader->index_count    = 0;
+	reader->index_interval = interval;
+
+	size_t pos = sizeof(dl_util_stream_header);
+	for( size_t record_index = 0; ; ++record_index )
+	{
+		dl_util_stream_record_header record;
+		dl_error_t err = dl_internal_stream_reader_peek( reader, pos, &record );
+		if( err == DL_ERROR_UTIL_END_OF_STREAM )
+			return DL_ERROR_OK;
+		if( err != DL_ERROR_OK )
+			return err;
+
+		if( record_index % interval == 0 )
+		{
+			if( reader->index_count == capacity )
+			{
+				size_t new_capacity = capacity == 0 ? 64 : capacity * 2;
+				size_t* new_index = (size_t*)dl_realloc( &reader->alloc, reader->index, new_capacity * sizeof(size_t), capacity * sizeof(size_t) );
+				if( new_index == 0x0 )
+					return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+				reader->index = new_index;
+				capacity = new_capacity;
+			}
+			reader->index[reader->index_count++] = pos;
+		}
+
+		pos = dl_internal_stream_reader_next_pos( reader, pos, &record );
+	}
+}
+
+dl_error_t dl_util_stream_reader_seek( dl_util_stream_reader_t reader, size_t record_index )
+{
+	size_t pos    = sizeof(dl_util_stream_header);
+	size_t record = 0;
+
+	if( record_index >= reader->record )
+	{
+		pos    = reader->pos;
+		record = reader->record;
+	}
+
+	if( reader->index_count > 0 )
+	{
+		size_t slot = record_index / reader->index_interval;
+		if( slot >= reader->index_count )
+			slot = reader->index_count - 1;
+		if( slot * reader->index_interval > record )
+		{
+			pos    = reader->index[slot];
+			record = slot * reader->index_interval;
+		}
+	}
+
+	for( ; record < record_index; ++record )
+	{
+		dl_util_stream_record_header header;
+		dl_error_t err = dl_internal_stream_reader_peek( reader, pos, &header );
+		if( err != DL_ERROR_OK )
+			return err;
+		pos = dl_internal_stream_reader_next_pos( reader, pos, &header );
+	}
+
+	reader->pos    = pos;
+	reader->record = record;
+	return DL_ERROR_OK;
+}
+
+void dl_util_stream_reader_close( dl_util_stream_reader_t reader )
+{
+	dl_allocator alloc = reader->alloc;
+	dl_internal_mapped_file_close( &reader->file );
+	if( reader->index )
+		dl_free( &alloc, reader->index );
+	dl_free( &alloc, reader );
+}
+
+static const uint32_t DL_UTIL_ARCHIVE_ID         = ('D'<< 24) | ('L' << 16) | ('A' << 8) | 'R';
+static const uint32_t DL_UTIL_ARCHIVE_ID_SWAPED  = dl_swap_endian_uint32( DL_UTIL_ARCHIVE_ID );
+static const uint32_t DL_UTIL_ARCHIVE_VERSION    = 1;
+static const size_t   DL_UTIL_ARCHIVE_ALIGNMENT  = 16; // alignment of the instance-data of each packed instance in archive.
+static const uint32_t DL_UTIL_ARCHIVE_EMPTY_SLOT = 0xFFFFFFFF;
+
+/*
+	An archive is laid out as:
+		dl_util_archive_header
+		dl_util_archive_toc_entry[entry_count]
+		uint32_t[slot_count]  - hash-table on name_hash, each slot is an index into the toc or DL_UTIL_ARCHIVE_EMPTY_SLOT.
+		char[names_size]      - zero-terminated names.
+		packed instances, each placed so that the instance-data after its dl_data_header is aligned to
+		                      DL_UTIL_ARCHIVE_ALIGNMENT.
+*/
+struct dl_util_archive_header
+{
+	uint32_t id;
+	uint32_t version;
+	uint32_t entry_count;
+	uint32_t slot_count; // always a power of 2.
+	uint32_t names_size;
+	uint32_t pad;
+};
+
+struct dl_util_archive_toc_entry
+{
+	uint64_t offset; // offset of packed instance from start of file.
+	uint32_t size;
+	uint32_t type;
+	uint32_t name_hash;
+	uint32_t name_offset; // offset into name-table.
+};
+
+static inline uint32_t dl_internal_archive_hash_name( const char* name )
+{
+	return dl_internal_hash_buffer( (const uint8_t*)name, strlen( name ) );
+}
+
+static uint32_t dl_internal_archive_slot_count( uint32_t entry_count )
+{
+	uint32_t slot_count = 16;
+	while( slot_count < entry_count * 2 )
+		slot_count *= 2;
+	return slot_count;
+}
+
+// offset of the first packed instance written at or after pos, the instance is loaded inplace so its instance-data
+// is aligned and not the dl_data_header.
+static size_t dl_internal_archive_entry_offset( size_t pos )
+{
+	return dl_internal_align_up( pos + sizeof(dl_data_header), DL_UTIL_ARCHIVE_ALIGNMENT ) - sizeof(dl_data_header);
+}
+
+static bool dl_internal_write_padding( FILE* file, size_t* pos, size_t new_pos )
+{
+	static const unsigned char PADDING[DL_UTIL_ARCHIVE_ALIGNMENT] = { 0 };
+	size_t padding = new_pos - *pos;
+	*pos = new_pos;
+	return fwrite( PADDING, 1, padding, file ) == padding;
+}
+
+dl_error_t dl_util_archive_write( const char*           filename,
+								  const char**          names,
+								  const unsigned char** packed_instances,
+								  const size_t*         packed_instance_sizes,
+								  unsigned int          count,
+								  dl_endian_t           out_endian )
+{
+	dl_allocator alloc;
+	dl_allocator_initialize( &alloc, 0x0, 0x0, 0x0, 0x0 );
+
+	uint32_t slot_count = dl_internal_archive_slot_count( count );
+	size_t   names_size = 0;
+	for( unsigned int i = 0; i < count; ++i )
+		names_size += strlen( names[i] ) + 1;
+
+	dl_util_archive_toc_entry* toc   = (dl_util_archive_toc_entry*)dl_alloc( &alloc, sizeof(dl_util_archive_toc_entry) * ( count + 1 ) );
+	uint32_t*                  slots = (uint32_t*)dl_alloc( &alloc, sizeof(uint32_t) * slot_count );
+	if( toc == 0x0 || slots == 0x0 )
+	{
+		if( toc )   dl_free( &alloc, toc );
+		if( slots ) dl_free( &alloc, slots );
+		return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+	}
+	memset( slots, 0xFF, sizeof(uint32_t) * slot_count );
+
+	size_t     pos = sizeof(dl_util_archive_header) + sizeof(dl_util_archive_toc_entry) * count + sizeof(uint32_t) * slot_count + names_size;
+	size_t     name_offset = 0;
+	dl_error_t err = DL_ERROR_OK;
+	for( unsigned int i = 0; i < count && err == DL_ERROR_OK; ++i )
+	{
+		dl_instance_info_t info;
+		if( packed_instance_sizes[i] < sizeof(dl_data_header) || packed_instance_sizes[i] > 0xFFFFFFFF )
+			err = DL_ERROR_MALFORMED_DATA;
+		else
+			err = dl_instance_get_info( packed_instances[i], packed_instance_sizes[i], &info );
+		if( err != DL_ERROR_OK )
+			break;
+
+		dl_util_archive_toc_entry* entry = &toc[i];
+		entry->offset      = dl_internal_archive_entry_offset( pos );
+		entry->size        = (uint32_t)packed_instance_sizes[i];
+		entry->type        = info.root_type;
+		entry->name_hash   = dl_internal_archive_hash_name( names[i] );
+		entry->name_offset = (uint32_t)name_offset;
+
+		uint32_t slot = entry->name_hash & ( slot_count - 1 );
+		for( ; slots[slot] != DL_UTIL_ARCHIVE_EMPTY_SLOT; slot = ( slot + 1 ) & ( slot_count - 1 ) )
+		{
+			const dl_util_archive_toc_entry* other = &toc[slots[slot]];
+			if( other->name_hash == entry->name_hash && strcmp( names[slots[slot]], names[i] ) == 0 )
+				err = DL_ERROR_INVALID_PARAMETER; // name used twice!
+		}
+		slots[slot] = i;
+
+		pos = (size_t)entry->offset + entry->size;
+		name_offset += strlen( names[i] ) + 1;
+	}
+
+	FILE* file = 0x0;
+	if( err == DL_ERROR_OK )
+	{
+		file = fopen( filename, "wb" );
+		if( file == 0x0 )
+			err = DL_ERROR_UTIL_FILE_NOT_FOUND;
+	}
+
+	if( err == DL_ERROR_OK )
+	{
+		dl_util_archive_header header = { DL_UTIL_ARCHIVE_ID, DL_UTIL_ARCHIVE_VERSION, count, slot_count, (uint32_t)names_size, 0 };
+		if( out_endian != DL_ENDIAN_HOST )
+		{
+			header.id          = dl_swap_endian_uint32( header.id );
+			header.version     = dl_swap_endian_uint32( header.version );
+			header.entry_count = dl_swap_endian_uint32( header.entry_count );
+			header.slot_count  = dl_swap_endian_uint32( header.slot_count );
+			header.names_size  = dl_swap_endian_uint32( header.names_size );
+			for( unsigned int i = 0; i < count; ++i )
+			{
+				toc[i].offset      = dl_swap_endian_uint64( toc[i].offset );
+				toc[i].size        = dl_swap_endian_uint32( toc[i].size );
+				toc[i].type        = dl_swap_endian_uint32( toc[i].type );
+				toc[i].name_hash   = dl_swap_endian_uint32( toc[i].name_hash );
+				toc[i].name_offset = dl_swap_endian_uint32( toc[i].name_offset );
+			}
+			for( uint32_t i = 0; i < slot_count; ++i )
+				slots[i] = dl_swap_endian_uint32( slots[i] );
+		}
+
+		bool ok = fwrite( &header, 1, sizeof(header), file ) == sizeof(header) &&
+				  fwrite( toc, sizeof(dl_util_archive_toc_entry), count, file ) == count &&
+				  fwrite( slots, sizeof(uint32_t), slot_count, file ) == slot_count;
+
+		for( unsigned int i = 0; i < count && ok; ++i )
+			ok = fwrite( names[i], 1, strlen( names[i] ) + 1, file ) == strlen( names[i] ) + 1;
+
+		pos = sizeof(header) + sizeof(dl_util_archive_toc_entry) * count + sizeof(uint32_t) * slot_count + names_size;
+		for( unsigned int i = 0; i < count && ok; ++i )
+		{
+			ok = dl_internal_write_padding( file, &pos, dl_internal_archive_entry_offset( pos ) ) &&
+				 fwrite( packed_instances[i], 1, packed_instance_sizes[i], file ) == packed_instance_sizes[i];
+			pos += packed_instance_sizes[i];
+		}
+
+		if( fclose( file ) != 0 || !ok )
+			err = DL_ERROR_UTIL_IO_ERROR;
+	}
+
+	dl_free( &alloc, toc );
+	dl_free( &alloc, slots );
+	return err;
+}
+
+struct dl_util_archive
+{
+	dl_allocator                     alloc;
+	dl_internal_mapped_file          file;
+	bool                             swap;
+	uint32_t                         entry_count;
+	uint32_t                         slot_count;
+	const dl_util_archive_toc_entry* toc;
+	const uint32_t*                  slots;
+	const char*                      names;
+	void**                           loaded; // loaded instance for each entry, 0x0 if not loaded yet.
+};
+
+static inline uint32_t dl_internal_archive_u32( const dl_util_archive* archive, uint32_t value )
+{
+	return archive->swap ? dl_swap_endian_uint32( value ) : value;
+}
+
+static inline uint64_t dl_internal_archive_u64( const dl_util_archive* archive, uint64_t value )
+{
+	return archive->swap ? dl_swap_endian_uint64( value ) : value;
+}
+
+static dl_error_t dl_internal_archive_read_toc( dl_util_archive* archive )
+{
+	dl_util_archive_header header;
+	memcpy( &header, archive->file.data, sizeof(header) );
+	if( header.id != DL_UTIL_ARCHIVE_ID && header.id != DL_UTIL_ARCHIVE_ID_SWAPED )
+		return DL_ERROR_MALFORMED_DATA;
+
+	archive->swap = header.id == DL_UTIL_ARCHIVE_ID_SWAPED;
+	if( dl_internal_archive_u32( archive, header.version ) != DL_UTIL_ARCHIVE_VERSION )
+		return DL_ERROR_VERSION_MISMATCH;
+
+	archive->entry_count = dl_internal_archive_u32( archive, header.entry_count );
+	archive->slot_count  = dl_internal_archive_u32( archive, header.slot_count );
+	uint32_t names_size  = dl_internal_archive_u32( archive, header.names_size );
+
+	if( archive->slot_count == 0 || ( archive->slot_count & ( archive->slot_count - 1 ) ) != 0 || archive->slot_count < archive->entry_count )
+		return DL_ERROR_MALFORMED_DATA;
+
+	uint64_t toc_end = sizeof(dl_util_archive_header) + (uint64_t)sizeof(dl_util_archive_toc_entry) * archive->entry_count + (uint64_t)sizeof(uint32_t) * archive->slot_count + names_size;
+	if( toc_end > archive->file.size )
+		return DL_ERROR_MALFORMED_DATA;
+
+	archive->toc   = (const dl_util_archive_toc_entry*)( archive->file.data + sizeof(dl_util_archive_header) );
+	archive->slots = (const uint32_t*)( archive->toc + archive->entry_count );
+	archive->names = (const char*)( archive->slots + archive->slot_count );
+
+	if( archive->entry_count > 0 && ( names_size == 0 || archive->names[names_size - 1] != '\0' ) )
+		return DL_ERROR_MALFORMED_DATA;
+
+	for( uint32_t i = 0; i < archive->entry_count; ++i )
+	{
+		const dl_util_archive_toc_entry* entry = &archive->toc[i];
+		uint64_t offset = dl_internal_archive_u64( archive, entry->offset );
+		uint32_t size   = dl_internal_archive_u32( archive, entry->size );
+		if( offset < toc_end || ( offset + sizeof(dl_data_header) ) % DL_UTIL_ARCHIVE_ALIGNMENT != 0 ||
+			offset > archive->file.size || size > archive->file.size - offset ||
+			dl_internal_archive_u32( archive, entry->name_offset ) >= names_size )
+			return DL_ERROR_MALFORMED_DATA;
+	}
+
+	for( uint32_t i = 0; i < archive->slot_count; ++i )
+	{
+		uint32_t slot = dl_internal_archive_u32( archive, archive->slots[i] );
+		if( slot != DL_UTIL_ARCHIVE_EMPTY_SLOT && slot >= archive->entry_count )
+			return DL_ERROR_MALFORMED_DATA;
+	}
+
+	return DL_ERROR_OK;
+}
+
+dl_error_t dl_util_archive_open( const char* filename, dl_allocator* allocator, dl_util_archive_t* out_archive )
+{
+	dl_allocator mallocator;
+	if(allocator == 0x0) {
+		dl_allocator_initialize(&mallocator, 0x0, 0x0, 0x0, 0x0);
+		allocator = &mallocator;
+	}
+
+	dl_util_archive* archive = (dl_util_archive*)dl_alloc( allocator, sizeof(dl_util_archive) );
+	if( archive == 0x0 )
+		return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+
+	memset( archive, 0x0, sizeof(dl_util_archive) );
+	archive->alloc = *allocator;
+
+	dl_error_t err = dl_internal_mapped_file_open( &archive->file, filename, sizeof(dl_util_archive_header) );
+	if( err == DL_ERROR_OK )
+		err = dl_internal_archive_read_toc( archive );
+
+	if( err == DL_ERROR_OK && archive->entry_count > 0 )
+	{
+		archive->loaded = (void**)dl_alloc( allocator, sizeof(void*) * archive->entry_count );
+		if( archive->loaded == 0x0 )
+			err = DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+		else
+			memset( archive->loaded, 0x0, sizeof(void*) * archive->entry_count );
+	}
+
+	if( err != DL_ERROR_OK )
+	{
+		dl_internal_mapped_file_close( &archive->file );
+		dl_free( allocator, archive );
+		return err;
+	}
+
+	*out_archive = archive;
+	return DL_ERROR_OK;
+}
+
+static uint32_t dl_internal_archive_find( dl_util_archive* archive, const char* name )
+{
+	uint32_t hash = dl_internal_archive_hash_name( name );
+	uint32_t mask = archive->slot_count - 1;
+
+	// slot_count > entry_count is guaranteed by the writer, but an archive with a full table must not loop forever.
+	for( uint32_t probe = 0, slot = hash & mask; probe < archive->slot_count; ++probe, slot = ( slot + 1 ) & mask )
+	{
+		uint32_t index = dl_internal_archive_u32( archive, archive->slots[slot] );
+		if( index == DL_UTIL_ARCHIVE_EMPTY_SLOT )
+			break;
+
+		const dl_util_archive_toc_entry* entry = &archive->toc[index];
+		if( dl_internal_archive_u32( archive, entry->name_hash ) == hash &&
+			strcmp( archive->names + dl_internal_archive_u32( archive, entry->name_offset ), name ) == 0 )
+			return index;
+	}
+	return DL_UTIL_ARCHIVE_EMPTY_SLOT;
+}
+
+dl_error_t dl_util_archive_load( dl_ctx_t          dl_ctx,
+								 dl_util_archive_t archive,
+								 dl_typeid_t       type,
+								 const char*       name,
+								 void**            out_instance,
+								 dl_typeid_t*      out_type )
+{
+	uint32_t index = dl_internal_archive_find( archive, name );
+	if( index == DL_UTIL_ARCHIVE_EMPTY_SLOT )
+		return DL_ERROR_UTIL_FILE_NOT_FOUND;
+
+	const dl_util_archive_toc_entry* entry = &archive->toc[index];
+	dl_typeid_t entry_type = dl_internal_archive_u32( archive, entry->type );
+	if( type != 0 && type != entry_type )
+		return DL_ERROR_TYPE_MISMATCH;
+
+	if( archive->loaded[index] == 0x0 )
+	{
+		unsigned char* packed = archive->file.data + dl_internal_archive_u64( archive, entry->offset );
+		size_t         size   = dl_internal_archive_u32( archive, entry->size );
+
+		dl_compressed_info_t compressed_info;
+		dl_error_t err = dl_compressed_get_info( packed, size, &compressed_info );
+		if( err != DL_ERROR_OK )
+			return err;
+
+		if( compressed_info.is_compressed )
+		{
+			// compressed entries can not be loaded inplace, decompress to a separate buffer owned by the archive.
+			size_t instance_size = compressed_info.decompressed_size - sizeof(dl_data_header);
+			void*  instance      = dl_alloc( &archive->alloc, instance_size == 0 ? 1 : instance_size );
+			if( instance == 0x0 )
+				return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+
+			err = dl_instance_load( dl_ctx, entry_type, instance, instance_size, packed, size, 0x0 );
+			if( err != DL_ERROR_OK )
+			{
+				dl_free( &archive->alloc, instance );
+				return err;
+			}
+			archive->loaded[index] = instance;
+		}
+		else
+		{
+			err = dl_instance_load_inplace( dl_ctx, entry_type, packed, size, &archive->loaded[index], 0x0 );
+			if( err != DL_ERROR_OK )
+				return err;
+		}
+	}
+
+	*out_instance = archive->loaded[index];
+	if( out_type != 0x0 )
+		*out_type = entry_type;
+	return DL_ERROR_OK;
+}
+
+unsigned int dl_util_archive_entry_count( dl_util_archive_t archive )
+{
+	return archive->entry_count;
+}
+
+dl_error_t dl_util_archive_get_entry( dl_util_archive_t archive, unsigned int index, dl_util_archive_entry_t* out_entry )
+{
+	if( index >= archive->entry_count )
+		return DL_ERROR_INVALID_PARAMETER;
+
+	const dl_util_archive_toc_entry* entry = &archive->toc[index];
+	out_entry->name                 = archive->names + dl_internal_archive_u32( archive, entry->name_offset );
+	out_entry->type                 = dl_internal_archive_u32( archive, entry->type );
+	out_entry->packed_instance_size = dl_internal_archive_u32( archive, entry->size );
+	return DL_ERROR_OK;
+}
+
+void dl_util_archive_close( dl_util_archive_t archive )
+{
+	dl_allocator alloc = archive->alloc;
+
+	// instances loaded from compressed entries are the only ones outside of the mapped file.
+	for( uint32_t i = 0; i < archive->entry_count; ++i )
+	{
+		unsigned char* loaded = (unsigned char*)archive->loaded[i];
+		if( loaded != 0x0 && ( loaded < archive->file.data || loaded >= archive->file.data + archive->file.size ) )
+			dl_free( &alloc, loaded );
+	}
+
+	dl_internal_mapped_file_close( &archive->file );
+	if( archive->loaded )
+		dl_free( &alloc, archive->loaded );
+	dl_free( &alloc, archive );
+}
@@ -1,6 +1,8 @@
 #include <gtest/gtest.h>
 #include "dl_tests_base.h"
 
+#include <dl/dl_convert.h>
+
 TYPED_TEST(DLBase, array_pod1)
 {
 	uint32_t array_data[8] = { 1337, 7331, 13, 37, 133, 7, 1, 337 } ;
@@ -196,6 +198,108 @@ TYPED_TEST(DLBase, big_array_complex_test)
 	free(loaded);
 }
 
+TEST_F(DL, array_same_memory_stored_once)
+{
+	const char* strs[] = { "cow", "bell" };
+	StringArray sub[] = { { { strs, DL_ARRAY_LENGTH( strs ) } },
+						  { { strs, DL_ARRAY_LENGTH( strs ) } },
+						  { { strs, 1 } } }; // same memory but other count is stored separately.
+	BugTest4 original = { { sub, DL_ARRAY_LENGTH( sub ) } };
+
+	unsigned char packed[1024];
+	size_t produced = 0;
+	EXPECT_DL_ERR_OK( dl_instance_store( Ctx, BugTest4::TYPE_ID, &original, packed, sizeof(packed), &produced ) );
+
+	BugTest4 loaded[32];
+	EXPECT_DL_ERR_OK( dl_instance_load( Ctx, BugTest4::TYPE_ID, loaded, sizeof(loaded), packed, produced, 0x0 ) );
+
+	EXPECT_EQ( 3u, loaded[0].struct_with_str_arr.count );
+	EXPECT_EQ( loaded[0].struct_with_str_arr[0].Strings.data, loaded[0].struct_with_str_arr[1].Strings.data );
+	EXPECT_NE( loaded[0].struct_with_str_arr[0].Strings.data, loaded[0].struct_with_str_arr[2].Strings.data );
+	EXPECT_STREQ( "cow",  loaded[0].struct_with_str_arr[1].Strings[0] );
+	EXPECT_STREQ( "bell", loaded[0].struct_with_str_arr[1].Strings[1] );
+	EXPECT_STREQ( "cow",  loaded[0].struct_with_str_arr[2].Strings[0] );
+
+	// strings are shared between the arrays as well.
+	EXPECT_EQ( loaded[0].struct_with_str_arr[0].Strings[0], loaded[0].struct_with_str_arr[2].Strings[0] );
+}
+
+TEST_F(DL, array_merge_identical_subdata)
+{
+	uint32_t arr1[]  = { 1, 3, 3, 7 };
+	uint32_t arr2[]  = { 7, 3, 3, 1 };
+	uint32_t arr1b[] = { 1, 3, 3, 7 };
+	PodArray1 sub[] = { { { arr1,  DL_ARRAY_LENGTH( arr1 ) } },
+						{ { arr2,  DL_ARRAY_LENGTH( arr2 ) } },
+						{ { arr1b, DL_ARRAY_LENGTH( arr1b ) } } };
+	PodArray2 original = { { sub, DL_ARRAY_LENGTH( sub ) } };
+
+	dl_store_params_t params;
+	DL_STORE_PARAMS_SET_DEFAULT( params );
+	params.flags = DL_STOREFLAGS_MERGE_IDENTICAL_SUBDATA;
+
+	size_t plain_size  = 0;
+	size_t merged_size = 0;
+	EXPECT_DL_ERR_OK( dl_instance_store_ex( Ctx, PodArray2::TYPE_ID, &original, 0x0, 0, &plain_size, 0x0 ) );
+	EXPECT_DL_ERR_OK( dl_instance_store_ex( Ctx, PodArray2::TYPE_ID, &original, 0x0, 0, &merged_size, &params ) );
+	EXPECT_EQ( plain_size - sizeof(arr1), merged_size );
+
+	unsigned char packed[1024];
+	size_t produced = 0;
+	EXPECT_DL_ERR_OK( dl_instance_store_ex( Ctx, PodArray2::TYPE_ID, &original, packed, sizeof(packed), &produced, &params ) );
+	EXPECT_EQ( merged_size, produced );
+
+	// shared arrays should stay shared when converting to other ptr-size and back.
+	unsigned char converted[1024];
+	size_t converted_size = 0;
+	EXPECT_DL_ERR_OK( dl_convert( Ctx, PodArray2::TYPE_ID, packed, produced, converted, sizeof(converted), DL_ENDIAN_HOST, sizeof(void*) == 8 ? 4 : 8, &converted_size ) );
+
+	unsigned char back[1024];
+	size_t back_size = 0;
+	EXPECT_DL_ERR_OK( dl_convert( Ctx, PodArray2::TYPE_ID, converted, converted_size, back, sizeof(back), DL_ENDIAN_HOST, sizeof(void*), &back_size ) );
+	EXPECT_EQ( produced, back_size );
+
+	// loading inplace patches the same buffer, shared data must only be patched once.
+	void* loaded_ptr = 0x0;
+	EXPECT_DL_ERR_OK( dl_instance_load_inplace( Ctx, PodArray2::TYPE_ID, back, back_size, &loaded_ptr, 0x0 ) );
+	PodArray2* loaded = (PodArray2*)loaded_ptr;
+
+	EXPECT_EQ( 3u, loaded->sub_arr.count );
+	EXPECT_ARRAY_EQ( DL_ARRAY_LENGTH( arr1 ), arr1, loaded->sub_arr[0].u32_arr.data );
+	EXPECT_ARRAY_EQ( DL_ARRAY_LENGTH( arr2 ), arr2, loaded->sub_arr[1].u32_arr.data );
+	EXPECT_EQ( loaded->sub_arr[0].u32_arr.data, loaded->sub_arr[2].u32_arr.data );
+	EXPECT_NE( loaded->sub_arr[0].u32_arr.data, loaded->sub_arr[1].u32_arr.data );
+}
+
+TEST_F(DL, array_merge_identical_string_arrays)
+{
+	const char* strs1[]  = { "cow", "bell" };
+	const char* strs1b[] = { "cow", "bell" };
+	const char* strs2[]  = { "bell" };
+	StringArray sub[] = { { { strs1,  DL_ARRAY_LENGTH( strs1 ) } },
+						  { { strs2,  DL_ARRAY_LENGTH( strs2 ) } },
+						  { { strs1b, DL_ARRAY_LENGTH( strs1b ) } } };
+	BugTest4 original = { { sub, DL_ARRAY_LENGTH( sub ) } };
+
+	dl_store_params_t params;
+	DL_STORE_PARAMS_SET_DEFAULT( params );
+	params.flags = DL_STOREFLAGS_MERGE_IDENTICAL_SUBDATA;
+
+	unsigned char packed[1024];
+	size_t produced = 0;
+	EXPECT_DL_ERR_OK( dl_instance_store_ex( Ctx, BugTest4::TYPE_ID, &original, packed, sizeof(packed), &produced, &params ) );
+
+	// string-arrays shared by elements must only be patched once.
+	BugTest4 loaded[32];
+	EXPECT_DL_ERR_OK( dl_instance_load( Ctx, BugTest4::TYPE_ID, loaded, sizeof(loaded), packed, produced, 0x0 ) );
+
+	EXPECT_EQ( 3u, loaded[0].struct_with_str_arr.count );
+	EXPECT_EQ( loaded[0].struct_with_str_arr[0].Strings.data, loaded[0].struct_with_str_arr[2].Strings.data );
+	EXPECT_STREQ( "cow",  loaded[0].struct_with_str_arr[0].Strings[0] );
+	EXPECT_STREQ( "bell", loaded[0].struct_with_str_arr[0].Strings[1] );
+	EXPECT_STREQ( "bell", loaded[0].struct_with_str_arr[1].Strings[0] );
+}
+
 #if !defined(_MSC_VER) || _MSC_VER >= 1700 // can't test ranged for if not supported!
 
 TEST_F(DL, ranged_for_int8)
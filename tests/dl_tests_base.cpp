@@ -182,3 +182,51 @@ void convert_inplace_test_do_it( dl_ctx_t       dl_ctx,        dl_typeid_t type,
 
 	free(convert_buffer);
 }
+
+void store_target_test_do_it( dl_ctx_t       dl_ctx,        dl_typeid_t type,
+							  unsigned char* store_buffer,  size_t      store_size,
+							  unsigned char** out_buffer,    size_t*     out_size,
+							  unsigned int   conv_ptr_size, dl_endian_t conv_endian )
+{
+	// load instance to be able to store it directly to the target format.
+	unsigned char* loaded_instance = (unsigned char*)malloc(store_size);
+	EXPECT_DL_ERR_OK( dl_instance_load( dl_ctx, type, loaded_instance, store_size, store_buffer, store_size, 0x0 ) );
+
+	dl_store_params_t params;
+	DL_STORE_PARAMS_SET_DEFAULT( params );
+	params.target_endian   = conv_endian;
+	params.target_ptr_size = conv_ptr_size;
+
+	size_t target_size = 0;
+	EXPECT_DL_ERR_OK( dl_instance_store_ex( dl_ctx, type, loaded_instance, 0x0, 0, &target_size, &params ) );
+	unsigned char* target_buffer = (unsigned char*)malloc(target_size + 1);
+	memset( target_buffer, 0x0, target_size );
+	target_buffer[target_size] = 0xFE;
+
+	EXPECT_DL_ERR_OK( dl_instance_store_ex( dl_ctx, type, loaded_instance, target_buffer, target_size, 0x0, &params ) );
+	EXPECT_EQ( (unsigned char)0xFE, target_buffer[target_size] ); // no overwrite on the calculated size plox!
+	EXPECT_INSTANCE_INFO( target_buffer, target_size, conv_ptr_size, conv_endian, type );
+
+	// storing directly to target should give the same result as converting.
+	size_t convert_size = 0;
+	EXPECT_DL_ERR_OK( dl_convert_calc_size( dl_ctx, type, store_buffer, store_size, conv_ptr_size, &convert_size ) );
+	EXPECT_EQ( convert_size, target_size );
+	if( conv_ptr_size != sizeof(void*) || conv_endian != DL_ENDIAN_HOST ) // convert to host is only a copy, including unset padding.
+	{
+		unsigned char* convert_buffer = (unsigned char*)malloc(convert_size);
+		memset( convert_buffer, 0x0, convert_size );
+		EXPECT_DL_ERR_OK( dl_convert( dl_ctx, type, store_buffer, store_size, convert_buffer, convert_size, conv_endian, conv_ptr_size, 0x0 ) );
+		EXPECT_EQ( 0, memcmp( convert_buffer, target_buffer, convert_size < target_size ? convert_size : target_size ) );
+		free(convert_buffer);
+	}
+
+	// convert back to host to be able to load.
+	EXPECT_DL_ERR_OK( dl_convert_calc_size( dl_ctx, type, target_buffer, target_size, sizeof(void*), out_size ) );
+	*out_buffer = (unsigned char*)malloc(*out_size + 1);
+	memset(*out_buffer, 0xFE, *out_size + 1);
+
+	EXPECT_DL_ERR_OK( dl_convert( dl_ctx, type, target_buffer, target_size, *out_buffer, *out_size, DL_ENDIAN_HOST, sizeof(void*), 0x0 ) );
+
+	free(target_buffer);
+	free(loaded_instance);
+}
@@ -61,6 +61,22 @@ struct convert_inplace_test
 	}
 };
 
+void store_target_test_do_it( dl_ctx_t       dl_ctx,        dl_typeid_t type,
+							  unsigned char* store_buffer,  size_t      store_size,
+							  unsigned char** out_buffer,    size_t*     out_size,
+							  unsigned int   conv_ptr_size, dl_endian_t conv_endian );
+
+template<unsigned int conv_ptr_size, dl_endian_t conv_endian>
+struct store_target_test
+{
+	static void do_it( dl_ctx_t       dl_ctx,       dl_typeid_t type,
+					   unsigned char* store_buffer, size_t      store_size,
+					   unsigned char** out_buffer,   size_t*     out_size )
+	{
+		store_target_test_do_it( dl_ctx, type, store_buffer, store_size, out_buffer, out_size, conv_ptr_size, conv_endian );
+	}
+};
+
 template <typename T>
 struct DLBase : public DL
 {
@@ -118,6 +134,10 @@ typedef ::testing::Types<
 	,convert_inplace_test<8, DL_ENDIAN_LITTLE>
 	,convert_inplace_test<4, DL_ENDIAN_BIG>
 	,convert_inplace_test<8, DL_ENDIAN_BIG>
+	,store_target_test<4, DL_ENDIAN_LITTLE>
+	,store_target_test<8, DL_ENDIAN_LITTLE>
+	,store_target_test<4, DL_ENDIAN_BIG>
+	,store_target_test<8, DL_ENDIAN_BIG>
 > DLBaseTypes;
 TYPED_TEST_CASE(DLBase, DLBaseTypes);
 
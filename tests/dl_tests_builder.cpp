@@ -0,0 +1,318 @@
+/* copyright (c) 2010 Fredrik Kihlander, see LICENSE for more info */
+
+#include <gtest/gtest.h>
+
+#include <dl/dl.h>
+#include <dl/dl_txt.h>
+#include <dl/dl_convert.h>
+#include <dl/dl_builder.h>
+
+#include "dl_test_common.h"
+
+class DLBuilder : public DL
+{
+public:
+	unsigned char packed[4096];
+	size_t        packed_size;
+	unsigned char loaded[4096];
+
+	dl_member_handle_t handle( dl_typeid_t type, const char* member )
+	{
+		dl_member_handle_t h;
+		EXPECT_DL_ERR_OK( dl_cursor_member_handle( Ctx, type, member, &h ) );
+		return h;
+	}
+
+	template <typename T>
+	T* finish_and_load( dl_builder_t builder )
+	{
+		EXPECT_DL_ERR_OK( dl_builder_finish( builder, packed, sizeof(packed), &packed_size ) );
+		EXPECT_DL_ERR_OK( dl_builder_free( builder ) );
+		EXPECT_DL_ERR_OK( dl_instance_load( Ctx, T::TYPE_ID, loaded, sizeof(loaded), packed, packed_size, 0x0 ) );
+		return (T*)loaded;
+	}
+
+	// check that instance is equal to the instance described by txt.
+	template <typename T>
+	void expect_equal_to_txt( const T* instance, const char* txt )
+	{
+		unsigned char txt_packed[4096];
+		unsigned char txt_loaded[4096];
+		EXPECT_DL_ERR_OK( dl_txt_pack( Ctx, txt, txt_packed, sizeof(txt_packed), 0x0 ) );
+		EXPECT_DL_ERR_OK( dl_instance_load( Ctx, T::TYPE_ID, txt_loaded, sizeof(txt_loaded), txt_packed, sizeof(txt_packed), 0x0 ) );
+
+		int equal = 0;
+		EXPECT_DL_ERR_OK( dl_instance_equal( Ctx, T::TYPE_ID, instance, txt_loaded, DL_HASHFLAGS_NONE, &equal ) );
+		EXPECT_TRUE( equal != 0 );
+	}
+};
+
+TEST_F( DLBuilder, pods_and_strings )
+{
+	dl_builder_t        builder;
+	dl_builder_struct_t root;
+	EXPECT_DL_ERR_OK( dl_builder_begin( Ctx, Strings::TYPE_ID, sizeof(void*), &builder, &root ) );
+	EXPECT_DL_ERR_OK( dl_builder_set_string( builder, &root, handle( Strings::TYPE_ID, "Str1" ), 0, "apa" ) );
+
+	Strings* strs = finish_and_load<Strings>( builder );
+	EXPECT_STREQ( "apa", strs->Str1 );
+	EXPECT_EQ( (const char*)0x0, strs->Str2 );
+
+	EXPECT_DL_ERR_OK( dl_builder_begin( Ctx, Pods::TYPE_ID, sizeof(void*), &builder, &root ) );
+	int16_t  i16 = -2;
+	uint64_t u64 = 1337;
+	double   f64 = 3.5;
+	EXPECT_DL_ERR_OK( dl_builder_set( builder, &root, handle( Pods::TYPE_ID, "i16" ), 0, &i16, sizeof(i16) ) );
+	EXPECT_DL_ERR_OK( dl_builder_set( builder, &root, handle( Pods::TYPE_ID, "u64" ), 0, &u64, sizeof(u64) ) );
+	EXPECT_DL_ERR_OK( dl_builder_set( builder, &root, handle( Pods::TYPE_ID, "f64" ), 0, &f64, sizeof(f64) ) );
+
+	Pods* pods = finish_and_load<Pods>( builder );
+	EXPECT_EQ( 0,     pods->i8 );
+	EXPECT_EQ( -2,    pods->i16 );
+	EXPECT_EQ( 1337u, pods->u64 );
+	EXPECT_EQ( 3.5,   pods->f64 );
+}
+
+TEST_F( DLBuilder, bitfields )
+{
+	dl_builder_t        builder;
+	dl_builder_struct_t root;
+	EXPECT_DL_ERR_OK( dl_builder_begin( Ctx, TestBits::TYPE_ID, sizeof(void*), &builder, &root ) );
+
+	uint8_t bit3 = 5, bit5 = 2, uneven = 7;
+	EXPECT_DL_ERR_OK( dl_builder_set( builder, &root, handle( TestBits::TYPE_ID, "Bit3" ),           0, &bit3,   sizeof(bit3) ) );
+	EXPECT_DL_ERR_OK( dl_builder_set( builder, &root, handle( TestBits::TYPE_ID, "Bit5" ),           0, &bit5,   sizeof(bit5) ) );
+	EXPECT_DL_ERR_OK( dl_builder_set( builder, &root, handle( TestBits::TYPE_ID, "make_it_uneven" ), 0, &uneven, sizeof(uneven) ) );
+
+	TestBits* bits = finish_and_load<TestBits>( builder );
+	EXPECT_EQ( 0u, bits->Bit1 );
+	EXPECT_EQ( 5u, bits->Bit3 );
+	EXPECT_EQ( 2u, bits->Bit5 );
+	EXPECT_EQ( 7u, bits->make_it_uneven );
+}
+
+TEST_F( DLBuilder, push_to_nested_arrays )
+{
+	dl_builder_t        builder;
+	dl_builder_struct_t root;
+	EXPECT_DL_ERR_OK( dl_builder_begin( Ctx, PodArray2::TYPE_ID, sizeof(void*), &builder, &root ) );
+
+	dl_member_handle_t sub_arr = handle( PodArray2::TYPE_ID, "sub_arr" );
+	dl_member_handle_t u32_arr = handle( PodArray1::TYPE_ID, "u32_arr" );
+
+	// pushing to the inner arrays in turn forces arrays to move.
+	for( uint32_t i = 0; i < 3; ++i )
+		EXPECT_DL_ERR_OK( dl_builder_push( builder, &root, sub_arr, 0x0 ) );
+	for( uint32_t value = 0; value < 10; ++value )
+	{
+		dl_builder_struct_t sub;
+		EXPECT_DL_ERR_OK( dl_builder_struct( builder, &root, sub_arr, value % 3, &sub ) );
+
+		unsigned int index;
+		EXPECT_DL_ERR_OK( dl_builder_push( builder, &sub, u32_arr, &index ) );
+		EXPECT_DL_ERR_OK( dl_builder_set( builder, &sub, u32_arr, index, &value, sizeof(value) ) );
+	}
+
+	PodArray2* arr = finish_and_load<PodArray2>( builder );
+	expect_equal_to_txt( arr, STRINGIFY( { "PodArray2" : { "sub_arr" : [ { "u32_arr" : [ 0, 3, 6, 9 ] }, { "u32_arr" : [ 1, 4, 7 ] }, { "u32_arr" : [ 2, 5, 8 ] } ] } } ) );
+}
+
+TEST_F( DLBuilder, reserve_do_not_move_array )
+{
+	dl_builder_t        builder;
+	dl_builder_struct_t root;
+	EXPECT_DL_ERR_OK( dl_builder_begin( Ctx, StringArray::TYPE_ID, sizeof(void*), &builder, &root ) );
+
+	dl_member_handle_t strings = handle( StringArray::TYPE_ID, "Strings" );
+	EXPECT_DL_ERR_OK( dl_builder_reserve( builder, &root, strings, 16 ) );
+
+	const char* strs[] = { "a", "bb", "ccc", "dddd", "eeeee", "ffffff", "g", "h", "i", "j", "k", "l", "m", "n", "o", "p" };
+	for( unsigned int i = 0; i < DL_ARRAY_LENGTH( strs ); ++i )
+	{
+		unsigned int index;
+		EXPECT_DL_ERR_OK( dl_builder_push( builder, &root, strings, &index ) );
+		EXPECT_DL_ERR_OK( dl_builder_set_string( builder, &root, strings, index, strs[i] ) );
+	}
+
+	size_t builder_size;
+	EXPECT_DL_ERR_OK( dl_builder_finish( builder, 0x0, 0, &builder_size ) );
+	StringArray* arr = finish_and_load<StringArray>( builder );
+	ASSERT_EQ( 16u, arr->Strings.count );
+	EXPECT_STREQ( "ffffff", arr->Strings[5] );
+
+	// same size as if it was stored.
+	size_t store_size;
+	EXPECT_DL_ERR_OK( dl_instance_store( Ctx, StringArray::TYPE_ID, arr, 0x0, 0, &store_size ) );
+	EXPECT_EQ( store_size, builder_size );
+}
+
+TEST_F( DLBuilder, ptrs )
+{
+	dl_builder_t        builder;
+	dl_builder_struct_t root;
+	EXPECT_DL_ERR_OK( dl_builder_begin( Ctx, DoublePtrChain::TYPE_ID, sizeof(void*), &builder, &root ) );
+
+	dl_member_handle_t int_member = handle( DoublePtrChain::TYPE_ID, "Int" );
+	dl_member_handle_t next       = handle( DoublePtrChain::TYPE_ID, "Next" );
+	dl_member_handle_t prev       = handle( DoublePtrChain::TYPE_ID, "Prev" );
+
+	uint32_t value = 1;
+	EXPECT_DL_ERR_OK( dl_builder_set( builder, &root, int_member, 0, &value, sizeof(value) ) );
+
+	dl_builder_struct_t second;
+	EXPECT_DL_ERR_OK( dl_builder_struct( builder, &root, next, 0, &second ) );
+	value = 2;
+	EXPECT_DL_ERR_OK( dl_builder_set( builder, &second, int_member, 0, &value, sizeof(value) ) );
+	EXPECT_DL_ERR_OK( dl_builder_set_ptr( builder, &second, prev, 0, &root ) );
+
+	// getting the struct of a set ptr do not create a new one.
+	dl_builder_struct_t second_again;
+	EXPECT_DL_ERR_OK( dl_builder_struct( builder, &root, next, 0, &second_again ) );
+	EXPECT_EQ( second.offset, second_again.offset );
+
+	DoublePtrChain* chain = finish_and_load<DoublePtrChain>( builder );
+	EXPECT_EQ( 1u, chain->Int );
+	EXPECT_EQ( (DoublePtrChain*)0x0, chain->Prev );
+	ASSERT_NE( (DoublePtrChain*)0x0, chain->Next );
+	EXPECT_EQ( 2u,    chain->Next->Int );
+	EXPECT_EQ( chain, chain->Next->Prev );
+	EXPECT_EQ( (DoublePtrChain*)0x0, chain->Next->Next );
+}
+
+TEST_F( DLBuilder, ptrs_into_moved_array )
+{
+	dl_builder_t        builder;
+	dl_builder_struct_t root;
+	EXPECT_DL_ERR_OK( dl_builder_begin( Ctx, ptrs_into_array::TYPE_ID, sizeof(void*), &builder, &root ) );
+
+	dl_member_handle_t arr  = handle( ptrs_into_array::TYPE_ID, "arr" );
+	dl_member_handle_t ptrs = handle( ptrs_into_array::TYPE_ID, "ptrs" );
+	dl_member_handle_t int1 = handle( Pods2::TYPE_ID, "Int1" );
+
+	// pushing to both arrays in turn moves both the pointed to elements and the ptrs.
+	for( uint32_t i = 0; i < 10; ++i )
+	{
+		unsigned int index;
+		dl_builder_struct_t elem;
+		EXPECT_DL_ERR_OK( dl_builder_push( builder, &root, arr, &index ) );
+		EXPECT_DL_ERR_OK( dl_builder_struct( builder, &root, arr, index, &elem ) );
+		EXPECT_DL_ERR_OK( dl_builder_set( builder, &elem, int1, 0, &i, sizeof(i) ) );
+
+		EXPECT_DL_ERR_OK( dl_builder_push( builder, &root, ptrs, &index ) );
+		EXPECT_DL_ERR_OK( dl_builder_set_ptr( builder, &root, ptrs, index, &elem ) );
+	}
+
+	ptrs_into_array* loaded_arr = finish_and_load<ptrs_into_array>( builder );
+	ASSERT_EQ( 10u, loaded_arr->arr.count );
+	ASSERT_EQ( 10u, loaded_arr->ptrs.count );
+	for( uint32_t i = 0; i < 10; ++i )
+	{
+		EXPECT_EQ( i, loaded_arr->arr[i].Int1 );
+		EXPECT_EQ( &loaded_arr->arr[i], loaded_arr->ptrs[i] );
+	}
+}
+
+TEST_F( DLBuilder, moved_array_leaves_unused_data )
+{
+	dl_builder_t        builder;
+	dl_builder_struct_t root;
+	EXPECT_DL_ERR_OK( dl_builder_begin( Ctx, PodArray2::TYPE_ID, sizeof(void*), &builder, &root ) );
+
+	dl_member_handle_t sub_arr = handle( PodArray2::TYPE_ID, "sub_arr" );
+	dl_member_handle_t u32_arr = handle( PodArray1::TYPE_ID, "u32_arr" );
+
+	dl_builder_struct_t sub0;
+	dl_builder_struct_t sub1;
+	EXPECT_DL_ERR_OK( dl_builder_push( builder, &root, sub_arr, 0x0 ) );
+	EXPECT_DL_ERR_OK( dl_builder_push( builder, &root, sub_arr, 0x0 ) );
+	EXPECT_DL_ERR_OK( dl_builder_struct( builder, &root, sub_arr, 0, &sub0 ) );
+	EXPECT_DL_ERR_OK( dl_builder_struct( builder, &root, sub_arr, 1, &sub1 ) );
+	for( uint32_t i = 0; i < 4; ++i )
+		EXPECT_DL_ERR_OK( dl_builder_push( builder, &sub0, u32_arr, 0x0 ) );
+	EXPECT_DL_ERR_OK( dl_builder_push( builder, &sub1, u32_arr, 0x0 ) );
+
+	size_t unmoved_size;
+	EXPECT_DL_ERR_OK( dl_builder_finish( builder, 0x0, 0, &unmoved_size ) );
+
+	// the array-data of sub0 is not last in the instance and is moved to grow.
+	EXPECT_DL_ERR_OK( dl_builder_push( builder, &sub0, u32_arr, 0x0 ) );
+
+	size_t builder_size;
+	EXPECT_DL_ERR_OK( dl_builder_finish( builder, 0x0, 0, &builder_size ) );
+	PodArray2* arr = finish_and_load<PodArray2>( builder );
+	ASSERT_EQ( 5u, arr->sub_arr[0].u32_arr.count );
+	ASSERT_EQ( 1u, arr->sub_arr[1].u32_arr.count );
+
+	// the old data and unused capacity is still in the instance.
+	size_t store_size;
+	EXPECT_DL_ERR_OK( dl_instance_store( Ctx, PodArray2::TYPE_ID, arr, 0x0, 0, &store_size ) );
+	EXPECT_EQ( unmoved_size + 8 * sizeof(uint32_t), builder_size );
+	EXPECT_LT( store_size, builder_size );
+}
+
+TEST_F( DLBuilder, union_member )
+{
+	dl_builder_t        builder;
+	dl_builder_struct_t root;
+	EXPECT_DL_ERR_OK( dl_builder_begin( Ctx, test_union_simple::TYPE_ID, sizeof(void*), &builder, &root ) );
+
+	dl_builder_struct_t item3;
+	EXPECT_DL_ERR_OK( dl_builder_struct( builder, &root, handle( test_union_simple::TYPE_ID, "item3" ), 0, &item3 ) );
+	uint32_t u32 = 7;
+	EXPECT_DL_ERR_OK( dl_builder_set( builder, &item3, handle( Pods::TYPE_ID, "u32" ), 0, &u32, sizeof(u32) ) );
+
+	test_union_simple* u = finish_and_load<test_union_simple>( builder );
+	EXPECT_EQ( test_union_simple_type_item3, u->type );
+	EXPECT_EQ( 7u, u->value.item3.u32 );
+}
+
+TEST_F( DLBuilder, other_ptr_size )
+{
+	size_t other_ptr_size = sizeof(void*) == 8 ? 4 : 8;
+
+	dl_builder_t        builder;
+	dl_builder_struct_t root;
+	EXPECT_DL_ERR_OK( dl_builder_begin( Ctx, StructArray1::TYPE_ID, (unsigned int)other_ptr_size, &builder, &root ) );
+
+	dl_member_handle_t array = handle( StructArray1::TYPE_ID, "Array" );
+	dl_member_handle_t int2  = handle( Pods2::TYPE_ID, "Int2" );
+	for( uint32_t i = 0; i < 3; ++i )
+	{
+		unsigned int index;
+		dl_builder_struct_t elem;
+		EXPECT_DL_ERR_OK( dl_builder_push( builder, &root, array, &index ) );
+		EXPECT_DL_ERR_OK( dl_builder_struct( builder, &root, array, index, &elem ) );
+		EXPECT_DL_ERR_OK( dl_builder_set( builder, &elem, int2, 0, &i, sizeof(i) ) );
+	}
+
+	unsigned char other[1024];
+	size_t        other_size;
+	EXPECT_DL_ERR_OK( dl_builder_finish( builder, other, sizeof(other), &other_size ) );
+	EXPECT_DL_ERR_OK( dl_builder_free( builder ) );
+
+	EXPECT_DL_ERR_OK( dl_convert( Ctx, StructArray1::TYPE_ID, other, other_size, packed, sizeof(packed), DL_ENDIAN_HOST, sizeof(void*), &packed_size ) );
+	EXPECT_DL_ERR_OK( dl_instance_load( Ctx, StructArray1::TYPE_ID, loaded, sizeof(loaded), packed, packed_size, 0x0 ) );
+	expect_equal_to_txt( (StructArray1*)loaded, STRINGIFY( { "StructArray1" : { "Array" : [ { "Int1" : 0, "Int2" : 0 }, { "Int1" : 0, "Int2" : 1 }, { "Int1" : 0, "Int2" : 2 } ] } } ) );
+}
+
+TEST_F( DLBuilder, errors )
+{
+	dl_builder_t        builder;
+	dl_builder_struct_t root;
+	EXPECT_DL_ERR_EQ( DL_ERROR_INVALID_PARAMETER, dl_builder_begin( Ctx, PodArray1::TYPE_ID, 2, &builder, &root ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_TYPE_NOT_FOUND,    dl_builder_begin( Ctx, 0xFEDCBA98, 8, &builder, &root ) );
+	EXPECT_DL_ERR_OK( dl_builder_begin( Ctx, PodArray1::TYPE_ID, sizeof(void*), &builder, &root ) );
+
+	dl_member_handle_t u32_arr = handle( PodArray1::TYPE_ID, "u32_arr" );
+	uint32_t value = 1;
+	uint8_t  small = 1;
+	EXPECT_DL_ERR_EQ( DL_ERROR_INVALID_PARAMETER, dl_builder_set( builder, &root, u32_arr, 0, &value, sizeof(value) ) );
+	EXPECT_DL_ERR_OK( dl_builder_push( builder, &root, u32_arr, 0x0 ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_TYPE_MISMATCH,     dl_builder_set( builder, &root, u32_arr, 0, &small, sizeof(small) ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_TYPE_MISMATCH,     dl_builder_set_string( builder, &root, u32_arr, 0, "apa" ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_TYPE_MISMATCH,     dl_builder_set( builder, &root, handle( Pods2::TYPE_ID, "Int1" ), 0, &value, sizeof(value) ) );
+
+	unsigned char out[16];
+	EXPECT_DL_ERR_EQ( DL_ERROR_BUFFER_TO_SMALL,   dl_builder_finish( builder, out, sizeof(out), 0x0 ) );
+	EXPECT_DL_ERR_OK( dl_builder_free( builder ) );
+}
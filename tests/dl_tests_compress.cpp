@@ -0,0 +1,279 @@
+/* copyright (c) 2010 Fredrik Kihlander, see LICENSE for more info */
+
+#include <gtest/gtest.h>
+
+#include <dl/dl.h>
+#include <dl/dl_compress.h>
+
+#include "dl_test_common.h"
+
+#include <stdlib.h>
+
+class DLCompress : public DL
+{
+public:
+	uint32_t*      arr;
+	size_t         arr_count;
+	unsigned char* packed;
+	size_t         packed_size;
+	unsigned char* compressed;
+	size_t         compressed_size;
+
+	virtual void SetUp()
+	{
+		DL::SetUp();
+		arr        = 0x0;
+		packed     = 0x0;
+		compressed = 0x0;
+	}
+
+	virtual void TearDown()
+	{
+		free( arr );
+		free( packed );
+		free( compressed );
+		DL::TearDown();
+	}
+
+	void alloc_array( size_t count )
+	{
+		arr       = (uint32_t*)malloc( count * sizeof(uint32_t) );
+		arr_count = count;
+	}
+
+	void store( dl_typeid_t type, const void* instance, const dl_store_params_t* params = 0x0 )
+	{
+		EXPECT_DL_ERR_OK( dl_instance_store_ex( Ctx, type, instance, 0x0, 0, &packed_size, params ) );
+		packed = (unsigned char*)malloc( packed_size );
+		EXPECT_DL_ERR_OK( dl_instance_store_ex( Ctx, type, instance, packed, packed_size, 0x0, params ) );
+	}
+
+	void compress()
+	{
+		EXPECT_DL_ERR_OK( dl_compress( Ctx, packed, packed_size, 0x0, 0, &compressed_size ) );
+		compressed = (unsigned char*)malloc( compressed_size + 1 );
+		compressed[compressed_size] = 0xFE;
+
+		size_t produced = 0;
+		EXPECT_DL_ERR_OK( dl_compress( Ctx, packed, packed_size, compressed, compressed_size, &produced ) );
+		EXPECT_EQ( compressed_size, produced );
+		EXPECT_EQ( 0xFE, compressed[compressed_size] );
+	}
+
+	void check_decompress()
+	{
+		dl_compressed_info_t info;
+		EXPECT_DL_ERR_OK( dl_compressed_get_info( compressed, compressed_size, &info ) );
+		EXPECT_EQ( 1u, info.is_compressed );
+		EXPECT_EQ( packed_size, info.decompressed_size );
+
+		size_t size = 0;
+		EXPECT_DL_ERR_OK( dl_decompress( Ctx, compressed, compressed_size, 0x0, 0, &size ) );
+		EXPECT_EQ( packed_size, size );
+
+		unsigned char* decompressed = (unsigned char*)malloc( size );
+		EXPECT_DL_ERR_EQ( DL_ERROR_BUFFER_TO_SMALL, dl_decompress( Ctx, compressed, compressed_size, decompressed, size - 1, 0x0 ) );
+		EXPECT_DL_ERR_OK( dl_decompress( Ctx, compressed, compressed_size, decompressed, size, 0x0 ) );
+		EXPECT_EQ( 0, memcmp( packed, decompressed, size ) );
+
+		// decompressing the blocks in any order gives the same result.
+		memset( decompressed, 0x0, size );
+		for( unsigned int block = info.block_count; block > 0; --block )
+			EXPECT_DL_ERR_OK( dl_decompress_blocks( Ctx, compressed, compressed_size, decompressed, size, block - 1, 1 ) );
+		EXPECT_EQ( 0, memcmp( packed, decompressed, size ) );
+
+		free( decompressed );
+	}
+};
+
+TEST_F( DLCompress, roundtrip_small )
+{
+	Pods p = { 1, 2, 3, 4, 5, 6, 7, 8, 9.0f, 10.0 };
+	store( Pods::TYPE_ID, &p );
+	compress();
+	check_decompress();
+
+	// instance-info still reports the decompressed size.
+	dl_instance_info_t info;
+	EXPECT_DL_ERR_OK( dl_instance_get_info( compressed, compressed_size, &info ) );
+	EXPECT_EQ( packed_size - 24, info.load_size );
+
+	Pods loaded;
+	size_t consumed = 0;
+	EXPECT_DL_ERR_OK( dl_instance_load( Ctx, Pods::TYPE_ID, &loaded, sizeof(loaded), compressed, compressed_size, &consumed ) );
+	EXPECT_EQ( compressed_size, consumed );
+	EXPECT_EQ( p.i32, loaded.i32 );
+	EXPECT_EQ( p.f64, loaded.f64 );
+}
+
+TEST_F( DLCompress, roundtrip_multiple_blocks )
+{
+	alloc_array( 100000 );
+	for( size_t i = 0; i < arr_count; ++i )
+		arr[i] = (uint32_t)( i % 100 );
+
+	PodArray1 original;
+	original.u32_arr.data  = arr;
+	original.u32_arr.count = (uint32_t)arr_count;
+	store( PodArray1::TYPE_ID, &original );
+	compress();
+
+	EXPECT_LT( compressed_size * 4, packed_size );
+
+	dl_compressed_info_t info;
+	EXPECT_DL_ERR_OK( dl_compressed_get_info( compressed, compressed_size, &info ) );
+	EXPECT_LT( 1u, info.block_count );
+	check_decompress();
+
+	// load directly from compressed data.
+	unsigned char* load_buffer = (unsigned char*)malloc( packed_size );
+	PodArray1* loaded = (PodArray1*)load_buffer;
+	size_t consumed = 0;
+	EXPECT_DL_ERR_OK( dl_instance_load( Ctx, PodArray1::TYPE_ID, loaded, packed_size, compressed, compressed_size, &consumed ) );
+	EXPECT_EQ( compressed_size, consumed );
+	EXPECT_EQ( arr_count, loaded->u32_arr.count );
+	EXPECT_EQ( 0, memcmp( arr, loaded->u32_arr.data, arr_count * sizeof(uint32_t) ) );
+	free( load_buffer );
+}
+
+TEST_F( DLCompress, incompressible_data )
+{
+	alloc_array( 50000 );
+	uint32_t seed = 0x12345678;
+	for( size_t i = 0; i < arr_count; ++i )
+	{
+		seed = seed * 1664525u + 1013904223u;
+		arr[i] = seed;
+	}
+
+	PodArray1 original;
+	original.u32_arr.data  = arr;
+	original.u32_arr.count = (uint32_t)arr_count;
+	store( PodArray1::TYPE_ID, &original );
+	compress();
+
+	// blocks that do not compress are stored as is, so the overhead is only the block-table.
+	EXPECT_LT( compressed_size, packed_size + 64 );
+	check_decompress();
+}
+
+TEST_F( DLCompress, other_endian )
+{
+	Strings str = { "cowbell cowbell cowbell cowbell cowbell", "more cowbell!" };
+
+	dl_store_params_t params;
+	DL_STORE_PARAMS_SET_DEFAULT( params );
+	params.target_endian = DL_ENDIAN_HOST == DL_ENDIAN_LITTLE ? DL_ENDIAN_BIG : DL_ENDIAN_LITTLE;
+	store( Strings::TYPE_ID, &str, &params );
+	compress();
+	check_decompress();
+
+	// instance is not in host endian.
+	Strings loaded[8];
+	EXPECT_DL_ERR_EQ( DL_ERROR_ENDIAN_MISMATCH, dl_instance_load( Ctx, Strings::TYPE_ID, loaded, sizeof(loaded), compressed, compressed_size, 0x0 ) );
+}
+
+TEST_F( DLCompress, checksum )
+{
+	alloc_array( 1000 );
+	for( size_t i = 0; i < arr_count; ++i )
+		arr[i] = (uint32_t)( i % 10 );
+
+	PodArray1 original;
+	original.u32_arr.data  = arr;
+	original.u32_arr.count = (uint32_t)arr_count;
+
+	dl_store_params_t params;
+	DL_STORE_PARAMS_SET_DEFAULT( params );
+	params.flags = DL_STOREFLAGS_CHECKSUM;
+	store( PodArray1::TYPE_ID, &original, &params );
+	compress();
+	check_decompress();
+
+	// the checksum is of the decompressed data and is verified after decompression.
+	dl_load_params_t load_params;
+	DL_LOAD_PARAMS_SET_DEFAULT( load_params );
+	load_params.flags = DL_LOADFLAGS_VERIFY_CHECKSUM;
+
+	unsigned char load_buffer[8192];
+	EXPECT_DL_ERR_OK( dl_instance_load_ex( Ctx, PodArray1::TYPE_ID, load_buffer, sizeof(load_buffer), compressed, compressed_size, 0x0, &load_params ) );
+
+	compressed[20] ^= 0x01; // checksum in header.
+	EXPECT_DL_ERR_EQ( DL_ERROR_CHECKSUM_MISMATCH, dl_instance_load_ex( Ctx, PodArray1::TYPE_ID, load_buffer, sizeof(load_buffer), compressed, compressed_size, 0x0, &load_params ) );
+}
+
+TEST_F( DLCompress, layout_fingerprint )
+{
+	alloc_array( 1000 );
+	for( size_t i = 0; i < arr_count; ++i )
+		arr[i] = (uint32_t)( i % 10 );
+
+	PodArray1 original;
+	original.u32_arr.data  = arr;
+	original.u32_arr.count = (uint32_t)arr_count;
+
+	dl_store_params_t params;
+	DL_STORE_PARAMS_SET_DEFAULT( params );
+	params.flags = DL_STOREFLAGS_LAYOUT_FINGERPRINT;
+	store( PodArray1::TYPE_ID, &original, &params );
+	compress();
+	check_decompress();
+
+	// the fingerprint can be read without decompressing.
+	dl_instance_info_t packed_info;
+	dl_instance_info_t compressed_info;
+	EXPECT_DL_ERR_OK( dl_instance_get_info( packed,     packed_size,             &packed_info ) );
+	EXPECT_DL_ERR_OK( dl_instance_get_info( compressed, 24 + sizeof(uint32_t), &compressed_info ) );
+	EXPECT_NE( 0u, packed_info.layout_fingerprint );
+	EXPECT_EQ( packed_info.layout_fingerprint, compressed_info.layout_fingerprint );
+
+	unsigned char load_buffer[8192];
+	size_t consumed = 0;
+	EXPECT_DL_ERR_OK( dl_instance_load( Ctx, PodArray1::TYPE_ID, load_buffer, sizeof(load_buffer), compressed, compressed_size, &consumed ) );
+	EXPECT_EQ( compressed_size, consumed );
+
+	compressed[24] ^= 0x01; // fingerprint directly after header.
+	EXPECT_DL_ERR_EQ( DL_ERROR_TYPE_LAYOUT_MISMATCH, dl_instance_load( Ctx, PodArray1::TYPE_ID, load_buffer, sizeof(load_buffer), compressed, compressed_size, 0x0 ) );
+}
+
+TEST_F( DLCompress, unsupported_operations )
+{
+	Pods p = { 1, 2, 3, 4, 5, 6, 7, 8, 9.0f, 10.0 };
+	store( Pods::TYPE_ID, &p );
+	compress();
+
+	size_t size;
+	EXPECT_DL_ERR_EQ( DL_ERROR_UNSUPPORTED_OPERATION, dl_compress( Ctx, compressed, compressed_size, 0x0, 0, &size ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_UNSUPPORTED_OPERATION, dl_decompress( Ctx, packed, packed_size, 0x0, 0, &size ) );
+
+	void* loaded;
+	EXPECT_DL_ERR_EQ( DL_ERROR_UNSUPPORTED_OPERATION, dl_instance_load_inplace( Ctx, Pods::TYPE_ID, compressed, compressed_size, &loaded, 0x0 ) );
+
+	dl_compressed_info_t info;
+	EXPECT_DL_ERR_OK( dl_compressed_get_info( packed, packed_size, &info ) );
+	EXPECT_EQ( 0u, info.is_compressed );
+	EXPECT_EQ( packed_size, info.decompressed_size );
+}
+
+TEST_F( DLCompress, malformed_data )
+{
+	alloc_array( 1000 );
+	for( size_t i = 0; i < arr_count; ++i )
+		arr[i] = (uint32_t)( i % 10 );
+
+	PodArray1 original;
+	original.u32_arr.data  = arr;
+	original.u32_arr.count = (uint32_t)arr_count;
+	store( PodArray1::TYPE_ID, &original );
+	compress();
+
+	unsigned char load_buffer[8192];
+
+	// truncated
+	EXPECT_DL_ERR_EQ( DL_ERROR_MALFORMED_DATA, dl_instance_load( Ctx, PodArray1::TYPE_ID, load_buffer, sizeof(load_buffer), compressed, compressed_size - 1, 0x0 ) );
+
+	// broken match-offsets must be detected and not read outside of the output.
+	for( size_t i = 24 + 12; i < compressed_size; ++i )
+		compressed[i] = 0xFF;
+	EXPECT_DL_ERR_EQ( DL_ERROR_MALFORMED_DATA, dl_instance_load( Ctx, PodArray1::TYPE_ID, load_buffer, sizeof(load_buffer), compressed, compressed_size, 0x0 ) );
+}
@@ -0,0 +1,111 @@
+/* copyright (c) 2010 Fredrik Kihlander, see LICENSE for more info */
+
+#include <gtest/gtest.h>
+
+#include <dl/dl.hpp>
+#include <dl/dl_txt.h>
+
+#include "dl_test_common.h"
+
+class DLCpp : public DL
+{
+public:
+	dl::packed<StringArray> pack_txt( const char* txt )
+	{
+		size_t size = 0;
+		EXPECT_DL_ERR_OK( dl_txt_pack( Ctx, txt, 0x0, 0, &size ) );
+		dl::packed<StringArray> packed( Ctx, size );
+		EXPECT_TRUE( (bool)packed );
+		EXPECT_DL_ERR_OK( dl_txt_pack( Ctx, txt, packed.data(), packed.size(), 0x0 ) );
+		return packed;
+	}
+};
+
+TEST_F( DLCpp, store_and_load )
+{
+	dl::packed<StringArray> packed = pack_txt( STRINGIFY( { "StringArray" : { "Strings" : [ "apa", "kossa" ] } } ) );
+
+	dl::loaded<StringArray> loaded;
+	EXPECT_DL_ERR_OK( dl::load( packed, &loaded ) );
+	ASSERT_TRUE( (bool)loaded );
+	ASSERT_EQ( 2u, loaded->Strings.count );
+	EXPECT_STREQ( "kossa", loaded->Strings[1] );
+
+	dl::packed<StringArray> stored;
+	EXPECT_DL_ERR_OK( dl::store( Ctx, *loaded, &stored ) );
+	EXPECT_EQ( packed.size(), stored.size() );
+
+	dl::loaded<StringArray> reloaded;
+	EXPECT_DL_ERR_OK( dl::load( stored, &reloaded ) );
+	int equal = 0;
+	EXPECT_DL_ERR_OK( dl_instance_equal( Ctx, StringArray::TYPE_ID, loaded.get(), reloaded.get(), DL_HASHFLAGS_NONE, &equal ) );
+	EXPECT_TRUE( equal != 0 );
+
+	dl::loaded<StringArray> copied;
+	EXPECT_DL_ERR_OK( dl::copy( *loaded, Ctx, &copied ) );
+	loaded.reset();
+	EXPECT_STREQ( "apa", copied->Strings[0] );
+}
+
+TEST_F( DLCpp, load_inplace_takes_memory )
+{
+	dl::packed<StringArray> packed = pack_txt( STRINGIFY( { "StringArray" : { "Strings" : [ "apa" ] } } ) );
+	const unsigned char* packed_data = packed.data();
+
+	dl::loaded<StringArray> loaded;
+	EXPECT_DL_ERR_OK( dl::load_inplace( std::move( packed ), &loaded ) );
+	EXPECT_FALSE( (bool)packed );
+	EXPECT_EQ( 0u, packed.size() );
+	ASSERT_TRUE( (bool)loaded );
+	EXPECT_GE( (const unsigned char*)loaded.get(), packed_data );
+	EXPECT_STREQ( "apa", loaded->Strings[0] );
+}
+
+TEST_F( DLCpp, move )
+{
+	dl::packed<StringArray> packed = pack_txt( STRINGIFY( { "StringArray" : { "Strings" : [ "apa" ] } } ) );
+	const unsigned char* data = packed.data();
+
+	dl::packed<StringArray> moved( std::move( packed ) );
+	EXPECT_FALSE( (bool)packed );
+	EXPECT_EQ( data, moved.data() );
+
+	packed = std::move( moved );
+	EXPECT_FALSE( (bool)moved );
+	EXPECT_EQ( data, packed.data() );
+
+	dl::loaded<StringArray> loaded;
+	EXPECT_DL_ERR_OK( dl::load( packed, &loaded ) );
+	dl::loaded<StringArray> moved_loaded( std::move( loaded ) );
+	EXPECT_EQ( (StringArray*)0x0, loaded.get() );
+	EXPECT_STREQ( "apa", moved_loaded->Strings[0] );
+}
+
+TEST_F( DLCpp, convert )
+{
+	dl::packed<StringArray> packed = pack_txt( STRINGIFY( { "StringArray" : { "Strings" : [ "apa", "kossa" ] } } ) );
+
+	size_t other_ptr_size = sizeof(void*) == 8 ? 4 : 8;
+	dl::packed<StringArray> other;
+	EXPECT_DL_ERR_OK( dl::convert( packed, DL_ENDIAN_HOST, other_ptr_size, &other ) );
+
+	dl::packed<StringArray> back;
+	EXPECT_DL_ERR_OK( dl::convert( other, DL_ENDIAN_HOST, sizeof(void*), &back ) );
+	EXPECT_EQ( packed.size(), back.size() );
+
+	dl::loaded<StringArray> loaded;
+	EXPECT_DL_ERR_OK( dl::load( back, &loaded ) );
+	ASSERT_EQ( 2u, loaded->Strings.count );
+	EXPECT_STREQ( "kossa", loaded->Strings[1] );
+}
+
+TEST_F( DLCpp, load_wrong_type )
+{
+	unsigned char packed[256];
+	size_t        packed_size;
+	EXPECT_DL_ERR_OK( dl_txt_pack( Ctx, STRINGIFY( { "Pods2" : { "Int1" : 1, "Int2" : 2 } } ), packed, sizeof(packed), &packed_size ) );
+
+	dl::loaded<StringArray> loaded;
+	EXPECT_DL_ERR_EQ( DL_ERROR_TYPE_MISMATCH, dl::load( Ctx, packed, packed_size, &loaded ) );
+	EXPECT_FALSE( (bool)loaded );
+}
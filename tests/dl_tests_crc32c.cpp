@@ -0,0 +1,26 @@
+/* copyright (c) 2010 Fredrik Kihlander, see LICENSE for more info */
+
+#include <gtest/gtest.h>
+
+#include "../src/dl_hash.h"
+
+TEST( DLCrc32c, known_answer )
+{
+	const char* check = "123456789";
+	EXPECT_EQ( 0xE3069283u, dl_internal_crc32c( (const uint8_t*)check, strlen( check ) ) );
+	EXPECT_EQ( 0xE3069283u, dl_internal_crc32c_software( (const uint8_t*)check, strlen( check ) ) );
+	EXPECT_EQ( 0u, dl_internal_crc32c( (const uint8_t*)check, 0 ) );
+	EXPECT_EQ( 0u, dl_internal_crc32c_software( (const uint8_t*)check, 0 ) );
+}
+
+TEST( DLCrc32c, software_matches_default )
+{
+	// all sizes and alignments around the 8 byte blocks.
+	uint8_t data[128];
+	for( size_t i = 0; i < sizeof(data); ++i )
+		data[i] = (uint8_t)( i * 37 + 11 );
+
+	for( size_t offset = 0; offset < 8; ++offset )
+		for( size_t size = 0; size <= sizeof(data) - offset; ++size )
+			EXPECT_EQ( dl_internal_crc32c( data + offset, size ), dl_internal_crc32c_software( data + offset, size ) );
+}
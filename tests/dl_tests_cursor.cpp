@@ -0,0 +1,220 @@
+/* copyright (c) 2010 Fredrik Kihlander, see LICENSE for more info */
+
+#include <gtest/gtest.h>
+
+#include <dl/dl.h>
+#include <dl/dl_txt.h>
+#include <dl/dl_convert.h>
+#include <dl/dl_cursor.h>
+
+#include "dl_test_common.h"
+
+static const size_t DL_HEADER_SIZE = 24; // size of the header of a packed instance.
+
+class DLCursor : public DL
+{
+public:
+	unsigned char packed[4096];
+	size_t        packed_size;
+
+	void pack( const char* txt )
+	{
+		ASSERT_DL_ERR_OK( dl_txt_pack( Ctx, txt, packed, sizeof(packed), &packed_size ) );
+	}
+
+	dl_member_handle_t handle( dl_typeid_t type, const char* name )
+	{
+		dl_member_handle_t h;
+		EXPECT_DL_ERR_OK( dl_cursor_member_handle( Ctx, type, name, &h ) );
+		return h;
+	}
+};
+
+TEST_F( DLCursor, read_pods )
+{
+	pack( STRINGIFY( { "Pods" : { "i8" : 1, "i16" : 2, "i32" : 3, "i64" : 4, "u8" : 5, "u16" : 6, "u32" : 7, "u64" : 8, "f32" : 9.5, "f64" : 10.5 } } ) );
+
+	dl_cursor_t root;
+	ASSERT_DL_ERR_OK( dl_cursor_init( Ctx, Pods::TYPE_ID, packed, packed_size, &root ) );
+
+	int16_t  i16 = 0;
+	uint64_t u64 = 0;
+	double   f64 = 0;
+	EXPECT_DL_ERR_OK( dl_cursor_read( &root, handle( Pods::TYPE_ID, "i16" ), 0, &i16, sizeof(i16) ) );
+	EXPECT_DL_ERR_OK( dl_cursor_read( &root, handle( Pods::TYPE_ID, "u64" ), 0, &u64, sizeof(u64) ) );
+	EXPECT_DL_ERR_OK( dl_cursor_read( &root, handle( Pods::TYPE_ID, "f64" ), 0, &f64, sizeof(f64) ) );
+	EXPECT_EQ( 2,    i16 );
+	EXPECT_EQ( 8u,   u64 );
+	EXPECT_EQ( 10.5, f64 );
+
+	EXPECT_DL_ERR_EQ( DL_ERROR_TYPE_MISMATCH,     dl_cursor_read( &root, handle( Pods::TYPE_ID, "i16" ), 0, &u64, sizeof(u64) ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_INVALID_PARAMETER, dl_cursor_read( &root, handle( Pods::TYPE_ID, "i16" ), 1, &i16, sizeof(i16) ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_TYPE_MISMATCH,     dl_cursor_read( &root, handle( Pods2::TYPE_ID, "Int1" ), 0, &i16, sizeof(i16) ) );
+
+	dl_member_handle_t h;
+	EXPECT_DL_ERR_EQ( DL_ERROR_MEMBER_NOT_FOUND, dl_cursor_member_handle( Ctx, Pods::TYPE_ID, "not_a_member", &h ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_TYPE_MISMATCH,    dl_cursor_init( Ctx, Pods2::TYPE_ID, packed, packed_size, &root ) );
+}
+
+TEST_F( DLCursor, read_arrays_and_strings )
+{
+	pack( STRINGIFY( { "StringArray" : { "Strings" : [ "cow", "bells", "rock" ] } } ) );
+
+	dl_cursor_t root;
+	ASSERT_DL_ERR_OK( dl_cursor_init( Ctx, StringArray::TYPE_ID, packed, packed_size, &root ) );
+
+	dl_member_handle_t strings = handle( StringArray::TYPE_ID, "Strings" );
+	unsigned int count = 0;
+	EXPECT_DL_ERR_OK( dl_cursor_array_count( &root, strings, &count ) );
+	EXPECT_EQ( 3u, count );
+
+	const char* str = 0x0;
+	EXPECT_DL_ERR_OK( dl_cursor_read_string( &root, strings, 1, &str ) );
+	EXPECT_STREQ( "bells", str );
+	EXPECT_DL_ERR_OK( dl_cursor_read_string( &root, strings, 2, &str ) );
+	EXPECT_STREQ( "rock", str );
+	EXPECT_DL_ERR_EQ( DL_ERROR_INVALID_PARAMETER, dl_cursor_read_string( &root, strings, 3, &str ) );
+
+	pack( STRINGIFY( { "WithInlineArray" : { "Array" : [ 1, 2, 3 ] } } ) );
+	ASSERT_DL_ERR_OK( dl_cursor_init( Ctx, WithInlineArray::TYPE_ID, packed, packed_size, &root ) );
+
+	dl_member_handle_t arr = handle( WithInlineArray::TYPE_ID, "Array" );
+	EXPECT_DL_ERR_OK( dl_cursor_array_count( &root, arr, &count ) );
+	EXPECT_EQ( 3u, count );
+
+	uint32_t val = 0;
+	EXPECT_DL_ERR_OK( dl_cursor_read( &root, arr, 2, &val, sizeof(val) ) );
+	EXPECT_EQ( 3u, val );
+}
+
+TEST_F( DLCursor, follow_structs_and_ptrs )
+{
+	pack( STRINGIFY( { "StructArray1" : { "Array" : [ { "Int1" : 1, "Int2" : 2 }, { "Int1" : 3, "Int2" : 4 } ] } } ) );
+
+	dl_cursor_t root;
+	ASSERT_DL_ERR_OK( dl_cursor_init( Ctx, StructArray1::TYPE_ID, packed, packed_size, &root ) );
+
+	dl_cursor_t elem;
+	uint32_t val = 0;
+	ASSERT_DL_ERR_OK( dl_cursor_struct( &root, handle( StructArray1::TYPE_ID, "Array" ), 1, &elem ) );
+	EXPECT_DL_ERR_OK( dl_cursor_read( &elem, handle( Pods2::TYPE_ID, "Int2" ), 0, &val, sizeof(val) ) );
+	EXPECT_EQ( 4u, val );
+
+	pack( STRINGIFY( { "SimplePtr" : { "Ptr1" : "p", "Ptr2" : null, "__subdata" : { "p" : { "i8" : 1, "i16" : 2, "i32" : 3, "i64" : 4, "u8" : 5, "u16" : 6, "u32" : 7, "u64" : 8, "f32" : 9, "f64" : 10 } } } } ) );
+	ASSERT_DL_ERR_OK( dl_cursor_init( Ctx, SimplePtr::TYPE_ID, packed, packed_size, &root ) );
+
+	dl_cursor_t pods;
+	ASSERT_DL_ERR_OK( dl_cursor_struct( &root, handle( SimplePtr::TYPE_ID, "Ptr1" ), 0, &pods ) );
+	ASSERT_NE( (const unsigned char*)0x0, pods.data );
+	EXPECT_DL_ERR_OK( dl_cursor_read( &pods, handle( Pods::TYPE_ID, "u32" ), 0, &val, sizeof(val) ) );
+	EXPECT_EQ( 7u, val );
+
+	ASSERT_DL_ERR_OK( dl_cursor_struct( &root, handle( SimplePtr::TYPE_ID, "Ptr2" ), 0, &pods ) );
+	EXPECT_EQ( (const unsigned char*)0x0, pods.data );
+}
+
+TEST_F( DLCursor, union_member )
+{
+	pack( STRINGIFY( { "test_union_simple" : { "item2" : 13.5 } } ) );
+
+	dl_cursor_t root;
+	ASSERT_DL_ERR_OK( dl_cursor_init( Ctx, test_union_simple::TYPE_ID, packed, packed_size, &root ) );
+
+	float   f = 0;
+	int32_t i = 0;
+	EXPECT_DL_ERR_OK( dl_cursor_read( &root, handle( test_union_simple::TYPE_ID, "item2" ), 0, &f, sizeof(f) ) );
+	EXPECT_EQ( 13.5f, f );
+	EXPECT_DL_ERR_EQ( DL_ERROR_MEMBER_NOT_FOUND, dl_cursor_read( &root, handle( test_union_simple::TYPE_ID, "item1" ), 0, &i, sizeof(i) ) );
+}
+
+TEST_F( DLCursor, read_32bit_ptrs )
+{
+	pack( STRINGIFY( { "StringArray" : { "Strings" : [ "cow", "bells" ] } } ) );
+
+	unsigned char converted[4096];
+	size_t converted_size = 0;
+	ASSERT_DL_ERR_OK( dl_convert( Ctx, StringArray::TYPE_ID, packed, packed_size, converted, sizeof(converted), DL_ENDIAN_HOST, 4, &converted_size ) );
+
+	dl_cursor_t root;
+	ASSERT_DL_ERR_OK( dl_cursor_init( Ctx, StringArray::TYPE_ID, converted, converted_size, &root ) );
+	EXPECT_EQ( 4u, root.ptr_size );
+
+	const char* str = 0x0;
+	EXPECT_DL_ERR_OK( dl_cursor_read_string( &root, handle( StringArray::TYPE_ID, "Strings" ), 1, &str ) );
+	EXPECT_STREQ( "bells", str );
+}
+
+TEST_F( DLCursor, out_of_bounds_offsets_are_rejected )
+{
+	pack( STRINGIFY( { "StringArray" : { "Strings" : [ "cow", "bells" ] } } ) );
+
+	// ... point the array outside of the instance ...
+	uintptr_t bad_offset = 4096;
+	memcpy( packed + DL_HEADER_SIZE, &bad_offset, sizeof(bad_offset) );
+
+	dl_cursor_t root;
+	ASSERT_DL_ERR_OK( dl_cursor_init( Ctx, StringArray::TYPE_ID, packed, packed_size, &root ) );
+
+	const char* str = 0x0;
+	EXPECT_DL_ERR_EQ( DL_ERROR_MALFORMED_DATA, dl_cursor_read_string( &root, handle( StringArray::TYPE_ID, "Strings" ), 0, &str ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_MALFORMED_DATA, dl_cursor_init( Ctx, StringArray::TYPE_ID, packed, DL_HEADER_SIZE + 4, &root ) );
+}
+
+TEST_F( DLCursor, load_subtree )
+{
+	pack( STRINGIFY( { "PtrArray" : { "arr" : [ { "ptr" : "a" }, { "ptr" : "b" }, { "ptr" : "a" } ],
+	                                  "__subdata" : { "a" : { "Int1" : 1, "Int2" : 2 },
+	                                                  "b" : { "Int1" : 3, "Int2" : 4 } } } } ) );
+
+	size_t full_size = 0;
+	size_t sub_size  = 0;
+	EXPECT_DL_ERR_OK( dl_instance_load_subtree( Ctx, PtrArray::TYPE_ID, packed, packed_size, "", PtrArray::TYPE_ID, 0x0, 0, &full_size ) );
+	EXPECT_DL_ERR_OK( dl_instance_load_subtree( Ctx, PtrArray::TYPE_ID, packed, packed_size, "arr[1]", PtrHolder::TYPE_ID, 0x0, 0, &sub_size ) );
+	EXPECT_GT( full_size, sub_size );
+
+	union { PtrHolder holder; uint8_t buffer[256]; } loaded;
+	size_t loaded_size = 0;
+	ASSERT_DL_ERR_OK( dl_instance_load_subtree( Ctx, PtrArray::TYPE_ID, packed, packed_size, "arr[1]", PtrHolder::TYPE_ID, &loaded, sizeof(loaded), &loaded_size ) );
+	EXPECT_EQ( sub_size, loaded_size );
+	ASSERT_NE( (Pods2*)0x0, loaded.holder.ptr );
+	EXPECT_GE( (uint8_t*)loaded.holder.ptr, loaded.buffer );
+	EXPECT_LT( (uint8_t*)loaded.holder.ptr, loaded.buffer + loaded_size );
+	EXPECT_EQ( 3u, loaded.holder.ptr->Int1 );
+	EXPECT_EQ( 4u, loaded.holder.ptr->Int2 );
+
+	// ... ptrs are followed along the path ...
+	union { Pods2 pods; uint8_t buffer[256]; } pods;
+	ASSERT_DL_ERR_OK( dl_instance_load_subtree( Ctx, PtrArray::TYPE_ID, packed, packed_size, "arr[2].ptr", Pods2::TYPE_ID, &pods, sizeof(pods), &loaded_size ) );
+	EXPECT_EQ( sizeof(Pods2), loaded_size );
+	EXPECT_EQ( 1u, pods.pods.Int1 );
+	EXPECT_EQ( 2u, pods.pods.Int2 );
+
+	EXPECT_DL_ERR_EQ( DL_ERROR_BUFFER_TO_SMALL,   dl_instance_load_subtree( Ctx, PtrArray::TYPE_ID, packed, packed_size, "arr[1]", PtrHolder::TYPE_ID, &loaded, sizeof(PtrHolder), 0x0 ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_TYPE_MISMATCH,     dl_instance_load_subtree( Ctx, PtrArray::TYPE_ID, packed, packed_size, "arr[1]", Pods2::TYPE_ID, &loaded, sizeof(loaded), 0x0 ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_INVALID_PARAMETER, dl_instance_load_subtree( Ctx, PtrArray::TYPE_ID, packed, packed_size, "arr[3]", PtrHolder::TYPE_ID, &loaded, sizeof(loaded), 0x0 ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_INVALID_PARAMETER, dl_instance_load_subtree( Ctx, PtrArray::TYPE_ID, packed, packed_size, "arr", PtrHolder::TYPE_ID, &loaded, sizeof(loaded), 0x0 ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_INVALID_PARAMETER, dl_instance_load_subtree( Ctx, PtrArray::TYPE_ID, packed, packed_size, "arr[1", PtrHolder::TYPE_ID, &loaded, sizeof(loaded), 0x0 ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_INVALID_PARAMETER, dl_instance_load_subtree( Ctx, PtrArray::TYPE_ID, packed, packed_size, "arr[1].", PtrHolder::TYPE_ID, &loaded, sizeof(loaded), 0x0 ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_MEMBER_NOT_FOUND,  dl_instance_load_subtree( Ctx, PtrArray::TYPE_ID, packed, packed_size, "arr[1].not_a_member", Pods2::TYPE_ID, &loaded, sizeof(loaded), 0x0 ) );
+}
+
+TEST_F( DLCursor, load_subtree_keeps_cycles )
+{
+	pack( STRINGIFY( { "DoublePtrChain" : { "Int" : 1, "Next" : "n", "Prev" : null,
+	                                        "__subdata" : { "n" : { "Int" : 2, "Next" : null, "Prev" : "__root" } } } } ) );
+
+	// ... convert to 32-bit ptrs to also test loading from another ptr-size ...
+	unsigned char converted[4096];
+	size_t converted_size = 0;
+	ASSERT_DL_ERR_OK( dl_convert( Ctx, DoublePtrChain::TYPE_ID, packed, packed_size, converted, sizeof(converted), DL_ENDIAN_HOST, 4, &converted_size ) );
+
+	union { DoublePtrChain chain; uint8_t buffer[256]; } loaded;
+	ASSERT_DL_ERR_OK( dl_instance_load_subtree( Ctx, DoublePtrChain::TYPE_ID, converted, converted_size, "Next", DoublePtrChain::TYPE_ID, &loaded, sizeof(loaded), 0x0 ) );
+	EXPECT_EQ( 2u, loaded.chain.Int );
+	EXPECT_EQ( (DoublePtrChain*)0x0, loaded.chain.Next );
+	ASSERT_NE( (DoublePtrChain*)0x0, loaded.chain.Prev );
+	EXPECT_EQ( 1u, loaded.chain.Prev->Int );
+	EXPECT_EQ( &loaded.chain, loaded.chain.Prev->Next );
+
+	EXPECT_DL_ERR_EQ( DL_ERROR_MEMBER_NOT_FOUND, dl_instance_load_subtree( Ctx, DoublePtrChain::TYPE_ID, converted, converted_size, "Next.Next", DoublePtrChain::TYPE_ID, &loaded, sizeof(loaded), 0x0 ) );
+}
@@ -0,0 +1,212 @@
+/* copyright (c) 2010 Fredrik Kihlander, see LICENSE for more info */
+
+#include <gtest/gtest.h>
+
+#include <dl/dl.h>
+#include <dl/dl_txt.h>
+#include <dl/dl_diff.h>
+
+#include "dl_test_common.h"
+
+class DLDiff : public DL
+{
+public:
+	unsigned char packed[4096];
+	size_t        packed_size;
+	unsigned char old_loaded[4096];
+	unsigned char new_loaded[4096];
+	unsigned char result[4096];
+	unsigned char diff[4096];
+	size_t        diff_size;
+
+	void load( const char* txt, unsigned char* loaded )
+	{
+		EXPECT_DL_ERR_OK( dl_txt_pack( Ctx, txt, packed, sizeof(packed), &packed_size ) );
+		dl_instance_info_t info;
+		EXPECT_DL_ERR_OK( dl_instance_get_info( packed, packed_size, &info ) );
+		EXPECT_DL_ERR_OK( dl_instance_load( Ctx, info.root_type, loaded, sizeof(new_loaded), packed, packed_size, 0x0 ) );
+	}
+
+	// diff old_txt against new_txt, apply it to old and return the result.
+	template <typename T>
+	T* diff_and_apply( const char* old_txt, const char* new_txt )
+	{
+		load( old_txt, old_loaded );
+		load( new_txt, new_loaded );
+
+		size_t size_only = 0;
+		EXPECT_DL_ERR_OK( dl_instance_diff( Ctx, T::TYPE_ID, old_loaded, new_loaded, 0x0, 0, &size_only ) );
+		EXPECT_DL_ERR_OK( dl_instance_diff( Ctx, T::TYPE_ID, old_loaded, new_loaded, diff, sizeof(diff), &diff_size ) );
+		EXPECT_EQ( size_only, diff_size );
+
+		size_t result_size = 0;
+		EXPECT_DL_ERR_OK( dl_instance_apply_diff( Ctx, T::TYPE_ID, old_loaded, diff, diff_size, result, sizeof(result), &result_size ) );
+
+		uint64_t result_hash, new_hash;
+		EXPECT_DL_ERR_OK( dl_instance_hash( Ctx, T::TYPE_ID, result, DL_HASHFLAGS_NONE, &result_hash ) );
+		EXPECT_DL_ERR_OK( dl_instance_hash( Ctx, T::TYPE_ID, new_loaded, DL_HASHFLAGS_NONE, &new_hash ) );
+		EXPECT_EQ( new_hash, result_hash );
+		return (T*)result;
+	}
+};
+
+TEST_F( DLDiff, unchanged_instance_gives_empty_diff )
+{
+	const char* txt = STRINGIFY( { "Pods" : { "i8" : 1, "i16" : 2, "i32" : 3, "i64" : 4, "u8" : 5, "u16" : 6, "u32" : 7, "u64" : 8, "f32" : 9, "f64" : 10 } } );
+	Pods* res = diff_and_apply<Pods>( txt, txt );
+
+	size_t full_size = 0;
+	EXPECT_DL_ERR_OK( dl_instance_store( Ctx, Pods::TYPE_ID, new_loaded, 0x0, 0, &full_size ) );
+	EXPECT_LT( diff_size, full_size );
+	EXPECT_EQ( 7u, res->u32 );
+}
+
+TEST_F( DLDiff, pod_member )
+{
+	Pods* res = diff_and_apply<Pods>( STRINGIFY( { "Pods" : { "i8" : 1, "i16" : 2, "i32" : 3, "i64" : 4, "u8" : 5, "u16" : 6, "u32" : 7, "u64" : 8, "f32" : 9, "f64" : 10 } } ),
+									  STRINGIFY( { "Pods" : { "i8" : 1, "i16" : 2, "i32" : 3, "i64" : 4, "u8" : 5, "u16" : 6, "u32" : 1337, "u64" : 8, "f32" : 9, "f64" : 10 } } ) );
+	EXPECT_EQ( 1337u, res->u32 );
+	EXPECT_EQ( 8u,    res->u64 );
+
+	unsigned char empty_diff[128];
+	size_t        empty_diff_size;
+	EXPECT_DL_ERR_OK( dl_instance_diff( Ctx, Pods::TYPE_ID, old_loaded, old_loaded, empty_diff, sizeof(empty_diff), &empty_diff_size ) );
+	EXPECT_EQ( empty_diff_size + sizeof(uint32_t) + sizeof(uint32_t), diff_size ); // member-index and value.
+}
+
+TEST_F( DLDiff, array_splice )
+{
+	PodArray1* res = diff_and_apply<PodArray1>( STRINGIFY( { "PodArray1" : { "u32_arr" : [ 1, 2, 3, 4, 5, 6, 7, 8 ] } } ),
+												STRINGIFY( { "PodArray1" : { "u32_arr" : [ 1, 2, 3, 10, 11, 12, 6, 7, 8 ] } } ) );
+	ASSERT_EQ( 9u, res->u32_arr.count );
+	EXPECT_EQ( 10u, res->u32_arr[3] );
+	EXPECT_EQ( 12u, res->u32_arr[5] );
+	EXPECT_EQ( 8u,  res->u32_arr[8] );
+
+	StructArray1* res2 = diff_and_apply<StructArray1>( STRINGIFY( { "StructArray1" : { "Array" : [ { "Int1" : 1, "Int2" : 2 }, { "Int1" : 3, "Int2" : 4 } ] } } ),
+													   STRINGIFY( { "StructArray1" : { "Array" : [ { "Int1" : 1, "Int2" : 5 } ] } } ) );
+	ASSERT_EQ( 1u, res2->Array.count );
+	EXPECT_EQ( 5u, res2->Array[0].Int2 );
+}
+
+TEST_F( DLDiff, strings )
+{
+	StringArray* res = diff_and_apply<StringArray>( STRINGIFY( { "StringArray" : { "Strings" : [ "a", "bb", "ccc" ] } } ),
+													STRINGIFY( { "StringArray" : { "Strings" : [ "a", "dddd", "ccc", "e" ] } } ) );
+	ASSERT_EQ( 4u, res->Strings.count );
+	EXPECT_STREQ( "a",    res->Strings[0] );
+	EXPECT_STREQ( "dddd", res->Strings[1] );
+	EXPECT_STREQ( "ccc",  res->Strings[2] );
+	EXPECT_STREQ( "e",    res->Strings[3] );
+
+	Strings* res2 = diff_and_apply<Strings>( STRINGIFY( { "Strings" : { "Str1" : "apa", "Str2" : "kossa" } } ),
+											 STRINGIFY( { "Strings" : { "Str1" : "apa", "Str2" : "bepa" } } ) );
+	EXPECT_STREQ( "apa",  res2->Str1 );
+	EXPECT_STREQ( "bepa", res2->Str2 );
+}
+
+TEST_F( DLDiff, union_switch )
+{
+	test_union_simple* res = diff_and_apply<test_union_simple>( STRINGIFY( { "test_union_simple" : { "item1" : 1337 } } ),
+																STRINGIFY( { "test_union_simple" : { "item3" : { "i8" : 1, "i16" : 2, "i32" : 3, "i64" : 4, "u8" : 5, "u16" : 6, "u32" : 7, "u64" : 8, "f32" : 9, "f64" : 10 } } } ) );
+	EXPECT_EQ( test_union_simple_type_item3, res->type );
+	EXPECT_EQ( 7u, res->value.item3.u32 );
+}
+
+TEST_F( DLDiff, ptr_target_changed )
+{
+	PtrHolder* res = diff_and_apply<PtrHolder>( STRINGIFY( { "PtrHolder" : { "ptr" : "p", "__subdata" : { "p" : { "Int1" : 1, "Int2" : 2 } } } } ),
+												STRINGIFY( { "PtrHolder" : { "ptr" : "p", "__subdata" : { "p" : { "Int1" : 1, "Int2" : 3 } } } } ) );
+	ASSERT_NE( (Pods2*)0x0, res->ptr );
+	EXPECT_EQ( 3u, res->ptr->Int2 );
+}
+
+TEST_F( DLDiff, changed_ptrs_store_full_instance )
+{
+	PtrHolder* res = diff_and_apply<PtrHolder>( STRINGIFY( { "PtrHolder" : { "ptr" : null } } ),
+												STRINGIFY( { "PtrHolder" : { "ptr" : "p", "__subdata" : { "p" : { "Int1" : 1, "Int2" : 2 } } } } ) );
+	ASSERT_NE( (Pods2*)0x0, res->ptr );
+	EXPECT_EQ( 2u, res->ptr->Int2 );
+
+	res = diff_and_apply<PtrHolder>( STRINGIFY( { "PtrHolder" : { "ptr" : "p", "__subdata" : { "p" : { "Int1" : 1, "Int2" : 2 } } } } ),
+									 STRINGIFY( { "PtrHolder" : { "ptr" : null } } ) );
+	EXPECT_EQ( (Pods2*)0x0, res->ptr );
+}
+
+TEST_F( DLDiff, apply_to_packed )
+{
+	load( STRINGIFY( { "PodArray1" : { "u32_arr" : [ 1, 2, 3 ] } } ), old_loaded );
+	load( STRINGIFY( { "PodArray1" : { "u32_arr" : [ 1, 4 ] } } ),    new_loaded );
+	EXPECT_DL_ERR_OK( dl_instance_diff( Ctx, PodArray1::TYPE_ID, old_loaded, new_loaded, diff, sizeof(diff), &diff_size ) );
+
+	unsigned char old_packed[1024];
+	size_t        old_packed_size;
+	EXPECT_DL_ERR_OK( dl_instance_store( Ctx, PodArray1::TYPE_ID, old_loaded, old_packed, sizeof(old_packed), &old_packed_size ) );
+
+	unsigned char new_packed[1024];
+	size_t        new_packed_size;
+	EXPECT_DL_ERR_OK( dl_instance_apply_diff_packed( Ctx, PodArray1::TYPE_ID, old_packed, old_packed_size, diff, diff_size, new_packed, sizeof(new_packed), &new_packed_size ) );
+	EXPECT_DL_ERR_OK( dl_instance_load( Ctx, PodArray1::TYPE_ID, result, sizeof(result), new_packed, new_packed_size, 0x0 ) );
+
+	PodArray1* res = (PodArray1*)result;
+	ASSERT_EQ( 2u, res->u32_arr.count );
+	EXPECT_EQ( 1u, res->u32_arr[0] );
+	EXPECT_EQ( 4u, res->u32_arr[1] );
+}
+
+TEST_F( DLDiff, errors )
+{
+	load( STRINGIFY( { "PodArray1" : { "u32_arr" : [ 1, 2, 3 ] } } ), old_loaded );
+	load( STRINGIFY( { "PodArray1" : { "u32_arr" : [ 1, 2, 3, 4 ] } } ), new_loaded );
+	EXPECT_DL_ERR_OK( dl_instance_diff( Ctx, PodArray1::TYPE_ID, old_loaded, new_loaded, diff, sizeof(diff), &diff_size ) );
+
+	unsigned char small[8];
+	EXPECT_DL_ERR_EQ( DL_ERROR_BUFFER_TO_SMALL, dl_instance_diff( Ctx, PodArray1::TYPE_ID, old_loaded, new_loaded, small, sizeof(small), 0x0 ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_TYPE_MISMATCH,   dl_instance_apply_diff( Ctx, Pods2::TYPE_ID, old_loaded, diff, diff_size, result, sizeof(result), 0x0 ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_MALFORMED_DATA,  dl_instance_apply_diff( Ctx, PodArray1::TYPE_ID, old_loaded, diff, diff_size - 1, result, sizeof(result), 0x0 ) );
+
+	// the result do not fit in out_instance, memory allocated while applying the diff should still be freed.
+	EXPECT_DL_ERR_EQ( DL_ERROR_BUFFER_TO_SMALL, dl_instance_apply_diff( Ctx, PodArray1::TYPE_ID, old_loaded, diff, diff_size, result, 8, 0x0 ) );
+
+	// splice outside of the array.
+	load( STRINGIFY( { "PodArray1" : { "u32_arr" : [ 1 ] } } ), old_loaded );
+	EXPECT_DL_ERR_EQ( DL_ERROR_MALFORMED_DATA,  dl_instance_apply_diff( Ctx, PodArray1::TYPE_ID, old_loaded, diff, diff_size, result, sizeof(result), 0x0 ) );
+}
+
+TEST_F( DLDiff, edit_shared_array )
+{
+	uint32_t arr1[] = { 1, 2, 3 };
+	uint32_t arr2[] = { 1, 2, 3 };
+	PodArray1 old_sub[] = { { { arr1, DL_ARRAY_LENGTH( arr1 ) } }, { { arr2, DL_ARRAY_LENGTH( arr2 ) } } };
+	PodArray2 old_inst  = { { old_sub, DL_ARRAY_LENGTH( old_sub ) } };
+
+	uint32_t edited[] = { 1, 9, 3 };
+	PodArray1 new_sub[] = { { { edited, DL_ARRAY_LENGTH( edited ) } }, { { arr2, DL_ARRAY_LENGTH( arr2 ) } } };
+	PodArray2 new_inst  = { { new_sub, DL_ARRAY_LENGTH( new_sub ) } };
+	EXPECT_DL_ERR_OK( dl_instance_diff( Ctx, PodArray2::TYPE_ID, &old_inst, &new_inst, diff, sizeof(diff), &diff_size ) );
+
+	// store old with both sub-arrays sharing the same data.
+	dl_store_params_t params;
+	DL_STORE_PARAMS_SET_DEFAULT( params );
+	params.flags = DL_STOREFLAGS_MERGE_IDENTICAL_SUBDATA;
+
+	unsigned char old_packed[1024];
+	size_t        old_packed_size;
+	EXPECT_DL_ERR_OK( dl_instance_store_ex( Ctx, PodArray2::TYPE_ID, &old_inst, old_packed, sizeof(old_packed), &old_packed_size, &params ) );
+	EXPECT_DL_ERR_OK( dl_instance_load( Ctx, PodArray2::TYPE_ID, old_loaded, sizeof(old_loaded), old_packed, old_packed_size, 0x0 ) );
+	PodArray2* old_shared = (PodArray2*)old_loaded;
+	ASSERT_EQ( old_shared->sub_arr[0].u32_arr.data, old_shared->sub_arr[1].u32_arr.data );
+
+	EXPECT_DL_ERR_OK( dl_instance_apply_diff( Ctx, PodArray2::TYPE_ID, old_loaded, diff, diff_size, result, sizeof(result), 0x0 ) );
+	PodArray2* res = (PodArray2*)result;
+	EXPECT_ARRAY_EQ( DL_ARRAY_LENGTH( edited ), edited, res->sub_arr[0].u32_arr.data );
+	EXPECT_ARRAY_EQ( DL_ARRAY_LENGTH( arr2 ),   arr2,   res->sub_arr[1].u32_arr.data );
+	EXPECT_ARRAY_EQ( DL_ARRAY_LENGTH( arr1 ),   arr1,   old_shared->sub_arr[0].u32_arr.data );
+
+	unsigned char new_packed[1024];
+	size_t        new_packed_size;
+	EXPECT_DL_ERR_OK( dl_instance_apply_diff_packed( Ctx, PodArray2::TYPE_ID, old_packed, old_packed_size, diff, diff_size, new_packed, sizeof(new_packed), &new_packed_size ) );
+	EXPECT_DL_ERR_OK( dl_instance_load( Ctx, PodArray2::TYPE_ID, result, sizeof(result), new_packed, new_packed_size, 0x0 ) );
+	EXPECT_ARRAY_EQ( DL_ARRAY_LENGTH( edited ), edited, res->sub_arr[0].u32_arr.data );
+	EXPECT_ARRAY_EQ( DL_ARRAY_LENGTH( arr2 ),   arr2,   res->sub_arr[1].u32_arr.data );
+}
@@ -11,6 +11,8 @@
 #include <dl/dl.h>
 #include <dl/dl_txt.h>
 #include <dl/dl_convert.h>
+#include <dl/dl_reflect.h>
+#include <dl/dl_typelib.h>
 
 #include "dl_test_common.h"
 
@@ -201,6 +203,534 @@ TYPED_TEST( DLBase, per_bug_1 )
 		EXPECT_STREQ( inst.arr[i].str, loaded[0].arr[i].str );
 }
 
+TEST_F(DL, batch_store_load)
+{
+	char shared[] = "cowbell";
+	Strings original[] = { { shared, "moo" }, { "bell", shared }, { shared, shared } };
+
+	size_t batch_size = 0;
+	EXPECT_DL_ERR_OK( dl_instance_store_batch( Ctx, Strings::TYPE_ID, original, DL_ARRAY_LENGTH(original), 0x0, 0, &batch_size, 0x0 ) );
+
+	// one header for all instances and strings shared between the instances are only stored once.
+	size_t single_size = 0;
+	size_t total_single_size = 0;
+	for( size_t i = 0; i < DL_ARRAY_LENGTH(original); ++i )
+	{
+		EXPECT_DL_ERR_OK( dl_instance_calc_size( Ctx, Strings::TYPE_ID, &original[i], &single_size ) );
+		total_single_size += single_size;
+	}
+	EXPECT_LT( batch_size, total_single_size );
+
+	unsigned char packed[1024];
+	memset( packed, 0xFE, sizeof(packed) );
+	size_t produced = 0;
+	EXPECT_DL_ERR_OK( dl_instance_store_batch( Ctx, Strings::TYPE_ID, original, DL_ARRAY_LENGTH(original), packed, batch_size, &produced, 0x0 ) );
+	EXPECT_EQ( batch_size, produced );
+	EXPECT_EQ( 0xFE, packed[batch_size] );
+
+	// a batch can not be loaded as a single instance.
+	Strings single[16];
+	EXPECT_DL_ERR_EQ( DL_ERROR_UNSUPPORTED_OPERATION, dl_instance_load( Ctx, Strings::TYPE_ID, single, sizeof(single), packed, produced, 0x0 ) );
+
+	Strings DL_ALIGN(8) loaded_buffer[32];
+	void* loaded[3];
+	unsigned int count = 0;
+	EXPECT_DL_ERR_EQ( DL_ERROR_BUFFER_TO_SMALL, dl_instance_load_batch( Ctx, Strings::TYPE_ID, loaded_buffer, sizeof(loaded_buffer), packed, produced, loaded, 2, &count, 0x0 ) );
+	EXPECT_EQ( 3u, count );
+
+	size_t consumed = 0;
+	EXPECT_DL_ERR_OK( dl_instance_load_batch( Ctx, Strings::TYPE_ID, loaded_buffer, sizeof(loaded_buffer), packed, produced, loaded, DL_ARRAY_LENGTH(loaded), &count, &consumed ) );
+	EXPECT_EQ( 3u, count );
+	EXPECT_EQ( produced, consumed );
+
+	for( size_t i = 0; i < DL_ARRAY_LENGTH(original); ++i )
+	{
+		Strings* s = (Strings*)loaded[i];
+		EXPECT_STREQ( original[i].Str1, s->Str1 );
+		EXPECT_STREQ( original[i].Str2, s->Str2 );
+	}
+	EXPECT_EQ( ((Strings*)loaded[0])->Str1, ((Strings*)loaded[1])->Str2 );
+	EXPECT_EQ( ((Strings*)loaded[0])->Str1, ((Strings*)loaded[2])->Str1 );
+}
+
+TEST_F(DL, batch_ptr_between_instances)
+{
+	PtrChain original[3];
+	original[0].Int = 1; original[0].Next = &original[1];
+	original[1].Int = 2; original[1].Next = &original[2];
+	original[2].Int = 3; original[2].Next = &original[0];
+
+	unsigned char packed[1024];
+	size_t produced = 0;
+	EXPECT_DL_ERR_OK( dl_instance_store_batch( Ctx, PtrChain::TYPE_ID, original, DL_ARRAY_LENGTH(original), packed, sizeof(packed), &produced, 0x0 ) );
+
+	PtrChain DL_ALIGN(8) loaded_buffer[32];
+	void* loaded[3];
+	unsigned int count = 0;
+	EXPECT_DL_ERR_OK( dl_instance_load_batch( Ctx, PtrChain::TYPE_ID, loaded_buffer, sizeof(loaded_buffer), packed, produced, loaded, DL_ARRAY_LENGTH(loaded), &count, 0x0 ) );
+	EXPECT_EQ( 3u, count );
+
+	for( unsigned int i = 0; i < count; ++i )
+	{
+		PtrChain* chain = (PtrChain*)loaded[i];
+		EXPECT_EQ( original[i].Int, chain->Int );
+		EXPECT_EQ( loaded[(i + 1) % count], chain->Next );
+	}
+}
+
+TEST_F(DL, batch_root_offset_above_4gb)
+{
+	// the offsets of the roots are checked before any instance is read, so instances do not need to be this large.
+	A128BitAlignedType instances[1];
+	instances[0].Int = 1;
+
+	size_t produced = 0;
+	EXPECT_DL_ERR_EQ( DL_ERROR_UNSUPPORTED_OPERATION, dl_instance_store_batch( Ctx, A128BitAlignedType::TYPE_ID, instances, 0x2000000, 0x0, 0, &produced, 0x0 ) );
+	EXPECT_DL_ERR_OK( dl_instance_store_batch( Ctx, A128BitAlignedType::TYPE_ID, instances, 1, 0x0, 0, &produced, 0x0 ) );
+}
+
+TEST_F(DL, checksum_store_load)
+{
+	Strings original = { "cowbell", "more cowbell!" };
+
+	dl_store_params_t store_params;
+	DL_STORE_PARAMS_SET_DEFAULT( store_params );
+	store_params.flags = DL_STOREFLAGS_CHECKSUM;
+
+	unsigned char packed[1024];
+	size_t produced = 0;
+	EXPECT_DL_ERR_OK( dl_instance_store_ex( Ctx, Strings::TYPE_ID, &original, packed, sizeof(packed), &produced, &store_params ) );
+
+	dl_load_params_t load_params;
+	DL_LOAD_PARAMS_SET_DEFAULT( load_params );
+	load_params.flags = DL_LOADFLAGS_VERIFY_CHECKSUM;
+
+	Strings loaded[8];
+	EXPECT_DL_ERR_OK( dl_instance_load_ex( Ctx, Strings::TYPE_ID, loaded, sizeof(loaded), packed, produced, 0x0, &load_params ) );
+	EXPECT_STREQ( original.Str1, loaded[0].Str1 );
+	EXPECT_STREQ( original.Str2, loaded[0].Str2 );
+
+	// checksum survives conversion to other endian and back.
+	dl_endian_t other_endian = DL_ENDIAN_HOST == DL_ENDIAN_LITTLE ? DL_ENDIAN_BIG : DL_ENDIAN_LITTLE;
+	unsigned char converted[1024];
+	unsigned char converted_back[1024];
+	size_t converted_size = 0;
+	EXPECT_DL_ERR_OK( dl_convert( Ctx, Strings::TYPE_ID, packed, produced, converted, sizeof(converted), other_endian, sizeof(void*), &converted_size ) );
+	EXPECT_DL_ERR_OK( dl_convert( Ctx, Strings::TYPE_ID, converted, converted_size, converted_back, sizeof(converted_back), DL_ENDIAN_HOST, sizeof(void*), &converted_size ) );
+	EXPECT_DL_ERR_OK( dl_instance_load_ex( Ctx, Strings::TYPE_ID, loaded, sizeof(loaded), converted_back, converted_size, 0x0, &load_params ) );
+
+	// converting to a too small buffer must not checksum outside of the buffer, heap-allocated to be found by
+	// sanitizers.
+	size_t small_size = produced / 2;
+	unsigned char* small = (unsigned char*)malloc( small_size );
+	EXPECT_DL_ERR_EQ( DL_ERROR_BUFFER_TO_SMALL, dl_convert( Ctx, Strings::TYPE_ID, packed, produced, small, small_size, DL_ENDIAN_HOST, sizeof(void*) == 8 ? 4 : 8, 0x0 ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_BUFFER_TO_SMALL, dl_convert( Ctx, Strings::TYPE_ID, packed, produced, small, small_size, other_endian, sizeof(void*), 0x0 ) );
+	free( small );
+
+	// corrupt the instance-data.
+	packed[produced - 2] ^= 0x20;
+	EXPECT_DL_ERR_EQ( DL_ERROR_CHECKSUM_MISMATCH, dl_instance_load_ex( Ctx, Strings::TYPE_ID, loaded, sizeof(loaded), packed, produced, 0x0, &load_params ) );
+
+	void* loaded_inplace = 0x0;
+	EXPECT_DL_ERR_EQ( DL_ERROR_CHECKSUM_MISMATCH, dl_instance_load_inplace_ex( Ctx, Strings::TYPE_ID, packed, produced, &loaded_inplace, 0x0, &load_params ) );
+
+	// checksum is only verified if requested.
+	EXPECT_DL_ERR_OK( dl_instance_load_ex( Ctx, Strings::TYPE_ID, loaded, sizeof(loaded), packed, produced, 0x0, 0x0 ) );
+}
+
+TEST_F(DL, checksum_verify_without_checksum)
+{
+	Pods original = { 1, 2, 3, 4, 5, 6, 7, 8, 9.0f, 10.0 };
+
+	unsigned char packed[1024];
+	size_t produced = 0;
+	EXPECT_DL_ERR_OK( dl_instance_store( Ctx, Pods::TYPE_ID, &original, packed, sizeof(packed), &produced ) );
+
+	dl_load_params_t load_params;
+	DL_LOAD_PARAMS_SET_DEFAULT( load_params );
+	load_params.flags = DL_LOADFLAGS_VERIFY_CHECKSUM;
+
+	void* loaded = 0x0;
+	EXPECT_DL_ERR_OK( dl_instance_load_inplace_ex( Ctx, Pods::TYPE_ID, packed, produced, &loaded, 0x0, &load_params ) );
+	EXPECT_EQ( original.u64, ((Pods*)loaded)->u64 );
+}
+
+TEST_F(DL, copy_instance)
+{
+	Pods2 pods[2] = { { 1, 2 }, { 3, 4 } };
+	PtrHolder holders[3] = { { &pods[0] }, { &pods[1] }, { &pods[0] } };
+	PtrArray original;
+	original.arr.data  = holders;
+	original.arr.count = DL_ARRAY_LENGTH(holders);
+
+	size_t copy_size = 0;
+	EXPECT_DL_ERR_OK( dl_instance_copy( Ctx, PtrArray::TYPE_ID, &original, 0x0, 0, &copy_size ) );
+
+	size_t store_size = 0;
+	EXPECT_DL_ERR_OK( dl_instance_store( Ctx, PtrArray::TYPE_ID, &original, 0x0, 0, &store_size ) );
+	EXPECT_EQ( store_size - 24, copy_size ); // same as the stored instance-data, without the header.
+
+	union { PtrArray arr; uint8_t buffer[1024]; } copy;
+	size_t produced = 0;
+	EXPECT_DL_ERR_EQ( DL_ERROR_BUFFER_TO_SMALL, dl_instance_copy( Ctx, PtrArray::TYPE_ID, &original, &copy, copy_size - 1, &produced ) );
+	EXPECT_DL_ERR_OK( dl_instance_copy( Ctx, PtrArray::TYPE_ID, &original, &copy, sizeof(copy), &produced ) );
+	EXPECT_EQ( copy_size, produced );
+
+	memset( pods, 0x0, sizeof(pods) ); // ... the copy do not reference the original ...
+
+	ASSERT_EQ( 3u, copy.arr.arr.count );
+	EXPECT_EQ( 1u, copy.arr.arr[0].ptr->Int1 );
+	EXPECT_EQ( 2u, copy.arr.arr[0].ptr->Int2 );
+	EXPECT_EQ( 3u, copy.arr.arr[1].ptr->Int1 );
+	EXPECT_EQ( 4u, copy.arr.arr[1].ptr->Int2 );
+	EXPECT_EQ( copy.arr.arr[0].ptr, copy.arr.arr[2].ptr );
+	EXPECT_GE( (uint8_t*)copy.arr.arr[1].ptr, copy.buffer );
+	EXPECT_LT( (uint8_t*)copy.arr.arr[1].ptr, copy.buffer + produced );
+}
+
+TEST_F(DL, copy_instance_with_cycles_and_strings)
+{
+	DoublePtrChain first  = { 1, 0x0, 0x0 };
+	DoublePtrChain second = { 2, 0x0, &first };
+	first.Next = &second;
+
+	union { DoublePtrChain chain; uint8_t buffer[256]; } copy;
+	EXPECT_DL_ERR_OK( dl_instance_copy( Ctx, DoublePtrChain::TYPE_ID, &first, &copy, sizeof(copy), 0x0 ) );
+	EXPECT_EQ( 1u, copy.chain.Int );
+	EXPECT_EQ( (DoublePtrChain*)0x0, copy.chain.Prev );
+	ASSERT_NE( (DoublePtrChain*)0x0, copy.chain.Next );
+	EXPECT_EQ( 2u, copy.chain.Next->Int );
+	EXPECT_EQ( &copy.chain, copy.chain.Next->Prev );
+
+	Strings strings = { "cowbell", 0x0 };
+	union { Strings strs; uint8_t buffer[256]; } str_copy;
+	EXPECT_DL_ERR_OK( dl_instance_copy( Ctx, Strings::TYPE_ID, &strings, &str_copy, sizeof(str_copy), 0x0 ) );
+	EXPECT_STREQ( "cowbell", str_copy.strs.Str1 );
+	EXPECT_NE( strings.Str1, str_copy.strs.Str1 );
+	EXPECT_EQ( (const char*)0x0, str_copy.strs.Str2 );
+}
+
+TEST_F(DL, instance_hash_skips_padding)
+{
+	Pods a, b;
+	memset( &a, 0x00, sizeof(a) );
+	memset( &b, 0xFF, sizeof(b) ); // garbage in padding
+	Pods values = { 1, 2, 3, 4, 5, 6, 7, 8, 9.0f, 10.0 };
+	a.i8 = b.i8 = values.i8;   a.i16 = b.i16 = values.i16; a.i32 = b.i32 = values.i32; a.i64 = b.i64 = values.i64;
+	a.u8 = b.u8 = values.u8;   a.u16 = b.u16 = values.u16; a.u32 = b.u32 = values.u32; a.u64 = b.u64 = values.u64;
+	a.f32 = b.f32 = values.f32; a.f64 = b.f64 = values.f64;
+
+	uint64_t hash_a, hash_b;
+	int equal;
+	EXPECT_DL_ERR_OK( dl_instance_hash( Ctx, Pods::TYPE_ID, &a, DL_HASHFLAGS_NONE, &hash_a ) );
+	EXPECT_DL_ERR_OK( dl_instance_hash( Ctx, Pods::TYPE_ID, &b, DL_HASHFLAGS_NONE, &hash_b ) );
+	EXPECT_DL_ERR_OK( dl_instance_equal( Ctx, Pods::TYPE_ID, &a, &b, DL_HASHFLAGS_NONE, &equal ) );
+	EXPECT_EQ( hash_a, hash_b );
+	EXPECT_EQ( 1, equal );
+
+	b.u16 = 1337;
+	EXPECT_DL_ERR_OK( dl_instance_hash( Ctx, Pods::TYPE_ID, &b, DL_HASHFLAGS_NONE, &hash_b ) );
+	EXPECT_DL_ERR_OK( dl_instance_equal( Ctx, Pods::TYPE_ID, &a, &b, DL_HASHFLAGS_NONE, &equal ) );
+	EXPECT_NE( hash_a, hash_b );
+	EXPECT_EQ( 0, equal );
+
+	// ... and unused bits of bitfields.
+	TestBits bits_a, bits_b;
+	memset( &bits_a, 0x00, sizeof(bits_a) );
+	memset( &bits_b, 0xFF, sizeof(bits_b) );
+	bits_a.Bit1 = bits_b.Bit1 = 1; bits_a.Bit2 = bits_b.Bit2 = 2; bits_a.Bit3 = bits_b.Bit3 = 3;
+	bits_a.Bit4 = bits_b.Bit4 = 0; bits_a.Bit5 = bits_b.Bit5 = 1; bits_a.Bit6 = bits_b.Bit6 = 5;
+	bits_a.make_it_uneven = bits_b.make_it_uneven = 17;
+	EXPECT_DL_ERR_OK( dl_instance_hash( Ctx, TestBits::TYPE_ID, &bits_a, DL_HASHFLAGS_NONE, &hash_a ) );
+	EXPECT_DL_ERR_OK( dl_instance_hash( Ctx, TestBits::TYPE_ID, &bits_b, DL_HASHFLAGS_NONE, &hash_b ) );
+	EXPECT_DL_ERR_OK( dl_instance_equal( Ctx, TestBits::TYPE_ID, &bits_a, &bits_b, DL_HASHFLAGS_NONE, &equal ) );
+	EXPECT_EQ( hash_a, hash_b );
+	EXPECT_EQ( 1, equal );
+}
+
+TEST_F(DL, instance_hash_canonical_floats)
+{
+	Pods a, b;
+	memset( &a, 0x0, sizeof(a) );
+	memset( &b, 0x0, sizeof(b) );
+	a.f32 = 0.0f;
+	b.f32 = -0.0f;
+	uint64_t nan_a = 0x7FF8000000000001ULL, nan_b = 0xFFF8000000000000ULL;
+	memcpy( &a.f64, &nan_a, sizeof(nan_a) );
+	memcpy( &b.f64, &nan_b, sizeof(nan_b) );
+
+	uint64_t hash_a, hash_b;
+	int equal;
+	EXPECT_DL_ERR_OK( dl_instance_equal( Ctx, Pods::TYPE_ID, &a, &b, DL_HASHFLAGS_NONE, &equal ) );
+	EXPECT_EQ( 0, equal );
+	EXPECT_DL_ERR_OK( dl_instance_hash( Ctx, Pods::TYPE_ID, &a, DL_HASHFLAGS_NONE, &hash_a ) );
+	EXPECT_DL_ERR_OK( dl_instance_hash( Ctx, Pods::TYPE_ID, &b, DL_HASHFLAGS_NONE, &hash_b ) );
+	EXPECT_NE( hash_a, hash_b );
+
+	EXPECT_DL_ERR_OK( dl_instance_equal( Ctx, Pods::TYPE_ID, &a, &b, DL_HASHFLAGS_CANONICAL_FLOATS, &equal ) );
+	EXPECT_EQ( 1, equal );
+	EXPECT_DL_ERR_OK( dl_instance_hash( Ctx, Pods::TYPE_ID, &a, DL_HASHFLAGS_CANONICAL_FLOATS, &hash_a ) );
+	EXPECT_DL_ERR_OK( dl_instance_hash( Ctx, Pods::TYPE_ID, &b, DL_HASHFLAGS_CANONICAL_FLOATS, &hash_b ) );
+	EXPECT_EQ( hash_a, hash_b );
+}
+
+TEST_F(DL, instance_hash_follows_ptrs_and_arrays)
+{
+	// same content in different memory.
+	Pods2 arr_a[3] = { { 1, 2 }, { 3, 4 }, { 5, 6 } };
+	Pods2 arr_b[3] = { { 1, 2 }, { 3, 4 }, { 5, 6 } };
+	StructArray1 a, b;
+	a.Array.data = arr_a; a.Array.count = 3;
+	b.Array.data = arr_b; b.Array.count = 3;
+
+	uint64_t hash_a, hash_b;
+	int equal;
+	EXPECT_DL_ERR_OK( dl_instance_hash( Ctx, StructArray1::TYPE_ID, &a, DL_HASHFLAGS_NONE, &hash_a ) );
+	EXPECT_DL_ERR_OK( dl_instance_hash( Ctx, StructArray1::TYPE_ID, &b, DL_HASHFLAGS_NONE, &hash_b ) );
+	EXPECT_DL_ERR_OK( dl_instance_equal( Ctx, StructArray1::TYPE_ID, &a, &b, DL_HASHFLAGS_NONE, &equal ) );
+	EXPECT_EQ( hash_a, hash_b );
+	EXPECT_EQ( 1, equal );
+
+	b.Array.count = 2;
+	EXPECT_DL_ERR_OK( dl_instance_hash( Ctx, StructArray1::TYPE_ID, &b, DL_HASHFLAGS_NONE, &hash_b ) );
+	EXPECT_DL_ERR_OK( dl_instance_equal( Ctx, StructArray1::TYPE_ID, &a, &b, DL_HASHFLAGS_NONE, &equal ) );
+	EXPECT_NE( hash_a, hash_b );
+	EXPECT_EQ( 0, equal );
+
+	char str_b[] = "cowbell";
+	Strings strs_a = { "cowbell", 0x0 };
+	Strings strs_b = { str_b, 0x0 };
+	EXPECT_DL_ERR_OK( dl_instance_hash( Ctx, Strings::TYPE_ID, &strs_a, DL_HASHFLAGS_NONE, &hash_a ) );
+	EXPECT_DL_ERR_OK( dl_instance_hash( Ctx, Strings::TYPE_ID, &strs_b, DL_HASHFLAGS_NONE, &hash_b ) );
+	EXPECT_EQ( hash_a, hash_b );
+	strs_b.Str2 = "";
+	EXPECT_DL_ERR_OK( dl_instance_hash( Ctx, Strings::TYPE_ID, &strs_b, DL_HASHFLAGS_NONE, &hash_b ) );
+	EXPECT_DL_ERR_OK( dl_instance_equal( Ctx, Strings::TYPE_ID, &strs_a, &strs_b, DL_HASHFLAGS_NONE, &equal ) );
+	EXPECT_NE( hash_a, hash_b ); // null and empty string differ.
+	EXPECT_EQ( 0, equal );
+}
+
+TEST_F(DL, instance_hash_cycles)
+{
+	DoublePtrChain a1 = { 1, 0x0, 0x0 }, a2 = { 2, 0x0, &a1 };
+	DoublePtrChain b1 = { 1, 0x0, 0x0 }, b2 = { 2, 0x0, &b1 };
+	a1.Next = &a2;
+	b1.Next = &b2;
+
+	uint64_t hash_a, hash_b;
+	int equal;
+	EXPECT_DL_ERR_OK( dl_instance_hash( Ctx, DoublePtrChain::TYPE_ID, &a1, DL_HASHFLAGS_NONE, &hash_a ) );
+	EXPECT_DL_ERR_OK( dl_instance_hash( Ctx, DoublePtrChain::TYPE_ID, &b1, DL_HASHFLAGS_NONE, &hash_b ) );
+	EXPECT_DL_ERR_OK( dl_instance_equal( Ctx, DoublePtrChain::TYPE_ID, &a1, &b1, DL_HASHFLAGS_NONE, &equal ) );
+	EXPECT_EQ( hash_a, hash_b );
+	EXPECT_EQ( 1, equal );
+
+	// same values, but b2 points back to itself instead of to b1.
+	b2.Prev = &b2;
+	EXPECT_DL_ERR_OK( dl_instance_hash( Ctx, DoublePtrChain::TYPE_ID, &b1, DL_HASHFLAGS_NONE, &hash_b ) );
+	EXPECT_DL_ERR_OK( dl_instance_equal( Ctx, DoublePtrChain::TYPE_ID, &a1, &b1, DL_HASHFLAGS_NONE, &equal ) );
+	EXPECT_NE( hash_a, hash_b );
+	EXPECT_EQ( 0, equal );
+}
+
+// store instance to a buffer filled with garbage first.
+static size_t store_to_garbage( dl_ctx_t dl_ctx, dl_typeid_t type, const void* instance, unsigned int flags, uint8_t garbage, unsigned char* out_buffer, size_t out_buffer_size )
+{
+	dl_store_params_t store_params;
+	DL_STORE_PARAMS_SET_DEFAULT( store_params );
+	store_params.flags = flags;
+	memset( out_buffer, garbage, out_buffer_size );
+	size_t produced = 0;
+	EXPECT_DL_ERR_OK( dl_instance_store_ex( dl_ctx, type, instance, out_buffer, out_buffer_size, &produced, &store_params ) );
+	return produced;
+}
+
+TEST_F(DL, canonical_store_zeroes_padding)
+{
+	// padding in an array of structs without subdata, unused bits of bitfields and unused bytes of unions.
+	bug_array_alignment_struct descs_a[2], descs_b[2];
+	memset( descs_a, 0x00, sizeof(descs_a) );
+	memset( descs_b, 0xFF, sizeof(descs_b) );
+	for( int i = 0; i < 2; ++i )
+	{
+		descs_a[i].type = descs_b[i].type = (uint32_t)i;
+		descs_a[i].ptr  = descs_b[i].ptr  = 1337 + i;
+		descs_a[i].used_sources = descs_b[i].used_sources = 7;
+	}
+	bug_array_alignment a = { { descs_a, 2 } };
+	bug_array_alignment b = { { descs_b, 2 } };
+
+	unsigned char packed_a[256], packed_b[256];
+	size_t size_a = store_to_garbage( Ctx, bug_array_alignment::TYPE_ID, &a, DL_STOREFLAGS_NONE, 0xAB, packed_a, sizeof(packed_a) );
+	size_t size_b = store_to_garbage( Ctx, bug_array_alignment::TYPE_ID, &b, DL_STOREFLAGS_NONE, 0xCD, packed_b, sizeof(packed_b) );
+	EXPECT_EQ( size_a, size_b );
+	EXPECT_NE( 0, memcmp( packed_a, packed_b, size_a ) );
+
+	size_a = store_to_garbage( Ctx, bug_array_alignment::TYPE_ID, &a, DL_STOREFLAGS_CANONICAL, 0xAB, packed_a, sizeof(packed_a) );
+	size_b = store_to_garbage( Ctx, bug_array_alignment::TYPE_ID, &b, DL_STOREFLAGS_CANONICAL, 0xCD, packed_b, sizeof(packed_b) );
+	ASSERT_EQ( size_a, size_b );
+	EXPECT_EQ( 0, memcmp( packed_a, packed_b, size_a ) );
+
+	bug_array_alignment DL_ALIGN(8) loaded[8];
+	EXPECT_DL_ERR_OK( dl_instance_load( Ctx, bug_array_alignment::TYPE_ID, loaded, sizeof(loaded), packed_b, size_b, 0x0 ) );
+	ASSERT_EQ( 2u, loaded[0].components.count );
+	EXPECT_EQ( 1u,    loaded[0].components[1].type );
+	EXPECT_EQ( 1338u, loaded[0].components[1].ptr );
+	EXPECT_EQ( 7u,    loaded[0].components[1].used_sources );
+
+	TestBits bits_a, bits_b;
+	memset( &bits_a, 0x00, sizeof(bits_a) );
+	memset( &bits_b, 0xFF, sizeof(bits_b) );
+	bits_a.Bit1 = bits_b.Bit1 = 1; bits_a.Bit2 = bits_b.Bit2 = 0; bits_a.Bit3 = bits_b.Bit3 = 5;
+	bits_a.Bit4 = bits_b.Bit4 = 0; bits_a.Bit5 = bits_b.Bit5 = 3; bits_a.Bit6 = bits_b.Bit6 = 2;
+	bits_a.make_it_uneven = bits_b.make_it_uneven = 17;
+	size_a = store_to_garbage( Ctx, TestBits::TYPE_ID, &bits_a, DL_STOREFLAGS_CANONICAL, 0xAB, packed_a, sizeof(packed_a) );
+	size_b = store_to_garbage( Ctx, TestBits::TYPE_ID, &bits_b, DL_STOREFLAGS_CANONICAL, 0xCD, packed_b, sizeof(packed_b) );
+	ASSERT_EQ( size_a, size_b );
+	EXPECT_EQ( 0, memcmp( packed_a, packed_b, size_a ) );
+
+	test_inline_array_of_unions unions_a, unions_b;
+	memset( &unions_a, 0x00, sizeof(unions_a) );
+	memset( &unions_b, 0xFF, sizeof(unions_b) );
+	for( int i = 0; i < 3; ++i )
+	{
+		unions_a.arr[i].type = unions_b.arr[i].type = test_union_simple_type_item1;
+		unions_a.arr[i].value.item1 = unions_b.arr[i].value.item1 = i;
+	}
+	size_a = store_to_garbage( Ctx, test_inline_array_of_unions::TYPE_ID, &unions_a, DL_STOREFLAGS_CANONICAL, 0xAB, packed_a, sizeof(packed_a) );
+	size_b = store_to_garbage( Ctx, test_inline_array_of_unions::TYPE_ID, &unions_b, DL_STOREFLAGS_CANONICAL, 0xCD, packed_b, sizeof(packed_b) );
+	ASSERT_EQ( size_a, size_b );
+	EXPECT_EQ( 0, memcmp( packed_a, packed_b, size_a ) );
+}
+
+TEST_F(DL, canonical_store_merges_subdata_with_different_padding)
+{
+	bug_array_alignment_struct descs[2][2];
+	memset( descs[0], 0x00, sizeof(descs[0]) );
+	memset( descs[1], 0xFF, sizeof(descs[1]) );
+	for( int arr = 0; arr < 2; ++arr )
+		for( int i = 0; i < 2; ++i )
+		{
+			descs[arr][i].type = (uint32_t)i;
+			descs[arr][i].ptr  = 1337;
+			descs[arr][i].used_sources = 7;
+		}
+
+	// an array of two arrays with equal content is written as one array.
+	bug_array_alignment holders[2] = { { { descs[0], 2 } }, { { descs[1], 2 } } };
+	bug_array_alignment_holder holder = { { holders, 2 } };
+	unsigned char packed_a[512], packed_b[512];
+	size_t merged_size = store_to_garbage( Ctx, bug_array_alignment_holder::TYPE_ID, &holder, DL_STOREFLAGS_CANONICAL | DL_STOREFLAGS_MERGE_IDENTICAL_SUBDATA, 0xAB, packed_a, sizeof(packed_a) );
+	size_t plain_size  = store_to_garbage( Ctx, bug_array_alignment_holder::TYPE_ID, &holder, DL_STOREFLAGS_CANONICAL, 0xCD, packed_b, sizeof(packed_b) );
+	EXPECT_EQ( plain_size - sizeof(descs[0]), merged_size );
+}
+
+TEST_F(DL, layout_fingerprint_store_load)
+{
+	Strings original = { "cowbell", "more cowbell!" };
+
+	dl_store_params_t store_params;
+	DL_STORE_PARAMS_SET_DEFAULT( store_params );
+	size_t plain_size = 0;
+	EXPECT_DL_ERR_OK( dl_instance_store_ex( Ctx, Strings::TYPE_ID, &original, 0x0, 0, &plain_size, &store_params ) );
+
+	store_params.flags = DL_STOREFLAGS_LAYOUT_FINGERPRINT;
+	unsigned char packed[1024];
+	size_t produced = 0;
+	EXPECT_DL_ERR_OK( dl_instance_store_ex( Ctx, Strings::TYPE_ID, &original, packed, sizeof(packed), &produced, &store_params ) );
+	EXPECT_EQ( plain_size + sizeof(uint32_t), produced );
+
+	dl_type_info_t type_info;
+	EXPECT_DL_ERR_OK( dl_reflect_get_type_info( Ctx, Strings::TYPE_ID, &type_info ) );
+	EXPECT_NE( 0u, type_info.layout_fingerprint );
+
+	dl_instance_info_t info;
+	EXPECT_DL_ERR_OK( dl_instance_get_info( packed, produced, &info ) );
+	EXPECT_EQ( type_info.layout_fingerprint, info.layout_fingerprint );
+	EXPECT_EQ( plain_size - 24, info.load_size );
+
+	// fingerprint survives conversion to other endian and ptr-size and back.
+	dl_endian_t other_endian = DL_ENDIAN_HOST == DL_ENDIAN_LITTLE ? DL_ENDIAN_BIG : DL_ENDIAN_LITTLE;
+	unsigned int other_ptr_size = sizeof(void*) == 8 ? 4 : 8;
+	unsigned char converted[1024];
+	unsigned char converted_back[1024];
+	size_t converted_size = 0;
+	EXPECT_DL_ERR_OK( dl_convert( Ctx, Strings::TYPE_ID, packed, produced, converted, sizeof(converted), other_endian, other_ptr_size, &converted_size ) );
+	EXPECT_DL_ERR_OK( dl_instance_get_info( converted, converted_size, &info ) );
+	EXPECT_EQ( type_info.layout_fingerprint, info.layout_fingerprint );
+	EXPECT_DL_ERR_OK( dl_convert( Ctx, Strings::TYPE_ID, converted, converted_size, converted_back, sizeof(converted_back), DL_ENDIAN_HOST, sizeof(void*), &converted_size ) );
+	EXPECT_EQ( produced, converted_size );
+	EXPECT_EQ( 0, memcmp( packed, converted_back, produced ) );
+
+	Strings loaded[8];
+	size_t consumed = 0;
+	EXPECT_DL_ERR_OK( dl_instance_load( Ctx, Strings::TYPE_ID, loaded, sizeof(loaded), packed, produced, &consumed ) );
+	EXPECT_EQ( produced, consumed );
+	EXPECT_STREQ( original.Str1, loaded[0].Str1 );
+	EXPECT_STREQ( original.Str2, loaded[0].Str2 );
+
+	// the fingerprint is part of the packed instance.
+	void* loaded_inplace = 0x0;
+	EXPECT_DL_ERR_EQ( DL_ERROR_MALFORMED_DATA, dl_instance_load_inplace( Ctx, Strings::TYPE_ID, packed, produced - 1, &loaded_inplace, 0x0 ) );
+	EXPECT_DL_ERR_OK( dl_instance_load_inplace( Ctx, Strings::TYPE_ID, packed, produced, &loaded_inplace, &consumed ) );
+	EXPECT_EQ( produced, consumed );
+	EXPECT_STREQ( original.Str2, ((Strings*)loaded_inplace)->Str2 );
+}
+
+TEST_F(DL, layout_fingerprint_mismatch)
+{
+	Strings original = { "cowbell", "more cowbell!" };
+
+	dl_store_params_t store_params;
+	DL_STORE_PARAMS_SET_DEFAULT( store_params );
+	store_params.flags = DL_STOREFLAGS_LAYOUT_FINGERPRINT;
+	unsigned char packed[1024];
+	size_t produced = 0;
+	EXPECT_DL_ERR_OK( dl_instance_store_ex( Ctx, Strings::TYPE_ID, &original, packed, sizeof(packed), &produced, &store_params ) );
+
+	// a context where "Strings" has its members in another order.
+	const char reordered_typelib[] = STRINGIFY({
+		"types" : {
+			"Strings" : { "members" : [ { "name" : "Str2", "type" : "string" }, { "name" : "Str1", "type" : "string" } ] }
+		}
+	});
+
+	dl_ctx_t other_ctx;
+	dl_create_params_t p;
+	DL_CREATE_PARAMS_SET_DEFAULT(p);
+	EXPECT_DL_ERR_OK( dl_context_create( &other_ctx, &p ) );
+	EXPECT_DL_ERR_OK( dl_context_load_txt_type_library( other_ctx, reordered_typelib, sizeof(reordered_typelib)-1 ) );
+
+	dl_type_info_t this_info;
+	dl_type_info_t other_info;
+	EXPECT_DL_ERR_OK( dl_reflect_get_type_info( Ctx,       Strings::TYPE_ID, &this_info ) );
+	EXPECT_DL_ERR_OK( dl_reflect_get_type_info( other_ctx, Strings::TYPE_ID, &other_info ) );
+	EXPECT_EQ( this_info.size, other_info.size );
+	EXPECT_NE( this_info.layout_fingerprint, other_info.layout_fingerprint );
+
+	Strings loaded[8];
+	EXPECT_DL_ERR_EQ( DL_ERROR_TYPE_LAYOUT_MISMATCH, dl_instance_load( other_ctx, Strings::TYPE_ID, loaded, sizeof(loaded), packed, produced, 0x0 ) );
+
+	unsigned char converted[1024];
+	dl_endian_t other_endian = DL_ENDIAN_HOST == DL_ENDIAN_LITTLE ? DL_ENDIAN_BIG : DL_ENDIAN_LITTLE;
+	EXPECT_DL_ERR_EQ( DL_ERROR_TYPE_LAYOUT_MISMATCH, dl_convert( other_ctx, Strings::TYPE_ID, packed, produced, converted, sizeof(converted), other_endian, sizeof(void*), 0x0 ) );
+
+	char txt[1024];
+	EXPECT_DL_ERR_EQ( DL_ERROR_TYPE_LAYOUT_MISMATCH, dl_txt_unpack( other_ctx, Strings::TYPE_ID, packed, produced, txt, sizeof(txt), 0x0 ) );
+
+	void* loaded_inplace = 0x0;
+	EXPECT_DL_ERR_EQ( DL_ERROR_TYPE_LAYOUT_MISMATCH, dl_instance_load_inplace( other_ctx, Strings::TYPE_ID, packed, produced, &loaded_inplace, 0x0 ) );
+
+	// a truncated fingerprint is malformed data.
+	EXPECT_DL_ERR_EQ( DL_ERROR_MALFORMED_DATA, dl_instance_load( Ctx, Strings::TYPE_ID, loaded, sizeof(loaded), packed, produced - 1, 0x0 ) );
+
+	// data without fingerprint is not checked.
+	EXPECT_DL_ERR_OK( dl_instance_store( Ctx, Strings::TYPE_ID, &original, packed, sizeof(packed), &produced ) );
+	EXPECT_DL_ERR_OK( dl_instance_load( other_ctx, Strings::TYPE_ID, loaded, sizeof(loaded), packed, produced, 0x0 ) );
+
+	dl_context_destroy( other_ctx );
+}
+
 TEST(DLMisc, endian_is_correct)
 {
 	// Test that DL_ENDIAN_HOST is set correctly
@@ -142,3 +142,250 @@ TEST_F(DLError, version_mismatch_returned)
 		EXPECT_DL_ERR_VERSION_MISMATCH( dl_txt_unpack_calc_size( Ctx, unused::TYPE_ID, packed, DL_ARRAY_LENGTH(packed), &dummy ) );
 	#undef EXPECT_DL_ERR_VERSION_MISMATCH
 }
+
+TEST_F(DLError, large_instance_header)
+{
+	Pods p = { 1, 2, 3, 4, 5, 6, 7, 8, 9.0f, 10.0 };
+	unsigned char packed[256];
+	size_t packed_size;
+	EXPECT_DL_ERR_OK( dl_instance_store( Ctx, Pods::TYPE_ID, &p, packed, sizeof(packed), &packed_size ) );
+
+	// instances that fit in 32 bits are still stored with version 1.
+	uint32_t version;
+	memcpy( &version, packed + 4, sizeof(version) );
+	EXPECT_EQ( 1u, version );
+
+	// fake an instance larger than 4GB by setting the high bits of the size in a version 2 header.
+	version = 2;
+	uint16_t size_hi = 1;
+	memcpy( packed + 4,  &version, sizeof(version) );
+	memcpy( packed + 18, &size_hi, sizeof(size_hi) );
+
+	dl_instance_info_t info;
+	EXPECT_DL_ERR_OK( dl_instance_get_info( packed, packed_size, &info ) );
+	if( sizeof(size_t) == 8 )
+	{
+		EXPECT_EQ( ( (uint64_t)1 << 32 ) + packed_size - 24, (uint64_t)info.load_size );
+	}
+
+	Pods loaded;
+	EXPECT_DL_ERR_EQ( DL_ERROR_BUFFER_TO_SMALL, dl_instance_load( Ctx, Pods::TYPE_ID, &loaded, sizeof(loaded), packed, packed_size, 0x0 ) );
+	void* loaded_inplace;
+	EXPECT_DL_ERR_EQ( DL_ERROR_MALFORMED_DATA, dl_instance_load_inplace( Ctx, Pods::TYPE_ID, packed, packed_size, &loaded_inplace, 0x0 ) );
+
+	// a version 2 header with a size that fits in 32 bits loads as version 1.
+	size_hi = 0;
+	memcpy( packed + 18, &size_hi, sizeof(size_hi) );
+	EXPECT_DL_ERR_OK( dl_instance_load( Ctx, Pods::TYPE_ID, &loaded, sizeof(loaded), packed, packed_size, 0x0 ) );
+	EXPECT_EQ( p.i32, loaded.i32 );
+}
+
+class DLValidate : public DLError
+{
+public:
+	unsigned char packed[1024];
+	size_t        packed_size;
+
+	template <typename T>
+	void store( const T* instance, unsigned int store_flags = DL_STOREFLAGS_NONE )
+	{
+		dl_store_params_t store_params;
+		DL_STORE_PARAMS_SET_DEFAULT( store_params );
+		store_params.flags = store_flags;
+		EXPECT_DL_ERR_OK( dl_instance_store_ex( Ctx, T::TYPE_ID, instance, packed, sizeof(packed), &packed_size, &store_params ) );
+	}
+
+	// patch a pointer-sized value in the packed instance at offset from the start of the instance-data.
+	void set_ptr( size_t offset, uintptr_t value ) { memcpy( packed + 24 + offset, &value, sizeof(value) ); }
+	void set_u32( size_t offset, uint32_t value )  { memcpy( packed + 24 + offset, &value, sizeof(value) ); }
+
+	dl_error_t load( dl_typeid_t type )
+	{
+		dl_load_params_t load_params;
+		DL_LOAD_PARAMS_SET_DEFAULT( load_params );
+		load_params.flags = DL_LOADFLAGS_VALIDATE;
+
+		unsigned char DL_ALIGN(8) loaded[1024];
+		dl_error_t err = dl_instance_load_ex( Ctx, type, loaded, sizeof(loaded), packed, packed_size, 0x0, &load_params );
+
+		// inplace-load validates the same way.
+		void* loaded_inplace;
+		unsigned char DL_ALIGN(8) inplace[1024];
+		memcpy( inplace, packed, packed_size );
+		EXPECT_DL_ERR_EQ( err, dl_instance_load_inplace_ex( Ctx, type, inplace, packed_size, &loaded_inplace, 0x0, &load_params ) );
+		return err;
+	}
+};
+
+TEST_F(DLValidate, valid_data)
+{
+	PtrChain chain[2];
+	chain[0].Int = 1; chain[0].Next = &chain[1];
+	chain[1].Int = 2; chain[1].Next = &chain[0];
+	store( &chain[0] );
+	EXPECT_DL_ERR_OK( load( PtrChain::TYPE_ID ) );
+
+	uint32_t arr[] = { 1, 2, 3, 4 };
+	PodArray1 sub[2];
+	sub[0].u32_arr.data = arr; sub[0].u32_arr.count = DL_ARRAY_LENGTH(arr);
+	sub[1].u32_arr.data = arr; sub[1].u32_arr.count = DL_ARRAY_LENGTH(arr);
+	PodArray2 arrays;
+	arrays.sub_arr.data = sub; arrays.sub_arr.count = DL_ARRAY_LENGTH(sub);
+	store( &arrays, DL_STOREFLAGS_MERGE_IDENTICAL_SUBDATA );
+	EXPECT_DL_ERR_OK( load( PodArray2::TYPE_ID ) );
+
+	const char* strs[] = { "cowbell", "bells", "cowbell" };
+	StringArray str_arr;
+	str_arr.Strings.data = strs; str_arr.Strings.count = DL_ARRAY_LENGTH(strs);
+	store( &str_arr, DL_STOREFLAGS_INTERN_STRINGS );
+	EXPECT_DL_ERR_OK( load( StringArray::TYPE_ID ) );
+
+	PodArray1 empty;
+	empty.u32_arr.data = 0x0; empty.u32_arr.count = 0;
+	store( &empty );
+	EXPECT_DL_ERR_OK( load( PodArray1::TYPE_ID ) );
+}
+
+TEST_F(DLValidate, array_out_of_bounds)
+{
+	uint32_t arr[] = { 1, 2, 3, 4 };
+	PodArray1 original;
+	original.u32_arr.data = arr; original.u32_arr.count = DL_ARRAY_LENGTH(arr);
+
+	store( &original );
+	set_u32( sizeof(void*), 0x10000000 );
+	EXPECT_DL_ERR_EQ( DL_ERROR_MALFORMED_DATA, load( PodArray1::TYPE_ID ) );
+
+	store( &original );
+	set_ptr( 0, 1024 );
+	EXPECT_DL_ERR_EQ( DL_ERROR_MALFORMED_DATA, load( PodArray1::TYPE_ID ) );
+
+	store( &original );
+	set_ptr( 0, 2 ); // unaligned
+	EXPECT_DL_ERR_EQ( DL_ERROR_MALFORMED_DATA, load( PodArray1::TYPE_ID ) );
+}
+
+TEST_F(DLValidate, string_not_terminated)
+{
+	Strings original = { "cowbell", "bell" };
+	store( &original );
+	packed[packed_size - 1] = 'x';
+	EXPECT_DL_ERR_EQ( DL_ERROR_MALFORMED_DATA, load( Strings::TYPE_ID ) );
+
+	store( &original );
+	set_ptr( sizeof(void*), packed_size );
+	EXPECT_DL_ERR_EQ( DL_ERROR_MALFORMED_DATA, load( Strings::TYPE_ID ) );
+}
+
+TEST_F(DLValidate, ptr_out_of_bounds)
+{
+	PtrChain chain[2];
+	chain[0].Int = 1; chain[0].Next = &chain[1];
+	chain[1].Int = 2; chain[1].Next = 0x0;
+
+	store( &chain[0] );
+	set_ptr( sizeof(void*), packed_size - 24 - 4 ); // points to partly outside of the data.
+	EXPECT_DL_ERR_EQ( DL_ERROR_MALFORMED_DATA, load( PtrChain::TYPE_ID ) );
+
+	store( &chain[0] );
+	set_ptr( sizeof(void*), 4 ); // unaligned
+	EXPECT_DL_ERR_EQ( DL_ERROR_MALFORMED_DATA, load( PtrChain::TYPE_ID ) );
+}
+
+TEST_F(DLValidate, overlapping_subdata)
+{
+	// array that overlaps the root, its ptr-slot would be patched twice.
+	const char* strs[] = { "cowbell" };
+	StringArray original;
+	original.Strings.data = strs; original.Strings.count = 1;
+	store( &original );
+	set_ptr( 0, 0 );
+	EXPECT_DL_ERR_EQ( DL_ERROR_MALFORMED_DATA, load( StringArray::TYPE_ID ) );
+}
+
+TEST_F(DLValidate, invalid_union_type)
+{
+	Pods pods = { 1, 2, 3, 4, 5, 6, 7, 8, 9.0f, 10.0 };
+	test_union_ptr original;
+	original.type = test_union_ptr_type_p1;
+	original.value.p1 = &pods;
+	store( &original );
+	set_u32( sizeof(void*), 0xFFFFFFFF );
+	EXPECT_DL_ERR_EQ( DL_ERROR_MALFORMED_DATA, load( test_union_ptr::TYPE_ID ) );
+}
+
+TEST_F(DLValidate, truncated_data)
+{
+	Strings original = { "cowbell", "bell" };
+	store( &original );
+
+	Strings loaded[8];
+	EXPECT_DL_ERR_EQ( DL_ERROR_MALFORMED_DATA, dl_instance_load( Ctx, Strings::TYPE_ID, loaded, sizeof(loaded), packed, packed_size - 1, 0x0 ) );
+
+	void* loaded_inplace;
+	EXPECT_DL_ERR_EQ( DL_ERROR_MALFORMED_DATA, dl_instance_load_inplace( Ctx, Strings::TYPE_ID, packed, packed_size - 1, &loaded_inplace, 0x0 ) );
+
+	dl_instance_info_t info;
+	EXPECT_DL_ERR_EQ( DL_ERROR_MALFORMED_DATA, dl_instance_get_info( packed, 4, &info ) );
+}
+
+static void* failing_alloc( size_t size, void* alloc_ctx )
+{
+	return *(bool*)alloc_ctx ? 0x0 : malloc( size );
+}
+
+static void* failing_realloc( void* ptr, size_t size, size_t old_size, void* alloc_ctx )
+{
+	(void)old_size;
+	return *(bool*)alloc_ctx ? 0x0 : realloc( ptr, size );
+}
+
+static void failing_free( void* ptr, void* alloc_ctx )
+{
+	(void)alloc_ctx;
+	free( ptr );
+}
+
+TEST_F(DLError, out_of_memory_while_patching_ptrs)
+{
+	static const unsigned char typelib[] =
+	{
+		#include "generated/unittest.bin.h"
+	};
+
+	// enough ptrs to not fit in the fixed set of patched ptrs used while loading.
+	PtrChain chain[512];
+	for( uint32_t i = 0; i < DL_ARRAY_LENGTH(chain); ++i )
+	{
+		chain[i].Int  = i;
+		chain[i].Next = &chain[( i + 1 ) % DL_ARRAY_LENGTH(chain)];
+	}
+
+	static unsigned char packed[sizeof(chain) * 2];
+	size_t packed_size = 0;
+	EXPECT_DL_ERR_OK( dl_instance_store( Ctx, PtrChain::TYPE_ID, chain, packed, sizeof(packed), &packed_size ) );
+
+	bool fail_allocs = false;
+	dl_ctx_t tmp_ctx = 0;
+	dl_create_params_t p;
+	DL_CREATE_PARAMS_SET_DEFAULT(p);
+	p.alloc_func   = failing_alloc;
+	p.realloc_func = failing_realloc;
+	p.free_func    = failing_free;
+	p.alloc_ctx    = &fail_allocs;
+	EXPECT_DL_ERR_OK( dl_context_create( &tmp_ctx, &p ) );
+	EXPECT_DL_ERR_OK( dl_context_load_type_library( tmp_ctx, typelib, sizeof(typelib) ) );
+
+	static PtrChain loaded[DL_ARRAY_LENGTH(chain) * 2];
+	EXPECT_DL_ERR_OK( dl_instance_load( tmp_ctx, PtrChain::TYPE_ID, loaded, sizeof(loaded), packed, packed_size, 0x0 ) );
+	EXPECT_EQ( &loaded[0], loaded[DL_ARRAY_LENGTH(chain) - 1].Next );
+
+	fail_allocs = true;
+	EXPECT_DL_ERR_EQ( DL_ERROR_OUT_OF_LIBRARY_MEMORY, dl_instance_load( tmp_ctx, PtrChain::TYPE_ID, loaded, sizeof(loaded), packed, packed_size, 0x0 ) );
+
+	void* loaded_inplace = 0x0;
+	EXPECT_DL_ERR_EQ( DL_ERROR_OUT_OF_LIBRARY_MEMORY, dl_instance_load_inplace( tmp_ctx, PtrChain::TYPE_ID, packed, packed_size, &loaded_inplace, 0x0 ) );
+
+	fail_allocs = false;
+	EXPECT_DL_ERR_OK( dl_context_destroy( tmp_ctx ) );
+}
@@ -0,0 +1,314 @@
+/* copyright (c) 2010 Fredrik Kihlander, see LICENSE for more info */
+
+#include <gtest/gtest.h>
+
+#include <dl/dl.h>
+#include <dl/dl_txt.h>
+#include <dl/dl_convert.h>
+#include <dl/dl_reflect.h>
+#include <dl/dl_typelib.h>
+
+#include "dl_test_common.h"
+
+#include <stdlib.h>
+
+// layout of "Root" and "Item" in new_typelib below.
+struct MigItem
+{
+	double      weight;
+	int32_t     id;
+	const char* tag;
+};
+
+struct MigRoot
+{
+	const char* name;
+	int64_t     count;
+	double      scale;
+	struct { int64_t* data; uint32_t count; } values;
+	struct { MigItem* data; uint32_t count; } items;
+	uint32_t    fixed[3];
+	MigItem*    first;
+	uint32_t    flags;
+	uint32_t    added;
+	struct { int32_t* data; uint32_t count; } added_arr;
+};
+
+static const char old_typelib[] = STRINGIFY({
+	"types" : {
+		"Item" : { "members" : [ { "name" : "id", "type" : "int16" }, { "name" : "weight", "type" : "fp32" } ] },
+		"Root" : {
+			"members" : [
+				{ "name" : "removed", "type" : "uint32" },
+				{ "name" : "count",   "type" : "int16" },
+				{ "name" : "scale",   "type" : "fp32" },
+				{ "name" : "name",    "type" : "string" },
+				{ "name" : "values",  "type" : "int32[]" },
+				{ "name" : "items",   "type" : "Item[]" },
+				{ "name" : "fixed",   "type" : "uint8[2]" },
+				{ "name" : "first",   "type" : "Item*" },
+				{ "name" : "flags",   "type" : "bitfield:3" }
+			]
+		}
+	}
+});
+
+static const char new_typelib[] = STRINGIFY({
+	"types" : {
+		"Item" : {
+			"members" : [
+				{ "name" : "weight", "type" : "fp64" },
+				{ "name" : "id",     "type" : "int32" },
+				{ "name" : "tag",    "type" : "string", "default" : "none" }
+			]
+		},
+		"Root" : {
+			"members" : [
+				{ "name" : "name",      "type" : "string" },
+				{ "name" : "count",     "type" : "int64" },
+				{ "name" : "scale",     "type" : "fp64" },
+				{ "name" : "values",    "type" : "int64[]" },
+				{ "name" : "items",     "type" : "Item[]" },
+				{ "name" : "fixed",     "type" : "uint32[3]" },
+				{ "name" : "first",     "type" : "Item*" },
+				{ "name" : "flags",     "type" : "uint32" },
+				{ "name" : "added",     "type" : "uint32", "default" : 1337 },
+				{ "name" : "added_arr", "type" : "int32[]", "default" : [ 1, 2, 3 ] }
+			]
+		}
+	}
+});
+
+static const char old_instance[] = STRINGIFY({
+	"Root" : {
+		"removed" : 7,
+		"count"   : -3,
+		"scale"   : 0.5,
+		"name"    : "migrated",
+		"values"  : [ 1, -2, 3 ],
+		"items"   : [ { "id" : 1, "weight" : 1.5 }, { "id" : -2, "weight" : 2.5 } ],
+		"fixed"   : [ 4, 5 ],
+		"first"   : "item",
+		"flags"   : 5,
+		"__subdata" : {
+			"item" : { "id" : 3, "weight" : 3.5 }
+		}
+	}
+});
+
+class DLMigrate : public ::testing::Test
+{
+public:
+	dl_ctx_t       old_ctx;
+	dl_ctx_t       new_ctx;
+	unsigned char* packed;
+	size_t         packed_size;
+	unsigned char* migrated;
+	size_t         migrated_size;
+	dl_typeid_t    root_type;
+
+	virtual void SetUp()
+	{
+		dl_create_params_t p;
+		DL_CREATE_PARAMS_SET_DEFAULT(p);
+		EXPECT_DL_ERR_OK( dl_context_create( &old_ctx, &p ) );
+		EXPECT_DL_ERR_OK( dl_context_create( &new_ctx, &p ) );
+		EXPECT_DL_ERR_OK( dl_context_load_txt_type_library( old_ctx, old_typelib, sizeof(old_typelib) - 1 ) );
+		EXPECT_DL_ERR_OK( dl_context_load_txt_type_library( new_ctx, new_typelib, sizeof(new_typelib) - 1 ) );
+		packed   = 0x0;
+		migrated = 0x0;
+		EXPECT_DL_ERR_OK( dl_reflect_get_type_id( new_ctx, "Root", &root_type ) );
+	}
+
+	virtual void TearDown()
+	{
+		free( packed );
+		free( migrated );
+		dl_context_destroy( old_ctx );
+		dl_context_destroy( new_ctx );
+	}
+
+	void pack( dl_ctx_t ctx, const char* txt )
+	{
+		EXPECT_DL_ERR_OK( dl_txt_pack( ctx, txt, 0x0, 0, &packed_size ) );
+		packed = (unsigned char*)malloc( packed_size );
+		EXPECT_DL_ERR_OK( dl_txt_pack( ctx, txt, packed, packed_size, 0x0 ) );
+	}
+
+	void migrate( dl_typeid_t type )
+	{
+		EXPECT_DL_ERR_OK( dl_instance_migrate( old_ctx, new_ctx, type, packed, packed_size, 0x0, 0, &migrated_size ) );
+		migrated = (unsigned char*)malloc( migrated_size + 1 );
+		migrated[migrated_size] = 0xFE;
+
+		size_t produced = 0;
+		EXPECT_DL_ERR_OK( dl_instance_migrate( old_ctx, new_ctx, type, packed, packed_size, migrated, migrated_size, &produced ) );
+		EXPECT_EQ( migrated_size, produced );
+		EXPECT_EQ( 0xFE, migrated[migrated_size] );
+	}
+};
+
+TEST_F( DLMigrate, members_matched_by_name )
+{
+	dl_type_info_t info;
+	EXPECT_DL_ERR_OK( dl_reflect_get_type_info( new_ctx, root_type, &info ) );
+	EXPECT_EQ( sizeof(MigRoot), info.size );
+
+	pack( old_ctx, old_instance );
+	migrate( root_type );
+
+	MigRoot loaded[16];
+	EXPECT_DL_ERR_OK( dl_instance_load( new_ctx, root_type, loaded, sizeof(loaded), migrated, migrated_size, 0x0 ) );
+
+	EXPECT_STREQ( "migrated", loaded[0].name );
+	EXPECT_EQ( -3, loaded[0].count );
+	EXPECT_EQ( 0.5, loaded[0].scale );
+	EXPECT_EQ( 5u, loaded[0].flags );
+
+	ASSERT_EQ( 3u, loaded[0].values.count );
+	EXPECT_EQ(  1, loaded[0].values.data[0] );
+	EXPECT_EQ( -2, loaded[0].values.data[1] );
+	EXPECT_EQ(  3, loaded[0].values.data[2] );
+
+	ASSERT_EQ( 2u, loaded[0].items.count );
+	EXPECT_EQ(  1,  loaded[0].items.data[0].id );
+	EXPECT_EQ(  1.5, loaded[0].items.data[0].weight );
+	EXPECT_STREQ( "none", loaded[0].items.data[0].tag );
+	EXPECT_EQ( -2,  loaded[0].items.data[1].id );
+	EXPECT_EQ(  2.5, loaded[0].items.data[1].weight );
+	EXPECT_STREQ( "none", loaded[0].items.data[1].tag );
+
+	// inline arrays keep the old elements and new elements are 0.
+	EXPECT_EQ( 4u, loaded[0].fixed[0] );
+	EXPECT_EQ( 5u, loaded[0].fixed[1] );
+	EXPECT_EQ( 0u, loaded[0].fixed[2] );
+
+	ASSERT_NE( (MigItem*)0x0, loaded[0].first );
+	EXPECT_EQ( 3, loaded[0].first->id );
+	EXPECT_EQ( 3.5, loaded[0].first->weight );
+	EXPECT_STREQ( "none", loaded[0].first->tag );
+
+	// members only in the new type get their default value.
+	EXPECT_EQ( 1337u, loaded[0].added );
+	ASSERT_EQ( 3u, loaded[0].added_arr.count );
+	EXPECT_EQ( 1, loaded[0].added_arr.data[0] );
+	EXPECT_EQ( 2, loaded[0].added_arr.data[1] );
+	EXPECT_EQ( 3, loaded[0].added_arr.data[2] );
+}
+
+TEST_F( DLMigrate, from_32bit_ptrs )
+{
+	pack( old_ctx, old_instance );
+
+	unsigned char* converted = (unsigned char*)malloc( packed_size );
+	size_t converted_size = 0;
+	EXPECT_DL_ERR_OK( dl_convert( old_ctx, root_type, packed, packed_size, converted, packed_size, DL_ENDIAN_HOST, 4, &converted_size ) );
+	free( packed );
+	packed      = converted;
+	packed_size = converted_size;
+
+	migrate( root_type );
+
+	MigRoot loaded[16];
+	EXPECT_DL_ERR_OK( dl_instance_load( new_ctx, root_type, loaded, sizeof(loaded), migrated, migrated_size, 0x0 ) );
+	EXPECT_STREQ( "migrated", loaded[0].name );
+	ASSERT_EQ( 2u, loaded[0].items.count );
+	EXPECT_EQ( -2, loaded[0].items.data[1].id );
+	ASSERT_NE( (MigItem*)0x0, loaded[0].first );
+	EXPECT_EQ( 3, loaded[0].first->id );
+	ASSERT_EQ( 3u, loaded[0].added_arr.count );
+	EXPECT_EQ( 3, loaded[0].added_arr.data[2] );
+}
+
+TEST_F( DLMigrate, buffer_to_small )
+{
+	pack( old_ctx, old_instance );
+
+	size_t needed = 0;
+	EXPECT_DL_ERR_OK( dl_instance_migrate( old_ctx, new_ctx, root_type, packed, packed_size, 0x0, 0, &needed ) );
+
+	unsigned char* out = (unsigned char*)malloc( needed );
+	EXPECT_DL_ERR_EQ( DL_ERROR_BUFFER_TO_SMALL, dl_instance_migrate( old_ctx, new_ctx, root_type, packed, packed_size, out, needed - 1, 0x0 ) );
+	EXPECT_DL_ERR_OK( dl_instance_migrate( old_ctx, new_ctx, root_type, packed, packed_size, out, needed, 0x0 ) );
+	free( out );
+
+	EXPECT_DL_ERR_EQ( DL_ERROR_MALFORMED_DATA, dl_instance_migrate( old_ctx, new_ctx, root_type, packed, packed_size - 1, 0x0, 0, &needed ) );
+}
+
+TEST_F( DLMigrate, added_member_without_default )
+{
+	const char typelib[] = STRINGIFY({
+		"types" : {
+			"Item" : { "members" : [ { "name" : "id", "type" : "int16" }, { "name" : "weight", "type" : "fp32" }, { "name" : "new", "type" : "uint8" } ] }
+		}
+	});
+	dl_context_destroy( new_ctx );
+	dl_create_params_t p;
+	DL_CREATE_PARAMS_SET_DEFAULT(p);
+	EXPECT_DL_ERR_OK( dl_context_create( &new_ctx, &p ) );
+	EXPECT_DL_ERR_OK( dl_context_load_txt_type_library( new_ctx, typelib, sizeof(typelib) - 1 ) );
+
+	dl_typeid_t item_type;
+	EXPECT_DL_ERR_OK( dl_reflect_get_type_id( old_ctx, "Item", &item_type ) );
+
+	pack( old_ctx, STRINGIFY( { "Item" : { "id" : 1, "weight" : 2 } } ) );
+	size_t needed = 0;
+	EXPECT_DL_ERR_EQ( DL_ERROR_TYPE_MISMATCH, dl_instance_migrate( old_ctx, new_ctx, item_type, packed, packed_size, 0x0, 0, &needed ) );
+}
+
+TEST_F( DLMigrate, incompatible_member )
+{
+	const char typelib[] = STRINGIFY({
+		"types" : {
+			"Item" : { "members" : [ { "name" : "id", "type" : "string" }, { "name" : "weight", "type" : "fp32" } ] }
+		}
+	});
+	dl_context_destroy( new_ctx );
+	dl_create_params_t p;
+	DL_CREATE_PARAMS_SET_DEFAULT(p);
+	EXPECT_DL_ERR_OK( dl_context_create( &new_ctx, &p ) );
+	EXPECT_DL_ERR_OK( dl_context_load_txt_type_library( new_ctx, typelib, sizeof(typelib) - 1 ) );
+
+	dl_typeid_t item_type;
+	EXPECT_DL_ERR_OK( dl_reflect_get_type_id( old_ctx, "Item", &item_type ) );
+
+	pack( old_ctx, STRINGIFY( { "Item" : { "id" : 1, "weight" : 2 } } ) );
+	size_t needed = 0;
+	EXPECT_DL_ERR_EQ( DL_ERROR_TYPE_MISMATCH, dl_instance_migrate( old_ctx, new_ctx, item_type, packed, packed_size, 0x0, 0, &needed ) );
+}
+
+TEST_F( DLMigrate, union_member )
+{
+	const char old_lib[] = STRINGIFY({
+		"unions" : { "U" : { "members" : [ { "name" : "i", "type" : "int32" }, { "name" : "s", "type" : "string" } ] } }
+	});
+	const char new_lib[] = STRINGIFY({
+		"unions" : { "U" : { "members" : [ { "name" : "s", "type" : "string" }, { "name" : "f", "type" : "fp64" }, { "name" : "i", "type" : "int64" } ] } }
+	});
+
+	dl_context_destroy( old_ctx );
+	dl_context_destroy( new_ctx );
+	dl_create_params_t p;
+	DL_CREATE_PARAMS_SET_DEFAULT(p);
+	EXPECT_DL_ERR_OK( dl_context_create( &old_ctx, &p ) );
+	EXPECT_DL_ERR_OK( dl_context_create( &new_ctx, &p ) );
+	EXPECT_DL_ERR_OK( dl_context_load_txt_type_library( old_ctx, old_lib, sizeof(old_lib) - 1 ) );
+	EXPECT_DL_ERR_OK( dl_context_load_txt_type_library( new_ctx, new_lib, sizeof(new_lib) - 1 ) );
+
+	dl_typeid_t union_type;
+	EXPECT_DL_ERR_OK( dl_reflect_get_type_id( old_ctx, "U", &union_type ) );
+
+	pack( old_ctx, STRINGIFY( { "U" : { "i" : -17 } } ) );
+	migrate( union_type );
+
+	char txt[256];
+	EXPECT_DL_ERR_OK( dl_txt_unpack( new_ctx, union_type, migrated, migrated_size, txt, sizeof(txt), 0x0 ) );
+
+	free( packed );
+	free( migrated );
+	migrated = 0x0;
+	pack( new_ctx, txt );
+	struct { int64_t i; uint32_t type; } loaded[4];
+	EXPECT_DL_ERR_OK( dl_instance_load( new_ctx, union_type, loaded, sizeof(loaded), packed, packed_size, 0x0 ) );
+	EXPECT_EQ( -17, loaded[0].i );
+}
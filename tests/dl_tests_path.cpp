@@ -0,0 +1,232 @@
+/* copyright (c) 2010 Fredrik Kihlander, see LICENSE for more info */
+
+#include <gtest/gtest.h>
+
+#include <dl/dl.h>
+#include <dl/dl_txt.h>
+#include <dl/dl_convert.h>
+#include <dl/dl_path.h>
+
+#include "dl_test_common.h"
+
+class DLPath : public DL
+{
+public:
+	unsigned char packed[4096];
+	size_t        packed_size;
+	unsigned char loaded[4096];
+
+	template <typename T>
+	T* pack_and_load( const char* txt )
+	{
+		EXPECT_DL_ERR_OK( dl_txt_pack( Ctx, txt, packed, sizeof(packed), &packed_size ) );
+		EXPECT_DL_ERR_OK( dl_instance_load( Ctx, T::TYPE_ID, loaded, sizeof(loaded), packed, packed_size, 0x0 ) );
+		return (T*)loaded;
+	}
+
+	dl_path_t compile( dl_typeid_t type, const char* path )
+	{
+		dl_path_t p = 0x0;
+		EXPECT_DL_ERR_OK( dl_path_compile( Ctx, type, path, &p ) );
+		return p;
+	}
+};
+
+TEST_F( DLPath, get_and_set_nested_struct_members )
+{
+	Pod2InStructInStruct* inst = pack_and_load<Pod2InStructInStruct>( STRINGIFY( { "Pod2InStructInStruct" : { "p2struct" : { "Pod1" : { "Int1" : 1, "Int2" : 2 }, "Pod2" : { "Int1" : 3, "Int2" : 4 } } } } ) );
+
+	dl_path_t path = compile( Pod2InStructInStruct::TYPE_ID, "p2struct.Pod2.Int1" );
+	ASSERT_NE( (dl_path_t)0x0, path );
+
+	uint32_t val = 0;
+	EXPECT_DL_ERR_OK( dl_path_get( path, inst, &val, sizeof(val) ) );
+	EXPECT_EQ( 3u, val );
+
+	val = 1337;
+	EXPECT_DL_ERR_OK( dl_path_set( path, inst, &val, sizeof(val) ) );
+	EXPECT_EQ( 1337u, inst->p2struct.Pod2.Int1 );
+	EXPECT_EQ( 1u,    inst->p2struct.Pod1.Int1 );
+
+	val = 0;
+	EXPECT_DL_ERR_OK( dl_path_get_packed( path, packed, packed_size, &val, sizeof(val) ) );
+	EXPECT_EQ( 3u, val );
+
+	uint8_t small;
+	EXPECT_DL_ERR_EQ( DL_ERROR_TYPE_MISMATCH, dl_path_get( path, inst, &small, sizeof(small) ) );
+	EXPECT_DL_ERR_OK( dl_path_free( path ) );
+}
+
+TEST_F( DLPath, arrays_and_ptrs )
+{
+	StructArray1* arr = pack_and_load<StructArray1>( STRINGIFY( { "StructArray1" : { "Array" : [ { "Int1" : 1, "Int2" : 2 }, { "Int1" : 3, "Int2" : 4 } ] } } ) );
+
+	dl_path_t path = compile( StructArray1::TYPE_ID, "Array[1].Int2" );
+	uint32_t val = 0;
+	EXPECT_DL_ERR_OK( dl_path_get( path, arr, &val, sizeof(val) ) );
+	EXPECT_EQ( 4u, val );
+	EXPECT_DL_ERR_OK( dl_path_get_packed( path, packed, packed_size, &val, sizeof(val) ) );
+	EXPECT_EQ( 4u, val );
+	dl_path_free( path );
+
+	// ... out of bounds of the loaded array is detected when evaluated ...
+	path = compile( StructArray1::TYPE_ID, "Array[2].Int2" );
+	EXPECT_DL_ERR_EQ( DL_ERROR_INVALID_PARAMETER, dl_path_get( path, arr, &val, sizeof(val) ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_INVALID_PARAMETER, dl_path_get_packed( path, packed, packed_size, &val, sizeof(val) ) );
+	dl_path_free( path );
+
+	PtrArray* ptrs = pack_and_load<PtrArray>( STRINGIFY( { "PtrArray" : { "arr" : [ { "ptr" : "a" }, { "ptr" : null } ], "__subdata" : { "a" : { "Int1" : 5, "Int2" : 6 } } } } ) );
+
+	path = compile( PtrArray::TYPE_ID, "arr[0].ptr.Int2" );
+	EXPECT_DL_ERR_OK( dl_path_get( path, ptrs, &val, sizeof(val) ) );
+	EXPECT_EQ( 6u, val );
+	dl_path_free( path );
+
+	path = compile( PtrArray::TYPE_ID, "arr[1].ptr.Int2" );
+	EXPECT_DL_ERR_EQ( DL_ERROR_MEMBER_NOT_FOUND, dl_path_get( path, ptrs, &val, sizeof(val) ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_MEMBER_NOT_FOUND, dl_path_get_packed( path, packed, packed_size, &val, sizeof(val) ) );
+	dl_path_free( path );
+}
+
+TEST_F( DLPath, strings_bitfields_and_unions )
+{
+	StringArray* strs = pack_and_load<StringArray>( STRINGIFY( { "StringArray" : { "Strings" : [ "cow", "bells" ] } } ) );
+
+	dl_path_t path = compile( StringArray::TYPE_ID, "Strings[1]" );
+	const char* str = 0x0;
+	EXPECT_DL_ERR_OK( dl_path_get( path, strs, &str, sizeof(str) ) );
+	EXPECT_STREQ( "bells", str );
+	EXPECT_DL_ERR_OK( dl_path_get_packed( path, packed, packed_size, &str, sizeof(str) ) );
+	EXPECT_STREQ( "bells", str );
+
+	const char* more = "more";
+	EXPECT_DL_ERR_OK( dl_path_set( path, strs, &more, sizeof(more) ) );
+	EXPECT_STREQ( "more", strs->Strings[1] );
+	dl_path_free( path );
+
+	TestBits* bits = pack_and_load<TestBits>( STRINGIFY( { "TestBits" : { "Bit1" : 1, "Bit2" : 2, "Bit3" : 3, "make_it_uneven" : 4, "Bit4" : 1, "Bit5" : 2, "Bit6" : 5 } } ) );
+
+	path = compile( TestBits::TYPE_ID, "Bit6" );
+	uint8_t bf = 0;
+	EXPECT_DL_ERR_OK( dl_path_get( path, bits, &bf, sizeof(bf) ) );
+	EXPECT_EQ( 5u, bf );
+	bf = 6;
+	EXPECT_DL_ERR_OK( dl_path_set( path, bits, &bf, sizeof(bf) ) );
+	EXPECT_EQ( 6u, bits->Bit6 );
+	EXPECT_EQ( 2u, bits->Bit5 );
+	dl_path_free( path );
+
+	test_union_simple* u = pack_and_load<test_union_simple>( STRINGIFY( { "test_union_simple" : { "item2" : 13.5 } } ) );
+
+	float f = 0;
+	path = compile( test_union_simple::TYPE_ID, "item2" );
+	EXPECT_DL_ERR_OK( dl_path_get( path, u, &f, sizeof(f) ) );
+	EXPECT_EQ( 13.5f, f );
+	dl_path_free( path );
+
+	int32_t i = 0;
+	path = compile( test_union_simple::TYPE_ID, "item1" );
+	EXPECT_DL_ERR_EQ( DL_ERROR_MEMBER_NOT_FOUND, dl_path_get( path, u, &i, sizeof(i) ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_MEMBER_NOT_FOUND, dl_path_get_packed( path, packed, packed_size, &i, sizeof(i) ) );
+	dl_path_free( path );
+}
+
+TEST_F( DLPath, compile_errors )
+{
+	dl_path_t path = 0x0;
+	EXPECT_DL_ERR_EQ( DL_ERROR_MEMBER_NOT_FOUND,  dl_path_compile( Ctx, Pod2InStruct::TYPE_ID, "Pod1.Int3",   &path ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_TYPE_MISMATCH,     dl_path_compile( Ctx, Pod2InStruct::TYPE_ID, "Pod1",        &path ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_TYPE_MISMATCH,     dl_path_compile( Ctx, Pod2InStruct::TYPE_ID, "Pod1.Int1.a", &path ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_TYPE_MISMATCH,     dl_path_compile( Ctx, Pod2InStruct::TYPE_ID, "Pod1[0].Int1", &path ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_INVALID_PARAMETER, dl_path_compile( Ctx, Pod2InStruct::TYPE_ID, "",            &path ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_INVALID_PARAMETER, dl_path_compile( Ctx, Pod2InStruct::TYPE_ID, "Pod1..Int1",  &path ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_INVALID_PARAMETER, dl_path_compile( Ctx, StructArray1::TYPE_ID, "Array.Int1",  &path ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_INVALID_PARAMETER, dl_path_compile( Ctx, WithInlineArray::TYPE_ID, "Array[3]", &path ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_INVALID_PARAMETER, dl_path_compile( Ctx, WithInlineArray::TYPE_ID, "Array[x]", &path ) );
+	EXPECT_EQ( (dl_path_t)0x0, path );
+}
+
+TEST_F( DLPath, set_packed_in_place )
+{
+	pack_and_load<StructArray1>( STRINGIFY( { "StructArray1" : { "Array" : [ { "Int1" : 1, "Int2" : 2 }, { "Int1" : 3, "Int2" : 4 } ] } } ) );
+
+	dl_path_t path = compile( StructArray1::TYPE_ID, "Array[1].Int1" );
+	uint32_t val = 1337;
+	EXPECT_DL_ERR_OK( dl_path_set_packed( path, packed, packed_size, &val, sizeof(val) ) );
+
+	StructArray1* arr = (StructArray1*)loaded;
+	ASSERT_DL_ERR_OK( dl_instance_load( Ctx, StructArray1::TYPE_ID, loaded, sizeof(loaded), packed, packed_size, 0x0 ) );
+	EXPECT_EQ( 1u,    arr->Array[0].Int1 );
+	EXPECT_EQ( 1337u, arr->Array[1].Int1 );
+	EXPECT_EQ( 4u,    arr->Array[1].Int2 );
+
+	// ... other endian and ptr-size is handled without converting the instance ...
+	unsigned char converted[4096];
+	size_t converted_size = 0;
+	dl_endian_t other_endian = DL_ENDIAN_HOST == DL_ENDIAN_LITTLE ? DL_ENDIAN_BIG : DL_ENDIAN_LITTLE;
+	ASSERT_DL_ERR_OK( dl_convert( Ctx, StructArray1::TYPE_ID, packed, packed_size, converted, sizeof(converted), other_endian, 4, &converted_size ) );
+
+	val = 7331;
+	EXPECT_DL_ERR_OK( dl_path_set_packed( path, converted, converted_size, &val, sizeof(val) ) );
+	val = 0;
+	EXPECT_DL_ERR_OK( dl_path_get_packed( path, converted, converted_size, &val, sizeof(val) ) );
+	EXPECT_EQ( 7331u, val );
+
+	ASSERT_DL_ERR_OK( dl_convert( Ctx, StructArray1::TYPE_ID, converted, converted_size, packed, sizeof(packed), DL_ENDIAN_HOST, sizeof(void*), &packed_size ) );
+	ASSERT_DL_ERR_OK( dl_instance_load( Ctx, StructArray1::TYPE_ID, loaded, sizeof(loaded), packed, packed_size, 0x0 ) );
+	EXPECT_EQ( 7331u, arr->Array[1].Int1 );
+	EXPECT_EQ( 4u,    arr->Array[1].Int2 );
+	dl_path_free( path );
+
+	path = compile( StringArray::TYPE_ID, "Strings[0]" );
+	const char* str = "str";
+	EXPECT_DL_ERR_EQ( DL_ERROR_TYPE_MISMATCH, dl_path_set_packed( path, packed, packed_size, &str, sizeof(str) ) );
+	dl_path_free( path );
+}
+
+TEST_F( DLPath, set_packed_bitfield_in_other_endian )
+{
+	pack_and_load<TestBits>( STRINGIFY( { "TestBits" : { "Bit1" : 1, "Bit2" : 2, "Bit3" : 3, "make_it_uneven" : 4, "Bit4" : 1, "Bit5" : 2, "Bit6" : 5 } } ) );
+
+	unsigned char converted[4096];
+	size_t converted_size = 0;
+	dl_endian_t other_endian = DL_ENDIAN_HOST == DL_ENDIAN_LITTLE ? DL_ENDIAN_BIG : DL_ENDIAN_LITTLE;
+	ASSERT_DL_ERR_OK( dl_convert( Ctx, TestBits::TYPE_ID, packed, packed_size, converted, sizeof(converted), other_endian, sizeof(void*), &converted_size ) );
+
+	dl_path_t path = compile( TestBits::TYPE_ID, "Bit5" );
+	uint8_t bf = 1;
+	EXPECT_DL_ERR_OK( dl_path_set_packed( path, converted, converted_size, &bf, sizeof(bf) ) );
+	dl_path_free( path );
+
+	ASSERT_DL_ERR_OK( dl_convert_inplace( Ctx, TestBits::TYPE_ID, converted, converted_size, DL_ENDIAN_HOST, sizeof(void*), &converted_size ) );
+	TestBits* bits = (TestBits*)loaded;
+	ASSERT_DL_ERR_OK( dl_instance_load( Ctx, TestBits::TYPE_ID, loaded, sizeof(loaded), converted, converted_size, 0x0 ) );
+	EXPECT_EQ( 1u, bits->Bit4 );
+	EXPECT_EQ( 1u, bits->Bit5 );
+	EXPECT_EQ( 5u, bits->Bit6 );
+	EXPECT_EQ( 4u, bits->make_it_uneven );
+}
+
+TEST_F( DLPath, set_packed_updates_checksum )
+{
+	Pods2 original = { 1, 2 };
+
+	dl_store_params_t store_params;
+	DL_STORE_PARAMS_SET_DEFAULT( store_params );
+	store_params.flags = DL_STOREFLAGS_CHECKSUM;
+	ASSERT_DL_ERR_OK( dl_instance_store_ex( Ctx, Pods2::TYPE_ID, &original, packed, sizeof(packed), &packed_size, &store_params ) );
+
+	dl_path_t path = compile( Pods2::TYPE_ID, "Int2" );
+	uint32_t val = 3;
+	EXPECT_DL_ERR_OK( dl_path_set_packed( path, packed, packed_size, &val, sizeof(val) ) );
+	dl_path_free( path );
+
+	dl_load_params_t load_params;
+	DL_LOAD_PARAMS_SET_DEFAULT( load_params );
+	load_params.flags = DL_LOADFLAGS_VERIFY_CHECKSUM;
+
+	Pods2 loaded_pods;
+	EXPECT_DL_ERR_OK( dl_instance_load_ex( Ctx, Pods2::TYPE_ID, &loaded_pods, sizeof(loaded_pods), packed, packed_size, 0x0, &load_params ) );
+	EXPECT_EQ( 1u, loaded_pods.Int1 );
+	EXPECT_EQ( 3u, loaded_pods.Int2 );
+}
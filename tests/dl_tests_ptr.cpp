@@ -207,3 +207,40 @@ TYPED_TEST(DLBase, ptr_array)
 	EXPECT_NE( loaded[0].arr[0], loaded[0].arr[1] );
 	EXPECT_EQ( loaded[0].arr[0], loaded[0].arr[2] );
 }
+
+TEST_F(DL, ptr_merge_identical_subdata)
+{
+	Pods2 p1  = { 1, 2 };
+	Pods2 p2  = { 3, 4 };
+	Pods2 p1b = { 1, 2 };
+	Pods2* arr[] = { &p1, &p2, &p1b };
+	ptr_array original;
+	original.arr.data = arr;
+	original.arr.count = DL_ARRAY_LENGTH(arr);
+
+	dl_store_params_t params;
+	DL_STORE_PARAMS_SET_DEFAULT( params );
+	params.flags = DL_STOREFLAGS_MERGE_IDENTICAL_SUBDATA;
+
+	size_t plain_size  = 0;
+	size_t merged_size = 0;
+	EXPECT_DL_ERR_OK( dl_instance_store_ex( Ctx, ptr_array::TYPE_ID, &original, 0x0, 0, &plain_size, 0x0 ) );
+	EXPECT_DL_ERR_OK( dl_instance_store_ex( Ctx, ptr_array::TYPE_ID, &original, 0x0, 0, &merged_size, &params ) );
+	EXPECT_EQ( plain_size - sizeof(Pods2), merged_size );
+
+	unsigned char packed[1024];
+	size_t produced = 0;
+	EXPECT_DL_ERR_OK( dl_instance_store_ex( Ctx, ptr_array::TYPE_ID, &original, packed, sizeof(packed), &produced, &params ) );
+	EXPECT_EQ( merged_size, produced );
+
+	ptr_array loaded[32];
+	EXPECT_DL_ERR_OK( dl_instance_load( Ctx, ptr_array::TYPE_ID, loaded, sizeof(loaded), packed, produced, 0x0 ) );
+
+	EXPECT_EQ( 3u, loaded[0].arr.count );
+	EXPECT_EQ( p1.Int1, loaded[0].arr[0]->Int1 );
+	EXPECT_EQ( p1.Int2, loaded[0].arr[0]->Int2 );
+	EXPECT_EQ( p2.Int1, loaded[0].arr[1]->Int1 );
+	EXPECT_EQ( p2.Int2, loaded[0].arr[1]->Int2 );
+	EXPECT_NE( loaded[0].arr[0], loaded[0].arr[1] );
+	EXPECT_EQ( loaded[0].arr[0], loaded[0].arr[2] );
+}
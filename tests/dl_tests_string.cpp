@@ -1,6 +1,8 @@
 #include <gtest/gtest.h>
 #include "dl_tests_base.h"
 
+#include <dl/dl_convert.h>
+
 TYPED_TEST(DLBase, string)
 {
 	Strings original = { "cow", "bell" } ;
@@ -53,3 +55,93 @@ TYPED_TEST(DLBase, escaped_val_in_string)
 	EXPECT_STREQ(Orig.Str1, Loaded[0].Str1);
 	EXPECT_STREQ(Orig.Str2, Loaded[0].Str2);
 }
+
+TEST_F(DL, string_intern)
+{
+	char str1[] = "cowbell";
+	char str2[] = "cowbell"; // same content, different memory.
+	char moo1[] = "moo";
+	char moo2[] = "moo";
+	const char* array_data[] = { str1, moo1, str2, moo2, str1 };
+	StringArray original = { { array_data, DL_ARRAY_LENGTH(array_data) } };
+
+	dl_store_params_t params;
+	DL_STORE_PARAMS_SET_DEFAULT( params );
+	params.flags = DL_STOREFLAGS_INTERN_STRINGS;
+
+	size_t plain_size  = 0;
+	size_t intern_size = 0;
+	EXPECT_DL_ERR_OK( dl_instance_store_ex( Ctx, StringArray::TYPE_ID, &original, 0x0, 0, &plain_size, 0x0 ) );
+	EXPECT_DL_ERR_OK( dl_instance_store_ex( Ctx, StringArray::TYPE_ID, &original, 0x0, 0, &intern_size, &params ) );
+	// str1 is only stored once even without interning since both references point to the same memory.
+	EXPECT_EQ( plain_size - ( strlen("cowbell") + 1 ) - ( strlen("moo") + 1 ), intern_size );
+
+	unsigned char packed[1024];
+	memset( packed, 0xFE, sizeof(packed) );
+	size_t produced = 0;
+	EXPECT_DL_ERR_OK( dl_instance_store_ex( Ctx, StringArray::TYPE_ID, &original, packed, intern_size, &produced, &params ) );
+	EXPECT_EQ( intern_size, produced );
+	EXPECT_EQ( 0xFE, packed[intern_size] );
+
+	StringArray loaded[10];
+	EXPECT_DL_ERR_OK( dl_instance_load( Ctx, StringArray::TYPE_ID, loaded, sizeof(loaded), packed, produced, 0x0 ) );
+
+	EXPECT_EQ( 5u, loaded[0].Strings.count );
+	for( uint32_t i = 0; i < loaded[0].Strings.count; ++i )
+		EXPECT_STREQ( array_data[i], loaded[0].Strings[i] );
+
+	EXPECT_EQ( loaded[0].Strings[0], loaded[0].Strings[2] );
+	EXPECT_EQ( loaded[0].Strings[0], loaded[0].Strings[4] );
+	EXPECT_EQ( loaded[0].Strings[1], loaded[0].Strings[3] );
+	EXPECT_NE( loaded[0].Strings[0], loaded[0].Strings[1] );
+}
+
+TEST_F(DL, string_intern_convert)
+{
+	Strings original = { "cowbell", "cowbell" };
+
+	dl_store_params_t params;
+	DL_STORE_PARAMS_SET_DEFAULT( params );
+	params.flags = DL_STOREFLAGS_INTERN_STRINGS;
+
+	unsigned char packed[1024];
+	size_t packed_size = 0;
+	EXPECT_DL_ERR_OK( dl_instance_store_ex( Ctx, Strings::TYPE_ID, &original, packed, sizeof(packed), &packed_size, &params ) );
+
+	// shared strings should stay shared when converting.
+	unsigned char converted[1024];
+	size_t converted_size = 0;
+	EXPECT_DL_ERR_OK( dl_convert( Ctx, Strings::TYPE_ID, packed, packed_size, converted, sizeof(converted), DL_ENDIAN_HOST, 4, &converted_size ) );
+
+	unsigned char back[1024];
+	size_t back_size = 0;
+	EXPECT_DL_ERR_OK( dl_convert( Ctx, Strings::TYPE_ID, converted, converted_size, back, sizeof(back), DL_ENDIAN_HOST, sizeof(void*), &back_size ) );
+	EXPECT_EQ( packed_size, back_size );
+
+	Strings loaded[10];
+	EXPECT_DL_ERR_OK( dl_instance_load( Ctx, Strings::TYPE_ID, loaded, sizeof(loaded), back, back_size, 0x0 ) );
+	EXPECT_STREQ( "cowbell", loaded[0].Str1 );
+	EXPECT_EQ( loaded[0].Str1, loaded[0].Str2 );
+}
+
+TEST_F(DL, string_same_memory_stored_once)
+{
+	char str[] = "cowbell";
+	Strings original = { str, str };
+
+	size_t packed_size = 0;
+	EXPECT_DL_ERR_OK( dl_instance_calc_size( Ctx, Strings::TYPE_ID, &original, &packed_size ) );
+
+	Strings other = { "cowbell", "moo" };
+	size_t other_size = 0;
+	EXPECT_DL_ERR_OK( dl_instance_calc_size( Ctx, Strings::TYPE_ID, &other, &other_size ) );
+	EXPECT_EQ( other_size - strlen("moo") - 1, packed_size );
+
+	unsigned char packed[1024];
+	EXPECT_DL_ERR_OK( dl_instance_store( Ctx, Strings::TYPE_ID, &original, packed, sizeof(packed), &packed_size ) );
+
+	Strings loaded[10];
+	EXPECT_DL_ERR_OK( dl_instance_load( Ctx, Strings::TYPE_ID, loaded, sizeof(loaded), packed, packed_size, 0x0 ) );
+	EXPECT_STREQ( "cowbell", loaded[0].Str1 );
+	EXPECT_EQ( loaded[0].Str1, loaded[0].Str2 );
+}
@@ -250,6 +250,37 @@ TEST_F(DLText, default_value_bitfield)
 	EXPECT_EQ(3, loaded.f6);
 }
 
+TEST_F(DLText, default_value_mixed_with_set_members)
+{
+	// members not set should get their default, also when defaults with and without subdata are mixed with set members,
+	// and the result should not depend on what was in the out-buffer before.
+	const char* text_data = STRINGIFY( { "DefaultWithOtherDataBefore" : { "t1" : "apa" } } );
+
+	unsigned char out_data_text1[1024];
+	unsigned char out_data_text2[1024];
+	memset( out_data_text1, 0x00, sizeof(out_data_text1) );
+	memset( out_data_text2, 0xFE, sizeof(out_data_text2) );
+
+	size_t produced1 = 0;
+	size_t produced2 = 0;
+	EXPECT_DL_ERR_OK(dl_txt_pack(Ctx, text_data, out_data_text1, sizeof(out_data_text1), &produced1));
+	EXPECT_DL_ERR_OK(dl_txt_pack(Ctx, text_data, out_data_text2, sizeof(out_data_text2), &produced2));
+	EXPECT_EQ(produced1, produced2);
+	EXPECT_EQ(0, memcmp(out_data_text1, out_data_text2, produced1));
+
+	const char* bf_text_data = STRINGIFY( { "BitfieldDefaultsMulti" : { "f3" : 3 } } );
+	BitfieldDefaultsMulti loaded;
+	EXPECT_DL_ERR_OK(dl_txt_pack(Ctx, bf_text_data, out_data_text2, sizeof(out_data_text2), 0x0));
+	EXPECT_DL_ERR_OK(dl_instance_load(Ctx, BitfieldDefaultsMulti::TYPE_ID, &loaded, sizeof(BitfieldDefaultsMulti), out_data_text2, sizeof(out_data_text2), 0x0));
+
+	EXPECT_EQ(0, loaded.f1);
+	EXPECT_EQ(1, loaded.f2);
+	EXPECT_EQ(3, loaded.f3);
+	EXPECT_EQ(1, loaded.f4);
+	EXPECT_EQ(2, loaded.f5);
+	EXPECT_EQ(3, loaded.f6);
+}
+
 TEST_F(DLText, default_value_bitfield_bool)
 {
 	const char* text_data = STRINGIFY( { "BitfieldDefaultsMulti" : { "f1" : true, "f5" : true } } );
@@ -1409,3 +1440,92 @@ TEST_F( DLText, empty_array_should_fail_if_no_default )
 {
 	dl_txt_test_expect_error<PodsDefaults>(Ctx, STRINGIFY( { "WithInlineArray" : {} } ), DL_ERROR_TXT_MISSING_MEMBER );
 }
+
+TEST_F( DLText, pack_layers_later_layer_overrides )
+{
+	const char* layers[] = {
+		STRINGIFY( { "Pod2InStruct" : { "Pod1" : { "Int1" : 1, "Int2" : 2 }, "Pod2" : { "Int1" : 3, "Int2" : 4 } } } ),
+		STRINGIFY( { "Pod2InStruct" : { "Pod1" : { "Int2" : 22 } } } ),
+		STRINGIFY( { "Pod2InStruct" : { "Pod2" : { "Int1" : 33 }, "Pod1" : { "Int2" : 222 } } } ),
+	};
+
+	unsigned char out_data[1024];
+	size_t produced = 0;
+	ASSERT_DL_ERR_OK( dl_txt_pack_layers( Ctx, layers, DL_ARRAY_LENGTH(layers), out_data, sizeof(out_data), &produced ) );
+
+	size_t calc_size = 0;
+	EXPECT_DL_ERR_OK( dl_txt_pack_layers( Ctx, layers, DL_ARRAY_LENGTH(layers), 0x0, 0, &calc_size ) );
+	EXPECT_EQ( produced, calc_size );
+
+	Pod2InStruct loaded;
+	ASSERT_DL_ERR_OK( dl_instance_load( Ctx, Pod2InStruct::TYPE_ID, &loaded, sizeof(loaded), out_data, produced, 0x0 ) );
+	EXPECT_EQ(   1u, loaded.Pod1.Int1 );
+	EXPECT_EQ( 222u, loaded.Pod1.Int2 );
+	EXPECT_EQ(  33u, loaded.Pod2.Int1 );
+	EXPECT_EQ(   4u, loaded.Pod2.Int2 );
+}
+
+TEST_F( DLText, pack_layers_strings_and_defaults )
+{
+	const char* layers[] = {
+		STRINGIFY( { "DefaultWithOtherDataBefore" : { "t1" : "base" } } ),
+		STRINGIFY( { "DefaultWithOtherDataBefore" : { "t1" : "override" } } ),
+	};
+
+	unsigned char out_data[1024];
+	size_t produced = 0;
+	ASSERT_DL_ERR_OK( dl_txt_pack_layers( Ctx, layers, DL_ARRAY_LENGTH(layers), out_data, sizeof(out_data), &produced ) );
+
+	DefaultWithOtherDataBefore loaded[10];
+	ASSERT_DL_ERR_OK( dl_instance_load( Ctx, DefaultWithOtherDataBefore::TYPE_ID, loaded, sizeof(loaded), out_data, produced, 0x0 ) );
+	EXPECT_STREQ( "override", loaded[0].t1 );
+	EXPECT_STREQ( "who",      loaded[0].Str );
+}
+
+TEST_F( DLText, pack_layers_subdata_per_layer )
+{
+	// "p" is defined in both layers and should resolve to the subdata of the layer setting the ptr. The subdata
+	// of the base layer is not used since both ptrs are overridden.
+	const char* layers[] = {
+		STRINGIFY( { "SimplePtr" : { "Ptr1" : "p", "Ptr2" : null, "__subdata" : { "p" : { "i8" : 1, "i16" : 1, "i32" : 1, "i64" : 1, "u8" : 1, "u16" : 1, "u32" : 1, "u64" : 1, "f32" : 1, "f64" : 1 } } } } ),
+		STRINGIFY( { "SimplePtr" : { "Ptr1" : "p", "Ptr2" : "p", "__subdata" : { "p" : { "i8" : 2, "i16" : 2, "i32" : 2, "i64" : 2, "u8" : 2, "u16" : 2, "u32" : 2, "u64" : 2, "f32" : 2, "f64" : 2 } } } } ),
+	};
+
+	unsigned char out_data[1024];
+	size_t produced = 0;
+	ASSERT_DL_ERR_OK( dl_txt_pack_layers( Ctx, layers, DL_ARRAY_LENGTH(layers), out_data, sizeof(out_data), &produced ) );
+
+	union { SimplePtr ptr; unsigned char buffer[1024]; } loaded;
+	ASSERT_DL_ERR_OK( dl_instance_load( Ctx, SimplePtr::TYPE_ID, loaded.buffer, sizeof(loaded.buffer), out_data, produced, 0x0 ) );
+	ASSERT_NE( (void*)0x0, loaded.ptr.Ptr1 );
+	EXPECT_EQ( loaded.ptr.Ptr1, loaded.ptr.Ptr2 );
+	EXPECT_EQ( 2, loaded.ptr.Ptr1->i8 );
+	EXPECT_EQ( 2.0, loaded.ptr.Ptr1->f64 );
+}
+
+TEST_F( DLText, pack_layers_errors )
+{
+	unsigned char out_data[1024];
+	{
+		const char* layers[] = {
+			STRINGIFY( { "Pods2" : { "Int1" : 1, "Int2" : 2 } } ),
+			STRINGIFY( { "StringArray" : { "Strings" : [] } } ),
+		};
+		EXPECT_DL_ERR_EQ( DL_ERROR_TYPE_MISMATCH, dl_txt_pack_layers( Ctx, layers, DL_ARRAY_LENGTH(layers), out_data, sizeof(out_data), 0x0 ) );
+	}
+	{
+		const char* layers[] = {
+			STRINGIFY( { "Pods2" : { "Int1" : 1 } } ),
+			STRINGIFY( { "Pods2" : { "Int1" : 2 } } ),
+		};
+		EXPECT_DL_ERR_EQ( DL_ERROR_TXT_MISSING_MEMBER, dl_txt_pack_layers( Ctx, layers, DL_ARRAY_LENGTH(layers), out_data, sizeof(out_data), 0x0 ) );
+	}
+	{
+		const char* layers[] = {
+			STRINGIFY( { "Pods2" : { "Int1" : 1, "Int2" : 2 } } ),
+			STRINGIFY( { "Pods2" : { "Int3" : 2 } } ),
+		};
+		EXPECT_DL_ERR_EQ( DL_ERROR_TXT_INVALID_MEMBER, dl_txt_pack_layers( Ctx, layers, DL_ARRAY_LENGTH(layers), out_data, sizeof(out_data), 0x0 ) );
+	}
+	EXPECT_DL_ERR_EQ( DL_ERROR_INVALID_PARAMETER, dl_txt_pack_layers( Ctx, 0x0, 0, out_data, sizeof(out_data), 0x0 ) );
+}
@@ -226,3 +226,306 @@ TEST_F( DLUtil, dl_util_load_non_existing_file )
 }
 
 // store in other endian and load!
+
+TEST_F( DLUtil, stream_write_read )
+{
+	remove( TEMP_FILE_NAME );
+
+	// small buffer to get both buffered and directly written records.
+	dl_util_stream_writer_t writer;
+	EXPECT_DL_ERR_OK( dl_util_stream_writer_open( TEMP_FILE_NAME, 128, 3, 0x0, &writer ) );
+
+	for( int32_t i = 0; i < 10; ++i )
+	{
+		p.i32 = i;
+		EXPECT_DL_ERR_OK( dl_util_stream_writer_append_instance( writer, Ctx, Pods::TYPE_ID, &p ) );
+	}
+
+	Strings str = { "cow", "bell" };
+	unsigned char packed[256];
+	size_t packed_size = 0;
+	EXPECT_DL_ERR_OK( dl_instance_store( Ctx, Strings::TYPE_ID, &str, packed, sizeof(packed), &packed_size ) );
+	EXPECT_DL_ERR_OK( dl_util_stream_writer_append( writer, packed, packed_size ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_MALFORMED_DATA, dl_util_stream_writer_append( writer, packed, 4 ) );
+	EXPECT_DL_ERR_OK( dl_util_stream_writer_close( writer ) );
+
+	dl_util_stream_reader_t reader;
+	EXPECT_DL_ERR_OK( dl_util_stream_reader_open( TEMP_FILE_NAME, 0x0, &reader ) );
+
+	dl_util_stream_record_t record;
+	for( int32_t i = 0; i < 10; ++i )
+	{
+		EXPECT_DL_ERR_OK( dl_util_stream_reader_next( reader, &record ) );
+		EXPECT_EQ( (size_t)i, record.index );
+		EXPECT_EQ( (dl_typeid_t)Pods::TYPE_ID, record.type );
+		EXPECT_EQ( 0u, (uintptr_t)( record.packed_instance + 24 ) % 16 ); // instance-data after the 24 byte header.
+
+		Pods* loaded = 0x0;
+		EXPECT_DL_ERR_OK( dl_instance_load_inplace( Ctx, Pods::TYPE_ID, record.packed_instance, record.packed_instance_size, (void**)&loaded, 0x0 ) );
+		p.i32 = i;
+		check_loaded( loaded );
+	}
+
+	EXPECT_DL_ERR_OK( dl_util_stream_reader_next( reader, &record ) );
+	EXPECT_EQ( (dl_typeid_t)Strings::TYPE_ID, record.type );
+	Strings* loaded_str = 0x0;
+	EXPECT_DL_ERR_OK( dl_instance_load_inplace( Ctx, Strings::TYPE_ID, record.packed_instance, record.packed_instance_size, (void**)&loaded_str, 0x0 ) );
+	EXPECT_STREQ( "cow",  loaded_str->Str1 );
+	EXPECT_STREQ( "bell", loaded_str->Str2 );
+
+	EXPECT_DL_ERR_EQ( DL_ERROR_UTIL_END_OF_STREAM, dl_util_stream_reader_next( reader, &record ) );
+	dl_util_stream_reader_close( reader );
+}
+
+TEST_F( DLUtil, stream_over_aligned_type )
+{
+	remove( TEMP_FILE_NAME );
+
+	dl_util_stream_writer_t writer;
+	EXPECT_DL_ERR_OK( dl_util_stream_writer_open( TEMP_FILE_NAME, 0, 0, 0x0, &writer ) );
+	for( uint32_t i = 0; i < 5; ++i )
+	{
+		A128BitAlignedType aligned;
+		aligned.Int = i;
+		EXPECT_DL_ERR_OK( dl_util_stream_writer_append_instance( writer, Ctx, A128BitAlignedType::TYPE_ID, &aligned ) );
+	}
+	EXPECT_DL_ERR_OK( dl_util_stream_writer_close( writer ) );
+
+	dl_util_stream_reader_t reader;
+	EXPECT_DL_ERR_OK( dl_util_stream_reader_open( TEMP_FILE_NAME, 0x0, &reader ) );
+
+	dl_util_stream_record_t record;
+	for( uint32_t i = 0; i < 5; ++i )
+	{
+		EXPECT_DL_ERR_OK( dl_util_stream_reader_next( reader, &record ) );
+		EXPECT_EQ( (dl_typeid_t)A128BitAlignedType::TYPE_ID, record.type );
+		EXPECT_EQ( 0u, (uintptr_t)( record.packed_instance + 24 ) % 16 ); // instance-data after the 24 byte header.
+
+		// alignment of the type is larger than the one guaranteed by the stream, load to an aligned buffer.
+		A128BitAlignedType loaded[2];
+		EXPECT_DL_ERR_OK( dl_instance_load( Ctx, A128BitAlignedType::TYPE_ID, loaded, sizeof(loaded), record.packed_instance, record.packed_instance_size, 0x0 ) );
+		EXPECT_EQ( i, loaded[0].Int );
+	}
+	EXPECT_DL_ERR_EQ( DL_ERROR_UTIL_END_OF_STREAM, dl_util_stream_reader_next( reader, &record ) );
+	dl_util_stream_reader_close( reader );
+}
+
+TEST_F( DLUtil, stream_append_to_existing )
+{
+	remove( TEMP_FILE_NAME );
+
+	for( int32_t i = 0; i < 3; ++i )
+	{
+		dl_util_stream_writer_t writer;
+		EXPECT_DL_ERR_OK( dl_util_stream_writer_open( TEMP_FILE_NAME, 0, 0, 0x0, &writer ) );
+		p.i32 = i;
+		EXPECT_DL_ERR_OK( dl_util_stream_writer_append_instance( writer, Ctx, Pods::TYPE_ID, &p ) );
+		EXPECT_DL_ERR_OK( dl_util_stream_writer_close( writer ) );
+	}
+
+	dl_util_stream_reader_t reader;
+	EXPECT_DL_ERR_OK( dl_util_stream_reader_open( TEMP_FILE_NAME, 0x0, &reader ) );
+
+	dl_util_stream_record_t record;
+	for( int32_t i = 0; i < 3; ++i )
+	{
+		EXPECT_DL_ERR_OK( dl_util_stream_reader_next( reader, &record ) );
+		Pods* loaded = 0x0;
+		EXPECT_DL_ERR_OK( dl_instance_load_inplace( Ctx, Pods::TYPE_ID, record.packed_instance, record.packed_instance_size, (void**)&loaded, 0x0 ) );
+		EXPECT_EQ( i, loaded->i32 );
+	}
+	EXPECT_DL_ERR_EQ( DL_ERROR_UTIL_END_OF_STREAM, dl_util_stream_reader_next( reader, &record ) );
+	dl_util_stream_reader_close( reader );
+}
+
+TEST_F( DLUtil, stream_seek_with_index )
+{
+	remove( TEMP_FILE_NAME );
+
+	dl_util_stream_writer_t writer;
+	EXPECT_DL_ERR_OK( dl_util_stream_writer_open( TEMP_FILE_NAME, 0, 0, 0x0, &writer ) );
+	for( int32_t i = 0; i < 100; ++i )
+	{
+		p.i32 = i;
+		EXPECT_DL_ERR_OK( dl_util_stream_writer_append_instance( writer, Ctx, Pods::TYPE_ID, &p ) );
+	}
+	EXPECT_DL_ERR_OK( dl_util_stream_writer_close( writer ) );
+
+	dl_util_stream_reader_t reader;
+	EXPECT_DL_ERR_OK( dl_util_stream_reader_open( TEMP_FILE_NAME, 0x0, &reader ) );
+
+	dl_util_stream_record_t record;
+	Pods* loaded = 0x0;
+
+	// seek without index.
+	EXPECT_DL_ERR_OK( dl_util_stream_reader_seek( reader, 42 ) );
+	EXPECT_DL_ERR_OK( dl_util_stream_reader_next( reader, &record ) );
+	EXPECT_EQ( 42u, record.index );
+	EXPECT_DL_ERR_OK( dl_instance_load_inplace( Ctx, Pods::TYPE_ID, record.packed_instance, record.packed_instance_size, (void**)&loaded, 0x0 ) );
+	EXPECT_EQ( 42, loaded->i32 );
+
+	EXPECT_DL_ERR_OK( dl_util_stream_reader_build_index( reader, 8 ) );
+
+	size_t seek_to[] = { 57, 3, 99, 0, 64 };
+	for( size_t i = 0; i < DL_ARRAY_LENGTH(seek_to); ++i )
+	{
+		EXPECT_DL_ERR_OK( dl_util_stream_reader_seek( reader, seek_to[i] ) );
+		EXPECT_DL_ERR_OK( dl_util_stream_reader_next( reader, &record ) );
+		EXPECT_EQ( seek_to[i], record.index );
+		if( seek_to[i] == 42 )
+			continue; // already loaded inplace above.
+		EXPECT_DL_ERR_OK( dl_instance_load_inplace( Ctx, Pods::TYPE_ID, record.packed_instance, record.packed_instance_size, (void**)&loaded, 0x0 ) );
+		EXPECT_EQ( (int32_t)seek_to[i], loaded->i32 );
+	}
+
+	EXPECT_DL_ERR_OK( dl_util_stream_reader_seek( reader, 100 ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_UTIL_END_OF_STREAM, dl_util_stream_reader_next( reader, &record ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_UTIL_END_OF_STREAM, dl_util_stream_reader_seek( reader, 101 ) );
+
+	dl_util_stream_reader_close( reader );
+}
+
+TEST_F( DLUtil, stream_truncated_record )
+{
+	remove( TEMP_FILE_NAME );
+
+	dl_util_stream_writer_t writer;
+	EXPECT_DL_ERR_OK( dl_util_stream_writer_open( TEMP_FILE_NAME, 0, 0, 0x0, &writer ) );
+	EXPECT_DL_ERR_OK( dl_util_stream_writer_append_instance( writer, Ctx, Pods::TYPE_ID, &p ) );
+	EXPECT_DL_ERR_OK( dl_util_stream_writer_append_instance( writer, Ctx, Pods::TYPE_ID, &p ) );
+	EXPECT_DL_ERR_OK( dl_util_stream_writer_close( writer ) );
+
+	// cut the last record in half as if the writer was interrupted.
+	unsigned char file_data[1024];
+	FILE* f = fopen( TEMP_FILE_NAME, "rb" );
+	size_t file_size = fread( file_data, 1, sizeof(file_data), f );
+	fclose( f );
+	f = fopen( TEMP_FILE_NAME, "wb" );
+	fwrite( file_data, 1, file_size - sizeof(Pods) / 2, f );
+	fclose( f );
+
+	dl_util_stream_reader_t reader;
+	EXPECT_DL_ERR_OK( dl_util_stream_reader_open( TEMP_FILE_NAME, 0x0, &reader ) );
+	dl_util_stream_record_t record;
+	EXPECT_DL_ERR_OK( dl_util_stream_reader_next( reader, &record ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_MALFORMED_DATA, dl_util_stream_reader_next( reader, &record ) );
+	dl_util_stream_reader_close( reader );
+}
+
+TEST_F( DLUtil, stream_open_non_stream )
+{
+	EXPECT_DL_ERR_OK( dl_util_store_to_file( Ctx, Pods::TYPE_ID, TEMP_FILE_NAME, DL_UTIL_FILE_TYPE_BINARY, DL_ENDIAN_HOST, sizeof(void*), &p, 0x0 ) );
+
+	dl_util_stream_reader_t reader;
+	EXPECT_DL_ERR_EQ( DL_ERROR_MALFORMED_DATA, dl_util_stream_reader_open( TEMP_FILE_NAME, 0x0, &reader ) );
+	dl_util_stream_writer_t writer;
+	EXPECT_DL_ERR_EQ( DL_ERROR_MALFORMED_DATA, dl_util_stream_writer_open( TEMP_FILE_NAME, 0, 0, 0x0, &writer ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_UTIL_FILE_NOT_FOUND, dl_util_stream_reader_open( "whobb whobb whoob", 0x0, &reader ) );
+}
+
+TEST_F( DLUtil, archive_write_load )
+{
+	const char* names[64];
+	char        name_buffer[64][32];
+	unsigned char packed_buffer[64][256];
+	const unsigned char* packed[64];
+	size_t packed_sizes[64];
+
+	for( int32_t i = 0; i < 64; ++i )
+	{
+		snprintf( name_buffer[i], sizeof(name_buffer[i]), "assets/pods_%d.pods", (int)i );
+		names[i] = name_buffer[i];
+		p.i32 = i;
+		EXPECT_DL_ERR_OK( dl_instance_store( Ctx, Pods::TYPE_ID, &p, packed_buffer[i], sizeof(packed_buffer[i]), &packed_sizes[i] ) );
+		packed[i] = packed_buffer[i];
+	}
+
+	// last one is a different type.
+	Strings str = { "cow", "bell" };
+	EXPECT_DL_ERR_OK( dl_instance_store( Ctx, Strings::TYPE_ID, &str, packed_buffer[63], sizeof(packed_buffer[63]), &packed_sizes[63] ) );
+
+	EXPECT_DL_ERR_OK( dl_util_archive_write( TEMP_FILE_NAME, names, packed, packed_sizes, 64, DL_ENDIAN_HOST ) );
+
+	dl_util_archive_t archive;
+	EXPECT_DL_ERR_OK( dl_util_archive_open( TEMP_FILE_NAME, 0x0, &archive ) );
+	EXPECT_EQ( 64u, dl_util_archive_entry_count( archive ) );
+
+	dl_util_archive_entry_t entry;
+	EXPECT_DL_ERR_OK( dl_util_archive_get_entry( archive, 5, &entry ) );
+	EXPECT_STREQ( "assets/pods_5.pods", entry.name );
+	EXPECT_EQ( (dl_typeid_t)Pods::TYPE_ID, entry.type );
+	EXPECT_EQ( packed_sizes[5], entry.packed_instance_size );
+	EXPECT_DL_ERR_EQ( DL_ERROR_INVALID_PARAMETER, dl_util_archive_get_entry( archive, 64, &entry ) );
+
+	for( int32_t i = 62; i >= 0; --i )
+	{
+		Pods* loaded = 0x0;
+		dl_typeid_t loaded_type = 0;
+		EXPECT_DL_ERR_OK( dl_util_archive_load( Ctx, archive, Pods::TYPE_ID, names[i], (void**)&loaded, &loaded_type ) );
+		EXPECT_EQ( (dl_typeid_t)Pods::TYPE_ID, loaded_type );
+		EXPECT_EQ( 0u, (uintptr_t)loaded % 16 );
+		p.i32 = i;
+		check_loaded( loaded );
+	}
+
+	// loading the same name again returns the same instance.
+	Pods* loaded1 = 0x0;
+	Pods* loaded2 = 0x0;
+	EXPECT_DL_ERR_OK( dl_util_archive_load( Ctx, archive, 0, names[7], (void**)&loaded1, 0x0 ) );
+	EXPECT_DL_ERR_OK( dl_util_archive_load( Ctx, archive, 0, names[7], (void**)&loaded2, 0x0 ) );
+	EXPECT_EQ( loaded1, loaded2 );
+	EXPECT_EQ( 7, loaded2->i32 );
+
+	Strings* loaded_str = 0x0;
+	EXPECT_DL_ERR_EQ( DL_ERROR_TYPE_MISMATCH, dl_util_archive_load( Ctx, archive, Pods::TYPE_ID, names[63], (void**)&loaded_str, 0x0 ) );
+	EXPECT_DL_ERR_OK( dl_util_archive_load( Ctx, archive, 0, names[63], (void**)&loaded_str, 0x0 ) );
+	EXPECT_STREQ( "cow",  loaded_str->Str1 );
+	EXPECT_STREQ( "bell", loaded_str->Str2 );
+
+	EXPECT_DL_ERR_EQ( DL_ERROR_UTIL_FILE_NOT_FOUND, dl_util_archive_load( Ctx, archive, 0, "assets/not_there.pods", (void**)&loaded1, 0x0 ) );
+
+	dl_util_archive_close( archive );
+}
+
+TEST_F( DLUtil, archive_errors )
+{
+	unsigned char packed[256];
+	size_t packed_size = 0;
+	EXPECT_DL_ERR_OK( dl_instance_store( Ctx, Pods::TYPE_ID, &p, packed, sizeof(packed), &packed_size ) );
+
+	const char* names[] = { "a", "b", "a" };
+	const unsigned char* instances[] = { packed, packed, packed };
+	size_t sizes[] = { packed_size, packed_size, packed_size };
+	EXPECT_DL_ERR_EQ( DL_ERROR_INVALID_PARAMETER, dl_util_archive_write( TEMP_FILE_NAME, names, instances, sizes, 3, DL_ENDIAN_HOST ) );
+
+	sizes[1] = 4;
+	EXPECT_DL_ERR_EQ( DL_ERROR_MALFORMED_DATA, dl_util_archive_write( TEMP_FILE_NAME, names, instances, sizes, 2, DL_ENDIAN_HOST ) );
+
+	// empty archive.
+	EXPECT_DL_ERR_OK( dl_util_archive_write( TEMP_FILE_NAME, names, instances, sizes, 0, DL_ENDIAN_HOST ) );
+	dl_util_archive_t archive;
+	EXPECT_DL_ERR_OK( dl_util_archive_open( TEMP_FILE_NAME, 0x0, &archive ) );
+	EXPECT_EQ( 0u, dl_util_archive_entry_count( archive ) );
+	void* loaded;
+	EXPECT_DL_ERR_EQ( DL_ERROR_UTIL_FILE_NOT_FOUND, dl_util_archive_load( Ctx, archive, 0, "a", &loaded, 0x0 ) );
+	dl_util_archive_close( archive );
+
+	// entry with an offset where offset + size overflows.
+	EXPECT_DL_ERR_OK( dl_util_archive_write( TEMP_FILE_NAME, names, instances, sizes, 1, DL_ENDIAN_HOST ) );
+	unsigned char file_data[1024];
+	FILE* file = fopen( TEMP_FILE_NAME, "rb" );
+	ASSERT_NE( (FILE*)0x0, file );
+	size_t file_size = fread( file_data, 1, sizeof(file_data), file );
+	fclose( file );
+
+	uint64_t bad_offset = 0xFFFFFFFFFFFFFFF8ULL; // first toc-entry starts with its offset after the 24 byte header.
+	memcpy( file_data + 24, &bad_offset, sizeof(bad_offset) );
+	file = fopen( TEMP_FILE_NAME, "wb" );
+	ASSERT_NE( (FILE*)0x0, file );
+	EXPECT_EQ( file_size, fwrite( file_data, 1, file_size, file ) );
+	fclose( file );
+	EXPECT_DL_ERR_EQ( DL_ERROR_MALFORMED_DATA, dl_util_archive_open( TEMP_FILE_NAME, 0x0, &archive ) );
+
+	EXPECT_DL_ERR_OK( dl_util_store_to_file( Ctx, Pods::TYPE_ID, TEMP_FILE_NAME, DL_UTIL_FILE_TYPE_BINARY, DL_ENDIAN_HOST, sizeof(void*), &p, 0x0 ) );
+	EXPECT_DL_ERR_EQ( DL_ERROR_MALFORMED_DATA, dl_util_archive_open( TEMP_FILE_NAME, 0x0, &archive ) );
+}
@@ -2,6 +2,7 @@
 #include <dl/dl.h>
 #include <dl/dl_util.h>
 #include <dl/dl_reflect.h>
+#include <dl/dl_compress.h>
 
 #include "getopt/getopt.h"
 
@@ -126,10 +127,121 @@ dl_ctx_t create_ctx()
 	return dl_ctx;
 }
 
+/*
+	Store instance to a malloc:ed buffer in the requested format, compressed if requested.
+*/
+dl_error_t store_instance( dl_ctx_t dl_ctx, dl_typeid_t type, void* instance, const dl_store_params_t* store_params, int compress, unsigned char** out_data, size_t* out_size )
+{
+	size_t size = 0;
+	dl_error_t err = dl_instance_store_ex( dl_ctx, type, instance, 0x0, 0, &size, store_params );
+	if( err != DL_ERROR_OK )
+		return err;
+
+	unsigned char* data = (unsigned char*)malloc( size );
+	if( data == 0x0 )
+		return DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+	err = dl_instance_store_ex( dl_ctx, type, instance, data, size, 0x0, store_params );
+
+	if( err == DL_ERROR_OK && compress )
+	{
+		size_t compressed_size = 0;
+		unsigned char* compressed = 0x0;
+		err = dl_compress( dl_ctx, data, size, 0x0, 0, &compressed_size );
+		if( err == DL_ERROR_OK )
+		{
+			compressed = (unsigned char*)malloc( compressed_size );
+			if( compressed == 0x0 )
+				err = DL_ERROR_OUT_OF_LIBRARY_MEMORY;
+		}
+		if( err == DL_ERROR_OK )
+			err = dl_compress( dl_ctx, data, size, compressed, compressed_size, 0x0 );
+
+		M_VERBOSE_OUTPUT( "Compressed %u bytes to %u bytes", (unsigned int)size, (unsigned int)compressed_size );
+		free( data );
+		data = compressed;
+		size = compressed_size;
+	}
+
+	if( err != DL_ERROR_OK )
+	{
+		free( data );
+		return err;
+	}
+
+	*out_data = data;
+	*out_size = size;
+	return DL_ERROR_OK;
+}
+
+/*
+	Pack all input files, text or binary, and write them as one archive to out_file_path.
+	Each instance is named by the path it was read from.
+*/
+int pack_archive( dl_ctx_t dl_ctx, const char** in_file_paths, unsigned int num_in_files, const char* out_file_path, dl_endian_t out_endian, unsigned int out_ptr_size, int compress, unsigned int store_flags )
+{
+	const unsigned char** packed       = (const unsigned char**)malloc( sizeof(unsigned char*) * ( num_in_files + 1 ) );
+	size_t*               packed_sizes = (size_t*)malloc( sizeof(size_t) * ( num_in_files + 1 ) );
+	unsigned int          num_packed   = 0;
+
+	dl_store_params_t store_params;
+	DL_STORE_PARAMS_SET_DEFAULT( store_params );
+	store_params.target_endian   = out_endian;
+	store_params.target_ptr_size = out_ptr_size;
+	store_params.flags           = store_flags;
+
+	dl_error_t err = DL_ERROR_OK;
+	for( ; num_packed < num_in_files; ++num_packed )
+	{
+		M_VERBOSE_OUTPUT( "Adding %s to archive", in_file_paths[num_packed] );
+
+		dl_typeid_t type;
+		void* instance = 0x0;
+		err = dl_util_load_from_file( dl_ctx, 0, in_file_paths[num_packed], DL_UTIL_FILE_TYPE_AUTO, &instance, &type, 0x0 );
+		if( err != DL_ERROR_OK )
+		{
+			fprintf( stderr, "Error: DL error reading %s: %s\n", in_file_paths[num_packed], dl_error_to_string( err ) );
+			break;
+		}
+
+		unsigned char* data = 0x0;
+		size_t         size = 0;
+		err = store_instance( dl_ctx, type, instance, &store_params, compress, &data, &size );
+		free( instance );
+
+		if( err != DL_ERROR_OK )
+		{
+			fprintf( stderr, "Error: DL error packing %s: %s\n", in_file_paths[num_packed], dl_error_to_string( err ) );
+			break;
+		}
+
+		packed[num_packed]       = data;
+		packed_sizes[num_packed] = size;
+	}
+
+	if( err == DL_ERROR_OK )
+	{
+		err = dl_util_archive_write( out_file_path, in_file_paths, packed, packed_sizes, num_in_files, out_endian );
+		if( err != DL_ERROR_OK )
+			fprintf( stderr, "Error: DL error writing archive %s: %s\n", out_file_path, dl_error_to_string( err ) );
+	}
+
+	for( unsigned int i = 0; i < num_packed; ++i )
+		free( (void*)packed[i] );
+	free( packed );
+	free( packed_sizes );
+
+	return err == DL_ERROR_OK ? 0 : 1;
+}
+
 int main( int argc, const char** argv )
 {
-	int show_info = 0;
-	int do_unpack = 0;
+	int show_info  = 0;
+	int do_unpack  = 0;
+	int do_archive = 0;
+	int compress   = 0;
+	int checksum   = 0;
+	int fingerprint = 0;
+	int canonical   = 0;
 
 	static const getopt_option_t option_list[] =
 	{
@@ -141,6 +253,11 @@ int main( int argc, const char** argv )
 		{ "ptrsize", 'p', GETOPT_OPTION_TYPE_REQUIRED, 0x0,        'p', "ptr-size of output data, if not specified pack-platform is assumed", "4,8" },
 		{ "unpack",  'u', GETOPT_OPTION_TYPE_FLAG_SET, &do_unpack,   1, "force dl_pack to treat input data as a packed instance that should be unpacked.", 0x0 },
 		{ "info",    'i', GETOPT_OPTION_TYPE_FLAG_SET, &show_info,   1, "make dl_pack show info about a packed instance.", 0x0 },
+		{ "compress",'c', GETOPT_OPTION_TYPE_FLAG_SET, &compress,    1, "compress packed output with the built-in block-compressor.", 0x0 },
+		{ "checksum",'k', GETOPT_OPTION_TYPE_FLAG_SET, &checksum,    1, "store a CRC32C-checksum of the instance-data in packed output.", 0x0 },
+		{ "fingerprint",'f', GETOPT_OPTION_TYPE_FLAG_SET, &fingerprint, 1, "store the layout-fingerprint of the root-type in packed output.", 0x0 },
+		{ "canonical",'C', GETOPT_OPTION_TYPE_FLAG_SET, &canonical,   1, "write padding and unused bits as zero so that equal instances give equal packed output.", 0x0 },
+		{ "archive", 'a', GETOPT_OPTION_TYPE_FLAG_SET, &do_archive,  1, "pack all input-files into one archive written to output, instances are named by input-path.", 0x0 },
 		{ "verbose", 'v', GETOPT_OPTION_TYPE_FLAG_SET, &g_Verbose,   1, "verbose output", 0x0 },
 		GETOPT_OPTIONS_END
 	};
@@ -151,6 +268,8 @@ int main( int argc, const char** argv )
 	add_lib_path("");
 	const char*  out_file_path  = "";
 	const char*  in_file_path   = "";
+	const char** in_file_paths  = (const char**)malloc( sizeof(const char*) * (size_t)argc );
+	unsigned int num_in_files   = 0;
 	dl_endian_t  out_endian     = DL_ENDIAN_HOST;
 	unsigned int out_ptr_size   = sizeof(void*);
 
@@ -185,15 +304,38 @@ int main( int argc, const char** argv )
 			case '!': M_ERROR_AND_QUIT("incorrect usage of flag \"%s\"!", go_ctx.current_opt_arg); break;
 			case '?': M_ERROR_AND_QUIT("unrecognized flag \"%s\"!", go_ctx.current_opt_arg); break;
 			case '+':
-				if(in_file_path[0] != '\0')
-					M_ERROR_AND_QUIT("input-file already set to: \"%s\", trying to set it to \"%s\"", in_file_path, go_ctx.current_opt_arg);
-
-				in_file_path = go_ctx.current_opt_arg;
+				in_file_paths[num_in_files++] = go_ctx.current_opt_arg;
 				break;
 			case 0: break; // ignore, flag was set!
 		}
 	}
 
+	unsigned int store_flags = DL_STOREFLAGS_NONE;
+	if( checksum )    store_flags |= DL_STOREFLAGS_CHECKSUM;
+	if( fingerprint ) store_flags |= DL_STOREFLAGS_LAYOUT_FINGERPRINT;
+	if( canonical )   store_flags |= DL_STOREFLAGS_CANONICAL;
+
+	if( do_archive )
+	{
+		if( out_file_path[0] == '\0' )
+			M_ERROR_AND_QUIT( "an output-file is required when building an archive!" );
+
+		dl_ctx_t dl_ctx = create_ctx();
+		if( dl_ctx == 0x0 )
+			return 1;
+
+		int res = pack_archive( dl_ctx, in_file_paths, num_in_files, out_file_path, out_endian, out_ptr_size, compress, store_flags );
+		dl_context_destroy( dl_ctx );
+		free( in_file_paths );
+		return res;
+	}
+
+	if( num_in_files > 1 )
+		M_ERROR_AND_QUIT("input-file already set to: \"%s\", trying to set it to \"%s\"", in_file_paths[0], in_file_paths[1]);
+	if( num_in_files == 1 )
+		in_file_path = in_file_paths[0];
+	free( in_file_paths );
+
 	FILE* in_file  = in_file_path[0]  == '\0' ? stdin  : fopen( in_file_path, "rb" );
 	FILE* out_file = out_file_path[0] == '\0' ? stdout : fopen( out_file_path, "wb" );
 	if( in_file  == 0x0 ) M_ERROR_AND_QUIT( "Could not open input file: %s", in_file_path );
@@ -218,6 +360,8 @@ int main( int argc, const char** argv )
 		printf( "ptr size: %u\n",         info.ptrsize );
 		printf( "endian:   %s\n",         info.endian == DL_ENDIAN_LITTLE ? "little" : "big" );
 		printf( "type:     %s (0x%8X)\n", tinfo.name, info.root_type );
+		if( info.layout_fingerprint != 0 )
+			printf( "layout:   0x%08X (%s)\n", info.layout_fingerprint, info.layout_fingerprint == tinfo.layout_fingerprint ? "matches loaded type-library" : "MISMATCH with loaded type-library" );
 
 		free( data );
 	}
@@ -230,14 +374,32 @@ int main( int argc, const char** argv )
 		if( err != DL_ERROR_OK )
 			M_ERROR_AND_QUIT( "DL error reading stream: %s", dl_error_to_string( err ) );
 
-		err = dl_util_store_to_stream( dl_ctx,
-									   type,
-									   out_file,
-									   do_unpack == 1 ? DL_UTIL_FILE_TYPE_TEXT : DL_UTIL_FILE_TYPE_BINARY,
-									   out_endian,
-									   out_ptr_size,
-									   instance,
-									   0x0 );
+		if( ( compress == 1 || store_flags != DL_STOREFLAGS_NONE ) && do_unpack == 0 )
+		{
+			dl_store_params_t store_params;
+			DL_STORE_PARAMS_SET_DEFAULT( store_params );
+			store_params.target_endian   = out_endian;
+			store_params.target_ptr_size = out_ptr_size;
+			store_params.flags           = store_flags;
+
+			unsigned char* data = 0x0;
+			size_t         size = 0;
+			err = store_instance( dl_ctx, type, instance, &store_params, compress, &data, &size );
+			if( err == DL_ERROR_OK )
+			{
+				fwrite( data, size, 1, out_file );
+				free( data );
+			}
+		}
+		else
+			err = dl_util_store_to_stream( dl_ctx,
+										   type,
+										   out_file,
+										   do_unpack == 1 ? DL_UTIL_FILE_TYPE_TEXT : DL_UTIL_FILE_TYPE_BINARY,
+										   out_endian,
+										   out_ptr_size,
+										   instance,
+										   0x0 );
 
 		if( err != DL_ERROR_OK )
 			M_ERROR_AND_QUIT( "DL error writing stream: %s", dl_error_to_string( err ) );